@@ -55,6 +55,7 @@ class IPluginPrivate;
  * X-KDevelop-Category=
  * X-KDevelop-Mode=GUI
  * X-KDevelop-LoadMode=
+ * X-KDevelop-Deferred=
  * X-KDevelop-Languages=
  * X-KDevelop-SupportedMimeTypes=
  * X-KDevelop-Interfaces=
@@ -98,6 +99,8 @@ class IPluginPrivate;
  * explanation) (required);
  * - <i>X-KDevelop-LoadMode</i> can be set to AlwaysOn in which case the plugin will
  *   never be unloaded even if requested via the API. (optional);
+ * - <i>X-KDevelop-Deferred</i> can be set to true for global plugins that only provide tool views
+ *   or actions. They are created once the main window is usable, or earlier when they are needed (optional);
  *
  * Plugin scope can be either:
  * - Global
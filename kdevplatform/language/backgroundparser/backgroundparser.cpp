@@ -8,15 +8,22 @@
 
 #include "backgroundparser.h"
 
+#include <QCache>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QList>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QPointer>
+#include <QQueue>
 #include <QRecursiveMutex>
 #include <QTimer>
 #include <QThread>
 
+#include <algorithm>
+#include <tuple>
+
 #include <KConfigGroup>
 #include <KLocalizedString>
 #include <KSharedConfig>
@@ -37,12 +44,25 @@
 #include <debug.h>
 
 #include "parsejob.h"
+#include "duchain/duchain.h"
+#include "duchain/duchainlock.h"
+#include "duchain/memorygovernor.h"
+#include "duchain/parsingenvironment.h"
 
 using namespace KDevelop;
 
 namespace {
 const bool separateThreadForHighPriority = true;
 
+// How many queued documents of one priority are compared against each other when picking the next one
+const int maxSchedulingCandidates = 64;
+// How many included files are remembered per document for scheduling
+const int maxRememberedIncludes = 128;
+// How many finished documents count as "recent" when looking for header reuse
+const int maxRecentDocuments = 16;
+// How many documents the run time of their last parse job is remembered for
+const int maxRememberedRunTimes = 4096;
+
 /**
  * Elides string in @p path, e.g. "VEEERY/LONG/PATH" -> ".../LONG/PATH"
  * - probably much faster than QFontMetrics::elidedText()
@@ -88,6 +108,69 @@ inline bool isValidURL(const IndexedString& url)
     QUrl cleaned = original.adjusted(QUrl::NormalizePathSegments);
     return original == cleaned;
 }
+
+/**
+ * @return the files transitively included by @p url according to the DUChain, as far as it knows them
+ *
+ * The DUChain must be read-locked.
+ */
+QVector<IndexedString> includedFiles(const IndexedString& url)
+{
+    QVector<IndexedString> ret;
+    QSet<IndexedString> visited{url};
+    QList<ParsingEnvironmentFilePointer> pending;
+    const auto files = DUChain::self()->allEnvironmentFiles(url);
+    for (const auto& file : files) {
+        if (file) {
+            pending += file->imports();
+        }
+    }
+
+    while (!pending.isEmpty() && ret.size() < maxRememberedIncludes) {
+        const auto file = pending.takeLast();
+        const auto fileUrl = file->url();
+        if (visited.contains(fileUrl)) {
+            continue;
+        }
+        visited.insert(fileUrl);
+        ret.append(fileUrl);
+        pending += file->imports();
+    }
+
+    return ret;
+}
+
+/**
+ * @return the fraction of the physical memory that is still available, or 1 if that cannot be determined
+ */
+double availableMemoryRatio()
+{
+#ifdef Q_OS_LINUX
+    QFile meminfo(QStringLiteral("/proc/meminfo"));
+    if (!meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return 1;
+    }
+
+    qint64 total = 0;
+    qint64 available = -1;
+    while (!meminfo.atEnd() && (total == 0 || available == -1)) {
+        const QByteArray line = meminfo.readLine();
+        const auto value = [&line]() {
+            return line.mid(line.indexOf(':') + 1).trimmed().split(' ').value(0).toLongLong();
+        };
+        if (line.startsWith("MemTotal:")) {
+            total = value();
+        } else if (line.startsWith("MemAvailable:")) {
+            available = value();
+        }
+    }
+
+    if (total > 0 && available >= 0) {
+        return static_cast<double>(available) / total;
+    }
+#endif
+    return 1;
+}
 }
 
 struct DocumentParseTarget
@@ -240,22 +323,60 @@ public:
         return bestRunningPriority;
     }
 
-    IndexedString nextDocumentToParse() const
+    /**
+     * How well a queued document fits the currently running parse jobs, greater is better.
+     *
+     * In order, that is: how few files it shares with the running jobs, which would otherwise wait
+     * for each other to update the shared headers, how many files it shares with recently finished
+     * jobs, whose contexts are still loaded and up to date, and how long it took to parse last time,
+     * so that the longest documents get started first and do not end up alone on the critical path.
+     */
+    using SchedulingScore = std::tuple<int, int, qint64>;
+
+    SchedulingScore schedulingScore(const IndexedString& url, const QSet<IndexedString>& runningIncludes) const
+    {
+        const auto* runTime = m_runTimes.object(url);
+        int conflicts = runningIncludes.contains(url) ? 1 : 0;
+        int reuse = 0;
+        for (const auto& include : m_includes.value(url)) {
+            if (runningIncludes.contains(include)) {
+                ++conflicts;
+            }
+            reuse += m_recentIncludes.value(include);
+        }
+        return {-conflicts, reuse, runTime ? *runTime : -1};
+    }
+
+    IndexedString nextDocumentToParse(int threads) const
     {
         // Before starting a new job, first wait for all higher-priority ones to finish.
         // That way, parse job priorities can be used for dependency handling.
         const int bestRunningPriority = currentBestRunningPriority();
 
+        QSet<IndexedString> runningIncludes;
+        for (auto it = m_parseJobs.constBegin(); it != m_parseJobs.constEnd(); ++it) {
+            runningIncludes.insert(it.key());
+            const auto includesIt = m_includes.constFind(it.key());
+            if (includesIt != m_includes.constEnd()) {
+                for (const auto& include : *includesIt) {
+                    runningIncludes.insert(include);
+                }
+            }
+        }
+
         for (auto it1 = m_documentsForPriority.begin();
              it1 != m_documentsForPriority.end(); ++it1) {
             const auto priority = it1.key();
             if (priority > m_neededPriority)
                 break; //The priority is not good enough to be processed right now
 
-            if (m_parseJobs.count() >= m_threads && priority > BackgroundParser::NormalPriority && !specialParseJob) {
+            if (m_parseJobs.count() >= threads && priority > BackgroundParser::NormalPriority && !specialParseJob) {
                 break; //The additional parsing thread is reserved for higher priority parsing
             }
 
+            IndexedString bestUrl;
+            SchedulingScore bestScore;
+            int candidates = 0;
             for (const auto& url : it1.value()) {
                 // When a document is scheduled for parsing while it is being parsed, it will be parsed
                 // again once the job finished, but not now.
@@ -272,13 +393,149 @@ public:
                     continue;
                 }
 
-                return url;
+                const auto score = schedulingScore(url, runningIncludes);
+                if (bestUrl.isEmpty() || bestScore < score) {
+                    bestUrl = url;
+                    bestScore = score;
+                }
+
+                // Don't compare thousands of documents each time a job gets created during project parsing
+                if (++candidates == maxSchedulingCandidates) {
+                    break;
+                }
+            }
+
+            if (!bestUrl.isEmpty()) {
+                return bestUrl;
             }
         }
 
         return {};
     }
 
+    /**
+     * @return how many parse jobs may run at once
+     *
+     * That is fewer than m_threads while the system is short of memory or the memory budget is exceeded,
+     * so that parsing a large project does not push it into swapping.
+     */
+    int availableThreadCount()
+    {
+        if (!m_memoryCheckTimer.isValid() || m_memoryCheckTimer.hasExpired(1000)) {
+            m_memoryCheckTimer.start();
+            m_availableMemoryRatio = availableMemoryRatio();
+        }
+
+        if (m_availableMemoryRatio < 0.05 || MemoryGovernor::self()->isUnderPressure()) {
+            return std::min(m_threads, 1);
+        } else if (m_availableMemoryRatio < 0.1) {
+            return std::min(m_threads, std::max(1, m_threads / 2));
+        }
+        return m_threads;
+    }
+
+    /**
+     * Look up which files the queued documents we know nothing about yet include.
+     *
+     * Only the documents that are considered by the next call to nextDocumentToParse() are looked at.
+     * Must be called without m_mutex held, as it locks the DUChain. It is called from the worker threads
+     * when a parse job ends, so that the foreground thread never waits for the DUChain lock here.
+     */
+    void updateSchedulingInfo()
+    {
+        QVector<IndexedString> unknown;
+        {
+            QMutexLocker lock(&m_mutex);
+            int candidates = 0;
+            for (auto it = m_documentsForPriority.constBegin();
+                 it != m_documentsForPriority.constEnd() && it.key() <= m_neededPriority
+                 && candidates < maxSchedulingCandidates; ++it) {
+                for (const auto& url : it.value()) {
+                    if (!m_includes.contains(url)) {
+                        unknown.append(url);
+                    }
+                    if (++candidates == maxSchedulingCandidates) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (unknown.isEmpty()) {
+            return;
+        }
+
+        QVector<QVector<IndexedString>> includes;
+        includes.reserve(unknown.size());
+        {
+            // don't hold up the worker thread behind a long-running write lock, we can still try next time
+            DUChainReadLocker lock(DUChain::lock(), 500);
+            if (!lock.locked()) {
+                return;
+            }
+            for (const auto& url : std::as_const(unknown)) {
+                includes.append(includedFiles(url));
+            }
+        }
+
+        QMutexLocker lock(&m_mutex);
+        for (int i = 0; i < unknown.size(); ++i) {
+            // the document may have been removed in the meantime
+            if (m_documents.contains(unknown[i])) {
+                m_includes.insert(unknown[i], includes[i]);
+            }
+        }
+    }
+
+    /**
+     * Drop the includes of @p url unless it is still queued, running or among the recent documents,
+     * so that m_includes does not grow with every document ever parsed.
+     *
+     * Must be called with m_mutex held.
+     */
+    void forgetSchedulingInfo(const IndexedString& url)
+    {
+        if (m_documents.contains(url) || m_parseJobs.contains(url)) {
+            return;
+        }
+        if (std::any_of(m_recentDocuments.cbegin(), m_recentDocuments.cend(), [&url](const RecentDocument& document) {
+                return document.url == url;
+            })) {
+            return;
+        }
+        m_includes.remove(url);
+    }
+
+    /**
+     * Remember how long the parse job for @p url took and which files it included.
+     *
+     * Must be called with m_mutex held.
+     */
+    void recordParseJob(const IndexedString& url, qint64 runTime, const QVector<IndexedString>& includes)
+    {
+        if (runTime >= 0) {
+            m_runTimes.insert(url, new qint64(runTime));
+        }
+        m_includes.insert(url, includes);
+
+        for (const auto& include : includes) {
+            ++m_recentIncludes[include];
+        }
+        m_recentDocuments.enqueue({url, includes});
+
+        while (m_recentDocuments.size() > maxRecentDocuments) {
+            // the includes of the document may have changed since, only take back what was counted
+            const auto oldDocument = m_recentDocuments.dequeue();
+            for (const auto& include : oldDocument.includes) {
+                auto countIt = m_recentIncludes.find(include);
+                if (countIt != m_recentIncludes.end() && --*countIt <= 0) {
+                    m_recentIncludes.erase(countIt);
+                }
+            }
+            forgetSchedulingInfo(oldDocument.url);
+        }
+    }
+
     /**
      * Create a single delayed parse job
      *
@@ -290,13 +547,15 @@ public:
         if (m_shuttingDown)
             return;
 
+        const int threads = availableThreadCount();
+
         //Only create parse-jobs for up to thread-count * 2 documents, so we don't fill the memory unnecessarily
-        if (m_parseJobs.count() >= m_threads + 1
-            || (m_parseJobs.count() >= m_threads && !separateThreadForHighPriority)) {
+        if (m_parseJobs.count() >= threads + 1
+            || (m_parseJobs.count() >= threads && !separateThreadForHighPriority)) {
             return;
         }
 
-        const auto& url = nextDocumentToParse();
+        const auto& url = nextDocumentToParse(threads);
         if (!url.isEmpty()) {
             qCDebug(LANGUAGE) << "creating parse-job" << url << "new count of active parse-jobs:" <<
                 m_parseJobs.count() + 1;
@@ -341,7 +600,7 @@ public:
             }
 
             if (decorator) {
-                if (m_parseJobs.count() == m_threads + 1 && !specialParseJob)
+                if (m_parseJobs.count() == threads + 1 && !specialParseJob)
                     specialParseJob = decorator; //This parse-job is allocated into the reserved thread
 
                 m_parseJobs.insert(url, decorator);
@@ -394,6 +653,27 @@ public:
 
             auto* decorator = new ThreadWeaver::QObjectDecorator(job);
 
+            // time the job on the worker thread, the queued done() below may be delayed
+            QObject::connect(decorator, &ThreadWeaver::QObjectDecorator::started, m_parser, [job] {
+                job->startRunTimer();
+            }, Qt::DirectConnection);
+            QObject::connect(decorator, &ThreadWeaver::QObjectDecorator::done, m_parser, [this, job] {
+                job->stopRunTimer();
+                // Still on the worker thread, so that the foreground thread does not wait for the DUChain lock.
+                // Time out rather than wait for a long-running write lock, e.g. while shutting down.
+                QVector<IndexedString> includes;
+                {
+                    DUChainReadLocker lock(DUChain::lock(), 500);
+                    if (lock.locked()) {
+                        includes = includedFiles(job->document());
+                    }
+                }
+                {
+                    QMutexLocker lock(&m_mutex);
+                    recordParseJob(job->document(), job->runTime(), includes);
+                }
+                updateSchedulingInfo();
+            }, Qt::DirectConnection);
             QObject::connect(decorator, &ThreadWeaver::QObjectDecorator::done,
                              m_parser, &BackgroundParser::parseComplete);
             QObject::connect(job, &ParseJob::progress,
@@ -443,6 +723,12 @@ public:
             m_parser->setThreadCount(BACKWARDS_COMPATIBLE_ENTRY("Number of Threads", QThread::idealThreadCount()));
         }
 
+        // in MiB, 0 picks a default depending on the physical memory
+        const qint64 memoryBudget = qEnvironmentVariableIsSet("KDEV_MEMORY_BUDGET")
+            ? qEnvironmentVariableIntValue("KDEV_MEMORY_BUDGET")
+            : config.readEntry("Memory Budget", 0);
+        MemoryGovernor::self()->setBudget(memoryBudget * 1024 * 1024);
+
         resume();
 
         if (BACKWARDS_COMPATIBLE_ENTRY("Enabled", true)) {
@@ -551,6 +837,25 @@ public:
     // Projects currently in progress of loading
     QSet<IProject*> m_loadingProjects;
 
+    // The files included by the queued, running and recent documents, see includedFiles()
+    QHash<IndexedString, QVector<IndexedString>> m_includes;
+    // How long the last parse job for a document ran in ns, kept independently of m_includes
+    // so that it is still known when the document gets queued again, e.g. on the next project load
+    QCache<IndexedString, qint64> m_runTimes{maxRememberedRunTimes};
+    // How many of the recently finished documents include a file
+    QHash<IndexedString, int> m_recentIncludes;
+    struct RecentDocument
+    {
+        IndexedString url;
+        // The includes counted in m_recentIncludes for this document
+        QVector<IndexedString> includes;
+    };
+    // The recently finished documents, oldest first
+    QQueue<RecentDocument> m_recentDocuments;
+
+    QElapsedTimer m_memoryCheckTimer;
+    double m_availableMemoryRatio = 1;
+
     ThreadWeaver::Queue m_weaver;
 
     // generic high-level mutex
@@ -596,6 +901,10 @@ BackgroundParser::BackgroundParser(ILanguageController* languageController)
     QObject::connect(ICore::self()->projectController(),
                      &IProjectController::projectOpeningAborted,
                      this, &BackgroundParser::projectOpeningAborted);
+
+    // start more parse jobs right away when the memory pressure is gone
+    QObject::connect(MemoryGovernor::self(), &MemoryGovernor::pressureChanged,
+                     this, &BackgroundParser::parseDocuments);
 }
 
 void BackgroundParser::aboutToQuit()
@@ -644,8 +953,10 @@ void BackgroundParser::revertAllRequests(QObject* notifyWhenReady)
         it->removeTargetsForListener(notifyWhenReady);
 
         if ((*it).targets().isEmpty()) {
+            const auto url = it.key();
             it = d->m_documents.erase(it);
             --d->m_maxParseJobs;
+            d->forgetSchedulingInfo(url);
 
             continue;
         }
@@ -690,6 +1001,7 @@ void BackgroundParser::removeDocument(const IndexedString& url, QObject* notifyW
         if (documentParsePlan.targets().isEmpty()) {
             d->m_documents.erase(documentParsePlanIt);
             --d->m_maxParseJobs;
+            d->forgetSchedulingInfo(url);
         } else {
             //Insert with an eventually different priority
             d->m_documentsForPriority[documentParsePlan.priority()].insert(url);
@@ -705,6 +1017,7 @@ void BackgroundParser::parseDocuments()
         startTimer(d->m_delay);
         return;
     }
+
     QMutexLocker lock(&d->m_mutex);
 
     d->parseDocumentsInternal();
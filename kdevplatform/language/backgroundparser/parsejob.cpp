@@ -7,11 +7,14 @@
 
 #include "parsejob.h"
 
+#include <QElapsedTimer>
 #include <QFile>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QStandardPaths>
 
+#include <array>
+
 #include <KLocalizedString>
 #include <KFormat>
 #include <KTextEditor/Document>
@@ -82,6 +85,13 @@ public:
     int parsePriority;
     ParseJob::SequentialProcessingFlags sequentialProcessingFlags;
     qint64 maximumFileSize;
+
+    // the job is constructed on the main thread and then runs on a single worker thread,
+    // the thread pool orders these accesses
+    std::array<qint64, ParseJob::PhaseCount> phaseTimes = {};
+    // started and stopped by the background parser from the worker thread
+    QElapsedTimer runTimer;
+    qint64 runTime = -1;
 };
 
 ParseJob::ParseJob(const IndexedString& url, KDevelop::ILanguageSupport* languageSupport)
@@ -206,6 +216,41 @@ TopDUContext::Features ParseJob::minimumFeatures() const
     return d->features | staticMinimumFeatures(d->url);
 }
 
+void ParseJob::addPhaseTime(Phase phase, qint64 nanoseconds)
+{
+    Q_D(ParseJob);
+
+    d->phaseTimes[phase] += nanoseconds;
+}
+
+qint64 ParseJob::phaseTime(Phase phase) const
+{
+    Q_D(const ParseJob);
+
+    return d->phaseTimes[phase];
+}
+
+qint64 ParseJob::runTime() const
+{
+    Q_D(const ParseJob);
+
+    return d->runTime;
+}
+
+void ParseJob::startRunTimer()
+{
+    Q_D(ParseJob);
+
+    d->runTimer.start();
+}
+
+void ParseJob::stopRunTimer()
+{
+    Q_D(ParseJob);
+
+    d->runTime = d->runTimer.nsecsElapsed();
+}
+
 void ParseJob::setDuChain(const ReferencedTopDUContext& duChain)
 {
     Q_D(ParseJob);
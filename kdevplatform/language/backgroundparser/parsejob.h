@@ -173,6 +173,25 @@ public:
     /// Returns whether there is minimum features set up for some url
     static bool hasStaticMinimumFeatures();
 
+    /// Parts of a parse job whose wall time language plugins can record with addPhaseTime().
+    enum Phase {
+        ResolveEnvironmentPhase, ///< Looking up the defines, include paths and other parser settings
+        ParsePhase, ///< Running the parser of the language
+        BuildDUChainPhase, ///< Building the DUChain from the parse result
+        PhaseCount
+    };
+
+    /// Adds @p nanoseconds to the wall time spent in @p phase.
+    /// This is only used for reporting, e.g. by the benchmark mode of duchainify.
+    void addPhaseTime(Phase phase, qint64 nanoseconds);
+
+    /// @returns the wall time in nanoseconds that was recorded for @p phase.
+    qint64 phaseTime(Phase phase) const;
+
+    /// @returns the wall time in nanoseconds between the start of this job on a worker thread and its end,
+    ///          or -1 if the job has not finished running.
+    qint64 runTime() const;
+
     ///Returns a structure containing information about data accesses in the parsed file.
     /// It's up to the caller to remove the returned instance
     virtual KDevelop::DataAccessRepository* dataAccessInformation();
@@ -228,6 +247,12 @@ protected:
     bool hasTracker() const;
 
 private:
+    friend class BackgroundParserPrivate;
+
+    // Called by the background parser on the worker thread when the job starts and ends, see runTime()
+    void startRunTimer();
+    void stopRunTimer();
+
     const QScopedPointer<class ParseJobPrivate> d_ptr;
     Q_DECLARE_PRIVATE(ParseJob)
 };
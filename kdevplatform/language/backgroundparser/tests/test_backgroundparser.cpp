@@ -289,6 +289,37 @@ void TestBackgroundparser::testParseOrdering_simple()
     QVERIFY(m_jobPlan.runJobs(1000));
 }
 
+void TestBackgroundparser::testParseOrdering_longestFirst()
+{
+    m_jobPlan.clear();
+    // documents of equal priority, one of which takes much longer to parse than the others
+    const IndexedString slowUrl(QUrl::fromLocalFile(QStringLiteral("/test_lf__slow.txt")));
+    m_jobPlan.addJob(JobPrototype(slowUrl.toUrl(), BackgroundParser::NormalPriority,
+                                  ParseJob::IgnoresSequentialProcessing, 200));
+    for (int i = 0; i < 8; ++i) {
+        m_jobPlan.addJob(JobPrototype(QUrl::fromLocalFile("/test_lf__" + QString::number(i) + ".txt"),
+                                      BackgroundParser::NormalPriority, ParseJob::IgnoresSequentialProcessing, 10));
+    }
+    QVERIFY(m_jobPlan.runJobs(1000));
+    const auto jobs = m_jobPlan.m_jobs;
+
+    // parse more documents than are kept as recent ones, so that the run time must be remembered beyond those
+    m_jobPlan.clear();
+    for (int i = 0; i < 40; ++i) {
+        m_jobPlan.addJob(JobPrototype(QUrl::fromLocalFile("/test_lf__other" + QString::number(i) + ".txt"),
+                                      BackgroundParser::NormalPriority, ParseJob::IgnoresSequentialProcessing, 10));
+    }
+    QVERIFY(m_jobPlan.runJobs(1000));
+
+    // once its run time is known, the slow document gets started first
+    m_jobPlan.clear();
+    for (const JobPrototype& job : jobs) {
+        m_jobPlan.addJob(job);
+    }
+    QVERIFY(m_jobPlan.runJobs(1000));
+    QCOMPARE(m_jobPlan.m_createdJobs.first(), slowUrl);
+}
+
 void TestBackgroundparser::benchmark()
 {
     const int jobs = 10000;
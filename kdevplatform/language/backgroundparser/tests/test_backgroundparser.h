@@ -93,6 +93,7 @@ private Q_SLOTS:
     void testParseOrdering_lockup();
     void testParseOrdering_foregroundThread();
     void testParseOrdering_noSequentialProcessing();
+    void testParseOrdering_longestFirst();
 
     void testNoDeadlockInJobCreation();
     void testSuspendResume();
@@ -21,6 +21,7 @@
 #include "ducontextdata.h"
 #include "declarationid.h"
 #include "uses.h"
+#include "parsingenvironment.h"
 #include <serialization/indexedstring.h>
 #include "duchainregister.h"
 #include "persistentsymboltable.h"
@@ -687,13 +688,29 @@ QMap<IndexedString, QVector<RangeInRevision>> Declaration::uses() const
     }
 
     DeclarationId _id = id();
+    KDevVarLengthArray<DeclarationId> ids;
+    ids.append(_id);
     KDevVarLengthArray<IndexedTopDUContext> useContexts = DUChain::uses()->uses(_id);
     if (!_id.isDirect()) { // also check uses based on direct IDs
-        KDevVarLengthArray<IndexedTopDUContext> directUseContexts = DUChain::uses()->uses(id(true));
+        ids.append(id(true));
+        KDevVarLengthArray<IndexedTopDUContext> directUseContexts = DUChain::uses()->uses(ids.back());
         useContexts.append(directUseContexts.data(), directUseContexts.size());
     }
 
     for (const IndexedTopDUContext indexedContext : std::as_const(useContexts)) {
+        // take the recorded use ranges where possible, that spares loading the top-context
+        if (DUChain::uses()->hasIndexedUseRanges(indexedContext)) {
+            const auto file = DUChain::self()->environmentFileForDocument(indexedContext);
+            QMap<RangeInRevision, bool>& ranges(tempUses[file->url()]);
+            for (const DeclarationId& usedId : std::as_const(ids)) {
+                const auto useRanges = DUChain::uses()->useRanges(usedId, indexedContext);
+                for (const RangeInRevision range : useRanges) {
+                    ranges[range] = true;
+                }
+            }
+            continue;
+        }
+
         TopDUContext* context = indexedContext.data();
         if (context) {
             QMap<RangeInRevision, bool>& ranges(tempUses[context->url()]);
@@ -9,6 +9,7 @@
 #include "duchainlock.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QHash>
 #include <QMultiMap>
 #include <QProcessEnvironment>
@@ -19,9 +20,12 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QRecursiveMutex>
+#include <QTextStream>
 #include <QTimer>
 #include <QRandomGenerator>
 
+#include <algorithm>
+
 #include <interfaces/idocumentcontroller.h>
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
@@ -50,6 +54,7 @@
 #include "waitforupdate.h"
 #include "importers.h"
 #include "codemodel.h"
+#include "memorygovernor.h"
 
 #if HAVE_MALLOC_TRIM
 #include "malloc.h"
@@ -63,6 +68,10 @@ namespace {
 //short times, which leads to no lockup in the UI.
 const int SOFT_CLEANUP_STEPS = 1;
 
+///In ms, how long DUChain::releaseMemory waits after a release that freed nothing, doubled each time
+const qint64 minMemoryReleaseBackoff = 10 * 1000;
+const qint64 maxMemoryReleaseBackoff = 5 * 60 * 1000;
+
 // seconds to wait before trying to cleanup the DUChain
 const uint cleanupEverySeconds = 200;
 
@@ -79,6 +88,8 @@ bool DUChain::m_deleted = false;
 ///This lock should be locked only for very short times
 QMutex DUChain::chainsByIndexLock;
 std::vector<TopDUContext*> DUChain::chainsByIndex;
+std::vector<quint64> DUChain::chainsLastUsed;
+quint64 DUChain::chainsUseTick = 0;
 
 //This thing is not actually used, but it's needed for compiling
 DEFINE_LIST_MEMBER_HASH(EnvironmentInformationListItem, items, uint)
@@ -352,6 +363,14 @@ private:
                     //Just to make sure the cache is cleared periodically
                     ModificationRevisionSet::clearCache();
 
+                    //Release unused repository space first, so that the following store already truncates the files
+                    if (!m_data->m_cleanupDisabled) {
+                        const qint64 reclaimed = globalItemRepositoryRegistry().compact();
+                        if (reclaimed) {
+                            qCDebug(LANGUAGE) << "repository compaction reclaims" << reclaimed << "bytes";
+                        }
+                    }
+
                     m_data->doMoreCleanup(SOFT_CLEANUP_STEPS, TryLock);
                 });
             timer.start(cleanupEverySeconds * 1000);
@@ -514,6 +533,11 @@ public:
 
     bool m_destroyed;
 
+    ///When DUChain::releaseMemory may try again after a release that freed nothing, in ms since the epoch
+    ///Only used from the memory governor thread
+    qint64 m_nextMemoryRelease = 0;
+    qint64 m_memoryReleaseBackoff = 0;
+
     ///The item must not be stored yet
     ///m_chainsMutex should not be locked, since this can trigger I/O
     void addEnvironmentInformation(ParsingEnvironmentFilePointer info)
@@ -773,6 +797,85 @@ public:
 
     QRecursiveMutex& cleanupMutex() { return m_cleanupMutex; }
 
+    ///Returns whether @p top can be unloaded without unloading anything else: It is neither referenced,
+    ///nor imported by a referenced or another loaded top-context
+    ///The duchain must be write-locked
+    bool isSeparatelyUnloadable(TopDUContext* top)
+    {
+        if (!top->loadedImporters().isEmpty()) {
+            return false;
+        }
+
+        QMutexLocker l(&m_referenceCountsMutex);
+        for (auto it = m_referenceCounts.constBegin(), end = m_referenceCounts.constEnd(); it != end; ++it) {
+            auto* context = it.key();
+            if (context == top || context->imports(top, CursorInRevision())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///Returns the least recently used separately unloadable top-contexts that together take about @p bytes
+    ///m_chainsMutex must be locked, and the duchain must be write-locked
+    QSet<TopDUContext*> leastRecentlyUsedChains(qint64 bytes)
+    {
+        std::vector<std::pair<quint64, TopDUContext*>> chains;
+        chains.reserve(m_chainsByUrl.size());
+        {
+            QMutexLocker lock(&DUChain::chainsByIndexLock);
+            for (TopDUContext* top : std::as_const(m_chainsByUrl)) {
+                chains.emplace_back(DUChain::chainsLastUsed[top->ownIndex()], top);
+            }
+        }
+        chains.erase(std::remove_if(chains.begin(), chains.end(), [this](const auto& chain) {
+            return !isSeparatelyUnloadable(chain.second);
+        }), chains.end());
+        std::sort(chains.begin(), chains.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+
+        QSet<TopDUContext*> ret;
+        for (const auto& chain : chains) {
+            if (bytes <= 0) {
+                break;
+            }
+            bytes -= chain.second->m_dynamicData->allocatedMemory();
+            ret.insert(chain.second);
+        }
+        return ret;
+    }
+
+    ///Stores all repositories and the static duchain data to disk
+    ///This must be the last step of a cleanup, due to the on-disk reference counting
+    void storeRepositories()
+    {
+        globalItemRepositoryRegistry().store(); //Stores all repositories
+
+        {
+            //Store the static parsing-environment file data
+            ///@todo Solve this more elegantly, using a general mechanism to store static duchain-like data
+            Q_ASSERT(ParsingEnvironmentFile::m_staticData);
+            QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/parsing_environment_data"));
+            bool opened = f.open(QIODevice::WriteOnly);
+            Q_ASSERT(opened);
+            Q_UNUSED(opened);
+            f.write(reinterpret_cast<const char*>(ParsingEnvironmentFile::m_staticData), sizeof(StaticParsingEnvironmentData));
+        }
+
+        ///Write out the list of available top-context indices
+        {
+            QMutexLocker lock(&m_chainsMutex);
+
+            QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/available_top_context_indices"));
+            bool opened = f.open(QIODevice::WriteOnly);
+            Q_ASSERT(opened);
+            Q_UNUSED(opened);
+
+            f.write(reinterpret_cast<const char*>(m_availableTopContextIndices.data()), m_availableTopContextIndices.size() * sizeof(uint));
+        }
+    }
+
     /// defines how we interact with the ongoing language parse jobs
     enum LockFlag {
         /// no locking required, only used when we locked previously
@@ -786,20 +889,32 @@ public:
     ///doing the cleanup without permanently locking the du-chain. During these steps the consistency
     ///of the disk-storage is not guaranteed, but only few changes will be done during these steps,
     ///so the final step where the duchain is permanently locked is much faster.
-    void doMoreCleanup(int retries = 0, LockFlag lockFlag = BlockingLock)
+    ///@param unloadBytes When this is not negative, only the least recently used top-contexts taking about this
+    ///many bytes are stored and unloaded, and only if no other loaded top-context imports them.
+    ///When none of them can be unloaded, nothing is done at all.
+    ///@return the estimated bytes of the unloaded top-contexts
+    qint64 doMoreCleanup(int retries = 0, LockFlag lockFlag = BlockingLock, qint64 unloadBytes = -1)
     {
         if (m_cleanupDisabled)
-            return;
+            return 0;
 
         //This mutex makes sure that there's never 2 threads at he same time trying to clean up
         QMutexLocker lockCleanupMutex(&cleanupMutex());
 
         if (m_destroyed || m_cleanupDisabled)
-            return;
+            return 0;
 
         Q_ASSERT(!instance->lock()->currentThreadHasReadLock() && !instance->lock()->currentThreadHasWriteLock());
         DUChainWriteLocker writeLock(instance->lock());
 
+        if (unloadBytes >= 0) {
+            //Don't stop the parsing and store everything when there is nothing to unload
+            QMutexLocker l(&m_chainsMutex);
+            if (unloadBytes == 0 || leastRecentlyUsedChains(unloadBytes).isEmpty()) {
+                return 0;
+            }
+        }
+
         //This is used to stop all parsing before starting to do the cleanup. This way less happens during the
         //soft cleanups, and we have a good chance that during the "hard" cleanup only few data has to be written.
         QList<QReadWriteLock*> locked;
@@ -823,7 +938,7 @@ public:
                             lock->unlock();
                         }
 
-                        return;
+                        return 0;
                     }
                 } else {
                     language->parseLock()->lockForWrite();
@@ -847,10 +962,14 @@ public:
         {
             QMutexLocker l(&m_chainsMutex);
 
-            workOnContexts.reserve(m_chainsByUrl.size());
-            for (TopDUContext* top : std::as_const(m_chainsByUrl)) {
-                workOnContexts << top;
-                Q_ASSERT(hasChainForIndex(top->ownIndex()));
+            if (unloadBytes >= 0) {
+                workOnContexts = leastRecentlyUsedChains(unloadBytes);
+            } else {
+                workOnContexts.reserve(m_chainsByUrl.size());
+                for (TopDUContext* top : std::as_const(m_chainsByUrl)) {
+                    workOnContexts << top;
+                    Q_ASSERT(hasChainForIndex(top->ownIndex()));
+                }
             }
         }
 
@@ -869,8 +988,11 @@ public:
         //Unload all top-contexts that don't have a reference-count and that are not imported by a referenced one
 
         bool unloadedOne = true;
+        qint64 unloadedBytes = 0;
+        int unloadedCount = 0;
 
-        bool unloadAllUnreferenced = !retries;
+        //Unloading only some contexts must not unload ones that stay imported by others
+        bool unloadAllUnreferenced = !retries && unloadBytes < 0;
 
         //Now unload contexts, but only ones that are not imported by any other currently loaded context
         //The complication: Since during the lock-break new references may be added, we must never keep
@@ -914,6 +1036,8 @@ unloadContexts:
                 //If nothing has changed, it is only a low-cost call.
                 unload->m_dynamicData->store();
                 Q_ASSERT(!unload->d_func()->m_dynamic);
+                unloadedBytes += unload->m_dynamicData->allocatedMemory();
+                ++unloadedCount;
                 removeDocumentChainFromMemory(unload);
                 workOnContexts.remove(unload);
                 unloadedOne = true;
@@ -927,7 +1051,7 @@ unloadContexts:
                 }
             }
 
-            if (hadUnloadable && !unloadedOne) {
+            if (hadUnloadable && !unloadedOne && unloadBytes < 0) {
                 Q_ASSERT(!unloadAllUnreferenced);
                 //This can happen in case of loops. We have o unload everything at one time.
                 qCDebug(LANGUAGE) << "found" << hadUnloadable <<
@@ -961,34 +1085,14 @@ unloadContexts:
         if (retries)
             writeLock.unlock();
 
-        //This must be the last step, due to the on-disk reference counting
-        globalItemRepositoryRegistry().store(); //Stores all repositories
-
-        {
-            //Store the static parsing-environment file data
-            ///@todo Solve this more elegantly, using a general mechanism to store static duchain-like data
-            Q_ASSERT(ParsingEnvironmentFile::m_staticData);
-            QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/parsing_environment_data"));
-            bool opened = f.open(QIODevice::WriteOnly);
-            Q_ASSERT(opened);
-            Q_UNUSED(opened);
-            f.write(reinterpret_cast<const char*>(ParsingEnvironmentFile::m_staticData), sizeof(StaticParsingEnvironmentData));
-        }
-
-        ///Write out the list of available top-context indices
-        {
-            QMutexLocker lock(&m_chainsMutex);
-
-            QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/available_top_context_indices"));
-            bool opened = f.open(QIODevice::WriteOnly);
-            Q_ASSERT(opened);
-            Q_UNUSED(opened);
-
-            f.write(reinterpret_cast<const char*>(m_availableTopContextIndices.data()), m_availableTopContextIndices.size() * sizeof(uint));
+        //When only some top-contexts should have been unloaded but none was, the disk state is not affected
+        if (unloadBytes < 0 || unloadedCount) {
+            storeRepositories();
         }
 
         if (retries) {
-            doMoreCleanup(retries - 1, NoLock);
+            const qint64 remainingBytes = unloadBytes < 0 ? -1 : std::max<qint64>(unloadBytes - unloadedBytes, 0);
+            unloadedBytes += doMoreCleanup(retries - 1, NoLock, remainingBytes);
             writeLock.lock();
         }
 
@@ -1010,6 +1114,8 @@ unloadContexts:
         // see: https://sourceware.org/bugzilla/show_bug.cgi?id=14827
         malloc_trim(50 * 1024 * 1024);
 #endif
+
+        return unloadedBytes;
     }
 
     ///Checks whether the information is already loaded.
@@ -1296,6 +1402,25 @@ void DUChain::initialize()
     globalIndexedImportIdentifier();
     globalAliasIdentifier();
     globalIndexedAliasIdentifier();
+
+    auto* governor = MemoryGovernor::self();
+    governor->registerConsumer(QStringLiteral("DUChain"), []() -> qint64 {
+        // don't wait for parse jobs holding a write-lock, the last sample is good enough meanwhile
+        DUChainReadLocker lock(DUChain::lock(), 100);
+        return lock.locked() ? DUChain::self()->allocatedMemory() : -1;
+    }, [](qint64 bytes) {
+        DUChain::self()->releaseMemory(bytes);
+    });
+    // released while the unloaded top-contexts are stored
+    governor->registerConsumer(QStringLiteral("Item repositories"), []() {
+        return globalItemRepositoryRegistry().allocatedMemory();
+    });
+    governor->registerConsumer(QStringLiteral("Symbol table cache"), []() -> qint64 {
+        const auto statistics = PersistentSymbolTable::self().cacheStatistics();
+        return statistics.declarations.usedMemory + statistics.imports.usedMemory;
+    }, [](qint64 bytes) {
+        PersistentSymbolTable::self().releaseCacheMemory(static_cast<std::size_t>(std::max<qint64>(bytes, 0)));
+    });
 }
 
 DUChainLock* DUChain::lock()
@@ -1325,6 +1450,8 @@ void DUChain::removeDocumentChain(TopDUContext* context)
     ENSURE_CHAIN_WRITE_LOCKED;
     IndexedTopDUContext indexed(context->indexed());
     Q_ASSERT(indexed.data() == context); ///This assertion fails if you call removeDocumentChain(..) on a document that has not been added to the du-chain
+    // the index may be reused by another top-context later on
+    uses()->removeUseRanges(indexed);
     context->m_dynamicData->deleteOnDisk();
     Q_ASSERT(indexed.data() == context);
     sdDUChainPrivate->removeDocumentChainFromMemory(context);
@@ -1346,10 +1473,13 @@ void DUChain::addDocumentChain(TopDUContext* chain)
 
     {
         QMutexLocker lock(&DUChain::chainsByIndexLock);
-        if (DUChain::chainsByIndex.size() <= chain->ownIndex())
+        if (DUChain::chainsByIndex.size() <= chain->ownIndex()) {
             DUChain::chainsByIndex.resize(chain->ownIndex() + 100, nullptr);
+            DUChain::chainsLastUsed.resize(chain->ownIndex() + 100, 0);
+        }
 
         DUChain::chainsByIndex[chain->ownIndex()] = chain;
+        DUChain::chainsLastUsed[chain->ownIndex()] = ++DUChain::chainsUseTick;
     }
     {
         Q_ASSERT(DUChain::chainsByIndex[chain->ownIndex()]);
@@ -1414,6 +1544,44 @@ bool DUChain::isInMemory(uint topContextIndex) const
     return DUChainPrivate::hasChainForIndex(topContextIndex);
 }
 
+qint64 DUChain::allocatedMemory() const
+{
+    ENSURE_CHAIN_READ_LOCKED;
+
+    QMutexLocker l(&sdDUChainPrivate->m_chainsMutex);
+
+    qint64 ret = 0;
+    for (TopDUContext* top : std::as_const(sdDUChainPrivate->m_chainsByUrl)) {
+        ret += top->m_dynamicData->allocatedMemory();
+    }
+    return ret;
+}
+
+void DUChain::releaseMemory(qint64 bytes)
+{
+    if (sdDUChainPrivate->m_destroyed) {
+        return;
+    }
+
+    // back off while releasing frees nothing, e.g. because the memory is held by referenced contexts
+    // or by something else entirely, so we don't keep interrupting the parsing for nothing
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now < sdDUChainPrivate->m_nextMemoryRelease) {
+        return;
+    }
+
+    qCDebug(LANGUAGE) << "unloading least recently used top-contexts to release" << bytes << "bytes";
+    const qint64 released = sdDUChainPrivate->doMoreCleanup(SOFT_CLEANUP_STEPS, DUChainPrivate::TryLock, bytes);
+    if (released > 0) {
+        sdDUChainPrivate->m_memoryReleaseBackoff = 0;
+    } else {
+        auto& backoff = sdDUChainPrivate->m_memoryReleaseBackoff;
+        backoff = std::min(backoff ? backoff * 2 : minMemoryReleaseBackoff, maxMemoryReleaseBackoff);
+        sdDUChainPrivate->m_nextMemoryRelease = now + backoff;
+        qCDebug(LANGUAGE) << "no top-context could be unloaded, next try in" << backoff << "ms";
+    }
+}
+
 IndexedString DUChain::urlForIndex(uint index) const
 {
     {
@@ -1738,6 +1906,17 @@ void DUChain::shutdown()
 
     qCDebug(LANGUAGE) << "Cleaning up and shutting down DUChain";
 
+    {
+        auto* governor = MemoryGovernor::self();
+        governor->unregisterConsumer(QStringLiteral("DUChain"));
+        governor->unregisterConsumer(QStringLiteral("Item repositories"));
+        governor->unregisterConsumer(QStringLiteral("Symbol table cache"));
+    }
+
+    if (qEnvironmentVariableIsSet("KDEV_DUCHAIN_LOCK_STATISTICS")) {
+        QTextStream(stderr) << "DUChain lock statistics:\n" << sdDUChainPrivate->lock.statistics().print() << Qt::endl;
+    }
+
     QMutexLocker lock(&sdDUChainPrivate->cleanupMutex());
 
     {
@@ -1750,6 +1929,11 @@ void DUChain::shutdown()
 
     sdDUChainPrivate->doMoreCleanup(); //Must be done _before_ finalCleanup, else we may be deleting yet needed data
 
+    if (qEnvironmentVariableIsSet("KDEV_DUCHAIN_STORAGE_STATISTICS")) {
+        QTextStream(stderr) << "Top-context storage statistics:\n"
+                            << TopDUContextDynamicData::storageStatistics().print() << Qt::endl;
+    }
+
     sdDUChainPrivate->m_openDocumentContexts.clear();
     sdDUChainPrivate->m_destroyed = true;
     sdDUChainPrivate->clear();
@@ -1824,6 +2008,12 @@ void DUChain::emitUpdateReady(const IndexedString& url, const ReferencedTopDUCon
     if (sdDUChainPrivate->m_destroyed)
         return;
 
+    if (topContext) {
+        // keep the use ranges up to date, so that uses can be found without loading this top-context
+        DUChainReadLocker lock;
+        uses()->indexUseRanges(topContext.data());
+    }
+
     emit updateReady(url, topContext);
 }
 
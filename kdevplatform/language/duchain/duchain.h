@@ -172,8 +172,10 @@ public:
 
             if (chainsByIndex.size() > index) {
                 TopDUContext* top = chainsByIndex[index];
-                if (top)
+                if (top) {
+                    chainsLastUsed[index] = ++chainsUseTick;
                     return top;
+                }
             }
         }
 
@@ -225,6 +227,15 @@ public:
     /// Returns whether the top-context with the given index is currently loaded in memory
     bool isInMemory(uint topContextIndex) const;
 
+    ///Returns an estimate of the bytes the loaded top-contexts take on the heap
+    ///The duchain must be read-locked
+    qint64 allocatedMemory() const;
+
+    ///Stores and unloads the least recently used top-contexts that are not referenced, until about @p bytes are released
+    ///Nothing is done while parse jobs are running. When a call frees nothing, the following calls are ignored for
+    ///a growing while. Only call this from one thread at a time; the duchain must not be locked in any way
+    void releaseMemory(qint64 bytes);
+
     /**
      * Changes the environment attached to the given top-level context, and updates the management-structures to reflect that
      * */
@@ -287,6 +298,9 @@ private:
     //These two are exported here so that the extremely frequently called chainForIndex(..) can be inlined
     static bool m_deleted;
     static std::vector<TopDUContext*> chainsByIndex;
+    /// When the top-context with the index was last retrieved, in ticks of chainsUseTick
+    static std::vector<quint64> chainsLastUsed;
+    static quint64 chainsUseTick;
     static QMutex chainsByIndexLock;
 
     /// Increases the reference-count for the given top-context. The result: It will not be unloaded.
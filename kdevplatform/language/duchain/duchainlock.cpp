@@ -10,15 +10,87 @@
 #include "duchainlock.h"
 #include "duchain.h"
 
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QScopeGuard>
 #include <QThread>
 #include <QThreadStorage>
-#include <QElapsedTimer>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 
 ///@todo Always prefer exactly that lock that is requested by the thread that has the foreground mutex,
 ///           to reduce the amount of UI blocking.
 
-//Microseconds to sleep when waiting for a lock
-const uint uSleepTime = 500;
+namespace {
+///Upper bound for the count of attempts a waiter spins before it is put to sleep
+const int maxSpinCount = 100;
+
+qint64 nowInNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LockTimeHistogram
+{
+public:
+    void record(qint64 nanoseconds)
+    {
+        const auto microseconds = static_cast<quint64>(std::max<qint64>(nanoseconds / 1000, 0));
+        const int bucket = microseconds ?
+                           std::min<int>(std::bit_width(microseconds) - 1, KDevelop::DUChainLockHistogram::BucketCount - 1) : 0;
+
+        m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_samples.fetch_add(1, std::memory_order_relaxed);
+        m_totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+
+        auto longest = m_longestMicroseconds.load(std::memory_order_relaxed);
+        while (longest < microseconds
+               && !m_longestMicroseconds.compare_exchange_weak(longest, microseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    KDevelop::DUChainLockHistogram histogram() const
+    {
+        KDevelop::DUChainLockHistogram ret;
+        for (int i = 0; i < KDevelop::DUChainLockHistogram::BucketCount; ++i) {
+            ret.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        }
+        ret.samples = m_samples.load(std::memory_order_relaxed);
+        ret.totalMicroseconds = m_totalMicroseconds.load(std::memory_order_relaxed);
+        ret.longestMicroseconds = m_longestMicroseconds.load(std::memory_order_relaxed);
+        return ret;
+    }
+
+    void reset()
+    {
+        for (auto& bucket : m_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        m_samples.store(0, std::memory_order_relaxed);
+        m_totalMicroseconds.store(0, std::memory_order_relaxed);
+        m_longestMicroseconds.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<quint64>, KDevelop::DUChainLockHistogram::BucketCount> m_buckets = {};
+    std::atomic<quint64> m_samples = 0;
+    std::atomic<quint64> m_totalMicroseconds = 0;
+    std::atomic<quint64> m_longestMicroseconds = 0;
+};
+
+struct ReaderState
+{
+    int recursion = 0;
+    ///When the outermost read-lock of this thread was acquired, or zero if that was not recorded
+    qint64 lockedSince = 0;
+};
+}
 
 namespace KDevelop {
 class DUChainLockPrivate
@@ -28,18 +100,119 @@ public:
         : m_writer(nullptr)
         , m_writerRecursion(0)
         , m_totalReaderRecursion(0)
+        , m_recordStatistics(qEnvironmentVariableIsSet("KDEV_DUCHAIN_LOCK_STATISTICS"))
     { }
 
+    bool recordStatistics() const
+    {
+        return m_recordStatistics.load(std::memory_order_relaxed);
+    }
+
     int ownReaderRecursion() const
     {
-        return m_readerRecursion.localData();
+        return m_readerState.localData().recursion;
     }
 
     void changeOwnReaderRecursion(int difference)
     {
-        m_readerRecursion.localData() += difference;
-        Q_ASSERT(m_readerRecursion.localData() >= 0);
-        m_totalReaderRecursion.fetchAndAddOrdered(difference);
+        auto& state = m_readerState.localData();
+        state.recursion += difference;
+        Q_ASSERT(state.recursion >= 0);
+        if (m_totalReaderRecursion.fetchAndAddOrdered(difference) + difference == 0) {
+            //The last reader is gone, a waiting writer may proceed now
+            wakeWaiters();
+        }
+    }
+
+    ///Returns whether the current thread may proceed with a read-lock, assuming it has already increased its reader-recursion
+    bool canRead() const
+    {
+        //m_writerRecursion is checked instead of m_writer, so a writer that is just reserving the lock is noticed as well
+        return m_writerRecursion.loadAcquire() == 0;
+    }
+
+    bool tryLockForWrite()
+    {
+        if (m_totalReaderRecursion.loadRelaxed() == 0 && m_writerRecursion.testAndSetOrdered(0, 1)) {
+            //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
+            if (m_totalReaderRecursion.loadAcquire() == 0) {
+                //There is still no readers, we have successfully acquired a write-lock
+                m_writer.storeRelaxed(QThread::currentThread());
+                return true;
+            }
+            //There may be readers, back off and let the readers that have seen us proceed
+            m_writerRecursion.fetchAndStoreOrdered(0);
+            wakeWaiters();
+        }
+        return false;
+    }
+
+    /**
+     * Blocks until @p tryProceed returns true or @p timeout milliseconds have passed.
+     *
+     * The waiter first spins for a while, adapting the spin count to how long it recently took until the lock
+     * became available, and is then put to sleep until the lock state changes.
+     * @return whether @p tryProceed succeeded.
+     */
+    template <typename TryProceed>
+    bool wait(TryProceed tryProceed, unsigned int timeout)
+    {
+        const QDeadlineTimer deadline = timeout ? QDeadlineTimer(timeout) : QDeadlineTimer(QDeadlineTimer::Forever);
+
+        const int spinCount = m_spinCount.loadRelaxed();
+        const int maxSpins = std::min(maxSpinCount, spinCount * 2 + 10);
+        for (int spins = 1; spins <= maxSpins; ++spins) {
+            QThread::yieldCurrentThread();
+            if (tryProceed()) {
+                m_spinCount.fetchAndAddRelaxed((spins - spinCount) / 8);
+                return true;
+            }
+            if (deadline.hasExpired()) {
+                m_timeouts.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        m_spinCount.fetchAndAddRelaxed((maxSpins - spinCount) / 8);
+
+        m_parkedWaits.fetch_add(1, std::memory_order_relaxed);
+
+        //Registering as waiter before checking the lock state makes sure that a releasing thread either notices us,
+        //or has released the lock before we check it
+        m_waiters.fetchAndAddOrdered(1);
+        const auto unregister = qScopeGuard([this] {
+            m_waiters.fetchAndAddOrdered(-1);
+        });
+
+        while (true) {
+            //Any release after this point increases the generation, so we cannot miss a wake-up below
+            const int generation = m_generation.loadAcquire();
+            if (tryProceed()) {
+                return true;
+            }
+
+            QMutexLocker lock(&m_waitMutex);
+            while (m_generation.loadRelaxed() == generation) {
+                if (!m_released.wait(&m_waitMutex, deadline)) {
+                    lock.unlock();
+                    if (tryProceed()) {
+                        return true;
+                    }
+                    m_timeouts.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+        }
+    }
+
+    void wakeWaiters()
+    {
+        if (m_waiters.loadAcquire() == 0) {
+            return;
+        }
+
+        QMutexLocker lock(&m_waitMutex);
+        m_generation.fetchAndAddRelease(1);
+        m_released.wakeAll();
     }
 
     ///Holds the writer that currently has the write-lock, or zero. Is protected by m_writerRecursion.
@@ -51,9 +224,59 @@ public:
     ///How often is the chain read-locked recursively by all readers? Should be sum of all m_readerRecursion values
     QAtomicInt m_totalReaderRecursion;
 
-    QThreadStorage<int> m_readerRecursion;
+    QThreadStorage<ReaderState> m_readerState;
+
+    ///When the write-lock was acquired by m_writer, or zero if that was not recorded
+    qint64 m_writeLockedSince = 0;
+
+    ///Count of threads that are sleeping in wait() or about to do so
+    QAtomicInt m_waiters;
+    ///Increased on every release that may let a sleeping waiter proceed
+    QAtomicInt m_generation;
+    ///Protects sleeping on m_released, the lock state itself is only accessed atomically
+    QMutex m_waitMutex;
+    QWaitCondition m_released;
+    ///Running average of the spins it took until the lock became available
+    QAtomicInt m_spinCount;
+
+    ///Whether the wait and hold times are recorded, which costs clock reads on every outermost lock and release
+    std::atomic<bool> m_recordStatistics;
+    LockTimeHistogram m_readWait;
+    LockTimeHistogram m_readHold;
+    LockTimeHistogram m_writeWait;
+    LockTimeHistogram m_writeHold;
+    std::atomic<quint64> m_parkedWaits = 0;
+    std::atomic<quint64> m_timeouts = 0;
 };
 
+QString DUChainLockHistogram::print() const
+{
+    QString ret = QStringLiteral("samples: %1 average: %2us longest: %3us")
+                      .arg(samples)
+                      .arg(samples ? totalMicroseconds / samples : 0)
+                      .arg(longestMicroseconds);
+    for (int i = 0; i < BucketCount - 1; ++i) {
+        if (buckets[i]) {
+            ret += QStringLiteral("\n  < %1us: %2").arg(quint64(1) << (i + 1)).arg(buckets[i]);
+        }
+    }
+    if (buckets[BucketCount - 1]) {
+        ret += QStringLiteral("\n  >= %1us: %2").arg(quint64(1) << (BucketCount - 1)).arg(buckets[BucketCount - 1]);
+    }
+    return ret;
+}
+
+QString DUChainLockStatistics::print() const
+{
+    QString ret;
+    ret += QStringLiteral("read wait: ") + readWait.print();
+    ret += QStringLiteral("\nread hold: ") + readHold.print();
+    ret += QStringLiteral("\nwrite wait: ") + writeWait.print();
+    ret += QStringLiteral("\nwrite hold: ") + writeHold.print();
+    ret += QStringLiteral("\nparked waits: %1 timeouts: %2").arg(parkedWaits).arg(timeouts);
+    return ret;
+}
+
 DUChainLock::DUChainLock()
     : d_ptr(new DUChainLockPrivate)
 {
@@ -65,31 +288,34 @@ bool DUChainLock::lockForRead(unsigned int timeout)
 {
     Q_D(DUChainLock);
 
+    const bool outermost = d->ownReaderRecursion() == 0;
+
     ///Step 1: Increase the own reader-recursion. This will make sure no further write-locks will succeed
     d->changeOwnReaderRecursion(1);
 
-    QThread* w = d->m_writer.loadAcquire();
-    if (w == nullptr || w == QThread::currentThread()) {
+    if (d->m_writer.loadRelaxed() == QThread::currentThread() || d->canRead()) {
         //Successful lock: Either there is no writer, or we hold the write-lock by ourselves
-    } else {
-        ///Step 2: Start spinning until there is no writer any more
-
-        QElapsedTimer t;
-        if (timeout) {
-            t.start();
+        if (outermost && d->recordStatistics()) {
+            d->m_readWait.record(0);
+            d->m_readerState.localData().lockedSince = nowInNanoseconds();
         }
+        return true;
+    }
 
-        while (d->m_writer.loadAcquire()) {
-            if (!timeout || t.elapsed() < timeout) {
-                QThread::usleep(uSleepTime);
-            } else {
-                //Fail!
-                d->changeOwnReaderRecursion(-1);
-                return false;
-            }
-        }
+    ///Step 2: Wait until there is no writer any more
+    const bool record = outermost && d->recordStatistics();
+    const qint64 waitStart = record ? nowInNanoseconds() : 0;
+    if (!d->wait([d] { return d->canRead(); }, timeout)) {
+        //Fail!
+        d->changeOwnReaderRecursion(-1);
+        return false;
     }
 
+    if (record) {
+        const qint64 now = nowInNanoseconds();
+        d->m_readWait.record(now - waitStart);
+        d->m_readerState.localData().lockedSince = now;
+    }
     return true;
 }
 
@@ -97,6 +323,15 @@ void DUChainLock::releaseReadLock()
 {
     Q_D(DUChainLock);
 
+    if (d->recordStatistics()) {
+        auto& state = d->m_readerState.localData();
+        //Statistics may have been enabled while the lock was held, then there is no start time
+        if (state.recursion == 1 && state.lockedSince) {
+            d->m_readHold.record(nowInNanoseconds() - state.lockedSince);
+            state.lockedSince = 0;
+        }
+    }
+
     d->changeOwnReaderRecursion(-1);
 }
 
@@ -121,35 +356,26 @@ bool DUChainLock::lockForWrite(uint timeout)
         return true;
     }
 
-    QElapsedTimer t;
-    if (timeout) {
-        t.start();
-    }
-
-    while (1) {
-        //Try acquiring the write-lcok
-        if (d->m_totalReaderRecursion.loadRelaxed() == 0 && d->m_writerRecursion.testAndSetOrdered(0, 1)) {
-            //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
-            d->m_writer = QThread::currentThread();
-            if (d->m_totalReaderRecursion.loadRelaxed() == 0) {
-                //There is still no readers, we have successfully acquired a write-lock
-                return true;
-            } else {
-                //There may be readers.. we have to continue spinning
-                d->m_writer = nullptr;
-                d->m_writerRecursion = 0;
-            }
+    const bool record = d->recordStatistics();
+    if (d->tryLockForWrite()) {
+        if (record) {
+            d->m_writeWait.record(0);
         }
+        d->m_writeLockedSince = record ? nowInNanoseconds() : 0;
+        return true;
+    }
 
-        if (!timeout || t.elapsed() < timeout) {
-            QThread::usleep(uSleepTime);
-        } else {
-            //Fail!
-            return false;
-        }
+    const qint64 waitStart = record ? nowInNanoseconds() : 0;
+    if (!d->wait([d] { return d->tryLockForWrite(); }, timeout)) {
+        //Fail!
+        return false;
     }
 
-    return false;
+    d->m_writeLockedSince = record ? nowInNanoseconds() : 0;
+    if (record) {
+        d->m_writeWait.record(d->m_writeLockedSince - waitStart);
+    }
+    return true;
 }
 
 void DUChainLock::releaseWriteLock()
@@ -160,10 +386,13 @@ void DUChainLock::releaseWriteLock()
 
     //The order is important here, m_writerRecursion protects m_writer
 
-    //TODO: could testAndSet here
     if (d->m_writerRecursion.loadRelaxed() == 1) {
-        d->m_writer = nullptr;
-        d->m_writerRecursion = 0;
+        if (d->m_writeLockedSince && d->recordStatistics()) {
+            d->m_writeHold.record(nowInNanoseconds() - d->m_writeLockedSince);
+        }
+        d->m_writer.storeRelaxed(nullptr);
+        d->m_writerRecursion.fetchAndStoreOrdered(0);
+        d->wakeWaiters();
     } else {
         d->m_writerRecursion.fetchAndAddOrdered(-1);
     }
@@ -176,6 +405,46 @@ bool DUChainLock::currentThreadHasWriteLock() const
     return d->m_writer.loadRelaxed() == QThread::currentThread();
 }
 
+bool DUChainLock::statisticsEnabled() const
+{
+    Q_D(const DUChainLock);
+
+    return d->recordStatistics();
+}
+
+void DUChainLock::setStatisticsEnabled(bool enabled)
+{
+    Q_D(DUChainLock);
+
+    d->m_recordStatistics.store(enabled, std::memory_order_relaxed);
+}
+
+DUChainLockStatistics DUChainLock::statistics() const
+{
+    Q_D(const DUChainLock);
+
+    DUChainLockStatistics ret;
+    ret.readWait = d->m_readWait.histogram();
+    ret.readHold = d->m_readHold.histogram();
+    ret.writeWait = d->m_writeWait.histogram();
+    ret.writeHold = d->m_writeHold.histogram();
+    ret.parkedWaits = d->m_parkedWaits.load(std::memory_order_relaxed);
+    ret.timeouts = d->m_timeouts.load(std::memory_order_relaxed);
+    return ret;
+}
+
+void DUChainLock::resetStatistics()
+{
+    Q_D(DUChainLock);
+
+    d->m_readWait.reset();
+    d->m_readHold.reset();
+    d->m_writeWait.reset();
+    d->m_writeHold.reset();
+    d->m_parkedWaits.store(0, std::memory_order_relaxed);
+    d->m_timeouts.store(0, std::memory_order_relaxed);
+}
+
 DUChainReadLocker::DUChainReadLocker(DUChainLock* duChainLock, uint timeout)
     : m_lock(duChainLock ? duChainLock : DUChain::lock())
     , m_locked(false)
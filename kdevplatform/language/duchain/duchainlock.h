@@ -9,6 +9,9 @@
 
 #include <language/languageexport.h>
 #include <QScopedPointer>
+#include <QString>
+
+#include <array>
 
 namespace KDevelop {
 // #define NO_DUCHAIN_LOCK_TESTING
@@ -35,8 +38,52 @@ class DUChainLockPrivate;
 #define ENSURE_CHAIN_NOT_LOCKED
 #endif
 
+/**
+ * Distribution of the time spent waiting for or holding a DUChainLock, in microseconds.
+ *
+ * Bucket @c i counts the samples that took between 2^i and 2^(i+1) microseconds.
+ * The first bucket also counts everything shorter, the last one everything longer.
+ */
+struct KDEVPLATFORMLANGUAGE_EXPORT DUChainLockHistogram
+{
+    enum {
+        BucketCount = 24
+    };
+
+    std::array<quint64, BucketCount> buckets = {};
+    quint64 samples = 0;
+    quint64 totalMicroseconds = 0;
+    quint64 longestMicroseconds = 0;
+
+    QString print() const;
+};
+
+/**
+ * Contention metrics of a DUChainLock, see DUChainLock::statistics().
+ *
+ * Only the outermost lock of a recursive acquisition is sampled, and the wait and
+ * hold times only while DUChainLock::statisticsEnabled().
+ */
+struct KDEVPLATFORMLANGUAGE_EXPORT DUChainLockStatistics
+{
+    DUChainLockHistogram readWait;
+    DUChainLockHistogram readHold;
+    DUChainLockHistogram writeWait;
+    DUChainLockHistogram writeHold;
+    quint64 parkedWaits = 0; // How often a waiter was put to sleep instead of acquiring the lock while spinning
+    quint64 timeouts = 0; // How often a lock could not be acquired within the requested timeout
+
+    QString print() const;
+};
+
 /**
  * Customized read/write locker for the definition-use chain.
+ *
+ * Waiters spin shortly and are then put to sleep until the lock is released.
+ * The spinning duration adapts to how long the lock was recently held.
+ *
+ * Set the environment variable KDEV_DUCHAIN_LOCK_STATISTICS to record the
+ * statistics() of every lock and print those of the global DUChain lock on shutdown.
  */
 class KDEVPLATFORMLANGUAGE_EXPORT DUChainLock
 {
@@ -91,6 +138,27 @@ public:
      */
     bool currentThreadHasWriteLock() const;
 
+    /**
+     * Returns whether wait and hold times are recorded. That is off by default, as it reads the clock on
+     * every outermost lock and release, unless KDEV_DUCHAIN_LOCK_STATISTICS is set.
+     */
+    bool statisticsEnabled() const;
+
+    /**
+     * Starts or stops recording wait and hold times.
+     */
+    void setStatisticsEnabled(bool enabled);
+
+    /**
+     * Returns the wait and hold time histograms collected since construction or the last resetStatistics().
+     */
+    DUChainLockStatistics statistics() const;
+
+    /**
+     * Clears the collected wait and hold time histograms.
+     */
+    void resetStatistics();
+
 private:
     const QScopedPointer<class DUChainLockPrivate> d_ptr;
     Q_DECLARE_PRIVATE(DUChainLock)
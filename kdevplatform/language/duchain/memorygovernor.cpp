@@ -0,0 +1,332 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "memorygovernor.h"
+
+#include <QFile>
+#include <QLocale>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+
+#include <debug.h>
+
+using namespace KDevelop;
+
+namespace {
+const int updateEverySeconds = 5;
+/// The default budget, as fraction of the physical memory
+const double defaultBudgetFraction = 0.6;
+/// Once under pressure, memory is released until the resident memory is below this fraction of the budget
+const double relievedBudgetFraction = 0.85;
+
+/**
+ * @return the value of the line starting with @p key in the /proc file @p fileName in bytes, or -1
+ */
+qint64 readProcValue(const QString& fileName, const QByteArray& key)
+{
+#ifdef Q_OS_LINUX
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith(key)) {
+            // the values are given in kB
+            return line.mid(key.size()).trimmed().split(' ').value(0).toLongLong() * 1024;
+        }
+    }
+#else
+    Q_UNUSED(fileName);
+    Q_UNUSED(key);
+#endif
+    return -1;
+}
+
+qint64 residentMemory()
+{
+    return readProcValue(QStringLiteral("/proc/self/status"), "VmRSS:");
+}
+
+qint64 physicalMemory()
+{
+    static const qint64 ret = readProcValue(QStringLiteral("/proc/meminfo"), "MemTotal:");
+    return ret;
+}
+
+QString formatBytes(qint64 bytes)
+{
+    return bytes < 0 ? QStringLiteral("unknown") : QLocale::c().formattedDataSize(bytes);
+}
+}
+
+namespace KDevelop {
+class MemoryGovernorThread : public QThread
+{
+public:
+    explicit MemoryGovernorThread(MemoryGovernor* governor)
+        : m_governor(governor)
+    {
+        setObjectName(QStringLiteral("MemoryGovernor"));
+    }
+
+private:
+    void run() override
+    {
+        QTimer timer;
+        QObject::connect(&timer, &QTimer::timeout, &timer, [this]() {
+            m_governor->update();
+        });
+        timer.start(updateEverySeconds * 1000);
+        exec();
+    }
+
+    MemoryGovernor* const m_governor;
+};
+
+class MemoryGovernorPrivate
+{
+public:
+    struct Consumer
+    {
+        QString category;
+        MemoryGovernor::UsageFunction usage;
+        MemoryGovernor::ReleaseFunction release;
+    };
+
+    qint64 effectiveBudget() const
+    {
+        if (m_budget > 0) {
+            return m_budget;
+        }
+        const qint64 physical = physicalMemory();
+        return physical > 0 ? static_cast<qint64>(physical * defaultBudgetFraction) : 0;
+    }
+
+    void stopThread()
+    {
+        if (m_thread) {
+            m_thread->quit();
+            m_thread->wait();
+            m_thread.reset();
+        }
+    }
+
+    // guards all members but m_underPressure
+    mutable QMutex m_mutex;
+    // held while the consumer functions are called
+    QMutex m_updateMutex;
+
+    QVector<Consumer> m_consumers;
+    QVector<MemoryGovernor::Usage> m_usage;
+    qint64 m_budget = 0;
+    std::atomic<bool> m_underPressure = false;
+    QScopedPointer<MemoryGovernorThread> m_thread;
+};
+}
+
+MemoryGovernor::MemoryGovernor()
+    : d_ptr(new MemoryGovernorPrivate)
+{
+}
+
+MemoryGovernor::~MemoryGovernor()
+{
+    Q_D(MemoryGovernor);
+
+    d->stopThread();
+}
+
+MemoryGovernor* MemoryGovernor::self()
+{
+    static MemoryGovernor ret;
+    return &ret;
+}
+
+void MemoryGovernor::setBudget(qint64 bytes)
+{
+    Q_D(MemoryGovernor);
+
+    QMutexLocker lock(&d->m_mutex);
+    d->m_budget = bytes;
+}
+
+qint64 MemoryGovernor::budget() const
+{
+    Q_D(const MemoryGovernor);
+
+    QMutexLocker lock(&d->m_mutex);
+    return d->effectiveBudget();
+}
+
+void MemoryGovernor::registerConsumer(const QString& category, const UsageFunction& usage,
+                                      const ReleaseFunction& release)
+{
+    Q_D(MemoryGovernor);
+
+    Q_ASSERT(usage);
+
+    QMutexLocker lock(&d->m_mutex);
+    auto it = std::find_if(d->m_consumers.begin(), d->m_consumers.end(),
+                           [&category](const MemoryGovernorPrivate::Consumer& consumer) {
+        return consumer.category == category;
+    });
+    if (it != d->m_consumers.end()) {
+        it->usage = usage;
+        it->release = release;
+    } else {
+        d->m_consumers.append({category, usage, release});
+    }
+
+    if (!d->m_thread) {
+        d->m_thread.reset(new MemoryGovernorThread(this));
+        d->m_thread->start(QThread::LowPriority);
+    }
+}
+
+void MemoryGovernor::unregisterConsumer(const QString& category)
+{
+    Q_D(MemoryGovernor);
+
+    bool stopThread = false;
+    {
+        QMutexLocker lock(&d->m_mutex);
+        d->m_consumers.erase(std::remove_if(d->m_consumers.begin(), d->m_consumers.end(),
+                                            [&category](const MemoryGovernorPrivate::Consumer& consumer) {
+            return consumer.category == category;
+        }), d->m_consumers.end());
+        stopThread = d->m_consumers.isEmpty();
+    }
+
+    if (stopThread) {
+        d->stopThread();
+    } else {
+        // wait for an update that may still call the removed consumer
+        QMutexLocker updateLock(&d->m_updateMutex);
+    }
+}
+
+QVector<MemoryGovernor::Usage> MemoryGovernor::usage() const
+{
+    Q_D(const MemoryGovernor);
+
+    QMutexLocker lock(&d->m_mutex);
+    return d->m_usage;
+}
+
+bool MemoryGovernor::isUnderPressure() const
+{
+    Q_D(const MemoryGovernor);
+
+    return d->m_underPressure.load(std::memory_order_relaxed);
+}
+
+void MemoryGovernor::update()
+{
+    Q_D(MemoryGovernor);
+
+    QMutexLocker updateLock(&d->m_updateMutex);
+
+    QVector<MemoryGovernorPrivate::Consumer> consumers;
+    QVector<Usage> previousUsage;
+    qint64 budget;
+    {
+        QMutexLocker lock(&d->m_mutex);
+        consumers = d->m_consumers;
+        previousUsage = d->m_usage;
+        budget = d->effectiveBudget();
+    }
+
+    QVector<Usage> usage;
+    usage.reserve(consumers.size() + 1);
+    const qint64 resident = residentMemory();
+    usage.append({QStringLiteral("Resident"), resident});
+    for (const auto& consumer : std::as_const(consumers)) {
+        qint64 bytes = consumer.usage();
+        if (bytes < 0) {
+            // e.g. the consumer could not get a lock in time, the last value is still a good guess
+            for (const auto& previous : std::as_const(previousUsage)) {
+                if (previous.category == consumer.category) {
+                    bytes = previous.bytes;
+                }
+            }
+        }
+        usage.append({consumer.category, bytes});
+    }
+
+    const bool wasUnderPressure = d->m_underPressure.load(std::memory_order_relaxed);
+    bool underPressure = false;
+    if (budget > 0 && resident >= 0) {
+        underPressure = resident > (wasUnderPressure ? budget * relievedBudgetFraction : budget);
+    }
+
+    {
+        QMutexLocker lock(&d->m_mutex);
+        d->m_usage = usage;
+        d->m_underPressure.store(underPressure, std::memory_order_relaxed);
+    }
+
+    if (underPressure) {
+        // every consumer that can release memory gets asked for its share of the excess
+        const double excess = resident - budget * relievedBudgetFraction;
+        double releasable = 0;
+        int releasableConsumers = 0;
+        for (int i = 0; i < consumers.size(); ++i) {
+            if (consumers[i].release) {
+                releasable += std::max<qint64>(usage[i + 1].bytes, 0);
+                ++releasableConsumers;
+            }
+        }
+
+        for (int i = 0; i < consumers.size(); ++i) {
+            if (!consumers[i].release) {
+                continue;
+            }
+            const double share = releasable > 0 ? std::max<qint64>(usage[i + 1].bytes, 0) / releasable
+                                                : 1.0 / releasableConsumers;
+            const auto bytes = static_cast<qint64>(excess * share);
+            if (bytes > 0) {
+                qCDebug(LANGUAGE) << "memory budget exceeded, releasing" << bytes << "bytes from"
+                                  << consumers[i].category;
+                consumers[i].release(bytes);
+            }
+        }
+    }
+
+    if (qEnvironmentVariableIsSet("KDEV_MEMORY_GOVERNOR_DEBUG")) {
+        QTextStream(stderr) << usageReport() << Qt::endl;
+    }
+
+    if (underPressure != wasUnderPressure) {
+        emit pressureChanged(underPressure);
+    }
+    emit usageChanged();
+}
+
+QString MemoryGovernor::usageReport() const
+{
+    const auto usage = this->usage();
+    const auto budget = this->budget();
+
+    QString ret;
+    QTextStream out(&ret);
+    out << "budget: " << formatBytes(budget > 0 ? budget : -1);
+    if (isUnderPressure()) {
+        out << " (exceeded)";
+    }
+    for (const auto& category : usage) {
+        out << '\n' << category.category << ": " << formatBytes(category.bytes);
+    }
+    return ret;
+}
+
+#include "moc_memorygovernor.cpp"
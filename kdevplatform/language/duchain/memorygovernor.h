@@ -0,0 +1,112 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_MEMORYGOVERNOR_H
+#define KDEVPLATFORM_MEMORYGOVERNOR_H
+
+#include <language/languageexport.h>
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <functional>
+
+namespace KDevelop {
+class MemoryGovernorPrivate;
+
+/**
+ * Keeps the memory used by the language support within a budget.
+ *
+ * Components holding large caches, like the loaded top-contexts or the translation units of a language
+ * plugin, register themselves as consumers of a category. The governor samples their usage and the
+ * resident memory of the process every few seconds in a background thread. While the resident memory
+ * exceeds the budget, the governor is under pressure: it asks every consumer to release its share of
+ * the excess, and the background parser runs only one parse job at a time.
+ *
+ * The budget is read from the "Memory Budget" entry of the "Background Parser" session settings, in MiB.
+ * When that is 0, it defaults to 60% of the physical memory.
+ *
+ * The usage is shown on the background parser settings page, and can be queried with the
+ * org.kdevelop.MemoryGovernor D-Bus interface or by setting KDEV_MEMORY_GOVERNOR_DEBUG.
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT MemoryGovernor : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kdevelop.MemoryGovernor")
+
+public:
+    /// The memory taken by one category
+    struct Usage
+    {
+        QString category;
+        /// -1 if unknown
+        qint64 bytes = -1;
+    };
+
+    /// @return the bytes the consumer uses right now, or -1 if that cannot be determined right now
+    using UsageFunction = std::function<qint64()>;
+    /// Releases about the given count of bytes, called from the governor thread
+    using ReleaseFunction = std::function<void(qint64 bytes)>;
+
+    ~MemoryGovernor() override;
+
+    static MemoryGovernor* self();
+
+    /**
+     * Sets the budget for the resident memory of the process.
+     *
+     * @param bytes 0 means the default, 60% of the physical memory
+     */
+    void setBudget(qint64 bytes);
+    /// @return the effective budget in bytes, or 0 if there is none because the physical memory is unknown
+    qint64 budget() const;
+
+    /**
+     * Registers a consumer of memory for @p category, replacing an earlier one for the same category.
+     *
+     * The functions are called from the governor thread, without any lock held.
+     * @p release may be empty when the memory cannot be released on request.
+     */
+    void registerConsumer(const QString& category, const UsageFunction& usage,
+                          const ReleaseFunction& release = ReleaseFunction());
+    /**
+     * Unregisters the consumer of @p category, waiting for a running call of its functions to return.
+     *
+     * Don't hold any lock the consumer functions may take when calling this.
+     */
+    void unregisterConsumer(const QString& category);
+
+    /// @return the usage of every category as of the last update, the first entry is the whole process
+    QVector<Usage> usage() const;
+
+    bool isUnderPressure() const;
+
+public Q_SLOTS:
+    /**
+     * Samples the usage, and releases memory when the budget is exceeded.
+     *
+     * This is done periodically in the background while consumers are registered.
+     */
+    void update();
+
+    /// @return a human-readable summary of the usage per category and the budget
+    Q_SCRIPTABLE QString usageReport() const;
+
+Q_SIGNALS:
+    /// Emitted from the governor thread after every update
+    void usageChanged();
+    void pressureChanged(bool underPressure);
+
+private:
+    MemoryGovernor();
+
+    const QScopedPointer<class MemoryGovernorPrivate> d_ptr;
+    Q_DECLARE_PRIVATE(MemoryGovernor)
+};
+}
+
+#endif // KDEVPLATFORM_MEMORYGOVERNOR_H
@@ -10,6 +10,8 @@
 #include <language/duchain/parsingenvironment.h>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/uses.h>
+#include <language/duchain/declarationid.h>
 #include <interfaces/iprojectcontroller.h>
 #include <interfaces/idocumentcontroller.h>
 #include <language/duchain/duchainutils.h>
@@ -28,6 +30,8 @@
 
 #include <KLocalizedString>
 
+#include <algorithm>
+
 using namespace KDevelop;
 
 ///@todo make this language-neutral
@@ -253,10 +257,36 @@ void UsesCollector::startCollecting()
             collected.insert(file);
 
         {
+            QVector<DeclarationId> declarationIds;
+            for (const IndexedDeclaration d : std::as_const(allDeclarations)) {
+                if (Declaration* declaration = d.data()) {
+                    declarationIds << declaration->id();
+                    if (!declarationIds.last().isDirect()) {
+                        declarationIds << declaration->id(true);
+                    }
+                }
+            }
+            auto* usesIndex = DUChain::uses();
+            auto hasIndexedUse = [&](const IndexedTopDUContext& top) {
+                return std::any_of(declarationIds.cbegin(), declarationIds.cend(), [&](const DeclarationId& id) {
+                    return !usesIndex->useRanges(id, top).isEmpty();
+                });
+            };
+
             QSet<ParsingEnvironmentFile*> filteredCollected;
             QMap<IndexedString, bool> grepCache;
-            // Filter the collected files by performing a grep
+            int indexedFiles = 0;
+            // Filter the collected files through the recorded use ranges, or else by performing a grep
             for (ParsingEnvironmentFile* file : std::as_const(collected)) {
+                const IndexedTopDUContext top = file->indexedTopContext();
+                if (usesIndex->hasIndexedUseRanges(top)) {
+                    ++indexedFiles;
+                    if (hasIndexedUse(top) || m_declarationTopContexts.contains(top)) {
+                        filteredCollected << file;
+                    }
+                    continue;
+                }
+
                 IndexedString url = file->url();
                 QMap<IndexedString, bool>::iterator grepCacheIt = grepCache.find(url);
                 if (grepCacheIt == grepCache.end()) {
@@ -271,7 +301,7 @@ void UsesCollector::startCollecting()
             }
 
             qCDebug(LANGUAGE) << "Collected contexts for full re-parse, before filtering: " << collected.size() <<
-                " after filtering: " << filteredCollected.size();
+                " after filtering: " << filteredCollected.size() << " filtered through recorded uses: " << indexedFiles;
             collected = filteredCollected;
         }
 
@@ -21,10 +21,12 @@
 
 #include <util/convenientfreelist.h>
 #include <util/embeddedfreetree.h>
+#include <util/shardedlrucache.h>
 
 #include <language/util/setrepository.h>
 
 #include <algorithm>
+#include <optional>
 
 #if defined(QT_NO_DEBUG) && !defined(QT_FORCE_ASSERTS)
 #define VERIFY_VISIT_NESTING 0
@@ -40,6 +42,10 @@ namespace {
 // For now, just _always_ use the cache
 const uint MinimumCountForCache = 1;
 
+// Approximate memory the caches of visitFilteredDeclarations may occupy, evicting the least recently used entries
+const std::size_t DeclarationsCacheMemoryBudget = 48 * 1024 * 1024;
+const std::size_t ImportsCacheMemoryBudget = 4 * 1024 * 1024;
+
 QDebug fromTextStream(const QTextStream& out)
 {
     if (out.device())
@@ -192,19 +198,59 @@ using FilteredDeclarationIterator =
     ConvenientEmbeddedSetTreeFilterIterator<IndexedDeclaration, IndexedDeclarationHandler, IndexedTopDUContext,
                                             CachedIndexedRecursiveImports, DeclarationTopContextExtractor>;
 
-// Maps declaration-ids to declarations, together with some caches
-class PersistentSymbolTableRepo
-    : public ItemRepository<PersistentSymbolTableItem, PersistentSymbolTableRequestItem, true, QRecursiveMutex>
+struct CachedDeclarationsSize
 {
-    using ItemRepository::ItemRepository;
+    std::size_t operator()(const IndexedQualifiedIdentifier&, const CachedDeclarationsByImports& cached) const
+    {
+        std::size_t ret = sizeof(IndexedQualifiedIdentifier) + sizeof(CachedDeclarationsByImports);
+        for (const auto& declarations : cached) {
+            ret += sizeof(TopDUContext::IndexedRecursiveImports) + sizeof(CachedDeclarations)
+                + declarations.size() * sizeof(IndexedDeclaration);
+        }
+        return ret;
+    }
+};
 
-public:
-    QHash<IndexedQualifiedIdentifier, CachedDeclarationsByImports> declarationsCache;
+struct CachedImportsSize
+{
+    std::size_t operator()(const TopDUContext::IndexedRecursiveImports&, const CachedIndexedRecursiveImports&) const
+    {
+        // The set itself lives in RecursiveImportCacheRepository, this is the cache entry and its hash node
+        return sizeof(TopDUContext::IndexedRecursiveImports) + sizeof(CachedIndexedRecursiveImports) + 32;
+    }
+};
+
+/**
+ * Caches of visitFilteredDeclarations.
+ *
+ * They are not members of PersistentSymbolTableRepo, so cache hits do not need to lock the repository and
+ * lookups from multiple threads can proceed in parallel. The cached declarations only change while the
+ * DUChain is write-locked, so a reader holding the DUChain read lock always sees a consistent state.
+ */
+struct PersistentSymbolTableCache
+{
+    ShardedLruCache<IndexedQualifiedIdentifier, CachedDeclarationsByImports, CachedDeclarationsSize> declarations{
+        DeclarationsCacheMemoryBudget};
 
     // We cache the imports so the currently used nodes are very close in memory, which leads to much better CPU cache
     // utilization
-    QHash<TopDUContext::IndexedRecursiveImports, CachedIndexedRecursiveImports> importsCache;
+    ShardedLruCache<TopDUContext::IndexedRecursiveImports, CachedIndexedRecursiveImports, CachedImportsSize> imports{
+        ImportsCacheMemoryBudget};
 
+    static PersistentSymbolTableCache& self()
+    {
+        static PersistentSymbolTableCache cache;
+        return cache;
+    }
+};
+
+// Maps declaration-ids to declarations
+class PersistentSymbolTableRepo
+    : public ItemRepository<PersistentSymbolTableItem, PersistentSymbolTableRequestItem, true, QRecursiveMutex>
+{
+    using ItemRepository::ItemRepository;
+
+public:
     /// Counts how many recursive calls to PersistentSymbolTable::visit* functions are ongoing
     /// and hold the repository's mutex lock. Is used only to assert correct API use.
     mutable uint ongoingIterations = 0;
@@ -257,20 +303,39 @@ class ItemRepositoryFor<PersistentSymbolTable>
 
 void PersistentSymbolTable::clearCache()
 {
-    LockedItemRepository::write<PersistentSymbolTable>([](PersistentSymbolTableRepo& repo) {
-        Q_ASSERT_X(repo.ongoingIterations == 0, Q_FUNC_INFO, "don't call clearCache directly from a visitor");
+    auto& cache = PersistentSymbolTableCache::self();
+    cache.imports.clear();
+    cache.declarations.clear();
+}
 
-        repo.importsCache.clear();
-        repo.declarationsCache.clear();
-    });
+std::size_t PersistentSymbolTable::releaseCacheMemory(std::size_t bytes)
+{
+    auto& cache = PersistentSymbolTableCache::self();
+    // release from both caches in proportion to the memory they use
+    const auto declarationsMemory = cache.declarations.statistics().usedMemory;
+    const auto importsMemory = cache.imports.statistics().usedMemory;
+    if (declarationsMemory + importsMemory == 0) {
+        return 0;
+    }
+    const auto declarationsShare
+        = static_cast<std::size_t>(double(bytes) * declarationsMemory / (declarationsMemory + importsMemory));
+    const auto freed = cache.declarations.release(declarationsShare);
+    return freed + cache.imports.release(bytes > freed ? bytes - freed : 0);
+}
+
+PersistentSymbolTable::CacheStatistics PersistentSymbolTable::cacheStatistics() const
+{
+    const auto& cache = PersistentSymbolTableCache::self();
+    return {cache.declarations.statistics(), cache.imports.statistics()};
 }
 
 PersistentSymbolTable::PersistentSymbolTable()
 {
-    // PersistentSymbolTableRepo::importsCache uses RecursiveImportCacheRepository, so the cache repository must be
-    // destroyed after and therefore created before the persistent symbol table repository.
+    // PersistentSymbolTableCache::imports uses RecursiveImportCacheRepository, so the cache repository must be
+    // destroyed after and therefore created before the cache.
     RecursiveImportCacheRepository::repository();
     LockedItemRepository::initialize<PersistentSymbolTable>();
+    PersistentSymbolTableCache::self();
 }
 
 PersistentSymbolTable::~PersistentSymbolTable() = default;
@@ -285,7 +350,7 @@ void PersistentSymbolTable::addDeclaration(const IndexedQualifiedIdentifier& id,
     LockedItemRepository::write<PersistentSymbolTable>([&item, &declaration](PersistentSymbolTableRepo& repo) {
         Q_ASSERT_X(repo.ongoingIterations == 0, Q_FUNC_INFO, "don't call addDeclaration directly from a visitor");
 
-        repo.declarationsCache.remove(item.id);
+        PersistentSymbolTableCache::self().declarations.remove(item.id);
 
         uint index = repo.findIndex(item);
 
@@ -337,7 +402,7 @@ void PersistentSymbolTable::removeDeclaration(const IndexedQualifiedIdentifier&
     LockedItemRepository::write<PersistentSymbolTable>([&item, &declaration](PersistentSymbolTableRepo& repo) {
         Q_ASSERT_X(repo.ongoingIterations == 0, Q_FUNC_INFO, "don't call removeDeclaration directly from a visitor");
 
-        repo.declarationsCache.remove(item.id);
+        PersistentSymbolTableCache::self().declarations.remove(item.id);
 
         uint index = repo.findIndex(item);
 
@@ -412,27 +477,44 @@ void PersistentSymbolTable::visitFilteredDeclarations(const IndexedQualifiedIden
 {
     ENSURE_CHAIN_READ_LOCKED
 
+    auto& cache = PersistentSymbolTableCache::self();
+
+    const auto visitCached = [&visitor](const CachedDeclarations& cachedDeclarations) {
+        Q_ASSERT(verifyNoDummies(cachedDeclarations));
+
+        for (const auto& declaration : cachedDeclarations) {
+            if (visitor(declaration) == VisitorState::Break) {
+                break;
+            }
+        }
+    };
+
+    // Fast path: the visible declarations are cached already, no need to lock the repository.
+    // NOTE: cheap COW copy, gives us safe reference of data even during recursion
+    const auto hit = cache.declarations.read(id, [&visibility](const CachedDeclarationsByImports& cached) {
+        auto cacheIt = cached.constFind(visibility);
+        return cacheIt == cached.constEnd() ? std::optional<CachedDeclarations>() : std::optional(*cacheIt);
+    });
+    if (hit) {
+        visitCached(*hit);
+        return;
+    }
+
     PersistentSymbolTableItem item;
     item.id = id;
 
-    // This function does not modify the item repository. write() rather than read() is called only in order to modify
-    // declarationsCache and importsCache. Making these two cache data members mutable would allow to call read() here.
-    LockedItemRepository::write<PersistentSymbolTable>([&](PersistentSymbolTableRepo& repo) {
+    LockedItemRepository::read<PersistentSymbolTable>([&](const PersistentSymbolTableRepo& repo) {
         ifVerifyVisitNesting(const auto guard = IterationCounter(repo);)
 
         uint index = repo.findIndex(item);
         if (!index) {
+            // Cache the absence as well, lookups of unknown identifiers are frequent
+            cache.declarations.update(id, [&visibility](CachedDeclarationsByImports& cached) {
+                cached.insert(visibility, {});
+            });
             return;
         }
 
-        auto visit = [&visitor](FilteredDeclarationIterator&& filterIterator) {
-            for (; filterIterator; ++filterIterator) {
-                if (visitor(*filterIterator) == VisitorState::Break) {
-                    break;
-                }
-            }
-        };
-
         const PersistentSymbolTableItem* repositoryItem = repo.itemFromIndex(index);
         const auto declarations = Declarations(repositoryItem->declarations(), repositoryItem->declarationsSize(),
                                                repositoryItem->centralFreeItem);
@@ -440,56 +522,47 @@ void PersistentSymbolTable::visitFilteredDeclarations(const IndexedQualifiedIden
         // NOTE: cheap copy here to ensure we don't rely on stable iterators
         //       which cannot be guaranteed due to possible recursion
         const auto cachedImports = [&]() {
-            auto it = repo.importsCache.constFind(visibility);
-            if (it != repo.importsCache.constEnd()) {
-                return *it;
+            if (auto cachedImports = cache.imports.value(visibility)) {
+                return *cachedImports;
             }
 
-            auto cachedImports = CachedIndexedRecursiveImports(visibility.set().stdSet());
-            repo.importsCache.insert(visibility, cachedImports);
+            auto cachedImports = CachedIndexedRecursiveImports(visibility.set().indices());
+            cache.imports.insert(visibility, cachedImports);
             return cachedImports;
         }();
 
         if (declarations.dataSize() <= MinimumCountForCache) {
             // no visibility caching needed
-            visit(FilteredDeclarationIterator(declarations.iterator(), cachedImports));
+            for (auto filterIterator = FilteredDeclarationIterator(declarations.iterator(), cachedImports);
+                 filterIterator; ++filterIterator) {
+                if (visitor(*filterIterator) == VisitorState::Break) {
+                    break;
+                }
+            }
             return;
         }
 
         // Do visibility caching
+        auto cachedDeclarations = CachedDeclarations();
+        {
+            auto cacheVisitor = [&cachedDeclarations](const IndexedDeclaration& decl) {
+                cachedDeclarations.append(decl);
+            };
+
+            using FilteredDeclarationCacheVisitor =
+                ConvenientEmbeddedSetTreeFilterVisitor<IndexedDeclaration, IndexedDeclarationHandler,
+                                                       IndexedTopDUContext, CachedIndexedRecursiveImports,
+                                                       DeclarationTopContextExtractor, decltype(cacheVisitor)>;
+
+            // The visitor visits all the declarations from within its constructor
+            FilteredDeclarationCacheVisitor visitor(cacheVisitor, declarations.iterator(), cachedImports);
+        }
 
-        // NOTE: cheap COW copy, gives us safe reference of data even during recursion
-        const auto cachedDeclarations = [&]() {
-            auto& cached = repo.declarationsCache[id];
-            auto cacheIt = cached.constFind(visibility);
-            if (cacheIt != cached.constEnd()) {
-                return *cacheIt;
-            }
-
-            auto cache = CachedDeclarations();
-            {
-                auto cacheVisitor = [&cache](const IndexedDeclaration& decl) {
-                    cache.append(decl);
-                };
-
-                using FilteredDeclarationCacheVisitor =
-                    ConvenientEmbeddedSetTreeFilterVisitor<IndexedDeclaration, IndexedDeclarationHandler,
-                                                           IndexedTopDUContext, CachedIndexedRecursiveImports,
-                                                           DeclarationTopContextExtractor, decltype(cacheVisitor)>;
-
-                // The visitor visits all the declarations from within its constructor
-                FilteredDeclarationCacheVisitor visitor(cacheVisitor, declarations.iterator(), cachedImports);
-            }
-
-            cached.insert(visibility, cache);
-            return cache;
-        }();
-
-        Q_ASSERT(verifyNoDummies(cachedDeclarations));
+        cache.declarations.update(id, [&](CachedDeclarationsByImports& cached) {
+            cached.insert(visibility, cachedDeclarations);
+        });
 
-        visit(FilteredDeclarationIterator(
-            Declarations::Iterator(cachedDeclarations.constData(), cachedDeclarations.size(), -1), cachedImports,
-            true));
+        visitCached(cachedDeclarations);
     });
 }
 
@@ -562,6 +635,15 @@ void PersistentSymbolTable::dump(const QTextStream& out)
         qout << "Statistics:" << Qt::endl;
         qout << repo.statistics() << Qt::endl;
     });
+
+    const auto printCacheStatistics = [&qout](const char* name, const ShardedLruCacheStatistics& statistics) {
+        qout << name << "cache: hits:" << statistics.hits << "misses:" << statistics.misses
+             << "evictions:" << statistics.evictions << "entries:" << statistics.entries
+             << "used memory:" << statistics.usedMemory << "of" << statistics.memoryBudget << Qt::endl;
+    };
+    const auto cache = cacheStatistics();
+    printCacheStatistics("declarations", cache.declarations);
+    printCacheStatistics("imports", cache.imports);
 }
 
 PersistentSymbolTable& PersistentSymbolTable::self()
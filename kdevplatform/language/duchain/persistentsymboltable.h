@@ -11,6 +11,8 @@
 
 #include "topducontext.h"
 
+#include <util/shardedlrucache.h>
+
 #include <functional>
 
 class QTextStream;
@@ -66,10 +68,20 @@ public:
     //Very expensive: Checks for problems in the symbol table
     void dump(const QTextStream& out);
 
-    //Clears the internal cache. Should be called regularly to save memory
-    // TODO: currently the cache is never cleared. The sizes of the cache containers grow steadily and never shrink.
-    // Consider clearing the cache when at least some of its entries become useless, e.g. when a project is closed.
+    //Clears the internal cache. The cache is bounded and evicts its least recently used entries on its own,
+    //so this is only needed to release all of its memory at once
     void clearCache();
+    //Evicts the least recently used entries of the internal cache until about @p bytes have been freed,
+    //returns the count of bytes actually freed
+    std::size_t releaseCacheMemory(std::size_t bytes);
+
+    struct CacheStatistics
+    {
+        ShardedLruCacheStatistics declarations;
+        ShardedLruCacheStatistics imports;
+    };
+    /// Hit, miss and memory statistics of the cache used by visitFilteredDeclarations()
+    CacheStatistics cacheStatistics() const;
 };
 }
 
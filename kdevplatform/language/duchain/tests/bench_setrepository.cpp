@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "bench_setrepository.h"
+
+#include <language/duchain/duchain.h>
+#include <language/util/basicsetrepository.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include <QRandomGenerator>
+#include <QRecursiveMutex>
+#include <QTest>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+QTEST_GUILESS_MAIN(BenchSetRepository)
+
+using namespace KDevelop;
+using Utils::BasicSetRepository;
+using Utils::Set;
+
+namespace {
+struct Repository
+{
+    QRecursiveMutex mutex;
+    BasicSetRepository repository{QStringLiteral("bench set repository"), &mutex};
+};
+
+std::unique_ptr<Repository> repository;
+
+/**
+ * Creates sets like the recursive imports of files in a project: each set contains a few shared
+ * blocks of indices, like the imports of commonly included headers, and random individual indices.
+ */
+std::vector<Set> createSets(int setCount, int setSize, bool shared)
+{
+    auto* const random = QRandomGenerator::global();
+    std::vector<Set> ret;
+    ret.reserve(setCount);
+    for (int i = 0; i < setCount; ++i) {
+        std::set<uint> indices;
+        if (shared) {
+            // blocks of a tenth of the set size, out of twenty blocks
+            for (int block = 0; block < 5; ++block) {
+                const uint start = 1 + random->bounded(20) * (setSize / 10);
+                for (uint index = start; index < start + setSize / 10; ++index) {
+                    indices.insert(index);
+                }
+            }
+        }
+        while (static_cast<int>(indices.size()) < setSize) {
+            indices.insert(1 + random->bounded(static_cast<uint>(setSize) * 4));
+        }
+        ret.push_back(repository->repository.createSet(indices));
+    }
+    return ret;
+}
+}
+
+Q_DECLARE_METATYPE(std::vector<Set>)
+
+void BenchSetRepository::initTestCase()
+{
+    AutoTestShell::init();
+    TestCore::initialize(Core::NoUi);
+    DUChain::self()->disablePersistentStorage();
+
+    qRegisterMetaType<std::vector<Set>>();
+    repository = std::make_unique<Repository>();
+}
+
+void BenchSetRepository::cleanupTestCase()
+{
+    repository.reset();
+    TestCore::shutdown();
+}
+
+void BenchSetRepository::feedData()
+{
+    QTest::addColumn<bool>("bulk");
+    QTest::addColumn<std::vector<Set>>("sets");
+
+    for (const bool shared : {false, true}) {
+        for (const int setCount : {2, 16, 32}) {
+            for (const int setSize : {100, 1000, 10000}) {
+                const auto sets = createSets(setCount, setSize, shared);
+                for (const bool bulk : {false, true}) {
+                    QTest::addRow("%s-%d-sets-of-%d-%s", shared ? "shared" : "random", setCount, setSize,
+                                  bulk ? "bulk" : "recursive")
+                        << bulk << sets;
+                }
+            }
+        }
+    }
+}
+
+void BenchSetRepository::unite()
+{
+    QFETCH(bool, bulk);
+    QFETCH(std::vector<Set>, sets);
+
+    if (bulk) {
+        QBENCHMARK {
+            repository->repository.createUnion(sets);
+        }
+    } else {
+        QBENCHMARK {
+            Set united;
+            for (const auto& set : sets) {
+                united += set;
+            }
+        }
+    }
+}
+
+void BenchSetRepository::unite_data()
+{
+    feedData();
+}
+
+void BenchSetRepository::intersect()
+{
+    QFETCH(bool, bulk);
+    QFETCH(std::vector<Set>, sets);
+
+    if (bulk) {
+        QBENCHMARK {
+            repository->repository.createIntersection(sets);
+        }
+    } else {
+        QBENCHMARK {
+            Set intersected = sets.front();
+            for (const auto& set : sets) {
+                intersected &= set;
+            }
+        }
+    }
+}
+
+void BenchSetRepository::intersect_data()
+{
+    feedData();
+}
+
+void BenchSetRepository::subtract()
+{
+    QFETCH(bool, bulk);
+    QFETCH(std::vector<Set>, sets);
+
+    const std::vector<Set> subtracted(sets.begin() + 1, sets.end());
+    if (bulk) {
+        QBENCHMARK {
+            repository->repository.createDifference(sets.front(), subtracted);
+        }
+    } else {
+        QBENCHMARK {
+            Set difference = sets.front();
+            for (const auto& set : subtracted) {
+                difference -= set;
+            }
+        }
+    }
+}
+
+void BenchSetRepository::subtract_data()
+{
+    feedData();
+}
+
+#include "moc_bench_setrepository.cpp"
@@ -0,0 +1,32 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_BENCH_SETREPOSITORY_H
+#define KDEVPLATFORM_BENCH_SETREPOSITORY_H
+
+#include <QObject>
+
+class BenchSetRepository
+    : public QObject
+{
+    Q_OBJECT
+
+private:
+    void feedData();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void unite();
+    void unite_data();
+    void intersect();
+    void intersect_data();
+    void subtract();
+    void subtract_data();
+};
+
+#endif // KDEVPLATFORM_BENCH_SETREPOSITORY_H
@@ -0,0 +1,160 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "bench_topcontextloading.h"
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/ducontext.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontext.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+#include <tests/testhelpermacros.h>
+
+#include <QFile>
+#include <QTest>
+
+#include <vector>
+
+QTEST_GUILESS_MAIN(BenchTopContextLoading)
+
+using namespace KDevelop;
+
+namespace {
+/// @return the resident memory of this process in KiB, or -1 where it is not known
+qint64 residentMemory()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+IndexedString urlForFile(int file)
+{
+    return IndexedString(QStringLiteral("/bench/topcontextloading/file%1.cpp").arg(file));
+}
+
+/// Creates and stores @p fileCount top-contexts with @p declarationCount declarations in ten contexts each
+void createStoredFiles(int fileCount, int declarationCount)
+{
+    {
+        DUChainWriteLocker lock;
+        for (int file = 0; file < fileCount; ++file) {
+            const auto url = urlForFile(file);
+            auto* top = new TopDUContext(url, RangeInRevision(0, 0, declarationCount, 0), new ParsingEnvironmentFile(url));
+            DUChain::self()->addDocumentChain(top);
+            for (int context = 0; context < 10; ++context) {
+                const int line = context * declarationCount / 10;
+                auto* child = new DUContext(RangeInRevision(line, 0, line + declarationCount / 10, 0), top);
+                child->setLocalScopeIdentifier(QualifiedIdentifier(QStringLiteral("ns%1").arg(context)));
+                for (int declaration = 0; declaration < declarationCount / 10; ++declaration) {
+                    auto* decl = new Declaration(RangeInRevision(line + declaration, 0, line + declaration, 1), child);
+                    decl->setIdentifier(Identifier(QStringLiteral("declaration%1").arg(declaration)));
+                }
+            }
+        }
+    }
+    // stores and unloads all top-contexts
+    DUChain::self()->storeToDisk();
+}
+
+void removeStoredFiles(int fileCount)
+{
+    DUChainWriteLocker lock;
+    for (int file = 0; file < fileCount; ++file) {
+        if (auto* top = DUChain::self()->chainForDocument(urlForFile(file))) {
+            DUChain::self()->removeDocumentChain(top);
+        }
+    }
+}
+
+/// Loads the stored top-contexts like a warm session does, and visits all their declarations
+std::vector<ReferencedTopDUContext> loadStoredFiles(int fileCount)
+{
+    std::vector<ReferencedTopDUContext> ret;
+    ret.reserve(fileCount);
+    DUChainReadLocker lock;
+    for (int file = 0; file < fileCount; ++file) {
+        auto* top = DUChain::self()->chainForDocument(urlForFile(file));
+        QVERIFY_RETURN(top, ret);
+        int identifiers = 0;
+        const auto contexts = top->childContexts();
+        for (auto* context : contexts) {
+            const auto declarations = context->localDeclarations();
+            for (auto* declaration : declarations) {
+                identifiers += !declaration->identifier().isEmpty();
+            }
+        }
+        QVERIFY_RETURN(identifiers > 0, ret);
+        ret.emplace_back(top);
+    }
+    return ret;
+}
+}
+
+void BenchTopContextLoading::initTestCase()
+{
+    AutoTestShell::init();
+    TestCore::initialize(Core::NoUi);
+    DUChain::self()->disablePersistentStorage(false);
+}
+
+void BenchTopContextLoading::cleanupTestCase()
+{
+    DUChain::self()->disablePersistentStorage(true);
+    TestCore::shutdown();
+}
+
+void BenchTopContextLoading::loadStored()
+{
+    QFETCH(int, fileCount);
+    QFETCH(int, declarationCount);
+
+    createStoredFiles(fileCount, declarationCount);
+
+    // the resident memory once, loading the same files again reuses the memory
+    const qint64 memoryBefore = residentMemory();
+    {
+        const auto loaded = loadStoredFiles(fileCount);
+        const qint64 memoryAfter = residentMemory();
+        if (memoryBefore >= 0 && memoryAfter >= 0) {
+            qInfo() << "resident memory for" << fileCount << "loaded top-contexts:" << (memoryAfter - memoryBefore)
+                    << "KiB";
+        }
+    }
+    DUChain::self()->storeToDisk();
+
+    QBENCHMARK {
+        loadStoredFiles(fileCount);
+        // unloads the top-contexts again, they are unchanged and not written
+        DUChain::self()->storeToDisk();
+    }
+
+    removeStoredFiles(fileCount);
+}
+
+void BenchTopContextLoading::loadStored_data()
+{
+    QTest::addColumn<int>("fileCount");
+    QTest::addColumn<int>("declarationCount");
+
+    QTest::newRow("100-files-of-100") << 100 << 100;
+    QTest::newRow("100-files-of-1000") << 100 << 1000;
+    QTest::newRow("500-files-of-100") << 500 << 100;
+}
+
+#include "moc_bench_topcontextloading.cpp"
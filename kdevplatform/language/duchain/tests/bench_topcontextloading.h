@@ -0,0 +1,25 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_BENCH_TOPCONTEXTLOADING_H
+#define KDEVPLATFORM_BENCH_TOPCONTEXTLOADING_H
+
+#include <QObject>
+
+class BenchTopContextLoading
+    : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadStored();
+    void loadStored_data();
+};
+
+#endif // KDEVPLATFORM_BENCH_TOPCONTEXTLOADING_H
@@ -8,6 +8,7 @@
 
 #include "test_duchain.h"
 
+#include <QFile>
 #include <QTest>
 #include <QElapsedTimer>
 
@@ -16,6 +17,7 @@
 
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/memorygovernor.h>
 #include <language/duchain/persistentsymboltable.h>
 #include <language/duchain/codemodel.h>
 #include <language/duchain/types/typesystemdata.h>
@@ -25,6 +27,9 @@
 #include <language/duchain/duchainregister.h>
 #include <language/duchain/problem.h>
 #include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontextdynamicdata.h>
+#include <language/duchain/uses.h>
+#include <serialization/itemrepositoryregistry.h>
 
 #include <language/codegen/coderepresentation.h>
 
@@ -36,6 +41,8 @@
 #include <algorithm>
 #include <iterator> // needed for std::insert_iterator on windows
 #include <type_traits>
+#include <atomic>
+#include <memory>
 #include <QThread>
 
 //Extremely slow
@@ -375,12 +382,115 @@ void TestDUChain::testStringSets()
 }
 #endif
 
+void TestDUChain::testBulkSetOperations()
+{
+    QRecursiveMutex mutex;
+    BasicSetRepository rep(QStringLiteral("bulk test repository"), &mutex);
+
+    const unsigned int setCount = 6;
+    std::vector<Set> sets;
+    std::vector<std::set<Index>> realSets;
+    for (unsigned int a = 0; a < setCount; ++a) {
+        std::set<Index> indices;
+        // dense and sparse sets, partially overlapping
+        const unsigned int step = a % 2 ? 1 : 7;
+        for (Index index = 1 + a * 50; index < 600 + a * 100; index += step) {
+            if (rand() % 4)
+                indices.insert(index);
+        }
+        sets.push_back(rep.createSet(indices));
+        realSets.push_back(indices);
+    }
+
+    for (unsigned int a = 0; a < setCount; ++a) {
+        const auto indices = sets[a].indices();
+        QCOMPARE(std::set<Index>(indices.begin(), indices.end()), realSets[a]);
+        QVERIFY(std::is_sorted(indices.begin(), indices.end()));
+    }
+
+    // the trees are canonical, so equal sets have equal indices
+    Set united;
+    Set intersected = sets[0];
+    Set subtracted = sets[0];
+    for (unsigned int a = 0; a < setCount; ++a) {
+        united += sets[a];
+        if (a) {
+            intersected &= sets[a];
+            subtracted -= sets[a];
+        }
+    }
+    const std::vector<Set> others(sets.begin() + 1, sets.end());
+    QCOMPARE(rep.createUnion(sets).setIndex(), united.setIndex());
+    QCOMPARE(rep.createIntersection(sets).setIndex(), intersected.setIndex());
+    QCOMPARE(rep.createDifference(sets[0], others).setIndex(), subtracted.setIndex());
+    QCOMPARE(rep.createIntersection({sets[1], sets[3]}).setIndex(), (sets[1] & sets[3]).setIndex());
+
+    // single indices, duplicates and empty inputs
+    QCOMPARE(rep.createUnion({sets[2], Set()}, {1, 3, 5000}).setIndex(),
+             (sets[2] + rep.createSet(std::set<Index>{1, 3, 5000})).setIndex());
+    QCOMPARE(rep.createUnion({sets[2], sets[2]}).setIndex(), sets[2].setIndex());
+    QCOMPARE(rep.createUnion({}).setIndex(), 0u);
+    QCOMPARE(rep.createIntersection({sets[0], Set()}).setIndex(), 0u);
+    QCOMPARE(rep.createDifference(sets[0], {sets[0]}).setIndex(), 0u);
+    QCOMPARE(rep.createDifference(sets[0], {}).setIndex(), sets[0].setIndex());
+}
+
 void TestDUChain::testSymbolTableValid()
 {
     DUChainReadLocker lock(DUChain::lock());
     PersistentSymbolTable::self().dump(QTextStream(stdout));
 }
 
+void TestDUChain::testSymbolTableCache()
+{
+    DUChainWriteLocker lock;
+    auto top = new TopDUContext(IndexedString(QStringLiteral("/test/symboltablecache")), {0, 0, INT_MAX, INT_MAX});
+    DUChain::self()->addDocumentChain(top);
+
+    auto& table = PersistentSymbolTable::self();
+    const IndexedQualifiedIdentifier id(QualifiedIdentifier(QStringLiteral("symbolTableCacheTest")));
+    const auto countVisible = [&] {
+        int count = 0;
+        table.visitFilteredDeclarations(id, top->recursiveImportIndices(), [&count](const IndexedDeclaration&) {
+            ++count;
+            return PersistentSymbolTable::VisitorState::Continue;
+        });
+        return count;
+    };
+    const auto cacheHits = [&] {
+        return table.cacheStatistics().declarations.hits;
+    };
+
+    // unknown identifiers are cached as well
+    QCOMPARE(countVisible(), 0);
+    auto hits = cacheHits();
+    QCOMPARE(countVisible(), 0);
+    QCOMPARE(cacheHits(), hits + 1);
+
+    const IndexedDeclaration first(top->ownIndex(), 1);
+    const IndexedDeclaration second(top->ownIndex(), 2);
+    table.addDeclaration(id, first);
+    table.addDeclaration(id, second);
+
+    hits = cacheHits();
+    QCOMPARE(countVisible(), 2);
+    QCOMPARE(cacheHits(), hits);
+    QCOMPARE(countVisible(), 2);
+    QCOMPARE(cacheHits(), hits + 1);
+
+    // changes invalidate the cached declarations
+    table.removeDeclaration(id, first);
+    QCOMPARE(countVisible(), 1);
+
+    table.removeDeclaration(id, second);
+    QCOMPARE(countVisible(), 0);
+
+    table.clearCache();
+    QCOMPARE(table.cacheStatistics().declarations.entries, 0);
+
+    DUChain::self()->removeDocumentChain(top);
+}
+
 void TestDUChain::testIndexedStrings()
 {
     int testCount  = 600000;
@@ -758,6 +868,78 @@ void TestDUChain::testLockForReadWrite()
     QVERIFY(threads.join(1000));
 }
 
+void TestDUChain::testLockWakesWaiters()
+{
+    DUChainLock lock;
+    lock.setStatisticsEnabled(true);
+    QVERIFY(lock.lockForWrite());
+    // recursive write- and read-locks do not count as separate samples
+    QVERIFY(lock.lockForWrite());
+    QVERIFY(lock.lockForRead());
+    lock.releaseReadLock();
+    lock.releaseWriteLock();
+
+    std::atomic<bool> readLocked = false;
+    const std::unique_ptr<QThread> reader(QThread::create([&] {
+        DUChainReadLocker readLock(&lock);
+        readLocked = true;
+    }));
+    reader->start();
+
+    QThread::msleep(50);
+    QVERIFY(!readLocked);
+
+    lock.releaseWriteLock();
+    QVERIFY(reader->wait(1000));
+    QVERIFY(readLocked);
+
+    const auto statistics = lock.statistics();
+    QCOMPARE(statistics.writeWait.samples, quint64(1));
+    QCOMPARE(statistics.writeHold.samples, quint64(1));
+    QCOMPARE(statistics.readWait.samples, quint64(2));
+    QCOMPARE(statistics.readHold.samples, quint64(2));
+    QCOMPARE(statistics.timeouts, quint64(0));
+
+    lock.resetStatistics();
+    QCOMPARE(lock.statistics().readHold.samples, quint64(0));
+
+    lock.setStatisticsEnabled(false);
+    QVERIFY(lock.lockForWrite());
+    lock.releaseWriteLock();
+    QVERIFY(lock.lockForRead());
+    lock.releaseReadLock();
+    QCOMPARE(lock.statistics().writeHold.samples, quint64(0));
+    QCOMPARE(lock.statistics().readHold.samples, quint64(0));
+}
+
+void TestDUChain::testLockTimeout()
+{
+    DUChainLock lock;
+    QVERIFY(lock.lockForRead());
+
+    bool writeLocked = true;
+    const auto tryLockForWrite = [&] {
+        writeLocked = lock.lockForWrite(50);
+        if (writeLocked) {
+            lock.releaseWriteLock();
+        }
+    };
+
+    std::unique_ptr<QThread> writer(QThread::create(tryLockForWrite));
+    writer->start();
+    QVERIFY(writer->wait(1000));
+    QVERIFY(!writeLocked);
+    QCOMPARE(lock.statistics().timeouts, quint64(1));
+
+    lock.releaseReadLock();
+
+    writer.reset(QThread::create(tryLockForWrite));
+    writer->start();
+    QVERIFY(writer->wait(1000));
+    QVERIFY(writeLocked);
+    QCOMPARE(lock.statistics().timeouts, quint64(1));
+}
+
 void TestDUChain::testProblemSerialization()
 {
     DUChain::self()->disablePersistentStorage(false);
@@ -835,6 +1017,195 @@ void TestDUChain::testProblemSerialization()
     QVERIFY(parent->diagnostics().isEmpty());
 }
 
+void TestDUChain::testCompressedStorage()
+{
+    DUChain::self()->disablePersistentStorage(false);
+    TopDUContextDynamicData::setCompressionEnabled(true);
+
+    const IndexedString url("/my/compressed/file");
+    const auto statisticsBefore = TopDUContextDynamicData::storageStatistics();
+
+    {
+        DUChainWriteLocker lock;
+        auto top = new TopDUContext(url, {0, 0, 100, 0}, new ParsingEnvironmentFile(url));
+        DUChain::self()->addDocumentChain(top);
+        auto context = new DUContext({1, 0, 99, 0}, top);
+        for (int i = 0; i < 50; ++i) {
+            auto dec = new Declaration({i + 2, 0, i + 2, 1}, context);
+            dec->setIdentifier(Identifier(QStringLiteral("compressedDeclaration%1").arg(i)));
+        }
+    }
+
+    // stores and unloads the top-context
+    DUChain::self()->storeToDisk();
+
+    const auto statisticsStored = TopDUContextDynamicData::storageStatistics();
+    QCOMPARE(statisticsStored.storedFiles, statisticsBefore.storedFiles + 1);
+    QVERIFY(statisticsStored.storedBytes > statisticsStored.storedCompressedBytes);
+
+    {
+        DUChainWriteLocker lock;
+        auto top = DUChain::self()->chainForDocument(url);
+        QVERIFY(top);
+        const auto loadedBlocks = TopDUContextDynamicData::storageStatistics().loadedBlocks;
+        QVERIFY(loadedBlocks > statisticsStored.loadedBlocks);
+
+        QCOMPARE(top->childContexts().size(), 1);
+        const auto declarations = top->childContexts().first()->localDeclarations();
+        QCOMPARE(declarations.size(), 50);
+        QCOMPARE(declarations.last()->identifier(), Identifier(QStringLiteral("compressedDeclaration49")));
+        // the offsets and the item data are decompressed on the first access
+        QCOMPARE(TopDUContextDynamicData::storageStatistics().loadedBlocks, loadedBlocks + 2);
+
+        DUChain::self()->removeDocumentChain(top);
+    }
+
+    TopDUContextDynamicData::setCompressionEnabled(false);
+    DUChain::self()->disablePersistentStorage(true);
+}
+
+void TestDUChain::testCompressedBlockSizes()
+{
+    DUChain::self()->disablePersistentStorage(false);
+    TopDUContextDynamicData::setCompressionEnabled(true);
+
+    // the top-context data block is longer than the following block of item offsets
+    const IndexedString url("/my/compressed/blocks");
+    uint topIndex;
+    {
+        DUChainWriteLocker lock;
+        auto top = new TopDUContext(url, {0, 0, 10, 0}, new ParsingEnvironmentFile(url));
+        DUChain::self()->addDocumentChain(top);
+        auto dec = new Declaration({1, 0, 1, 1}, top);
+        dec->setIdentifier(Identifier(QStringLiteral("onlyDeclaration")));
+        topIndex = top->ownIndex();
+    }
+
+    DUChain::self()->storeToDisk();
+
+    QFile file(globalItemRepositoryRegistry().path() + QLatin1String("/topcontexts/") + QString::number(topIndex));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    const char* pos = data.constData() + sizeof(uint);
+    const char* const end = data.constData() + data.size();
+    QVector<QByteArray> blocks;
+    while (end - pos >= qint64(sizeof(uint))) {
+        uint size;
+        memcpy(&size, pos, sizeof(uint));
+        pos += sizeof(uint);
+        QVERIFY(end - pos >= qint64(size));
+        blocks.append(qUncompress(reinterpret_cast<const uchar*>(pos), size));
+        pos += size;
+    }
+    QCOMPARE(blocks.size(), 3);
+    QVERIFY(blocks[0].size() > blocks[1].size());
+    // the counts of contexts, declarations and problems, and the offset of the one declaration
+    QCOMPARE(blocks[1].size(), qsizetype(3 * sizeof(uint) + sizeof(TopDUContextDynamicData::ItemDataInfo)));
+
+    {
+        DUChainWriteLocker lock;
+        auto top = DUChain::self()->chainForDocument(url);
+        QVERIFY(top);
+        QCOMPARE(top->localDeclarations().size(), 1);
+        DUChain::self()->removeDocumentChain(top);
+    }
+
+    TopDUContextDynamicData::setCompressionEnabled(false);
+    DUChain::self()->disablePersistentStorage(true);
+}
+
+void TestDUChain::testUseRanges()
+{
+    const IndexedString declarationUrl("/my/used/file");
+    const IndexedString useUrl("/my/using/file");
+    const RangeInRevision useRange(5, 2, 5, 8);
+
+    ReferencedTopDUContext useTopReference;
+    IndexedTopDUContext indexedUseTop;
+    DeclarationId usedId;
+    {
+        DUChainWriteLocker lock;
+        auto declarationTop = new TopDUContext(declarationUrl, {0, 0, 10, 0},
+                                               new ParsingEnvironmentFile(declarationUrl));
+        DUChain::self()->addDocumentChain(declarationTop);
+        auto declaration = new Declaration({1, 0, 1, 5}, declarationTop);
+        declaration->setIdentifier(Identifier(QStringLiteral("usedDeclaration")));
+
+        auto useTop = new TopDUContext(useUrl, {0, 0, 10, 0}, new ParsingEnvironmentFile(useUrl));
+        DUChain::self()->addDocumentChain(useTop);
+        useTop->setFeatures(TopDUContext::AllDeclarationsContextsAndUses);
+        auto context = new DUContext({1, 0, 9, 0}, useTop);
+        context->createUse(useTop->indexForUsedDeclaration(declaration), useRange);
+
+        useTopReference = useTop;
+        indexedUseTop = useTop->indexed();
+        usedId = useTop->usedDeclarationIdForIndex(useTop->indexForUsedDeclaration(declaration, false));
+        QVERIFY(usedId.isValid());
+        QVERIFY(!DUChain::uses()->hasIndexedUseRanges(indexedUseTop));
+    }
+
+    DUChain::self()->emitUpdateReady(useUrl, useTopReference);
+
+    {
+        DUChainWriteLocker lock;
+        QVERIFY(DUChain::uses()->hasIndexedUseRanges(indexedUseTop));
+        const auto ranges = DUChain::uses()->useRanges(usedId, indexedUseTop);
+        QCOMPARE(ranges.size(), 1);
+        QCOMPARE(ranges.first(), useRange);
+
+        auto declarationTop = DUChain::self()->chainForDocument(declarationUrl);
+        QVERIFY(declarationTop);
+        const auto uses = declarationTop->localDeclarations().first()->uses();
+        QCOMPARE(uses.value(useUrl), QVector<RangeInRevision>{useRange});
+
+        // the ranges are dropped together with the top-context, its index may be reused
+        useTopReference = nullptr;
+        DUChain::self()->removeDocumentChain(indexedUseTop.data());
+        QVERIFY(!DUChain::uses()->hasIndexedUseRanges(indexedUseTop));
+        QVERIFY(DUChain::uses()->useRanges(usedId, indexedUseTop).isEmpty());
+
+        DUChain::self()->removeDocumentChain(declarationTop);
+    }
+}
+
+void TestDUChain::testMemoryGovernor()
+{
+    auto* governor = MemoryGovernor::self();
+    const QString category = QStringLiteral("TestDUChain");
+
+    qint64 released = 0;
+    governor->registerConsumer(category, []() {
+        return qint64(1) << 40;
+    }, [&released](qint64 bytes) {
+        released += bytes;
+    });
+
+    governor->setBudget(0);
+    QVERIFY(governor->budget() > 0);
+
+    // every process exceeds a budget of one byte
+    governor->setBudget(1);
+    governor->update();
+    QVERIFY(governor->isUnderPressure());
+    QVERIFY(released > 0);
+
+    const auto usage = governor->usage();
+    QVERIFY(usage.size() >= 2);
+    QCOMPARE(usage.first().category, QStringLiteral("Resident"));
+    QVERIFY(usage.first().bytes > 0);
+    const auto it = std::find_if(usage.begin(), usage.end(), [&category](const MemoryGovernor::Usage& entry) {
+        return entry.category == category;
+    });
+    QVERIFY(it != usage.end());
+    QCOMPARE(it->bytes, qint64(1) << 40);
+    QVERIFY(governor->usageReport().contains(category));
+
+    governor->unregisterConsumer(category);
+    governor->setBudget(0);
+    governor->update();
+    QVERIFY(!governor->isUnderPressure());
+}
+
 void TestDUChain::testIdentifiers()
 {
     QualifiedIdentifier aj(QStringLiteral("::Area::jump"));
@@ -24,13 +24,21 @@ private Q_SLOTS:
     // Causes stack overflow on Windows (MSVC2015)
     void testStringSets();
 #endif
+    void testBulkSetOperations();
     void testSymbolTableValid();
+    void testSymbolTableCache();
     void testIndexedStrings();
     void testImportStructure();
     void testLockForWrite();
     void testLockForRead();
     void testLockForReadWrite();
+    void testLockWakesWaiters();
+    void testLockTimeout();
     void testProblemSerialization();
+    void testCompressedStorage();
+    void testCompressedBlockSizes();
+    void testUseRanges();
+    void testMemoryGovernor();
     void testIdentifiers();
     void testTypePtr();
     ///NOTE: these are not "automated"!
@@ -8,6 +8,7 @@
 #include "topducontext.h"
 #include "topducontextutils.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "persistentsymboltable.h"
@@ -383,8 +384,33 @@ const TopDUContext::IndexedRecursiveImports& TopDUContext::recursiveImportIndice
     return m_local->m_indexedRecursiveImports;
 }
 
+void TopDUContextData::RecursiveImportsCollector::mergeImportsCaches() const
+{
+    // the repository shares the common subtrees of the caches, so adding them one by one is cheap here
+    for (; mergedCount < importsCaches.size(); ++mergedCount) {
+        mergedImportsCaches += importsCaches[mergedCount];
+    }
+}
+
+bool TopDUContextData::RecursiveImportsCollector::contains(uint index) const
+{
+    if (indices.find(index) != indices.end())
+        return true;
+
+    // one lookup in the union instead of one per imports cache
+    mergeImportsCaches();
+    return mergedImportsCaches.containsIndex(index);
+}
+
+TopDUContext::IndexedRecursiveImports TopDUContextData::RecursiveImportsCollector::unite() const
+{
+    mergeImportsCaches();
+    return TopDUContext::IndexedRecursiveImports::unite({mergedImportsCaches},
+                                                        std::vector<uint>(indices.begin(), indices.end()));
+}
+
 void TopDUContextData::updateImportCacheRecursion(uint baseIndex, IndexedTopDUContext currentContext,
-                                                  TopDUContext::IndexedRecursiveImports& visited)
+                                                  RecursiveImportsCollector& visited)
 {
     if (visited.contains(currentContext.index()))
         return;
@@ -393,7 +419,7 @@ void TopDUContextData::updateImportCacheRecursion(uint baseIndex, IndexedTopDUCo
         qCDebug(LANGUAGE) << "importing invalid context";
         return;
     }
-    visited.insert(currentContext.index());
+    visited.indices.insert(currentContext.index());
 
     const TopDUContextData* currentData = currentContext.data()->topContext()->d_func();
     if (currentData->m_importsCache.contains(baseIndex) || currentData->m_importsCache.isEmpty()) {
@@ -407,7 +433,7 @@ void TopDUContextData::updateImportCacheRecursion(uint baseIndex, IndexedTopDUCo
         }
     } else {
         //If we don't have a loop with baseIndex, we can safely just merge with the imported importscache
-        visited += currentData->m_importsCache;
+        visited.importsCaches.push_back(currentData->m_importsCache);
     }
 }
 
@@ -444,7 +470,10 @@ void TopDUContext::updateImportsCache()
         d_func_dynamic()->m_importsCache = IndexedRecursiveImports(visited);
     } else {
         d_func_dynamic()->m_importsCache = IndexedRecursiveImports();
-        TopDUContextData::updateImportCacheRecursion(ownIndex(), this, d_func_dynamic()->m_importsCache);
+        TopDUContextData::RecursiveImportsCollector imports;
+        TopDUContextData::updateImportCacheRecursion(ownIndex(), this, imports);
+        // uniting all parts at once is much faster than adding them one by one
+        d_func_dynamic()->m_importsCache = imports.unite();
     }
     Q_ASSERT(d_func_dynamic()->m_importsCache.contains(IndexedTopDUContext(this)));
     Q_ASSERT(usingImportsCache());
@@ -1148,6 +1177,15 @@ Declaration* TopDUContext::usedDeclarationForIndex(unsigned int declarationIndex
         return nullptr;
 }
 
+DeclarationId TopDUContext::usedDeclarationIdForIndex(unsigned int declarationIndex) const
+{
+    ENSURE_CAN_READ
+    if (declarationIndex & (1 << 31) || declarationIndex >= d_func()->m_usedDeclarationIdsSize()) {
+        return DeclarationId();
+    }
+    return d_func()->m_usedDeclarationIds()[declarationIndex];
+}
+
 int TopDUContext::indexForUsedDeclaration(Declaration* declaration, bool create)
 {
     if (create) {
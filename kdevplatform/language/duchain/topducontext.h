@@ -26,6 +26,7 @@ class ParsingEnvironmentFile;
 class TopDUContextData;
 class TopDUContextLocalPrivate;
 class IndexedTopDUContext;
+class DeclarationId;
 //   class TopDUContextDynamicData;
 class Problem;
 class DeclarationChecker;
@@ -221,6 +222,13 @@ public:
      * */
     Declaration* usedDeclarationForIndex(unsigned int declarationIndex) const;
 
+    /**
+     * Retrieves the id of the used declaration, without loading the declaration
+     * @param declarationIndex The index of the declaration, as stored in a use
+     * @return The id, or an invalid id if the declaration is local to this top-context
+     * */
+    DeclarationId usedDeclarationIdForIndex(unsigned int declarationIndex) const;
+
     /**
      * You can use this before you rebuild all uses. This does not affect any uses directly,
      * it only invalidates the mapping of declarationIndices to Declarations.
@@ -68,9 +68,27 @@ public:
     END_APPENDED_LISTS(TopDUContextData, m_problems);
 
 private:
+    ///The parts of a recursive imports set, which are united in one bulk operation once all are known
+    struct RecursiveImportsCollector
+    {
+        bool contains(uint index) const;
+        TopDUContext::IndexedRecursiveImports unite() const;
+
+        std::set<uint> indices;
+        std::vector<TopDUContext::IndexedRecursiveImports> importsCaches;
+
+    private:
+        /// Merges the imports caches added since the last call into mergedImportsCaches
+        void mergeImportsCaches() const;
+
+        /// The union of the first mergedCount importsCaches
+        mutable TopDUContext::IndexedRecursiveImports mergedImportsCaches;
+        mutable std::size_t mergedCount = 0;
+    };
+
     static void updateImportCacheRecursion(IndexedTopDUContext currentContext, std::set<uint>& visited);
     static void updateImportCacheRecursion(uint baseIndex, IndexedTopDUContext currentContext,
-                                           TopDUContext::IndexedRecursiveImports& imports);
+                                           RecursiveImportsCollector& imports);
     friend class TopDUContext;
 };
 }
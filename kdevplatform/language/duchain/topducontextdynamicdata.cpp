@@ -7,9 +7,14 @@
 
 #include "topducontextdynamicdata.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <typeinfo>
+#include <QBuffer>
 #include <QFile>
 #include <QByteArray>
+#include <QElapsedTimer>
 
 #include "declaration.h"
 #include "declarationdata.h"
@@ -25,8 +30,6 @@
 
 //#define DEBUG_DATA_INFO
 
-//This might be problematic on some systems, because really many mmaps are created
-#define USE_MMAP
 using namespace KDevelop;
 
 namespace {
@@ -154,6 +157,145 @@ QString pathForTopContext(const uint topContextIndex)
     return basePath() + QString::number(topContextIndex);
 }
 
+/**
+ * Maps the whole top-context file @p file.
+ *
+ * The mapping is private, so the loaded data can point into it directly: pages are only copied when
+ * something writes to them, and nothing is ever written back to the file.
+ *
+ * @return the mapped data, or nullptr if the file cannot be mapped
+ */
+uchar* mapTopContextFile(QFile& file)
+{
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(uint))) {
+        return nullptr;
+    }
+    auto* data = file.map(0, size, QFileDevice::MapPrivateOption);
+    if (!data) {
+        qCDebug(LANGUAGE) << "Failed to map" << file.fileName() << file.errorString();
+    }
+    return data;
+}
+
+/// @return the size of the top-context data at the start of the top-context file @p data of size @p size, or 0 if it is truncated
+uint readTopContextDataSize(const char* data, qint64 size)
+{
+    if (size < qint64(sizeof(uint))) {
+        return 0;
+    }
+    uint topContextDataSize;
+    memcpy(&topContextDataSize, data, sizeof(uint));
+    if (size - qint64(sizeof(uint)) < qint64(topContextDataSize)) {
+        return 0;
+    }
+    return topContextDataSize;
+}
+
+/// Starts compressed top-context files, uncompressed ones start with the size of the top-context data instead
+constexpr uint CompressedFileMarker = 0xffffffff;
+
+struct StorageCounters
+{
+    std::atomic<quint64> storedFiles = 0;
+    std::atomic<quint64> storedBytes = 0;
+    std::atomic<quint64> storedCompressedBytes = 0;
+    std::atomic<quint64> loadedBlocks = 0;
+    std::atomic<quint64> loadedBytes = 0;
+    std::atomic<quint64> loadedCompressedBytes = 0;
+    std::atomic<quint64> decompressionTime = 0;
+};
+
+StorageCounters& storageCounters()
+{
+    static StorageCounters counters;
+    return counters;
+}
+
+std::atomic<bool>& compressionEnabledFlag()
+{
+    static std::atomic<bool> enabled = qEnvironmentVariableIsSet("KDEV_DUCHAIN_COMPRESS_TOPCONTEXTS");
+    return enabled;
+}
+
+bool isCompressedFile(const char* data, qint64 size)
+{
+    if (size < qint64(sizeof(uint))) {
+        return false;
+    }
+    uint marker;
+    memcpy(&marker, data, sizeof(uint));
+    return marker == CompressedFileMarker;
+}
+
+void writeCompressedBlock(QIODevice* file, const QByteArray& block)
+{
+    // the fastest level, loading speed matters more than the last percents of size
+    const QByteArray compressed = qCompress(block, 1);
+    const uint size = compressed.size();
+    file->write(reinterpret_cast<const char*>(&size), sizeof(uint));
+    file->write(compressed);
+
+    auto& counters = storageCounters();
+    counters.storedBytes.fetch_add(block.size(), std::memory_order_relaxed);
+    counters.storedCompressedBytes.fetch_add(sizeof(uint) + size, std::memory_order_relaxed);
+}
+
+/// Advances @p data past the compressed block it points to, @return the size of the block or -1 if it is truncated
+qint64 skipCompressedBlock(const char*& data, const char* end)
+{
+    uint size;
+    if (end - data < qint64(sizeof(uint))) {
+        data = end;
+        return -1;
+    }
+    memcpy(&size, data, sizeof(uint));
+    data += sizeof(uint);
+    if (end - data < qint64(size)) {
+        data = end;
+        return -1;
+    }
+    data += size;
+    return size;
+}
+
+/// Decompresses the block @p data points to and advances it past the block, @return an empty array on error
+QByteArray readCompressedBlock(const char*& data, const char* end)
+{
+    const qint64 size = skipCompressedBlock(data, end);
+    if (size < 0) {
+        return {};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray ret = qUncompress(reinterpret_cast<const uchar*>(data - size), size);
+
+    auto& counters = storageCounters();
+    counters.loadedBlocks.fetch_add(1, std::memory_order_relaxed);
+    counters.loadedBytes.fetch_add(ret.size(), std::memory_order_relaxed);
+    counters.loadedCompressedBytes.fetch_add(sizeof(uint) + size, std::memory_order_relaxed);
+    counters.decompressionTime.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+    return ret;
+}
+
+/**
+ * Decompresses the first block of a compressed top-context file, @p data points behind the marker
+ * and is advanced past the block.
+ *
+ * @return the top-context data, or an empty array if it is corrupted
+ */
+QByteArray readCompressedTopContextData(const char*& data, const char* end)
+{
+    QByteArray ret = readCompressedBlock(data, end);
+    const uint size = readTopContextDataSize(ret.constData(), ret.size());
+    if (size < sizeof(TopDUContextData) || size != ret.size() - sizeof(uint)) {
+        return {};
+    }
+    ret.remove(0, sizeof(uint));
+    return ret;
+}
+
 enum LoadType {
     PartialLoad, ///< Only load the direct member data
     FullLoad   ///< Load everything, including appended lists
@@ -166,8 +308,43 @@ void loadTopDUContextData(const uint topContextIndex, LoadType loadType, F callb
         return;
     }
 
+    if (const auto* map = mapTopContextFile(file)) {
+        const auto* data = reinterpret_cast<const char*>(map);
+        const auto* const end = data + file.size();
+        if (isCompressedFile(data, file.size())) {
+            data += sizeof(uint);
+            const QByteArray topContextData = readCompressedTopContextData(data, end);
+            if (topContextData.isEmpty()) {
+                qCWarning(LANGUAGE) << "Top-context file is corrupted" << file.fileName();
+                return;
+            }
+            callback(reinterpret_cast<const TopDUContextData*>(topContextData.constData()));
+            return;
+        }
+
+        const uint size = readTopContextDataSize(data, file.size());
+        if (size < sizeof(TopDUContextData)) {
+            qCWarning(LANGUAGE) << "Top-context file is truncated" << file.fileName();
+            return;
+        }
+        callback(reinterpret_cast<const TopDUContextData*>(data + sizeof(uint)));
+        // the file is unmapped when it is destroyed
+        return;
+    }
+
     uint readValue;
     file.read(reinterpret_cast<char*>(&readValue), sizeof(uint));
+    if (readValue == CompressedFileMarker) {
+        const QByteArray fileData = file.readAll();
+        const char* data = fileData.constData();
+        const QByteArray topContextData = readCompressedTopContextData(data, data + fileData.size());
+        if (topContextData.isEmpty()) {
+            qCWarning(LANGUAGE) << "Top-context file is corrupted" << file.fileName();
+            return;
+        }
+        callback(reinterpret_cast<const TopDUContextData*>(topContextData.constData()));
+        return;
+    }
     // now readValue is filled with the top-context data size
     Q_ASSERT(readValue >= sizeof(TopDUContextData));
     const QByteArray data = file.read(loadType == FullLoad ? readValue : sizeof(TopDUContextData));
@@ -422,23 +599,25 @@ void TopDUContextDynamicData::DUChainItemStorage<Item>::deleteOnDisk()
 }
 
 template <class Item>
-void TopDUContextDynamicData::DUChainItemStorage<Item>::loadData(QFile* file) const
+void TopDUContextDynamicData::DUChainItemStorage<Item>::loadData(const char*& data) const
 {
     Q_ASSERT(offsets.isEmpty());
     Q_ASSERT(items.isEmpty());
 
     uint readValue;
-    file->read(reinterpret_cast<char*>(&readValue), sizeof(uint));
+    memcpy(&readValue, data, sizeof(uint));
+    data += sizeof(uint);
     offsets.resize(readValue);
 
-    file->read(reinterpret_cast<char*>(offsets.data()), sizeof(ItemDataInfo) * offsets.size());
+    memcpy(offsets.data(), data, sizeof(ItemDataInfo) * offsets.size());
+    data += sizeof(ItemDataInfo) * offsets.size();
 
     //Fill with zeroes for now, will be initialized on-demand
     items.resize(offsets.size());
 }
 
 template <class Item>
-void TopDUContextDynamicData::DUChainItemStorage<Item>::writeData(QFile* file)
+void TopDUContextDynamicData::DUChainItemStorage<Item>::writeData(QIODevice* file)
 {
     uint writeValue = offsets.size();
     file->write(reinterpret_cast<const char*>(&writeValue), sizeof(uint));
@@ -466,6 +645,8 @@ TopDUContextDynamicData::TopDUContextDynamicData(TopDUContext* topContext)
     , m_onDisk(false)
     , m_dataLoaded(true)
     , m_mappedFile(nullptr)
+    , m_mappedFileData(nullptr)
+    , m_mappedFileSize(0)
     , m_mappedData(nullptr)
     , m_mappedDataSize(0)
     , m_itemRetrievalForbidden(false)
@@ -488,10 +669,52 @@ void KDevelop::TopDUContextDynamicData::unmap()
 {
     delete m_mappedFile;
     m_mappedFile = nullptr;
+    m_mappedFileData = nullptr;
+    m_mappedFileSize = 0;
     m_mappedData = nullptr;
     m_mappedDataSize = 0;
 }
 
+void TopDUContextDynamicData::setCompressionEnabled(bool enabled)
+{
+    compressionEnabledFlag().store(enabled, std::memory_order_relaxed);
+}
+
+bool TopDUContextDynamicData::compressionEnabled()
+{
+    return compressionEnabledFlag().load(std::memory_order_relaxed);
+}
+
+TopDUContextStorageStatistics TopDUContextDynamicData::storageStatistics()
+{
+    const auto& counters = storageCounters();
+    TopDUContextStorageStatistics ret;
+    ret.storedFiles = counters.storedFiles.load(std::memory_order_relaxed);
+    ret.storedBytes = counters.storedBytes.load(std::memory_order_relaxed);
+    ret.storedCompressedBytes = counters.storedCompressedBytes.load(std::memory_order_relaxed);
+    ret.loadedBlocks = counters.loadedBlocks.load(std::memory_order_relaxed);
+    ret.loadedBytes = counters.loadedBytes.load(std::memory_order_relaxed);
+    ret.loadedCompressedBytes = counters.loadedCompressedBytes.load(std::memory_order_relaxed);
+    ret.decompressionTime = counters.decompressionTime.load(std::memory_order_relaxed);
+    return ret;
+}
+
+QString TopDUContextStorageStatistics::print() const
+{
+    QString ret;
+    ret += QStringLiteral("stored compressed files: %1 bytes: %2 compressed bytes: %3 compression ratio: %4")
+               .arg(storedFiles)
+               .arg(storedBytes)
+               .arg(storedCompressedBytes)
+               .arg(compressionRatio());
+    ret += QStringLiteral("\nloaded compressed blocks: %1 bytes: %2 compressed bytes: %3 load throughput: %4 MiB/s")
+               .arg(loadedBlocks)
+               .arg(loadedBytes)
+               .arg(loadedCompressedBytes)
+               .arg(loadThroughput() / (1024 * 1024));
+    return ret;
+}
+
 bool TopDUContextDynamicData::fileExists(uint topContextIndex)
 {
     return QFile::exists(pathForTopContext(topContextIndex));
@@ -540,39 +763,70 @@ void TopDUContextDynamicData::loadData() const
     Q_ASSERT(!m_dataLoaded);
     Q_ASSERT(m_data.isEmpty());
 
-    auto* file = new QFile(pathForTopContext(m_topContext->ownIndex()));
-    bool open = file->open(QIODevice::ReadOnly);
-    Q_UNUSED(open);
-    Q_ASSERT(open);
-    Q_ASSERT(file->size());
+    // usually load() has mapped the file already, only if that failed it is tried again or read
+    QByteArray fileData;
+    if (!m_mappedFile) {
+        auto file = std::make_unique<QFile>(pathForTopContext(m_topContext->ownIndex()));
+        bool open = file->open(QIODevice::ReadOnly);
+        Q_UNUSED(open);
+        Q_ASSERT(open);
+        Q_ASSERT(file->size());
+
+        if (auto* map = mapTopContextFile(*file)) {
+            m_mappedFileData = map;
+            m_mappedFileSize = file->size();
+            file->close(); //Close the file, so there is less open file descriptors(May be problematic)
+            m_mappedFile = file.release();
+        } else {
+            fileData = file->readAll();
+        }
+    }
 
-    //Skip the offsets, we're already read them
-    //Skip top-context data
-    uint readValue;
-    file->read(reinterpret_cast<char*>(&readValue), sizeof(uint));
-    file->seek(readValue + file->pos());
+    const char* const begin =
+        m_mappedFile ? reinterpret_cast<const char*>(m_mappedFileData) : fileData.constData();
+    const qint64 size = m_mappedFile ? m_mappedFileSize : fileData.size();
+
+    if (isCompressedFile(begin, size)) {
+        const char* data = begin + sizeof(uint);
+        const char* const end = begin + size;
+        // the top-context data was decompressed by load()
+        skipCompressedBlock(data, end);
+        const QByteArray offsets = readCompressedBlock(data, end);
+        const QByteArray itemData = readCompressedBlock(data, end);
+
+        const uint noItems[3] = {};
+        const char* offsetsData = reinterpret_cast<const char*>(noItems);
+        if (offsets.size() >= qint64(sizeof(noItems)) && !itemData.isEmpty()) {
+            offsetsData = offsets.constData();
+        } else {
+            qCWarning(LANGUAGE) << "Top-context file is corrupted" << pathForTopContext(m_topContext->ownIndex());
+        }
+        m_contexts.loadData(offsetsData);
+        m_declarations.loadData(offsetsData);
+        m_problems.loadData(offsetsData);
+
+        // everything needed was decompressed, nothing points into the compressed file
+        unmap();
+        m_data.append({itemData, ( uint )itemData.size()});
+        m_dataLoaded = true;
+        return;
+    }
 
-    m_contexts.loadData(file);
-    m_declarations.loadData(file);
-    m_problems.loadData(file);
+    //Skip top-context data
+    const char* data = begin + sizeof(uint) + readTopContextDataSize(begin, size);
 
-#ifdef USE_MMAP
+    m_contexts.loadData(data);
+    m_declarations.loadData(data);
+    m_problems.loadData(data);
 
-    m_mappedData = file->map(file->pos(), file->size() - file->pos());
-    if (m_mappedData) {
-        m_mappedFile = file;
-        m_mappedDataSize = file->size() - file->pos();
-        file->close(); //Close the file, so there is less open file descriptors(May be problematic)
+    const qint64 itemDataOffset = data - begin;
+    Q_ASSERT(itemDataOffset <= size);
+    if (m_mappedFile) {
+        m_mappedData = m_mappedFileData + itemDataOffset;
+        m_mappedDataSize = size - itemDataOffset;
     } else {
-        qCDebug(LANGUAGE) << "Failed to map" << file->fileName();
-    }
-
-#endif
-
-    if (!m_mappedFile) {
-        QByteArray data = file->readAll();
-        m_data.append({data, ( uint )data.size()});
-        delete file;
+        fileData.remove(0, itemDataOffset);
+        m_data.append({fileData, ( uint )fileData.size()});
     }
 
     m_dataLoaded = true;
@@ -580,22 +834,59 @@ void TopDUContextDynamicData::loadData() const
 
 TopDUContext* TopDUContextDynamicData::load(uint topContextIndex)
 {
-    QFile file(pathForTopContext(topContextIndex));
-    if (file.open(QIODevice::ReadOnly)) {
-        if (file.size() == 0) {
-            qCWarning(LANGUAGE) << "Top-context file is empty" << file.fileName();
+    auto file = std::make_unique<QFile>(pathForTopContext(topContextIndex));
+    if (file->open(QIODevice::ReadOnly)) {
+        const qint64 fileSize = file->size();
+        if (fileSize == 0) {
+            qCWarning(LANGUAGE) << "Top-context file is empty" << file->fileName();
             return nullptr;
         }
 
-        uint readValue;
-        file.read(reinterpret_cast<char*>(&readValue), sizeof(uint));
-        //now readValue is filled with the top-context data size
-        QByteArray topContextData = file.read(readValue);
+        // Map the file, so that the top-context data and later the item data point into the mapping
+        // instead of being read into copies. The mapping is kept until the top-context is stored or unloaded.
+        QByteArray topContextData;
+        auto* map = mapTopContextFile(*file);
+        if (map && isCompressedFile(reinterpret_cast<const char*>(map), fileSize)) {
+            const char* data = reinterpret_cast<const char*>(map) + sizeof(uint);
+            topContextData = readCompressedTopContextData(data, reinterpret_cast<const char*>(map) + fileSize);
+            // the rest is decompressed on its first access, until then the mapping is not needed
+            file->unmap(map);
+            map = nullptr;
+            if (topContextData.isEmpty()) {
+                qCWarning(LANGUAGE) << "Top-context file is corrupted" << file->fileName();
+                return nullptr;
+            }
+        } else if (map) {
+            const auto* data = reinterpret_cast<const char*>(map);
+            const uint size = readTopContextDataSize(data, fileSize);
+            if (!size) {
+                qCWarning(LANGUAGE) << "Top-context file is truncated" << file->fileName();
+                return nullptr;
+            }
+            topContextData = QByteArray::fromRawData(data + sizeof(uint), size);
+            file->close();
+        } else {
+            uint readValue;
+            file->read(reinterpret_cast<char*>(&readValue), sizeof(uint));
+            if (readValue == CompressedFileMarker) {
+                const QByteArray fileData = file->readAll();
+                const char* data = fileData.constData();
+                topContextData = readCompressedTopContextData(data, data + fileData.size());
+                if (topContextData.isEmpty()) {
+                    qCWarning(LANGUAGE) << "Top-context file is corrupted" << file->fileName();
+                    return nullptr;
+                }
+            } else {
+                //now readValue is filled with the top-context data size
+                topContextData = file->read(readValue);
+            }
+        }
 
-        auto* topData = reinterpret_cast<DUChainBaseData*>(topContextData.data());
+        // don't detach from the mapping, private pages are copied on write anyway
+        auto* topData = reinterpret_cast<DUChainBaseData*>(const_cast<char*>(topContextData.constData()));
         auto* ret = dynamic_cast<TopDUContext*>(DUChainItemSystem::self().create(topData));
         if (!ret) {
-            qCWarning(LANGUAGE) << "Cannot load a top-context from file" << file.fileName() <<
+            qCWarning(LANGUAGE) << "Cannot load a top-context from file" << file->fileName() <<
                 "- the required language-support for handling ID" << topData->classId << "is probably not loaded";
             return nullptr;
         }
@@ -605,6 +896,11 @@ TopDUContext* TopDUContextDynamicData::load(uint topContextIndex)
         target.m_data.clear();
         target.m_dataLoaded = false;
         target.m_onDisk = true;
+        if (map) {
+            target.m_mappedFile = file.release();
+            target.m_mappedFileData = map;
+            target.m_mappedFileSize = fileSize;
+        }
         ret->rebuildDynamicData(nullptr, topContextIndex);
         target.m_topContextData.append({topContextData, ( uint )0});
         return ret;
@@ -618,6 +914,33 @@ bool TopDUContextDynamicData::isOnDisk() const
     return m_onDisk;
 }
 
+size_t TopDUContextDynamicData::allocatedMemory() const
+{
+    size_t ret = sizeof(TopDUContextDynamicData) + sizeof(TopDUContext);
+
+    // arrays pointing into the mapped file have no capacity of their own
+    for (const auto& data : std::as_const(m_data)) {
+        ret += data.array.capacity();
+    }
+    for (const auto& data : std::as_const(m_topContextData)) {
+        ret += data.array.capacity();
+    }
+
+    const auto countLoaded = [](const auto& items) {
+        return std::count_if(items.begin(), items.end(), [](const auto& item) {
+            return static_cast<bool>(item);
+        });
+    };
+    ret += countLoaded(m_contexts.items) * (sizeof(DUContext) + sizeof(DUContextDynamicData));
+    ret += countLoaded(m_declarations.items) * sizeof(Declaration);
+    ret += countLoaded(m_problems.items) * sizeof(Problem);
+    ret += (m_contexts.items.capacity() + m_declarations.items.capacity() + m_problems.items.capacity())
+        * sizeof(void*);
+    ret += (m_contexts.offsets.capacity() + m_declarations.offsets.capacity() + m_problems.offsets.capacity())
+        * sizeof(ItemDataInfo);
+    return ret;
+}
+
 void TopDUContextDynamicData::deleteOnDisk()
 {
     if (!isOnDisk())
@@ -726,17 +1049,43 @@ void TopDUContextDynamicData::store()
     if (file.open(QIODevice::WriteOnly)) {
         file.resize(0);
 
-        file.write(reinterpret_cast<const char*>(&topContextDataSize), sizeof(uint));
+        // Compressed files consist of the marker followed by three compressed blocks, which contain the same
+        // sections as an uncompressed file: the top-context data, the offsets of the items, and the item data.
+        const bool compress = compressionEnabled();
+        QBuffer block;
+        QIODevice* target = &file;
+        if (compress) {
+            file.write(reinterpret_cast<const char*>(&CompressedFileMarker), sizeof(uint));
+            block.open(QIODevice::WriteOnly);
+            target = &block;
+        }
+        auto finishBlock = [&]() {
+            if (compress) {
+                writeCompressedBlock(&file, block.data());
+                // WriteOnly alone only rewinds, a shorter block would keep the tail of the previous one
+                block.close();
+                block.open(QIODevice::WriteOnly | QIODevice::Truncate);
+            }
+        };
+
+        target->write(reinterpret_cast<const char*>(&topContextDataSize), sizeof(uint));
         for (const ArrayWithPosition& pos : std::as_const(m_topContextData)) {
-            file.write(pos.array.constData(), pos.position);
+            target->write(pos.array.constData(), pos.position);
         }
+        finishBlock();
 
-        m_contexts.writeData(&file);
-        m_declarations.writeData(&file);
-        m_problems.writeData(&file);
+        m_contexts.writeData(target);
+        m_declarations.writeData(target);
+        m_problems.writeData(target);
+        finishBlock();
 
         for (const ArrayWithPosition& pos : std::as_const(m_data)) {
-            file.write(pos.array.constData(), pos.position);
+            target->write(pos.array.constData(), pos.position);
+        }
+        finishBlock();
+
+        if (compress) {
+            storageCounters().storedFiles.fetch_add(1, std::memory_order_relaxed);
         }
 
         m_onDisk = true;
@@ -9,9 +9,12 @@
 
 #include <QVector>
 #include <QByteArray>
+#include <QString>
 #include "problem.h"
+#include <language/languageexport.h>
 
 class QFile;
+class QIODevice;
 
 namespace KDevelop {
 class TopDUContext;
@@ -21,6 +24,32 @@ class IndexedString;
 class IndexedDUContext;
 class DUChainBaseData;
 
+/// Counters of the compressed top-context files written and read since startup
+struct KDEVPLATFORMLANGUAGE_EXPORT TopDUContextStorageStatistics
+{
+    quint64 storedFiles = 0;
+    quint64 storedBytes = 0; // Size of the compressed files before compression
+    quint64 storedCompressedBytes = 0;
+    quint64 loadedBlocks = 0;
+    quint64 loadedBytes = 0; // Size of the loaded blocks after decompression
+    quint64 loadedCompressedBytes = 0;
+    quint64 decompressionTime = 0; // In nanoseconds
+
+    /// @return the uncompressed size divided by the compressed size of the stored files
+    double compressionRatio() const
+    {
+        return storedCompressedBytes ? double(storedBytes) / storedCompressedBytes : 0;
+    }
+
+    /// @return the decompressed bytes per second while loading
+    double loadThroughput() const
+    {
+        return decompressionTime ? loadedBytes * 1e9 / decompressionTime : 0;
+    }
+
+    QString print() const;
+};
+
 ///This class contains dynamic data of a top-context, and also the repository that contains all the data within this top-context.
 class TopDUContextDynamicData
 {
@@ -75,6 +104,9 @@ public:
     ///Whether this top-context is on disk(Either has been loaded, or has been stored)
     bool isOnDisk() const;
 
+    /// @return an estimate of the bytes this top-context takes on the heap, the mapped file doesn't count
+    size_t allocatedMemory() const;
+
     ///Loads the top-context from disk, or returns zero on failure. The top-context will not be registered anywhere, and will have no ParsingEnvironmentFile assigned.
     ///Also loads all imported contexts. The Declarations/Contexts will be correctly initialized, and put into the symbol tables if needed.
     static TopDUContext* load(uint topContextIndex);
@@ -89,6 +121,18 @@ public:
 
     static QList<IndexedDUContext> loadImports(uint topContextIndex);
 
+    /**
+     * Sets whether top-contexts are stored compressed, which is off by default or enabled by setting
+     * the environment variable KDEV_DUCHAIN_COMPRESS_TOPCONTEXTS.
+     *
+     * Compressed files are split into blocks that are decompressed on their first access: the top-context data
+     * when the top-context is loaded, and the data of its declarations, contexts and problems when the first of
+     * them is needed. Both compressed and uncompressed files are always loaded.
+     */
+    KDEVPLATFORMLANGUAGE_EXPORT static void setCompressionEnabled(bool enabled);
+    KDEVPLATFORMLANGUAGE_EXPORT static bool compressionEnabled();
+    KDEVPLATFORMLANGUAGE_EXPORT static TopDUContextStorageStatistics storageStatistics();
+
     bool isTemporaryContextIndex(uint index) const;
     bool isTemporaryDeclarationIndex(uint index) const;
 
@@ -141,8 +185,9 @@ private:
         void deleteOnDisk();
         bool isItemForIndexLoaded(uint index) const;
 
-        void loadData(QFile* file) const;
-        void writeData(QFile* file);
+        /// Reads the offsets from @p data, and advances it past them
+        void loadData(const char*& data) const;
+        void writeData(QIODevice* file);
 
         //May contain zero items if they were deleted
         mutable QVector<Item> items;
@@ -162,7 +207,11 @@ private:
     bool m_onDisk;
     mutable bool m_dataLoaded;
 
+    /// The whole file is mapped privately, the top-context data and the item data point into it
     mutable QFile* m_mappedFile;
+    mutable uchar* m_mappedFileData;
+    mutable qint64 m_mappedFileSize;
+    /// The item data, behind the offsets in the mapped file
     mutable uchar* m_mappedData;
     mutable size_t m_mappedDataSize;
     mutable bool m_itemRetrievalForbidden;
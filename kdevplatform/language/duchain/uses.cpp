@@ -7,12 +7,20 @@
 #include "uses.h"
 
 #include "declarationid.h"
+#include "duchain.h"
 #include "duchainpointer.h"
+#include "parsingenvironment.h"
 #include "serialization/itemrepository.h"
 #include "topducontext.h"
+#include "editor/modificationrevision.h"
+#include "util/kdevhash.h"
+
+#include <QHash>
 
 namespace KDevelop {
 DEFINE_LIST_MEMBER_HASH(UsesItem, uses, IndexedTopDUContext)
+DEFINE_LIST_MEMBER_HASH(UseRangesItem, ranges, RangeInRevision)
+DEFINE_LIST_MEMBER_HASH(UseRangeFileItem, declarations, DeclarationId)
 
 class UsesItem
 {
@@ -116,9 +124,241 @@ class ItemRepositoryFor<Uses>
     }
 };
 
+/// The ranges of the uses of one declaration within one top-context
+class UseRangesItem
+{
+public:
+    UseRangesItem()
+    {
+        initializeAppendedLists();
+    }
+    UseRangesItem(const UseRangesItem& rhs, bool dynamic = true) : declaration(rhs.declaration)
+        , topContext(rhs.topContext)
+    {
+        initializeAppendedLists(dynamic);
+        copyListsFrom(rhs);
+    }
+
+    ~UseRangesItem()
+    {
+        freeAppendedLists();
+    }
+
+    UseRangesItem& operator=(const UseRangesItem& rhs) = delete;
+
+    unsigned int hash() const
+    {
+        //We only compare the declaration and the top-context, so the repository can be used as a map.
+        return KDevHash() << declaration << topContext;
+    }
+
+    unsigned int itemSize() const
+    {
+        return dynamicSize();
+    }
+
+    uint classSize() const
+    {
+        return sizeof(UseRangesItem);
+    }
+
+    DeclarationId declaration;
+    uint topContext = 0;
+
+    START_APPENDED_LISTS(UseRangesItem);
+    APPENDED_LIST_FIRST(UseRangesItem, RangeInRevision, ranges);
+    END_APPENDED_LISTS(UseRangesItem, ranges);
+};
+
+class UseRangesRequestItem
+{
+public:
+
+    UseRangesRequestItem(const UseRangesItem& item) : m_item(item)
+    {
+    }
+    enum {
+        AverageSize = 40 //This should be the approximate average size of an Item
+    };
+
+    unsigned int hash() const
+    {
+        return m_item.hash();
+    }
+
+    uint itemSize() const
+    {
+        return m_item.itemSize();
+    }
+
+    void createItem(UseRangesItem* item) const
+    {
+        new (item) UseRangesItem(m_item, false);
+    }
+
+    static void destroy(UseRangesItem* item, KDevelop::AbstractItemRepository&)
+    {
+        item->~UseRangesItem();
+    }
+
+    static bool persistent(const UseRangesItem* /*item*/)
+    {
+        return true;
+    }
+
+    bool equals(const UseRangesItem* item) const
+    {
+        return m_item.declaration == item->declaration && m_item.topContext == item->topContext;
+    }
+
+    const UseRangesItem& m_item;
+};
+
+/// The declarations whose use ranges were recorded for one top-context
+class UseRangeFileItem
+{
+public:
+    UseRangeFileItem()
+    {
+        initializeAppendedLists();
+    }
+    UseRangeFileItem(const UseRangeFileItem& rhs, bool dynamic = true) : topContext(rhs.topContext)
+        , revision(rhs.revision)
+    {
+        initializeAppendedLists(dynamic);
+        copyListsFrom(rhs);
+    }
+
+    ~UseRangeFileItem()
+    {
+        freeAppendedLists();
+    }
+
+    UseRangeFileItem& operator=(const UseRangeFileItem& rhs) = delete;
+
+    unsigned int hash() const
+    {
+        return KDevHash() << topContext;
+    }
+
+    unsigned int itemSize() const
+    {
+        return dynamicSize();
+    }
+
+    uint classSize() const
+    {
+        return sizeof(UseRangeFileItem);
+    }
+
+    uint topContext = 0;
+    // The revision of the top-context when its uses were recorded
+    ModificationRevision revision;
+
+    START_APPENDED_LISTS(UseRangeFileItem);
+    APPENDED_LIST_FIRST(UseRangeFileItem, DeclarationId, declarations);
+    END_APPENDED_LISTS(UseRangeFileItem, declarations);
+};
+
+class UseRangeFileRequestItem
+{
+public:
+
+    UseRangeFileRequestItem(const UseRangeFileItem& item) : m_item(item)
+    {
+    }
+    enum {
+        AverageSize = 200 //This should be the approximate average size of an Item
+    };
+
+    unsigned int hash() const
+    {
+        return m_item.hash();
+    }
+
+    uint itemSize() const
+    {
+        return m_item.itemSize();
+    }
+
+    void createItem(UseRangeFileItem* item) const
+    {
+        new (item) UseRangeFileItem(m_item, false);
+    }
+
+    static void destroy(UseRangeFileItem* item, KDevelop::AbstractItemRepository&)
+    {
+        item->~UseRangeFileItem();
+    }
+
+    static bool persistent(const UseRangeFileItem* /*item*/)
+    {
+        return true;
+    }
+
+    bool equals(const UseRangeFileItem* item) const
+    {
+        return m_item.topContext == item->topContext;
+    }
+
+    const UseRangeFileItem& m_item;
+};
+
+// Maps pairs of declaration-ids and top-contexts to use ranges
+using UseRangesRepo = ItemRepository<UseRangesItem, UseRangesRequestItem>;
+struct UseRanges {
+};
+template<>
+class ItemRepositoryFor<UseRanges>
+{
+    friend struct LockedItemRepository;
+    static UseRangesRepo& repo()
+    {
+        static QMutex mutex;
+        static UseRangesRepo repo { QStringLiteral("Use Ranges"), &mutex };
+        return repo;
+    }
+};
+
+// Maps top-contexts to the declaration-ids whose use ranges were recorded for them
+using UseRangeFilesRepo = ItemRepository<UseRangeFileItem, UseRangeFileRequestItem>;
+struct UseRangeFiles {
+};
+template<>
+class ItemRepositoryFor<UseRangeFiles>
+{
+    friend struct LockedItemRepository;
+    static UseRangeFilesRepo& repo()
+    {
+        static QMutex mutex;
+        static UseRangeFilesRepo repo { QStringLiteral("Use Range Files"), &mutex };
+        return repo;
+    }
+};
+
+static void collectUseRanges(const TopDUContext* top, const DUContext* context,
+                             QHash<DeclarationId, QVector<RangeInRevision>>& ranges)
+{
+    const Use* uses = context->uses();
+    for (int a = 0; a < context->usesCount(); ++a) {
+        // uses of declarations that are local to the top-context are not recorded, those can only be found in it
+        const DeclarationId id = top->usedDeclarationIdForIndex(uses[a].m_declarationIndex);
+        if (id.isValid()) {
+            ranges[id].append(uses[a].m_range);
+        }
+    }
+
+    const auto childContexts = context->childContexts();
+    for (const DUContext* child : childContexts) {
+        collectUseRanges(top, child, ranges);
+    }
+}
+
 Uses::Uses()
 {
     LockedItemRepository::initialize<Uses>();
+    LockedItemRepository::initialize<UseRanges>();
+    LockedItemRepository::initialize<UseRangeFiles>();
 }
 
 void Uses::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
@@ -204,4 +444,118 @@ KDevVarLengthArray<IndexedTopDUContext> Uses::uses(const DeclarationId& id) cons
 
     return ret;
 }
+
+void Uses::indexUseRanges(const TopDUContext* top)
+{
+    const IndexedTopDUContext indexedTop = top->indexed();
+    removeUseRanges(indexedTop);
+
+    const auto file = top->parsingEnvironmentFile();
+    if (!file || file->isProxyContext() || !(top->features() & TopDUContext::AllDeclarationsContextsAndUses)) {
+        return;
+    }
+
+    QHash<DeclarationId, QVector<RangeInRevision>> ranges;
+    collectUseRanges(top, top, ranges);
+
+    UseRangeFileItem fileItem;
+    fileItem.topContext = indexedTop.index();
+    fileItem.revision = file->modificationRevision();
+
+    LockedItemRepository::write<UseRanges>([&](UseRangesRepo& repo) {
+        for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+            UseRangesItem item;
+            item.declaration = it.key();
+            item.topContext = indexedTop.index();
+            for (const RangeInRevision& range : it.value()) {
+                item.rangesList().append(range);
+            }
+            repo.index(UseRangesRequestItem(item));
+            fileItem.declarationsList().append(it.key());
+        }
+    });
+
+    // the file is added last, so that it is only considered indexed when all its ranges are available
+    LockedItemRepository::write<UseRangeFiles>([&](UseRangeFilesRepo& repo) {
+        repo.index(UseRangeFileRequestItem(fileItem));
+    });
+}
+
+void Uses::removeUseRanges(const IndexedTopDUContext& top)
+{
+    UseRangeFileItem fileItem;
+    fileItem.topContext = top.index();
+
+    KDevVarLengthArray<DeclarationId> declarations;
+    LockedItemRepository::write<UseRangeFiles>([&](UseRangeFilesRepo& repo) {
+        const uint index = repo.findIndex(fileItem);
+        if (index) {
+            const UseRangeFileItem* repositoryItem = repo.itemFromIndex(index);
+            FOREACH_FUNCTION(const DeclarationId& id, repositoryItem->declarations)
+            declarations.append(id);
+            repo.deleteItem(index);
+        }
+    });
+
+    if (declarations.isEmpty()) {
+        return;
+    }
+
+    LockedItemRepository::write<UseRanges>([&](UseRangesRepo& repo) {
+        for (const DeclarationId& id : std::as_const(declarations)) {
+            UseRangesItem item;
+            item.declaration = id;
+            item.topContext = top.index();
+            const uint index = repo.findIndex(item);
+            if (index) {
+                repo.deleteItem(index);
+            }
+        }
+    });
+}
+
+bool Uses::hasIndexedUseRanges(const IndexedTopDUContext& top) const
+{
+    UseRangeFileItem fileItem;
+    fileItem.topContext = top.index();
+
+    bool indexed = false;
+    ModificationRevision revision;
+    LockedItemRepository::read<UseRangeFiles>([&](const UseRangeFilesRepo& repo) {
+        const uint index = repo.findIndex(fileItem);
+        if (index) {
+            indexed = true;
+            revision = repo.itemFromIndex(index)->revision;
+        }
+    });
+
+    if (!indexed) {
+        return false;
+    }
+
+    // the top-context may have been updated without being reported through DUChain::emitUpdateReady()
+    const auto file = DUChain::self()->environmentFileForDocument(top);
+    return file && file->modificationRevision() == revision
+           && (file->features() & TopDUContext::AllDeclarationsContextsAndUses);
+}
+
+KDevVarLengthArray<RangeInRevision> Uses::useRanges(const DeclarationId& id, const IndexedTopDUContext& top) const
+{
+    KDevVarLengthArray<RangeInRevision> ret;
+
+    UseRangesItem item;
+    item.declaration = id;
+    item.topContext = top.index();
+
+    LockedItemRepository::read<UseRanges>([&](const UseRangesRepo& repo) {
+        const uint index = repo.findIndex(item);
+        if (index) {
+            const UseRangesItem* repositoryItem = repo.itemFromIndex(index);
+            FOREACH_FUNCTION(const RangeInRevision& range, repositoryItem->ranges)
+            ret.append(range);
+        }
+    });
+
+    return ret;
+}
 }
@@ -8,16 +8,20 @@
 #define KDEVPLATFORM_USES_H
 
 #include <language/languageexport.h>
+#include <language/editor/rangeinrevision.h>
 #include <util/kdevvarlengtharray.h>
 
 namespace KDevelop {
 class DeclarationId;
 class IndexedTopDUContext;
+class TopDUContext;
 
 /**
  * Global mapping of Declaration-Ids to top-contexts, protected through DUChainLock.
  *
- * To retrieve the actual uses, query the duchain for the files.
+ * Additionally, the ranges of the uses in each top-context are recorded when its update is
+ * reported through DUChain::emitUpdateReady(). For those top-contexts, the uses can be
+ * retrieved through useRanges() without loading them. For all others, query the duchain for the files.
  * */
 class KDEVPLATFORMLANGUAGE_EXPORT Uses
 {
@@ -39,6 +43,32 @@ public:
 
     ///Gets the top-contexts of all users assigned to the declaration-id
     KDevVarLengthArray<IndexedTopDUContext> uses(const DeclarationId& id) const;
+
+    /**
+     * Records the ranges of all uses in @p top, replacing the ones recorded for it before.
+     *
+     * If @p top does not contain uses, the recorded ranges are only removed.
+     * The DUChain must be read-locked.
+     * */
+    void indexUseRanges(const TopDUContext* top);
+
+    /**
+     * Removes the use ranges recorded for @p top.
+     * */
+    void removeUseRanges(const IndexedTopDUContext& top);
+
+    /**
+     * Checks whether useRanges() is complete for @p top, i.e. whether its uses were recorded
+     * and it has not been modified since. This does not load @p top.
+     * The DUChain must be read-locked.
+     * */
+    bool hasIndexedUseRanges(const IndexedTopDUContext& top) const;
+
+    /**
+     * Gets the ranges of the uses of the declaration-id in @p top, as recorded by indexUseRanges().
+     * The ranges are in the revision of @p top. This does not load @p top.
+     * */
+    KDevVarLengthArray<RangeInRevision> useRanges(const DeclarationId& id, const IndexedTopDUContext& top) const;
 };
 }
 
@@ -30,16 +30,24 @@
 #include <backgroundparser/urlparselock.h>
 
 #include <KTextEditor/Document>
+#include <KTextEditor/View>
+
+#include <QElapsedTimer>
+#include <QPointer>
+
+#include <algorithm>
 
 using namespace KTextEditor;
 
 static const float highlightingZDepth = -500;
+// Count of highlighted ranges that are applied together, the smallest unit of work on the GUI thread
+static const int highlightingChunkSize = 256;
+// Time after which applying highlighting yields back to the event loop
+static const qint64 highlightingSliceTime = 8 * 1000 * 1000;
 
 #define ifDebug(x)
 
 namespace KDevelop {
-///@todo Don't highlighting everything, only what is visible on-demand
-
 CodeHighlighting::CodeHighlighting(QObject* parent)
     : QObject(parent)
     , m_localColorization(true)
@@ -140,11 +148,17 @@ bool CodeHighlighting::hasHighlighting(IndexedString url) const
     if (tracker) {
         QMutexLocker lock(&m_dataMutex);
         const auto highlightingIt = m_highlights.constFind(tracker);
-        return highlightingIt != m_highlights.constEnd() && !(*highlightingIt)->m_highlightedRanges.isEmpty();
+        return highlightingIt != m_highlights.constEnd() && !(*highlightingIt)->m_highlightedRanges.empty();
     }
     return false;
 }
 
+CodeHighlighting::ApplyStatistics CodeHighlighting::applyStatistics() const
+{
+    QMutexLocker lock(&m_dataMutex);
+    return m_applyStatistics;
+}
+
 void CodeHighlighting::highlightDUChain(ReferencedTopDUContext context)
 {
     ENSURE_CHAIN_NOT_LOCKED
@@ -500,6 +514,12 @@ void CodeHighlighting::clearHighlightingForDocument(const IndexedString& documen
     auto highlightingIt = m_highlights.find(tracker);
     if (highlightingIt != m_highlights.end()) {
         disconnect(tracker, &DocumentChangeTracker::destroyed, this, nullptr);
+        // the connections are made again when highlighting is applied the next time
+        disconnect(tracker->document(), nullptr, this, nullptr);
+        const auto views = tracker->document()->views();
+        for (auto* view : views) {
+            disconnect(view, nullptr, this, nullptr);
+        }
         auto& highlighting = *highlightingIt;
         qDeleteAll(highlighting->m_highlightedRanges);
         delete highlighting;
@@ -530,11 +550,10 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
         return;
     }
 
-    QVector<MovingRange*> oldHighlightedRanges;
-
     const auto highlightingIt = m_highlights.find(tracker);
     if (highlightingIt != m_highlights.end()) {
-        oldHighlightedRanges = (*highlightingIt)->m_highlightedRanges;
+        // The old ranges are replaced chunk by chunk, until then they keep highlighting their text
+        highlighting->m_highlightedRanges = std::move((*highlightingIt)->m_highlightedRanges);
         delete *highlightingIt;
         *highlightingIt = highlighting;
     } else {
@@ -553,54 +572,219 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
                                           // destroyed
             m_highlights.remove(tracker);
         });
+        // Highlighting outside of the visible area is applied once it is scrolled into view
+        const auto views = tracker->document()->views();
+        for (auto* view : views) {
+            connectView(view, tracker);
+        }
+        connect(tracker->document(), &Document::viewCreated, this,
+                [this, tracker = QPointer<DocumentChangeTracker>(tracker)](Document*, View* view) {
+                    if (tracker) {
+                        connectView(view, tracker);
+                    }
+                });
         m_highlights.insert(tracker, highlighting);
     }
 
-    // Now create MovingRanges (match old ones with the incoming ranges)
+    if (highlighting->m_waiting.isEmpty()) {
+        qDeleteAll(highlighting->m_highlightedRanges);
+        highlighting->m_highlightedRanges.clear();
+        return;
+    }
+
+    const auto& waiting = highlighting->m_waiting;
+    const int size = waiting.size();
+    highlighting->m_pendingChunks.reserve((size + highlightingChunkSize - 1) / highlightingChunkSize);
+    for (int begin = 0; begin < size;) {
+        // A chunk replaces the old ranges by their start, so chunks must not split ranges with equal starts
+        int end = qMin(begin + highlightingChunkSize, size);
+        while (end < size && !(waiting[end - 1].range.start < waiting[end].range.start)) {
+            ++end;
+        }
+        highlighting->m_pendingChunks.append({begin, end});
+        begin = end;
+    }
+
+    applyPendingChunks(tracker);
+}
+
+void CodeHighlighting::connectView(View* view, DocumentChangeTracker* tracker)
+{
+    const auto schedule = [this, tracker = QPointer<DocumentChangeTracker>(tracker)]() {
+        if (tracker) {
+            scheduleApplyPendingChunks(tracker);
+        }
+    };
+    connect(view, &View::verticalScrollPositionChanged, this, schedule);
+    connect(view, &View::focusIn, this, schedule);
+}
+
+void CodeHighlighting::scheduleApplyPendingChunks(DocumentChangeTracker* tracker)
+{
+    QMutexLocker lock(&m_dataMutex);
+    auto* highlighting = m_highlights.value(tracker);
+    if (!highlighting || highlighting->m_pendingChunks.isEmpty() || highlighting->m_applyScheduled) {
+        return;
+    }
+
+    highlighting->m_applyScheduled = true;
+    QMetaObject::invokeMethod(
+        this,
+        [this, tracker = QPointer<DocumentChangeTracker>(tracker)]() {
+            VERIFY_FOREGROUND_LOCKED
+            QMutexLocker lock(&m_dataMutex);
+            // the highlighting may have been replaced or cleared in the meantime
+            auto* highlighting = tracker ? m_highlights.value(tracker) : nullptr;
+            if (highlighting) {
+                highlighting->m_applyScheduled = false;
+                applyPendingChunks(tracker);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void CodeHighlighting::applyPendingChunks(DocumentChangeTracker* tracker)
+{
+    auto* highlighting = m_highlights.value(tracker);
+    if (!highlighting || highlighting->m_pendingChunks.isEmpty()) {
+        return;
+    }
+
+    if (!tracker->holdingRevision(highlighting->m_waitingRevision)) {
+        qCDebug(LANGUAGE) << "not holding revision" << highlighting->m_waitingRevision
+                          << "dropping the rest of the highlighting of" << highlighting->m_document.str();
+        highlighting->m_pendingChunks.clear();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The displayed lines of all visible views, with one screen of margin in both directions
+    QVector<QPair<int, int>> visibleLines;
+    const auto views = tracker->document()->views();
+    for (auto* view : views) {
+        if (view->isVisible()) {
+            const int first = view->firstDisplayedLine();
+            const int last = view->lastDisplayedLine();
+            const int margin = last - first + 1;
+            visibleLines.append({first - margin, last + margin});
+        }
+    }
+
+    // Without visible views, everything is applied in the background
+    const auto isVisible = [&](const QPair<int, int>& chunk) {
+        if (visibleLines.isEmpty()) {
+            return true;
+        }
+        const int firstLine =
+            tracker->transformToCurrentRevision(highlighting->m_waiting[chunk.first].range,
+                                                highlighting->m_waitingRevision).start().line();
+        const int lastLine =
+            tracker->transformToCurrentRevision(highlighting->m_waiting[chunk.second - 1].range,
+                                                highlighting->m_waitingRevision).end().line();
+        return std::any_of(visibleLines.begin(), visibleLines.end(), [&](const QPair<int, int>& lines) {
+            return firstLine <= lines.second && lines.first <= lastLine;
+        });
+    };
+
+    bool outOfTime = false;
+    auto& pendingChunks = highlighting->m_pendingChunks;
+    for (int i = 0; i < pendingChunks.size();) {
+        if (timer.nsecsElapsed() >= highlightingSliceTime) {
+            outOfTime = true;
+            break;
+        }
+        if (isVisible(pendingChunks[i])) {
+            applyChunk(tracker, highlighting, pendingChunks[i].first, pendingChunks[i].second);
+            pendingChunks.remove(i);
+        } else {
+            ++i;
+        }
+    }
 
-    KTextEditor::Range tempRange;
+    const qint64 time = timer.nsecsElapsed();
+    highlighting->m_applyTime += time;
+    ++highlighting->m_applySlices;
+    m_applyStatistics.time += time;
+    ++m_applyStatistics.slices;
+
+    if (pendingChunks.isEmpty()) {
+        qCDebug(LANGUAGE) << "applied highlighting of" << highlighting->m_document.str() << "in"
+                          << highlighting->m_applySlices << "slices taking" << highlighting->m_applyTime / 1000
+                          << "microseconds";
+    } else if (outOfTime) {
+        scheduleApplyPendingChunks(tracker);
+    }
+}
 
-    QVector<MovingRange*>::iterator movingIt = oldHighlightedRanges.begin();
-    QVector<HighlightedRange>::iterator rangeIt = highlighting->m_waiting.begin();
+void CodeHighlighting::applyChunk(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, int begin,
+                                  int end)
+{
+    const auto& waiting = highlighting->m_waiting;
+    auto& ranges = highlighting->m_highlightedRanges;
+
+    const auto transformedStart = [&](int index) {
+        return tracker->transformToCurrentRevision(waiting[index].range, highlighting->m_waitingRevision).start();
+    };
+    const auto startsBefore = [](const MovingRange* range, const KTextEditor::Cursor& cursor) {
+        return range->start().toCursor() < cursor;
+    };
+
+    // The chunk replaces the moving ranges starting from its first range up to the first range of the next chunk
+    auto regionBegin = ranges.begin();
+    if (begin > 0) {
+        regionBegin = std::lower_bound(ranges.begin(), ranges.end(), transformedStart(begin), startsBefore);
+    }
+    auto regionEnd = ranges.end();
+    if (end < waiting.size()) {
+        regionEnd = std::lower_bound(regionBegin, ranges.end(), transformedStart(end), startsBefore);
+    }
+
+    // Now create MovingRanges (match old ones with the incoming ranges)
 
-    while (rangeIt != highlighting->m_waiting.end()) {
+    std::vector<MovingRange*> applied;
+    applied.reserve(end - begin);
+    int created = 0;
+
+    auto movingIt = regionBegin;
+    for (int i = begin; i < end; ++i) {
+        const HighlightedRange& range = waiting[i];
         // Translate the range into the current revision
-        KTextEditor::Range transformedRange = tracker->transformToCurrentRevision(rangeIt->range,
-                                                                                  highlighting->m_waitingRevision);
+        const KTextEditor::Range transformedRange =
+            tracker->transformToCurrentRevision(range.range, highlighting->m_waitingRevision);
 
-        while (movingIt != oldHighlightedRanges.end() &&
-               ((*movingIt)->start().line() < transformedRange.start().line() ||
-                ((*movingIt)->start().line() == transformedRange.start().line() &&
-                 (*movingIt)->start().column() < transformedRange.start().column()))) {
+        while (movingIt != regionEnd && (*movingIt)->start().toCursor() < transformedRange.start()) {
             delete *movingIt; // Skip ranges that are in front of the current matched range
             ++movingIt;
         }
 
-        tempRange = transformedRange;
-
-        if (movingIt == oldHighlightedRanges.end() ||
-            transformedRange.start().line() != (*movingIt)->start().line() ||
-            transformedRange.start().column() != (*movingIt)->start().column() ||
-            transformedRange.end().line() != (*movingIt)->end().line() ||
-            transformedRange.end().column() != (*movingIt)->end().column()) {
-            Q_ASSERT(rangeIt->attribute);
+        Q_ASSERT(range.attribute);
+        if (movingIt == regionEnd || (*movingIt)->toRange() != transformedRange) {
             // The moving range is behind or unequal, create a new range
-            highlighting->m_highlightedRanges.push_back(tracker->document()->newMovingRange(tempRange));
-            highlighting->m_highlightedRanges.back()->setAttribute(rangeIt->attribute);
-            highlighting->m_highlightedRanges.back()->setZDepth(highlightingZDepth);
-        } else
-        {
-            // Update the existing moving range
-            (*movingIt)->setAttribute(rangeIt->attribute);
-            (*movingIt)->setRange(tempRange);
-            highlighting->m_highlightedRanges.push_back(*movingIt);
+            auto* movingRange = tracker->document()->newMovingRange(transformedRange);
+            movingRange->setAttribute(range.attribute);
+            movingRange->setZDepth(highlightingZDepth);
+            applied.push_back(movingRange);
+            ++created;
+        } else {
+            // Reuse the existing moving range, only touching it if its highlighting changed
+            const auto& attribute = (*movingIt)->attribute();
+            if (attribute != range.attribute && !(attribute && *attribute == *range.attribute)) {
+                (*movingIt)->setAttribute(range.attribute);
+            }
+            applied.push_back(*movingIt);
             ++movingIt;
         }
-        ++rangeIt;
     }
 
-    for (; movingIt != oldHighlightedRanges.end(); ++movingIt)
+    for (; movingIt != regionEnd; ++movingIt)
         delete *movingIt; // Delete unmatched moving ranges behind
+
+    ranges.insert(ranges.erase(regionBegin, regionEnd), applied.begin(), applied.end());
+
+    m_applyStatistics.appliedRanges += end - begin;
+    m_applyStatistics.createdRanges += created;
 }
 
 void CodeHighlighting::aboutToInvalidateMovingInterfaceContent(Document* doc)
@@ -622,16 +806,15 @@ void CodeHighlighting::aboutToRemoveText(const KTextEditor::Range& range)
                                      ->trackerForUrl(IndexedString(doc->url()));
     const auto highlightingIt = m_highlights.constFind(tracker);
     if (highlightingIt != m_highlights.constEnd()) {
-        QVector<MovingRange*>& ranges = (*highlightingIt)->m_highlightedRanges;
-        QVector<MovingRange*>::iterator it = ranges.begin();
-        while (it != ranges.end()) {
-            if (range.contains((*it)->toRange())) {
-                delete (*it);
-                it = ranges.erase(it);
-            } else {
-                ++it;
+        auto& ranges = (*highlightingIt)->m_highlightedRanges;
+        const auto removed = std::remove_if(ranges.begin(), ranges.end(), [&range](MovingRange* movingRange) {
+            if (range.contains(movingRange->toRange())) {
+                delete movingRange;
+                return true;
             }
-        }
+            return false;
+        });
+        ranges.erase(removed, ranges.end());
     }
 }
 }
@@ -21,6 +21,12 @@
 #include <KTextEditor/Attribute>
 #include <KTextEditor/MovingRange>
 
+#include <vector>
+
+namespace KTextEditor {
+class View;
+}
+
 namespace KDevelop {
 class DUContext;
 class Declaration;
@@ -148,6 +154,23 @@ public:
     /// Returns whether a highlighting is already given for the given url
     bool hasHighlighting(IndexedString url) const override;
 
+    /// The work done on the GUI thread to apply highlighting to documents
+    struct ApplyStatistics
+    {
+        /// Time spent, in nanoseconds
+        qint64 time = 0;
+        /// Count of time slices the work was split into
+        int slices = 0;
+        /// Count of highlighted ranges that were applied
+        int appliedRanges = 0;
+        /// Count of highlighted ranges that needed a new moving range, the others were reused
+        int createdRanges = 0;
+    };
+
+    /// This function is thread-safe
+    /// Returns the work done to apply highlighting since this object was created
+    ApplyStatistics applyStatistics() const;
+
 private:
     //Returns whether the given attribute was set by the code highlighting, and not by something else
     //Always returns true when the attribute is zero
@@ -166,9 +189,24 @@ private:
         qint64 m_waitingRevision;
         // The ranges are sorted by range start, so they can easily be matched
         QVector<HighlightedRange> m_waiting;
-        QVector<KTextEditor::MovingRange*> m_highlightedRanges;
+        // The chunks of m_waiting that are not applied yet, as pairs of begin and end index
+        QVector<QPair<int, int>> m_pendingChunks;
+        // Sorted by their current start. In pending chunks, these are still the ranges of an older highlighting.
+        std::vector<KTextEditor::MovingRange*> m_highlightedRanges;
+        bool m_applyScheduled = false;
+        // The work done to apply this highlighting so far
+        qint64 m_applyTime = 0;
+        int m_applySlices = 0;
     };
 
+    /// Applies pending chunks of the highlighting of @p tracker within one time slice, visible ones first.
+    /// Chunks outside of the visible area of the document are left pending until they are scrolled into view.
+    void applyPendingChunks(DocumentChangeTracker* tracker);
+    void scheduleApplyPendingChunks(DocumentChangeTracker* tracker);
+    /// Replaces the moving ranges within the chunk @p begin to @p end of the waiting ranges of @p highlighting
+    void applyChunk(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, int begin, int end);
+    void connectView(KTextEditor::View* view, DocumentChangeTracker* tracker);
+
     QHash<DocumentChangeTracker*, DocumentHighlighting*> m_highlights;
 
     friend class CodeHighlightingInstance;
@@ -184,6 +222,8 @@ private:
 
     mutable QRecursiveMutex m_dataMutex;
 
+    ApplyStatistics m_applyStatistics;
+
 private Q_SLOTS:
     void clearHighlightingForDocument(const KDevelop::IndexedString& document);
     void applyHighlighting(void* highlighting);
@@ -6,13 +6,27 @@
 
 #include "test_highlighting.h"
 
+#include <QDateTime>
+#include <QTemporaryFile>
 #include <QTest>
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
+#include <interfaces/idocumentcontroller.h>
+#include <interfaces/ilanguagecontroller.h>
+#include <language/backgroundparser/backgroundparser.h>
+#include <language/duchain/declaration.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontext.h>
 #include <language/codegen/coderepresentation.h>
 #include <language/highlighting/codehighlighting.h>
 
+#include <KTextEditor/Document>
+#include <KTextEditor/View>
+
+#include <memory>
+
 QTEST_MAIN(TestHighlighting)
 
 using namespace KDevelop;
@@ -20,7 +34,8 @@ using namespace KDevelop;
 void TestHighlighting::initTestCase()
 {
     AutoTestShell::init();
-    TestCore::initialize(Core::NoUi);
+    // documents are only opened, and their changes tracked, with a user interface
+    TestCore::initialize();
 
     DUChain::self()->disablePersistentStorage();
     CodeRepresentation::setDiskChangesForbidden(true);
@@ -37,4 +52,73 @@ void TestHighlighting::testInitialization()
     QVERIFY(highlighting.attributeForDepth(0));
 }
 
+void TestHighlighting::testChunkedApplication()
+{
+    // many chunks of ranges, on many more lines than a view shows
+    const int lineCount = 20000;
+    const int declarationsPerLine = 3;
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    for (int line = 0; line < lineCount; ++line) {
+        file.write("int foo;\n");
+    }
+    file.close();
+
+    const auto url = QUrl::fromLocalFile(file.fileName());
+    auto* document = ICore::self()->documentController()->openDocument(url);
+    QVERIFY(document);
+    const IndexedString indexedUrl(url);
+    auto* tracker = ICore::self()->languageController()->backgroundParser()->trackerForUrl(indexedUrl);
+    QVERIFY(tracker);
+
+    std::unique_ptr<KTextEditor::View> view(document->textDocument()->createView(nullptr));
+    view->resize(400, 300);
+    view->show();
+    QVERIFY(QTest::qWaitForWindowExposed(view.get()));
+    view->setCursorPosition({0, 0});
+
+    ReferencedTopDUContext top;
+    {
+        DUChainWriteLocker lock;
+        top = new TopDUContext(indexedUrl, RangeInRevision(0, 0, lineCount, 0));
+        auto* environmentFile = new ParsingEnvironmentFile(indexedUrl);
+        const auto revision = tracker->revisionAtLastReset()->revision();
+        environmentFile->setModificationRevision(ModificationRevision(QDateTime(), revision));
+        top->setParsingEnvironmentFile(environmentFile);
+        DUChain::self()->addDocumentChain(top);
+        // ranges with equal starts, which the chunk boundaries must not separate
+        for (int line = 0; line < lineCount; ++line) {
+            for (int i = 0; i < declarationsPerLine; ++i) {
+                new Declaration(RangeInRevision(line, 4, line, 5 + i), top);
+            }
+        }
+    }
+
+    CodeHighlighting highlighting(this);
+    highlighting.highlightDUChain(top);
+
+    // only the chunks around the visible lines are applied
+    QTRY_VERIFY(highlighting.applyStatistics().appliedRanges > 0);
+    QTest::qWait(500);
+    const int visibleLines = view->lastDisplayedLine() - view->firstDisplayedLine() + 1;
+    const int applied = highlighting.applyStatistics().appliedRanges;
+    QVERIFY(applied >= visibleLines * declarationsPerLine);
+    QVERIFY(applied < lineCount * declarationsPerLine / 2);
+    QCOMPARE(highlighting.applyStatistics().createdRanges, applied);
+    QVERIFY(highlighting.applyStatistics().slices >= 1);
+
+    // scrolling applies the chunks that come into view
+    view->setCursorPosition({lineCount - 1, 0});
+    QTRY_VERIFY(highlighting.applyStatistics().appliedRanges > applied);
+    QTest::qWait(500);
+    QVERIFY(highlighting.applyStatistics().appliedRanges < lineCount * declarationsPerLine);
+
+    view.reset();
+    document->close(IDocument::Discard);
+    {
+        DUChainWriteLocker lock;
+        DUChain::self()->removeDocumentChain(top.data());
+    }
+}
+
 #include "moc_test_highlighting.cpp"
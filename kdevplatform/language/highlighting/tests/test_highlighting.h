@@ -20,6 +20,7 @@ private Q_SLOTS:
 
     // for valgrind
     void testInitialization();
+    void testChunkedApplication();
 };
 
 #endif // KDEVPLATFORM_TEST_HIGHLIGHTING_H
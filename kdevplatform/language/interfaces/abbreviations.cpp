@@ -11,6 +11,8 @@
 #include <QStringList>
 #include <QVarLengthArray>
 
+#include <algorithm>
+
 namespace KDevelop {
 // Taken and adapted for kdevelop from katecompletionmodel.cpp
 static bool matchesAbbreviationHelper(QStringView word, const QString& typed, const QVarLengthArray<int, 32>& offsets,
@@ -147,6 +149,59 @@ bool matchesAbbreviationMulti(QStringView word, const QStringList& typedFragment
     return matchedFragments == typedFragments.size();
 }
 
+SubsequenceFilter::SubsequenceFilter(const QStringList& typedFragments)
+{
+    for (const auto& fragment : typedFragments) {
+        for (const QChar c : fragment) {
+            if (c.unicode() >= 0x80) {
+                // the case folding of non-ASCII characters is beyond the scope of this quick test
+                m_folded.clear();
+                return;
+            }
+            m_folded += c.toLower();
+        }
+    }
+}
+
+bool SubsequenceFilter::advance(QStringView text, int& matched) const
+{
+    const auto* const folded = m_folded.utf16();
+    const int size = m_folded.size();
+    for (const QChar c : text) {
+        const char16_t ch = c.unicode();
+        // some non-ASCII characters match ASCII ones case-insensitively, e.g. the Kelvin sign matches 'k',
+        // so let non-ASCII characters match anything. Matching greedily still never rejects a possible match.
+        if (ch >= 0x80 || ((ch >= u'A' && ch <= u'Z') ? ch + (u'a' - u'A') : ch) == folded[matched]) {
+            if (++matched == size) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool SubsequenceFilter::mayMatch(QStringView word) const
+{
+    if (m_folded.isEmpty() || word.isEmpty()) {
+        // matchesAbbreviationMulti() matches empty words
+        return true;
+    }
+    int matched = 0;
+    return advance(word, matched);
+}
+
+bool SubsequenceFilter::mayMatch(const Path& path) const
+{
+    if (m_folded.isEmpty()) {
+        return true;
+    }
+    int matched = 0;
+    const auto& segments = path.segments();
+    return std::any_of(segments.cbegin(), segments.cend(), [this, &matched](const QString& segment) {
+        return advance(segment, matched);
+    });
+}
+
 int matchPathFilter(const Path& toFilter, const QStringList& text, const Path& prefixPath)
 {
     enum PathFilterMatchQuality {
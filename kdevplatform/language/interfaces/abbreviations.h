@@ -35,6 +35,31 @@ KDEVPLATFORMLANGUAGE_EXPORT bool matchesAbbreviationMulti(QStringView word, cons
  * @return -1 when no match is found, otherwise a positive integer, higher values mean lower quality
  */
 KDEVPLATFORMLANGUAGE_EXPORT int matchPathFilter(const Path& toFilter, const QStringList& text, const Path& prefixPath);
+
+/**
+ * @brief A fast test that rejects most words and paths which the matching functions above do not match.
+ *
+ * All of matchesAbbreviationMulti(), matchPathFilter() and case-insensitive substring matching only match
+ * if the typed fragments occur in the right order, so words which do not contain the characters of the fragments
+ * as a case-insensitive subsequence are rejected here without splitting them or comparing them fragment by
+ * fragment.
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT SubsequenceFilter
+{
+public:
+    explicit SubsequenceFilter(const QStringList& typedFragments);
+
+    /// @return false if @p word does not contain the typed fragments as a case-insensitive subsequence
+    bool mayMatch(QStringView word) const;
+    /// @return false if the segments of @p path do not contain the typed fragments as a case-insensitive subsequence
+    bool mayMatch(const Path& path) const;
+
+private:
+    bool advance(QStringView text, int& matched) const;
+
+    /// The typed characters folded to lower case, empty if the filter cannot reject anything
+    QString m_folded;
+};
 }
 
 #endif
@@ -11,8 +11,11 @@
 
 #include "abbreviations.h"
 
+#include <util/algorithm.h>
 #include <util/path.h>
 
+#include <vector>
+
 namespace KDevelop {
 /**
  * This is a simple filter-implementation that helps you implementing own quickopen data-providers.
@@ -28,7 +31,8 @@ namespace KDevelop {
  * What you need to do to use it:
  *
  * Reimplement itemText(..) to provide the text filtering
- * should be performed on (This must be efficient).
+ * should be performed on (This must be efficient and thread-safe, as large
+ * sets of items are filtered concurrently).
  *
  * Call setItems(..) when starting a new quickopen session, or when the content
  * changes, to initialize the filter with your data.
@@ -103,10 +107,19 @@ public:
             clearFilter();
             return;
         }
-        for (const Item& data : filterBase) {
-            const QString& itemData = itemText(data);
-            if (itemData.contains(text, Qt::CaseInsensitive) || matchesAbbreviationMulti(itemData, typedFragments)) {
-                m_filtered << data;
+        const SubsequenceFilter subsequenceFilter(typedFragments);
+        std::vector<char> matches(filterBase.size());
+        Algorithm::parallelForRanges(filterBase.size(), MinimumItemsPerThread, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                const QString& itemData = itemText(filterBase.at(i));
+                matches[i] = subsequenceFilter.mayMatch(itemData)
+                    && (itemData.contains(text, Qt::CaseInsensitive)
+                        || matchesAbbreviationMulti(itemData, typedFragments));
+            }
+        });
+        for (int i = 0, c = filterBase.size(); i < c; ++i) {
+            if (matches[i]) {
+                m_filtered << filterBase.at(i);
             }
         }
 
@@ -118,6 +131,9 @@ protected:
     virtual QString itemText(const Item& data) const = 0;
 
 private:
+    /// Filtering fewer items than this is not worth involving another thread
+    static constexpr int MinimumItemsPerThread = 2048;
+
     QString m_oldFilterText;
     QVector<Item> m_filtered;
     QVector<Item> m_items;
@@ -196,15 +212,25 @@ public:
             filterBase = m_items;
         }
 
+        // the filter is applied concurrently, so itemPath() and itemPrefixPath() must be thread-safe
+        const auto* const parent = static_cast<const Parent*>(this);
+        const SubsequenceFilter subsequenceFilter(text);
+        std::vector<int> matchQualities(filterBase.size());
+        Algorithm::parallelForRanges(filterBase.size(), MinimumItemsPerThread, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                const auto& data = filterBase.at(i);
+                const auto& path = parent->itemPath(data);
+                matchQualities[i] = subsequenceFilter.mayMatch(path)
+                    ? matchPathFilter(path, text, parent->itemPrefixPath(data))
+                    : -1;
+            }
+        });
+
         QVector<QPair<int, int>> matches;
         for (int i = 0, c = filterBase.size(); i < c; ++i) {
-            const auto& data = filterBase.at(i);
-            const auto matchQuality = matchPathFilter(static_cast<Parent*>(this)->itemPath(data), text,
-                                                      static_cast<Parent*>(this)->itemPrefixPath(data));
-            if (matchQuality == -1) {
-                continue;
+            if (matchQualities[i] != -1) {
+                matches.push_back({matchQualities[i], i});
             }
-            matches.push_back({matchQuality, i});
         }
 
         std::stable_sort(matches.begin(), matches.end(),
@@ -221,6 +247,9 @@ public:
     }
 
 private:
+    /// Filtering fewer items than this is not worth involving another thread
+    static constexpr int MinimumItemsPerThread = 2048;
+
     ///Clears the filter, but not the data.
     void clearFilter()
     {
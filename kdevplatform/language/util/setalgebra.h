@@ -0,0 +1,105 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_SETALGEBRA_H
+#define KDEVPLATFORM_SETALGEBRA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Kernels for the set operations on sorted arrays of unique indices, used by the bulk operations of
+ * BasicSetRepository.
+ *
+ * The merge loops select and advance without data-dependent branches, so that their throughput does not
+ * suffer from mispredictions on interleaved inputs. Each kernel appends its result to @p out.
+ */
+namespace Utils {
+namespace SetAlgebra {
+using Index = unsigned int;
+
+/// Intersections switch to binary searches in the larger input once it is this many times larger
+constexpr std::size_t GallopRatio = 32;
+
+inline void unite(const Index* first, const Index* firstEnd, const Index* second, const Index* secondEnd,
+                  std::vector<Index>& out)
+{
+    const auto offset = out.size();
+    out.resize(offset + (firstEnd - first) + (secondEnd - second));
+    Index* output = out.data() + offset;
+
+    while (first != firstEnd && second != secondEnd) {
+        const Index a = *first;
+        const Index b = *second;
+        *output++ = a < b ? a : b;
+        first += a <= b;
+        second += b <= a;
+    }
+    output = std::copy(first, firstEnd, output);
+    output = std::copy(second, secondEnd, output);
+    out.resize(output - out.data());
+}
+
+inline void intersect(const Index* first, const Index* firstEnd, const Index* second, const Index* secondEnd,
+                      std::vector<Index>& out)
+{
+    std::size_t firstSize = firstEnd - first;
+    std::size_t secondSize = secondEnd - second;
+    if (firstSize > secondSize) {
+        std::swap(first, second);
+        std::swap(firstEnd, secondEnd);
+        std::swap(firstSize, secondSize);
+    }
+
+    if (firstSize * GallopRatio < secondSize) {
+        for (; first != firstEnd && second != secondEnd; ++first) {
+            second = std::lower_bound(second, secondEnd, *first);
+            if (second != secondEnd && *second == *first) {
+                out.push_back(*first);
+            }
+        }
+        return;
+    }
+
+    const auto offset = out.size();
+    // one more slot, the loop writes the current candidate before deciding whether to keep it
+    out.resize(offset + firstSize + 1);
+    Index* output = out.data() + offset;
+
+    while (first != firstEnd && second != secondEnd) {
+        const Index a = *first;
+        const Index b = *second;
+        *output = a;
+        output += a == b;
+        first += a <= b;
+        second += b <= a;
+    }
+    out.resize(output - out.data());
+}
+
+inline void subtract(const Index* first, const Index* firstEnd, const Index* second, const Index* secondEnd,
+                     std::vector<Index>& out)
+{
+    const auto offset = out.size();
+    out.resize(offset + (firstEnd - first) + 1);
+    Index* output = out.data() + offset;
+
+    while (first != firstEnd && second != secondEnd) {
+        const Index a = *first;
+        const Index b = *second;
+        *output = a;
+        output += a < b;
+        first += a <= b;
+        second += b <= a;
+    }
+    output = std::copy(first, firstEnd, output);
+    out.resize(output - out.data());
+}
+}
+}
+
+#endif // KDEVPLATFORM_SETALGEBRA_H
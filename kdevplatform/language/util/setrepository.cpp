@@ -5,6 +5,7 @@
 */
 
 #include "setrepository.h"
+#include "setalgebra.h"
 #include <debug.h>
 #include <list>
 #include <util/kdevvarlengtharray.h>
@@ -121,6 +122,41 @@ struct SetRepositoryAlgorithms
 
     QString dumpDotGraph(uint node) const;
 
+    ///Appends the indices contained by @p node to @p indices, in ascending order
+    void collectIndices(const SetNodeData* node, std::vector<Index>& indices) const
+    {
+        if (node->contiguous()) {
+            for (Index index = node->start(); index < node->end(); ++index) {
+                indices.push_back(index);
+            }
+            return;
+        }
+        collectIndices(getLeftNode(node), indices);
+        collectIndices(getRightNode(node), indices);
+    }
+
+    ///Returns the sorted indices of each of @p sets, which must belong to this repository
+    std::vector<std::vector<Index>> flatten(const std::vector<Set>& sets) const
+    {
+        std::vector<std::vector<Index>> ret;
+        ret.reserve(sets.size());
+        for (const Set& set : sets) {
+            Q_ASSERT(!set.setIndex() || set.repository() == setRepository);
+            ret.emplace_back();
+            if (set.setIndex())
+                collectIndices(nodeFromIndex(set.setIndex()), ret.back());
+        }
+        return ret;
+    }
+
+    ///Returns the set representing the sorted @p indices
+    Set setFromIndices(const std::vector<Index>& indices)
+    {
+        if (indices.empty())
+            return Set();
+        return Set(setForIndices(indices.begin(), indices.end()), setRepository);
+    }
+
     ///Finds or inserts the given ranges into the repository, and returns the set-index that represents them
     uint setForIndices(std::vector<uint>::const_iterator begin, std::vector<uint>::const_iterator end,
                        uchar splitBit = 31)
@@ -423,6 +459,19 @@ public:
     }
 };
 
+std::vector<Index> Set::indices() const
+{
+    std::vector<Index> ret;
+    if (!m_tree || !m_repository)
+        return ret;
+
+    QMutexLocker lock(m_repository->m_mutex);
+
+    SetRepositoryAlgorithms alg(m_repository->m_dataRepository, m_repository);
+    alg.collectIndices(m_repository->m_dataRepository.itemFromIndex(m_tree), ret);
+    return ret;
+}
+
 std::set<Index> Set::stdSet() const
 {
     Set::Iterator it = iterator();
@@ -941,6 +990,81 @@ Set BasicSetRepository::createSet(const std::set<Index>& indices)
     return createSetFromIndices(indicesVector);
 }
 
+Set BasicSetRepository::createUnion(const std::vector<Set>& sets, const std::vector<Index>& indices)
+{
+    QMutexLocker lock(m_mutex);
+
+    SetRepositoryAlgorithms alg(m_dataRepository, this);
+    auto lists = alg.flatten(sets);
+    lists.push_back(indices);
+
+    //Merge pairs of lists until one is left, so that every index takes part in a logarithmic count of merges
+    while (lists.size() > 1) {
+        std::vector<std::vector<Index>> next;
+        next.reserve(lists.size() / 2 + 1);
+        for (std::size_t i = 0; i + 1 < lists.size(); i += 2) {
+            std::vector<Index> merged;
+            merged.reserve(lists[i].size() + lists[i + 1].size());
+            SetAlgebra::unite(lists[i].data(), lists[i].data() + lists[i].size(), lists[i + 1].data(),
+                              lists[i + 1].data() + lists[i + 1].size(), merged);
+            next.push_back(std::move(merged));
+        }
+        if (lists.size() % 2)
+            next.push_back(std::move(lists.back()));
+        lists.swap(next);
+    }
+
+    return alg.setFromIndices(lists.front());
+}
+
+Set BasicSetRepository::createIntersection(const std::vector<Set>& sets)
+{
+    if (sets.empty())
+        return Set();
+
+    QMutexLocker lock(m_mutex);
+
+    SetRepositoryAlgorithms alg(m_dataRepository, this);
+    auto lists = alg.flatten(sets);
+    //Start with the smallest list, it bounds the size of all intermediate results
+    std::sort(lists.begin(), lists.end(), [](const std::vector<Index>& lhs, const std::vector<Index>& rhs) {
+        return lhs.size() < rhs.size();
+    });
+
+    std::vector<Index> result = std::move(lists.front());
+    std::vector<Index> intersection;
+    for (auto it = lists.begin() + 1; it != lists.end() && !result.empty(); ++it) {
+        intersection.clear();
+        SetAlgebra::intersect(result.data(), result.data() + result.size(), it->data(), it->data() + it->size(),
+                              intersection);
+        result.swap(intersection);
+    }
+
+    return alg.setFromIndices(result);
+}
+
+Set BasicSetRepository::createDifference(const Set& set, const std::vector<Set>& subtracted)
+{
+    if (!set.m_tree)
+        return Set();
+
+    QMutexLocker lock(m_mutex);
+
+    SetRepositoryAlgorithms alg(m_dataRepository, this);
+    std::vector<Index> result = alg.flatten({set}).front();
+    std::vector<Index> difference;
+    for (const auto& list : alg.flatten(subtracted)) {
+        if (result.empty())
+            break;
+        difference.clear();
+        SetAlgebra::subtract(result.data(), result.data() + result.size(), list.data(), list.data() + list.size(),
+                             difference);
+        result.swap(difference);
+    }
+
+    return alg.setFromIndices(result);
+}
+
 BasicSetRepository::BasicSetRepository(const QString& name, QRecursiveMutex* mutex,
                                        KDevelop::ItemRepositoryRegistry* registry, bool delayedDeletion)
     : m_dataRepository(this, name, registry, mutex)
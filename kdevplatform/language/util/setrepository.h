@@ -175,10 +175,39 @@ public:
             set().staticRef();
     }
 
+    ///@param indices sorted indices
+    explicit StorableSet(const std::vector<uint>& indices)
+    {
+        StaticAccessLocker lock;
+        Q_UNUSED(lock);
+        if (!indices.empty())
+            m_setIndex = StaticRepository::repository()->createSetFromIndices(indices).setIndex();
+        if (doReferenceCounting)
+            set().staticRef();
+    }
+
     StorableSet()
     {
     }
 
+    ///Returns the union of @p sets and of the sorted @p indices, see BasicSetRepository::createUnion()
+    static StorableSet unite(const std::vector<StorableSet>& sets, const std::vector<uint>& indices = {})
+    {
+        StaticAccessLocker lock;
+        Q_UNUSED(lock);
+        std::vector<Set> repositorySets;
+        repositorySets.reserve(sets.size());
+        for (const auto& set : sets) {
+            repositorySets.push_back(set.set());
+        }
+
+        StorableSet ret;
+        ret.m_setIndex = StaticRepository::repository()->createUnion(repositorySets, indices).setIndex();
+        if (doReferenceCounting)
+            ret.set().staticRef();
+        return ret;
+    }
+
     ~StorableSet()
     {
         StaticAccessLocker lock;
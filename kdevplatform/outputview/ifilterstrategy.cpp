@@ -6,6 +6,7 @@
 */
 
 #include "ifilterstrategy.h"
+#include "filtereditem.h"
 
 namespace KDevelop
 {
@@ -25,4 +26,18 @@ IFilterStrategy::Progress IFilterStrategy::progressInLine(const QString& line)
     return {};
 }
 
+QVector<FilteredItem> IFilterStrategy::filterLines(const QStringList& lines)
+{
+    QVector<FilteredItem> items;
+    items.reserve(lines.size());
+    for (const QString& line : lines) {
+        FilteredItem item = errorInLine(line);
+        if (item.type == FilteredItem::InvalidItem) {
+            item = actionInLine(line);
+        }
+        items << item;
+    }
+    return items;
+}
+
 }
@@ -12,6 +12,8 @@
 
 #include <QMetaType>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
 namespace KDevelop
 {
@@ -66,6 +68,17 @@ public:
      */
     virtual Progress progressInLine(const QString& line);
 
+    /**
+     * Examine consecutive lines, which follow all lines examined before, for errors and actions.
+     *
+     * The default implementation calls errorInLine() for each line, and actionInLine() if that
+     * did not find an error. Strategies can override this to examine the lines concurrently, but
+     * must return the same items.
+     *
+     * @return one FilteredItem per line, in the order of @p lines
+     */
+    virtual QVector<FilteredItem> filterLines(const QStringList& lines);
+
 };
 
 } // namespace KDevelop
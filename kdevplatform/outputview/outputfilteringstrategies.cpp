@@ -7,6 +7,7 @@
 #include "outputfilteringstrategies.h"
 #include "outputformats.h"
 #include "filtereditem.h"
+#include <util/algorithm.h>
 #include <util/path.h>
 
 #include <KLocalizedString>
@@ -14,6 +15,8 @@
 #include <QFileInfo>
 
 #include <algorithm>
+#include <iterator>
+#include <vector>
 
 namespace KDevelop
 {
@@ -64,96 +67,30 @@ FilteredItem NoFilterStrategy::errorInLine(const QString& line)
 
 /// --- Compiler error filter strategy ---
 
-/// Impl. of CompilerFilterStrategy.
-class CompilerFilterStrategyPrivate
-{
-public:
-    explicit CompilerFilterStrategyPrivate(const QUrl& buildDir);
-    Path pathForFile( const QString& ) const;
-    bool isMultiLineCase(const ErrorFormat& curErrFilter) const;
-    void putDirAtEnd(const Path& pathToInsert);
-
-    QVector<Path> m_currentDirs;
-    Path m_buildDir;
-
-    using PositionMap = QHash<Path, int>;
-    PositionMap m_positionInCurrentDirs;
-};
-
-CompilerFilterStrategyPrivate::CompilerFilterStrategyPrivate(const QUrl& buildDir)
-    : m_buildDir(buildDir)
-{
-}
-
-Path CompilerFilterStrategyPrivate::pathForFile(const QString& filename) const
-{
-    QFileInfo fi( filename );
-    Path currentPath;
-    if( fi.isRelative() ) {
-        if( m_currentDirs.isEmpty() ) {
-            return Path(m_buildDir, filename );
-        }
-
-        auto it = m_currentDirs.constEnd() - 1;
-        do {
-            currentPath = Path(*it, filename);
-        } while( (it-- !=  m_currentDirs.constBegin()) && !QFileInfo::exists(currentPath.toLocalFile()) );
-
-        return currentPath;
-    } else {
-        currentPath = Path(filename);
-    }
-    return currentPath;
-}
-
-bool CompilerFilterStrategyPrivate::isMultiLineCase(const KDevelop::ErrorFormat& curErrFilter) const
-{
-    if(curErrFilter.compiler == QLatin1String("gfortran") || curErrFilter.compiler == QLatin1String("cmake")) {
-        return true;
-    }
-    return false;
-}
-
-void CompilerFilterStrategyPrivate::putDirAtEnd(const Path& pathToInsert)
-{
-    CompilerFilterStrategyPrivate::PositionMap::iterator it = m_positionInCurrentDirs.find( pathToInsert );
-    // Encountered new build directory?
-    if (it == m_positionInCurrentDirs.end()) {
-        m_currentDirs.push_back( pathToInsert );
-        m_positionInCurrentDirs.insert( pathToInsert, m_currentDirs.size() - 1 );
-    } else {
-        // Build dir already in currentDirs, but move it to back of currentDirs list
-        // (this gives us most-recently-used semantics in pathForFile)
-        std::rotate(m_currentDirs.begin() + it.value(), m_currentDirs.begin() + it.value() + 1, m_currentDirs.end() );
-        it.value() = m_currentDirs.size() - 1;
-    }
-}
+namespace {
 
-CompilerFilterStrategy::CompilerFilterStrategy(const QUrl& buildDir)
-    : d_ptr(new CompilerFilterStrategyPrivate(buildDir))
+/// The format that matched a line together with its match, or no format at all
+template<typename Format>
+struct FormatMatch
 {
-}
-
-CompilerFilterStrategy::~CompilerFilterStrategy() = default;
+    const Format* format = nullptr;
+    QRegularExpressionMatch match;
+};
 
-QVector<QString> CompilerFilterStrategy::currentDirs() const
+/// The part of filtering a line that does not depend on the preceding lines
+struct CompilerLineMatch
 {
-    Q_D(const CompilerFilterStrategy);
+    FormatMatch<ErrorFormat> error;
+    FormatMatch<ActionFormat> action;
+};
 
-    QVector<QString> ret;
-    ret.reserve(d->m_currentDirs.size());
-    for (const auto& path : std::as_const(d->m_currentDirs)) {
-        ret << path.pathOrUrl();
-    }
-    return ret;
-}
+/// Lines are only filtered concurrently in batches of at least this size per thread
+constexpr int MinimumLinesPerThread = 256;
 
-FilteredItem CompilerFilterStrategy::actionInLine(const QString& line)
+/// A list of filters for possible compiler, linker, and make actions
+const auto& compilerActionFormats()
 {
-    Q_D(CompilerFilterStrategy);
-
-    // A list of filters for possible compiler, linker, and make actions
-    static const ActionFormat ACTION_FILTERS[] = {
+    static const ActionFormat formats[] = {
         ActionFormat( 2,
                       QStringLiteral("(?:^|[^=])\\b(gcc|CC|cc|distcc|c\\+\\+|g\\+\\+|clang(?:\\+\\+)|mpicc|icc|icpc)\\s+.*-c.*[/ '\\\\]+(\\w+\\.(?:cpp|CPP|c|C|cxx|CXX|cs|java|hpf|f|F|f90|F90|f95|F95))")),
         //moc and uic
@@ -194,60 +131,13 @@ FilteredItem CompilerFilterStrategy::actionInLine(const QString& line)
         ActionFormat( QStringLiteral("cd"),
                       QStringLiteral("(Waf|scons): Entering directory (\\`|\\')(.+)'"), 3)
     };
-
-    FilteredItem item(line);
-    for (const auto& curActFilter : ACTION_FILTERS) {
-        const auto match = curActFilter.expression.match(line);
-        if( match.hasMatch() ) {
-            item.type = FilteredItem::ActionItem;
-
-            if( curActFilter.tool == QLatin1String("cd") ) {
-                const Path path(match.captured(curActFilter.fileGroup));
-                d->m_currentDirs.push_back( path );
-                d->m_positionInCurrentDirs.insert( path , d->m_currentDirs.size() - 1 );
-            }
-
-            // Special case for cmake: we parse the "Compiling <objectfile>" expression
-            // and use it to find out about the build paths encountered during a build.
-            // They are later searched by pathForFile to find source files corresponding to
-            // compiler errors.
-            // Note: CMake objectfile has the format: "/path/to/four/CMakeFiles/file.o"
-            if ( curActFilter.fileGroup != -1 && curActFilter.tool == QLatin1String("cmake") && line.contains(QLatin1String("Building"))) {
-                const auto objectFile = match.captured(curActFilter.fileGroup);
-                const auto dir = objectFile.section(QStringLiteral("CMakeFiles/"), 0, 0);
-                d->putDirAtEnd(Path(d->m_buildDir, dir));
-            }
-            break;
-        }
-    }
-    return item;
+    return formats;
 }
 
-FilteredItem CompilerFilterStrategy::errorInLine(const QString& line)
+/// A list of filters for possible compiler, linker, and make errors
+const auto& compilerErrorFormats()
 {
-    Q_D(CompilerFilterStrategy);
-
-    // All the possible string that indicate an error if we via Regex have been able to
-    // extract file and linenumber from a given outputline
-    // TODO: This seems clumsy -- and requires another scan of the line.
-    // Merge this information into ErrorFormat? --Kevin
-    using Indicator = QPair<QString, FilteredItem::FilteredOutputItemType>;
-    static const Indicator INDICATORS[] = {
-        // ld
-        Indicator(QStringLiteral("undefined reference"), FilteredItem::ErrorItem),
-        Indicator(QStringLiteral("undefined symbol"), FilteredItem::ErrorItem),
-        Indicator(QStringLiteral("ld: cannot find"), FilteredItem::ErrorItem),
-        Indicator(QStringLiteral("no such file"), FilteredItem::ErrorItem),
-        // gcc
-        Indicator(QStringLiteral("error"), FilteredItem::ErrorItem),
-        // generic
-        Indicator(QStringLiteral("warning"), FilteredItem::WarningItem),
-        Indicator(QStringLiteral("info"), FilteredItem::InformationItem),
-        Indicator(QStringLiteral("note"), FilteredItem::InformationItem),
-    };
-
-    // A list of filters for possible compiler, linker, and make errors
-    static const ErrorFormat ERROR_FILTERS[] = {
+    static const ErrorFormat formats[] = {
 #ifdef Q_OS_WIN
         // MSVC
         ErrorFormat( QStringLiteral("^([a-zA-Z]:\\\\.+)\\(([1-9][0-9]*)\\): ((?:error|warning) .+\\:).*$"), 1, 2, 3 ),
@@ -296,56 +186,292 @@ FilteredItem CompilerFilterStrategy::errorInLine(const QString& line)
         ErrorFormat(QStringLiteral("^(.*)\\(([0-9]+),([0-9]+)\\): ((?:[Ww]arning|[Ee]rror) TS[0-9]+: .*)"), 1, 2, 4,
                     QStringLiteral("tsc"), 3),
     };
+    return formats;
+}
+
+/**
+ * Most lines of a build log match none of the formats. Every action format requires one of these literals,
+ * which are much cheaper to look for than evaluating all expressions.
+ */
+bool mayMatchCompilerAction(const QString& line)
+{
+    static const QLatin1String literals[] = {
+        QLatin1String("-c"), QLatin1String("-o"), QLatin1String("%] "), QLatin1String("-- "),
+        QLatin1String("Entering directory"), QLatin1String("libtool"), QLatin1String("compiling "),
+        QLatin1String("generating "), QLatin1String("linking "), QLatin1String("Linking "), QLatin1String("cmake"),
+        QLatin1String("mkinstalldirs"), QLatin1String("usr/bin/install"), QLatin1String("dcopidl"),
+    };
+    return std::any_of(std::begin(literals), std::end(literals), [&line](QLatin1String literal) {
+        return line.contains(literal);
+    });
+}
 
-    FilteredItem item(line);
-    for (const auto& curErrFilter : ERROR_FILTERS) {
-        const auto match = curErrFilter.expression.match(line);
+/// Same as mayMatchCompilerAction() for the error formats, nearly all of them require a colon
+bool mayMatchCompilerError(const QString& line)
+{
+    return line.contains(QLatin1Char(':')) || line.contains(QLatin1String("No rule to make target"))
+        || line.contains(QLatin1String("PGF9"));
+}
+
+FormatMatch<ActionFormat> matchCompilerAction(const QString& line)
+{
+    if (!mayMatchCompilerAction(line)) {
+        return {};
+    }
+    for (const auto& format : compilerActionFormats()) {
+        auto match = format.expression.match(line);
+        if (match.hasMatch()) {
+            return {&format, std::move(match)};
+        }
+    }
+    return {};
+}
+
+FormatMatch<ErrorFormat> matchCompilerError(const QString& line)
+{
+    if (!mayMatchCompilerError(line)) {
+        return {};
+    }
+    for (const auto& format : compilerErrorFormats()) {
+        auto match = format.expression.match(line);
         if( match.hasMatch() && !( line.contains( QLatin1String("Each undeclared identifier is reported only once") )
                                || line.contains( QLatin1String("for each function it appears in.") ) ) )
         {
-            if(curErrFilter.fileGroup > 0) {
-                if( curErrFilter.compiler == QLatin1String("cmake") ) { // Unfortunately we cannot know if an error or an action comes first in cmake, and therefore we need to do this
-                    if( d->m_currentDirs.empty() ) {
-                        d->putDirAtEnd( d->m_buildDir.parent() );
-                    }
-                }
-                item.url = d->pathForFile( match.captured( curErrFilter.fileGroup ) ).toUrl();
-            }
-            initializeFilteredItem(item, curErrFilter, match);
+            return {&format, std::move(match)};
+        }
+    }
+    return {};
+}
 
-            const auto txt = match.capturedView(curErrFilter.textGroup);
+}
 
-            // Find the indicator which happens most early.
-            int earliestIndicatorIdx = txt.length();
-            for (const auto& curIndicator : INDICATORS) {
-                int curIndicatorIdx = txt.indexOf(curIndicator.first, 0, Qt::CaseInsensitive);
-                if((curIndicatorIdx >= 0) && (earliestIndicatorIdx > curIndicatorIdx)) {
-                    earliestIndicatorIdx = curIndicatorIdx;
-                    item.type = curIndicator.second;
-                }
+/// Impl. of CompilerFilterStrategy.
+class CompilerFilterStrategyPrivate
+{
+public:
+    explicit CompilerFilterStrategyPrivate(const QUrl& buildDir);
+    Path pathForFile( const QString& ) const;
+    bool isMultiLineCase(const ErrorFormat& curErrFilter) const;
+    void putDirAtEnd(const Path& pathToInsert);
+    FilteredItem actionItem(const QString& line, const FormatMatch<ActionFormat>& action);
+    FilteredItem errorItem(const QString& line, const FormatMatch<ErrorFormat>& error);
+
+    QVector<Path> m_currentDirs;
+    Path m_buildDir;
+
+    using PositionMap = QHash<Path, int>;
+    PositionMap m_positionInCurrentDirs;
+};
+
+CompilerFilterStrategyPrivate::CompilerFilterStrategyPrivate(const QUrl& buildDir)
+    : m_buildDir(buildDir)
+{
+}
+
+Path CompilerFilterStrategyPrivate::pathForFile(const QString& filename) const
+{
+    QFileInfo fi( filename );
+    Path currentPath;
+    if( fi.isRelative() ) {
+        if( m_currentDirs.isEmpty() ) {
+            return Path(m_buildDir, filename );
+        }
+
+        auto it = m_currentDirs.constEnd() - 1;
+        do {
+            currentPath = Path(*it, filename);
+        } while( (it-- !=  m_currentDirs.constBegin()) && !QFileInfo::exists(currentPath.toLocalFile()) );
+
+        return currentPath;
+    } else {
+        currentPath = Path(filename);
+    }
+    return currentPath;
+}
+
+bool CompilerFilterStrategyPrivate::isMultiLineCase(const KDevelop::ErrorFormat& curErrFilter) const
+{
+    if(curErrFilter.compiler == QLatin1String("gfortran") || curErrFilter.compiler == QLatin1String("cmake")) {
+        return true;
+    }
+    return false;
+}
+
+void CompilerFilterStrategyPrivate::putDirAtEnd(const Path& pathToInsert)
+{
+    CompilerFilterStrategyPrivate::PositionMap::iterator it = m_positionInCurrentDirs.find( pathToInsert );
+    // Encountered new build directory?
+    if (it == m_positionInCurrentDirs.end()) {
+        m_currentDirs.push_back( pathToInsert );
+        m_positionInCurrentDirs.insert( pathToInsert, m_currentDirs.size() - 1 );
+    } else {
+        // Build dir already in currentDirs, but move it to back of currentDirs list
+        // (this gives us most-recently-used semantics in pathForFile)
+        std::rotate(m_currentDirs.begin() + it.value(), m_currentDirs.begin() + it.value() + 1, m_currentDirs.end() );
+        it.value() = m_currentDirs.size() - 1;
+    }
+}
+
+FilteredItem CompilerFilterStrategyPrivate::actionItem(const QString& line, const FormatMatch<ActionFormat>& action)
+{
+    FilteredItem item(line);
+    if (!action.format) {
+        return item;
+    }
+    const auto& curActFilter = *action.format;
+    const auto& match = action.match;
+
+    item.type = FilteredItem::ActionItem;
+
+    if( curActFilter.tool == QLatin1String("cd") ) {
+        const Path path(match.captured(curActFilter.fileGroup));
+        m_currentDirs.push_back( path );
+        m_positionInCurrentDirs.insert( path , m_currentDirs.size() - 1 );
+    }
+
+    // Special case for cmake: we parse the "Compiling <objectfile>" expression
+    // and use it to find out about the build paths encountered during a build.
+    // They are later searched by pathForFile to find source files corresponding to
+    // compiler errors.
+    // Note: CMake objectfile has the format: "/path/to/four/CMakeFiles/file.o"
+    if ( curActFilter.fileGroup != -1 && curActFilter.tool == QLatin1String("cmake") && line.contains(QLatin1String("Building"))) {
+        const auto objectFile = match.captured(curActFilter.fileGroup);
+        const auto dir = objectFile.section(QStringLiteral("CMakeFiles/"), 0, 0);
+        putDirAtEnd(Path(m_buildDir, dir));
+    }
+    return item;
+}
+
+FilteredItem CompilerFilterStrategyPrivate::errorItem(const QString& line, const FormatMatch<ErrorFormat>& error)
+{
+    // All the possible string that indicate an error if we via Regex have been able to
+    // extract file and linenumber from a given outputline
+    // TODO: This seems clumsy -- and requires another scan of the line.
+    // Merge this information into ErrorFormat? --Kevin
+    using Indicator = QPair<QString, FilteredItem::FilteredOutputItemType>;
+    static const Indicator INDICATORS[] = {
+        // ld
+        Indicator(QStringLiteral("undefined reference"), FilteredItem::ErrorItem),
+        Indicator(QStringLiteral("undefined symbol"), FilteredItem::ErrorItem),
+        Indicator(QStringLiteral("ld: cannot find"), FilteredItem::ErrorItem),
+        Indicator(QStringLiteral("no such file"), FilteredItem::ErrorItem),
+        // gcc
+        Indicator(QStringLiteral("error"), FilteredItem::ErrorItem),
+        // generic
+        Indicator(QStringLiteral("warning"), FilteredItem::WarningItem),
+        Indicator(QStringLiteral("info"), FilteredItem::InformationItem),
+        Indicator(QStringLiteral("note"), FilteredItem::InformationItem),
+    };
+
+    FilteredItem item(line);
+    if (!error.format) {
+        return item;
+    }
+    const auto& curErrFilter = *error.format;
+    const auto& match = error.match;
+
+    if(curErrFilter.fileGroup > 0) {
+        if( curErrFilter.compiler == QLatin1String("cmake") ) { // Unfortunately we cannot know if an error or an action comes first in cmake, and therefore we need to do this
+            if( m_currentDirs.empty() ) {
+                putDirAtEnd( m_buildDir.parent() );
             }
+        }
+        item.url = pathForFile( match.captured( curErrFilter.fileGroup ) ).toUrl();
+    }
+    initializeFilteredItem(item, curErrFilter, match);
 
-            // Make the item clickable if it comes with the necessary file information
-            if (item.url.isValid()) {
-                item.isActivatable = true;
-                if(item.type == FilteredItem::InvalidItem) {
-                    // If there are no error indicators in the line
-                    // maybe this is a multiline case
-                    if(d->isMultiLineCase(curErrFilter)) {
-                        item.type = FilteredItem::ErrorItem;
-                    } else {
-                        // Okay so we couldn't find anything to indicate an error, but we have file and lineGroup
-                        // Lets keep this item clickable and indicate this to the user.
-                        item.type = FilteredItem::InformationItem;
-                    }
-                }
+    const auto txt = match.capturedView(curErrFilter.textGroup);
+
+    // Find the indicator which happens most early.
+    int earliestIndicatorIdx = txt.length();
+    for (const auto& curIndicator : INDICATORS) {
+        int curIndicatorIdx = txt.indexOf(curIndicator.first, 0, Qt::CaseInsensitive);
+        if((curIndicatorIdx >= 0) && (earliestIndicatorIdx > curIndicatorIdx)) {
+            earliestIndicatorIdx = curIndicatorIdx;
+            item.type = curIndicator.second;
+        }
+    }
+
+    // Make the item clickable if it comes with the necessary file information
+    if (item.url.isValid()) {
+        item.isActivatable = true;
+        if(item.type == FilteredItem::InvalidItem) {
+            // If there are no error indicators in the line
+            // maybe this is a multiline case
+            if(isMultiLineCase(curErrFilter)) {
+                item.type = FilteredItem::ErrorItem;
+            } else {
+                // Okay so we couldn't find anything to indicate an error, but we have file and lineGroup
+                // Lets keep this item clickable and indicate this to the user.
+                item.type = FilteredItem::InformationItem;
             }
-            break;
         }
     }
     return item;
 }
 
+CompilerFilterStrategy::CompilerFilterStrategy(const QUrl& buildDir)
+    : d_ptr(new CompilerFilterStrategyPrivate(buildDir))
+{
+}
+
+CompilerFilterStrategy::~CompilerFilterStrategy() = default;
+
+QVector<QString> CompilerFilterStrategy::currentDirs() const
+{
+    Q_D(const CompilerFilterStrategy);
+
+    QVector<QString> ret;
+    ret.reserve(d->m_currentDirs.size());
+    for (const auto& path : std::as_const(d->m_currentDirs)) {
+        ret << path.pathOrUrl();
+    }
+    return ret;
+}
+
+FilteredItem CompilerFilterStrategy::actionInLine(const QString& line)
+{
+    Q_D(CompilerFilterStrategy);
+
+    return d->actionItem(line, matchCompilerAction(line));
+}
+
+FilteredItem CompilerFilterStrategy::errorInLine(const QString& line)
+{
+    Q_D(CompilerFilterStrategy);
+
+    return d->errorItem(line, matchCompilerError(line));
+}
+
+QVector<FilteredItem> CompilerFilterStrategy::filterLines(const QStringList& lines)
+{
+    Q_D(CompilerFilterStrategy);
+
+    // matching the expressions is the expensive part, and it does not depend on the preceding lines
+    std::vector<CompilerLineMatch> matches(lines.size());
+    Algorithm::parallelForRanges(lines.size(), MinimumLinesPerThread, [&lines, &matches](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            matches[i].error = matchCompilerError(lines[i]);
+            if (!matches[i].error.format) {
+                matches[i].action = matchCompilerAction(lines[i]);
+            }
+        }
+    });
+
+    // the tracking of the current directories requires the lines in order
+    QVector<FilteredItem> items;
+    items.reserve(lines.size());
+    for (int i = 0; i < lines.size(); ++i) {
+        auto item = d->errorItem(lines[i], matches[i].error);
+        if (item.type == FilteredItem::InvalidItem) {
+            // rarely, a line matches an error format but still is no error
+            item = d->actionItem(lines[i], matches[i].error.format ? matchCompilerAction(lines[i]) : matches[i].action);
+        }
+        items << item;
+    }
+    return items;
+}
+
 
 /// --- Script error filter strategy ---
 
@@ -58,6 +58,14 @@ public:
 
     FilteredItem actionInLine(const QString& line) override;
 
+    /**
+     * Matches the lines against the error and action formats concurrently, and then
+     * tracks the current directories in order.
+     *
+     * Subclasses that override errorInLine() or actionInLine() must override this as well.
+     */
+    QVector<FilteredItem> filterLines(const QStringList& lines) override;
+
     QVector<QString> currentDirs() const;
 
 private:
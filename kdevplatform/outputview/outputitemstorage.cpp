@@ -0,0 +1,185 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "outputitemstorage.h"
+
+#include "debug.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QTemporaryFile>
+
+namespace KDevelop
+{
+
+namespace {
+/// Spill only once this many more items than allowed are in memory, so that spilling happens in large writes
+int spillThreshold(int maximumItemsInMemory)
+{
+    return maximumItemsInMemory + qMax(maximumItemsInMemory / 4, 64);
+}
+
+void writeItem(QDataStream& stream, const FilteredItem& item)
+{
+    stream << quint8(item.type) << item.isActivatable << qint32(item.lineNo) << qint32(item.columnNo)
+           << item.url.toEncoded() << item.originalLine.toUtf8();
+}
+
+FilteredItem readItem(QDataStream& stream)
+{
+    quint8 type = 0;
+    bool isActivatable = false;
+    qint32 lineNo = -1;
+    qint32 columnNo = -1;
+    QByteArray url;
+    QByteArray line;
+    stream >> type >> isActivatable >> lineNo >> columnNo >> url >> line;
+
+    FilteredItem item(QString::fromUtf8(line), static_cast<FilteredItem::FilteredOutputItemType>(type));
+    item.isActivatable = isActivatable;
+    item.lineNo = lineNo;
+    item.columnNo = columnNo;
+    item.url = QUrl::fromEncoded(url);
+    return item;
+}
+}
+
+OutputItemStorage::OutputItemStorage()
+    : m_readCache(256)
+{
+}
+
+OutputItemStorage::~OutputItemStorage() = default;
+
+void OutputItemStorage::setMaximumItemsInMemory(int count)
+{
+    m_maximumItemsInMemory = qMax(count, 0);
+}
+
+int OutputItemStorage::size() const
+{
+    return static_cast<int>(m_activatable.size());
+}
+
+FilteredItem OutputItemStorage::at(int row) const
+{
+    const int firstItemInMemory = size() - m_items.size();
+    if (row >= firstItemInMemory) {
+        return m_items.at(row - firstItemInMemory);
+    }
+    if (const auto* cached = m_readCache.object(row)) {
+        return *cached;
+    }
+    auto item = readSpilled(row);
+    m_readCache.insert(row, new FilteredItem(item));
+    return item;
+}
+
+bool OutputItemStorage::isActivatable(int row) const
+{
+    return m_activatable[row];
+}
+
+void OutputItemStorage::append(const QVector<FilteredItem>& items)
+{
+    m_items.reserve(m_items.size() + items.size());
+    for (const auto& item : items) {
+        m_items << item;
+        m_activatable.push_back(item.isActivatable);
+    }
+
+    if (m_maximumItemsInMemory > 0 && !m_spillingFailed && m_items.size() > spillThreshold(m_maximumItemsInMemory)) {
+        spill();
+    }
+}
+
+void OutputItemStorage::clear()
+{
+    m_items.clear();
+    m_offsets.clear();
+    m_activatable.clear();
+    m_readCache.clear();
+    m_map = nullptr;
+    m_mappedSize = 0;
+    // removes the file and its mapping
+    m_file.reset();
+    m_spillingFailed = false;
+}
+
+void OutputItemStorage::spill()
+{
+    if (!m_file) {
+        m_file = std::make_unique<QTemporaryFile>(QDir::tempPath() + QLatin1String("/kdevelop-output-XXXXXX"));
+        if (!m_file->open()) {
+            qCWarning(OUTPUTVIEW) << "cannot create a file for old output lines, keeping them in memory:"
+                                  << m_file->errorString();
+            m_file.reset();
+            m_spillingFailed = true;
+            return;
+        }
+        m_offsets.push_back(0);
+    }
+
+    const int count = m_items.size() - m_maximumItemsInMemory;
+    QByteArray buffer;
+    QDataStream stream(&buffer, QIODevice::WriteOnly);
+    std::vector<qint64> offsets;
+    offsets.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        writeItem(stream, m_items.at(i));
+        offsets.push_back(m_offsets.back() + buffer.size());
+    }
+
+    if (!m_file->seek(m_offsets.back()) || m_file->write(buffer) != buffer.size() || !m_file->flush()) {
+        qCWarning(OUTPUTVIEW) << "cannot write old output lines, keeping them in memory:" << m_file->errorString();
+        m_spillingFailed = true;
+        return;
+    }
+
+    m_offsets.insert(m_offsets.end(), offsets.begin(), offsets.end());
+    m_items.remove(0, count);
+}
+
+const uchar* OutputItemStorage::mappedData(qint64 size) const
+{
+    if (size > m_mappedSize) {
+        if (m_map) {
+            m_file->unmap(m_map);
+        }
+        // map everything written so far, the file grows in large steps
+        m_mappedSize = m_offsets.back();
+        m_map = m_file->map(0, m_mappedSize);
+        if (!m_map) {
+            m_mappedSize = 0;
+        }
+    }
+    return m_map;
+}
+
+FilteredItem OutputItemStorage::readSpilled(int row) const
+{
+    const qint64 begin = m_offsets[row];
+    const qint64 end = m_offsets[row + 1];
+
+    QByteArray data;
+    if (const auto* map = mappedData(end)) {
+        data = QByteArray::fromRawData(reinterpret_cast<const char*>(map) + begin, end - begin);
+    } else {
+        // mapping is not supported everywhere, read the item instead
+        m_file->seek(begin);
+        data = m_file->read(end - begin);
+    }
+
+    QDataStream stream(data);
+    auto item = readItem(stream);
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(OUTPUTVIEW) << "cannot read old output line" << row;
+        return FilteredItem();
+    }
+    return item;
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_OUTPUTITEMSTORAGE_H
+#define KDEVPLATFORM_OUTPUTITEMSTORAGE_H
+
+#include "filtereditem.h"
+
+#include <QCache>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+class QTemporaryFile;
+
+namespace KDevelop
+{
+
+/**
+ * Stores the items of an OutputModel.
+ *
+ * Only the most recent items are kept in memory. Older items are appended to a temporary file,
+ * which is memory-mapped to read them back, so that the memory usage of very long outputs stays
+ * bounded. Per spilled item, only its offset in the file and whether it is activatable remain in
+ * memory.
+ *
+ * If the temporary file cannot be created or written, all items stay in memory.
+ */
+class OutputItemStorage
+{
+public:
+    /// The default of setMaximumItemsInMemory()
+    static constexpr int DefaultMaximumItemsInMemory = 100000;
+
+    OutputItemStorage();
+    ~OutputItemStorage();
+
+    Q_DISABLE_COPY_MOVE(OutputItemStorage)
+
+    /**
+     * Sets the count of recent items that are kept in memory, 0 keeps all items in memory.
+     * It takes effect when items are appended the next time.
+     */
+    void setMaximumItemsInMemory(int count);
+
+    int size() const;
+    /// @return the item at @p row, which is read from the temporary file if it was spilled
+    FilteredItem at(int row) const;
+    /// @return whether the item at @p row is activatable, without reading spilled items
+    bool isActivatable(int row) const;
+
+    void append(const QVector<FilteredItem>& items);
+    void clear();
+
+private:
+    /// Moves all but the most recent items to the temporary file
+    void spill();
+    FilteredItem readSpilled(int row) const;
+    /// @return the mapped file contents covering at least @p size bytes, or nullptr
+    const uchar* mappedData(qint64 size) const;
+
+    int m_maximumItemsInMemory = DefaultMaximumItemsInMemory;
+    /// The items that were not spilled, starting at row spilledCount()
+    QVector<FilteredItem> m_items;
+    /// The offsets of the spilled items in the file, followed by the end offset of the last one
+    std::vector<qint64> m_offsets;
+    /// Whether each item is activatable, for all rows
+    std::vector<bool> m_activatable;
+    std::unique_ptr<QTemporaryFile> m_file;
+    bool m_spillingFailed = false;
+    mutable uchar* m_map = nullptr;
+    mutable qint64 m_mappedSize = 0;
+    /// Recently read spilled items, views query each visible row several times while painting
+    mutable QCache<int, FilteredItem> m_readCache;
+};
+
+}
+
+#endif // KDEVPLATFORM_OUTPUTITEMSTORAGE_H
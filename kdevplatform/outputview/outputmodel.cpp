@@ -9,10 +9,12 @@
 #include "outputmodel.h"
 #include "filtereditem.h"
 #include "outputfilteringstrategies.h"
+#include "outputitemstorage.h"
 #include "debug.h"
 
 #include <interfaces/icore.h>
 #include <interfaces/idocumentcontroller.h>
+#include <util/algorithm.h>
 #include <util/kdevstringhandler.h>
 
 #include <QStringList>
@@ -41,6 +43,12 @@ static const int BATCH_SIZE = 50;
  */
 static const int BATCH_AGGREGATE_TIME_DELAY = 50;
 
+/**
+ * Minimum number of lines per thread when the cached lines are pre-processed
+ * concurrently. Fewer lines are processed in the parse worker's thread alone.
+ */
+static const int MINIMUM_LINES_PER_THREAD = 256;
+
 class ParseWorker : public QObject
 {
     Q_OBJECT
@@ -89,41 +97,31 @@ Q_SIGNALS:
 private Q_SLOTS:
     /**
      * Process *all* cached lines, emit parsedBatch for each batch
+     *
+     * When the worker falls behind, many lines are cached and the filtering
+     * strategy can spread them over several threads.
      */
     void process()
     {
-        QVector<KDevelop::FilteredItem> filteredItems;
-        filteredItems.reserve(qMin(BATCH_SIZE, m_cachedLines.size()));
-
-        // apply pre-filtering functions
-        std::transform(m_cachedLines.constBegin(), m_cachedLines.constEnd(),
-                       m_cachedLines.begin(), &KDevelop::stripAnsiSequences);
+        // apply pre-filtering functions, detach first so that the threads only write to their own lines
+        QString* const lines = m_cachedLines.data();
+        Algorithm::parallelForRanges(m_cachedLines.size(), MINIMUM_LINES_PER_THREAD, [lines](int begin, int end) {
+            std::transform(lines + begin, lines + end, lines + begin, &KDevelop::stripAnsiSequences);
+        });
 
         // apply filtering strategy
-        for (const QString& line : std::as_const(m_cachedLines)) {
-            FilteredItem item = m_filter->errorInLine(line);
-            if( item.type == FilteredItem::InvalidItem ) {
-                item = m_filter->actionInLine(line);
-            }
-
-            filteredItems << item;
+        const QVector<KDevelop::FilteredItem> filteredItems = m_filter->filterLines(m_cachedLines);
 
+        for (const QString& line : std::as_const(m_cachedLines)) {
             auto progress = m_filter->progressInLine(line);
             if (progress.percent >= 0 && m_progress.percent != progress.percent) {
                 m_progress = progress;
                 emit this->progress(m_progress);
             }
-
-            if( filteredItems.size() == BATCH_SIZE ) {
-                emit parsedBatch(filteredItems);
-                filteredItems.clear();
-                filteredItems.reserve(qMin(BATCH_SIZE, m_cachedLines.size()));
-            }
         }
 
-        // Make sure to emit the rest as well
-        if( !filteredItems.isEmpty() ) {
-            emit parsedBatch(filteredItems);
+        for (int i = 0; i < filteredItems.size(); i += BATCH_SIZE) {
+            emit parsedBatch(filteredItems.mid(i, BATCH_SIZE));
         }
         m_cachedLines.clear();
     }
@@ -173,7 +171,7 @@ public:
     OutputModel* model;
     ParseWorker* worker;
 
-    QVector<FilteredItem> m_filteredItems;
+    OutputItemStorage m_filteredItems;
     // We use std::set because that is ordered
     std::set<int> m_errorItems; // Indices of all items that we want to move to using previous and next
     QUrl m_buildDir;
@@ -182,13 +180,14 @@ public:
     {
         model->beginInsertRows( QModelIndex(), model->rowCount(), model->rowCount() + items.size() -  1);
 
-        m_filteredItems.reserve(m_filteredItems.size() + items.size());
+        int row = m_filteredItems.size();
         for (const FilteredItem& item : items) {
             if( item.type == FilteredItem::ErrorItem ) {
-                m_errorItems.insert(m_filteredItems.size());
+                m_errorItems.insert(row);
             }
-            m_filteredItems << item;
+            ++row;
         }
+        m_filteredItems.append(items);
 
         model->endInsertRows();
     }
@@ -260,7 +259,7 @@ int OutputModel::rowCount( const QModelIndex& parent ) const
     Q_D(const OutputModel);
 
     if( !parent.isValid() )
-        return d->m_filteredItems.count();
+        return d->m_filteredItems.size();
     return 0;
 }
 
@@ -310,7 +309,7 @@ QModelIndex OutputModel::firstHighlightIndex()
     }
 
     for( int row = 0; row < rowCount(); ++row ) {
-        if( d->m_filteredItems.at( row ).isActivatable ) {
+        if( d->m_filteredItems.isActivatable( row ) ) {
             return index( row, 0, QModelIndex() );
         }
     }
@@ -338,7 +337,7 @@ QModelIndex OutputModel::nextHighlightIndex( const QModelIndex &currentIdx )
     for( int row = 0; row < rowCount(); ++row )
     {
         int currow = (startrow + row) % rowCount();
-        if( d->m_filteredItems.at( currow ).isActivatable )
+        if( d->m_filteredItems.isActivatable( currow ) )
         {
             return index( currow, 0, QModelIndex() );
         }
@@ -371,7 +370,7 @@ QModelIndex OutputModel::previousHighlightIndex( const QModelIndex &currentIdx )
     for ( int row = 0; row < rowCount(); ++row )
     {
         int currow = (startrow - row) % rowCount();
-        if( d->m_filteredItems.at( currow ).isActivatable )
+        if( d->m_filteredItems.isActivatable( currow ) )
         {
             return index( currow, 0, QModelIndex() );
         }
@@ -388,7 +387,7 @@ QModelIndex OutputModel::lastHighlightIndex()
     }
 
     for( int row = rowCount()-1; row >=0; --row ) {
-        if( d->m_filteredItems.at( row ).isActivatable ) {
+        if( d->m_filteredItems.isActivatable( row ) ) {
             return index( row, 0, QModelIndex() );
         }
     }
@@ -396,6 +395,13 @@ QModelIndex OutputModel::lastHighlightIndex()
     return QModelIndex();
 }
 
+void OutputModel::setMaximumLinesInMemory(int lineCount)
+{
+    Q_D(OutputModel);
+
+    d->m_filteredItems.setMaximumItemsInMemory(lineCount);
+}
+
 void OutputModel::setFilteringStrategy(const OutputFilterStrategy& currentStrategy)
 {
     Q_D(OutputModel);
@@ -466,6 +472,7 @@ void OutputModel::clear()
     ensureAllDone();
     beginResetModel();
     d->m_filteredItems.clear();
+    d->m_errorItems.clear();
     endResetModel();
 }
 
@@ -57,6 +57,14 @@ public:
     int rowCount( const QModelIndex& = QModelIndex() ) const override;
     QVariant headerData( int, Qt::Orientation, int = Qt::DisplayRole ) const override;
 
+    /**
+     * Sets the count of recent lines that are kept in memory, 0 keeps all lines in memory.
+     *
+     * Older lines are moved to a temporary file and read back when they are accessed, which keeps
+     * the memory usage of very long outputs bounded. By default, the latest 100000 lines are kept.
+     */
+    void setMaximumLinesInMemory(int lineCount);
+
     void setFilteringStrategy(const OutputFilterStrategy& currentStrategy);
     void setFilteringStrategy(IFilterStrategy* filterStrategy);
 
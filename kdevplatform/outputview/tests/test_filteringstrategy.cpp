@@ -521,6 +521,54 @@ void TestFilteringStrategy::testCompilerFilterstrategyUrlFromAction()
     QCOMPARE(testee.currentDirs().at(last), expectedLastDir);
 }
 
+void TestFilteringStrategy::testCompilerFilterStrategyFilterLines()
+{
+    const QString basepath = projectPath();
+    const QStringList block = {
+        QStringLiteral("[ 25%] Building CXX object path/to/one/CMakeFiles/file.o"),
+        buildCompilerLine(),
+        QStringLiteral("../relative/file.cpp:12:5: error: expected ';' before '}' token"),
+        QString("make[4]: Entering directory '" + basepath + "/path/to/two/'"),
+        QStringLiteral("file.cpp:3: warning: unused variable 'x'"),
+        buildCompilerErrorLine(),
+        buildCompilerInformationLine(),
+        buildInfileIncludedFromFirstLine(),
+        buildCompilerActionLine(),
+        buildCmakeConfigureMultiLine(),
+        buildLinkerErrorLine(),
+        QStringLiteral("-- Configuring done"),
+        QStringLiteral("just some output"),
+        QStringLiteral("Each undeclared identifier is reported only once for each function it appears in."),
+        QStringLiteral("[ 26%] Building CXX object path/to/two/CMakeFiles/file.o"),
+    };
+    QStringList lines;
+    // enough lines to be filtered by several threads
+    while (lines.size() < 2000) {
+        lines += block;
+    }
+
+    const QUrl projecturl = QUrl::fromLocalFile(basepath);
+    CompilerFilterStrategy testee(projecturl);
+    const auto items = testee.filterLines(lines);
+
+    CompilerFilterStrategy reference(projecturl);
+    QCOMPARE(items.size(), lines.size());
+    for (int i = 0; i < lines.size(); ++i) {
+        auto expected = reference.errorInLine(lines[i]);
+        if (expected.type == FilteredItem::InvalidItem) {
+            expected = reference.actionInLine(lines[i]);
+        }
+        const auto& item = items[i];
+        QCOMPARE(item.originalLine, expected.originalLine);
+        QCOMPARE(item.type, expected.type);
+        QCOMPARE(item.url, expected.url);
+        QCOMPARE(item.lineNo, expected.lineNo);
+        QCOMPARE(item.columnNo, expected.columnNo);
+        QCOMPARE(item.isActivatable, expected.isActivatable);
+    }
+    QCOMPARE(testee.currentDirs(), reference.currentDirs());
+}
+
 void TestFilteringStrategy::benchMarkCompilerFilterAction()
 {
     QString projecturl = projectPath();
@@ -25,6 +25,7 @@ private Q_SLOTS:
     void testCompilerFilterstrategyMultipleKeywords();
     void testCompilerFilterstrategyUrlFromAction_data();
     void testCompilerFilterstrategyUrlFromAction();
+    void testCompilerFilterStrategyFilterLines();
     void testScriptErrorFilterStrategy_data();
     void testScriptErrorFilterStrategy();
     void testNativeAppErrorFilterStrategy_data();
@@ -64,6 +64,38 @@ QStringList generateLongLine()
     return QStringList() << line;
 }
 
+/// A build log like the one of "make -j" on a CMake project, with interleaved progress, commands and diagnostics
+QStringList generateBuildLog()
+{
+    const int numLines = 50000;
+    const QString buildDir = QStringLiteral("/tmp/build-foo");
+    QStringList outputlines;
+    for (int i = 0; outputlines.size() < numLines; ++i) {
+        const auto target = QStringLiteral("target%1").arg(i % 7);
+        const auto percent = QStringLiteral("[%1%] ").arg(i * 100 / (numLines / 4), 3);
+        outputlines << QStringLiteral("make[2]: Entering directory '%1/src/%2'").arg(buildDir, target);
+        outputlines << percent + QStringLiteral("Building CXX object src/%1/CMakeFiles/%1.dir/file%2.cpp.o").arg(target).arg(i);
+        outputlines << QStringLiteral("/usr/bin/c++ -DQT_CORE_LIB -I%1/src/%2 -isystem /usr/include/qt6 -O2 -g -fPIC "
+                                      "-o CMakeFiles/%2.dir/file%3.cpp.o -c /home/user/project/src/%2/file%3.cpp")
+                           .arg(buildDir, target)
+                           .arg(i);
+        if (i % 5 == 0) {
+            outputlines << QStringLiteral("/home/user/project/src/%1/file%2.cpp:%3:12: warning: unused variable 'x' [-Wunused-variable]")
+                               .arg(target)
+                               .arg(i)
+                               .arg(i % 300 + 1);
+            outputlines << QStringLiteral("   %1 |     int x = 0;").arg(i % 300 + 1, 4);
+            outputlines << QStringLiteral("      |         ^");
+        }
+        outputlines << QStringLiteral("make[2]: Leaving directory '%1/src/%2'").arg(buildDir, target);
+        if (i % 20 == 19) {
+            outputlines << percent + QStringLiteral("Linking CXX shared library lib%1.so").arg(target);
+            outputlines << percent + QStringLiteral("Built target %1").arg(target);
+        }
+    }
+    return outputlines;
+}
+
 void TestOutputModel::bench()
 {
     QFETCH(KDevelop::OutputModel::OutputFilterStrategy, strategy);
@@ -87,6 +119,7 @@ void TestOutputModel::bench()
 
     qDebug() << "ms elapsed to add lines: " << elapsed;
     qDebug() << "total number of added lines: " << lines.count();
+    qDebug() << "lines per second: " << (elapsed ? lines.count() * 1000 / elapsed : lines.count() * 1000);
     const double avgUiLockup = double(elapsed) / processEventsCounter;
     qDebug() << "average UI lockup in ms: " << avgUiLockup;
     QVERIFY(avgUiLockup < 200);
@@ -99,12 +132,14 @@ void TestOutputModel::bench_data()
 
     const QStringList lines = generateLines();
     const QStringList longLine = generateLongLine();
+    const QStringList buildLog = generateBuildLog();
 
     QTest::newRow("no-filter") << OutputModel::NoFilter << lines;
     QTest::newRow("no-filter-longline") << OutputModel::NoFilter << longLine;
 
     QTest::newRow("compiler-filter") << OutputModel::CompilerFilter << lines;
     QTest::newRow("compiler-filter-longline") << OutputModel::CompilerFilter << longLine;
+    QTest::newRow("compiler-filter-build-log") << OutputModel::CompilerFilter << buildLog;
 
     QTest::newRow("script-error-filter") << OutputModel::ScriptErrorFilter << lines;
     QTest::newRow("script-error-filter-longline") << OutputModel::ScriptErrorFilter << longLine;
@@ -113,6 +148,56 @@ void TestOutputModel::bench_data()
     QTest::newRow("static-analysis-filter-longline") << OutputModel::StaticAnalysisFilter << longLine;
 }
 
+
+void TestOutputModel::testMaximumLinesInMemory()
+{
+    const QStringList lines = generateLines().mid(0, 3000);
+
+    const auto fill = [&lines](OutputModel& model) {
+        model.setFilteringStrategy(OutputModel::CompilerFilter);
+        model.appendLines(lines);
+        QTRY_COMPARE(model.rowCount(), lines.count());
+    };
+
+    OutputModel reference(QUrl::fromLocalFile(QStringLiteral("/tmp/build-foo")));
+    reference.setMaximumLinesInMemory(0);
+    fill(reference);
+    QCOMPARE(reference.rowCount(), lines.count());
+
+    OutputModel testee(QUrl::fromLocalFile(QStringLiteral("/tmp/build-foo")));
+    testee.setMaximumLinesInMemory(100);
+    fill(testee);
+    QCOMPARE(testee.rowCount(), lines.count());
+
+    // read backwards as well, spilled lines are cached after reading them
+    for (int row : {0, 1, 2000, 1999, 2999, 5}) {
+        QCOMPARE(testee.data(testee.index(row)), reference.data(reference.index(row)));
+    }
+    for (int row = 0; row < lines.count(); ++row) {
+        QCOMPARE(testee.data(testee.index(row)), reference.data(reference.index(row)));
+        QCOMPARE(testee.data(testee.index(row), OutputModel::OutputItemTypeRole),
+                 reference.data(reference.index(row), OutputModel::OutputItemTypeRole));
+    }
+
+    QModelIndex testeeIndex = testee.firstHighlightIndex();
+    QModelIndex referenceIndex = reference.firstHighlightIndex();
+    QVERIFY(referenceIndex.isValid());
+    for (int i = 0; i < 20; ++i) {
+        QCOMPARE(testeeIndex.row(), referenceIndex.row());
+        testeeIndex = testee.nextHighlightIndex(testeeIndex);
+        referenceIndex = reference.nextHighlightIndex(referenceIndex);
+    }
+    QCOMPARE(testee.lastHighlightIndex().row(), reference.lastHighlightIndex().row());
+    QCOMPARE(testee.previousHighlightIndex(testee.index(1500)).row(),
+             reference.previousHighlightIndex(reference.index(1500)).row());
+
+    testee.clear();
+    QCOMPARE(testee.rowCount(), 0);
+    fill(testee);
+    QCOMPARE(testee.rowCount(), lines.count());
+    QCOMPARE(testee.data(testee.index(0)), reference.data(reference.index(0)));
+}
+
 }
 
 #include "moc_test_outputmodel.cpp"
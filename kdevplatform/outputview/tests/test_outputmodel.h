@@ -23,6 +23,7 @@ public:
 private Q_SLOTS:
     void bench();
     void bench_data();
+    void testMaximumLinesInMemory();
 };
 
 }
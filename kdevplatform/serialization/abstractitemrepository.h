@@ -31,6 +31,11 @@ public:
     /// Does a big cleanup, removing all non-persistent items in the repositories.
     /// @returns Count of bytes of data that have been removed.
     virtual int finalCleanup() = 0;
+    /// Releases unused space at the end of the repository, without moving any items.
+    /// @returns Count of bytes the repository files shrink by when the repository is stored next time.
+    virtual qint64 compact() = 0;
+    /// @returns Count of bytes the loaded buckets take on the heap. Memory-mapped buckets don't count.
+    virtual qint64 allocatedMemory() const = 0;
     virtual QString repositoryName() const = 0;
     virtual QString printStatistics() const = 0;
 
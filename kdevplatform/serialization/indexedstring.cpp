@@ -146,7 +146,8 @@ inline char indexToChar(uint index)
     return static_cast<char>(index & 0xff);
 }
 
-using IndexedStringRepository = ItemRepository<IndexedStringData, IndexedStringRepositoryItemRequest, false>;
+using IndexedStringRepository
+    = ItemRepository<IndexedStringData, IndexedStringRepositoryItemRequest, false, ItemRepositorySharedMutex>;
 }
 
 namespace KDevelop
@@ -157,7 +158,7 @@ class ItemRepositoryFor<IndexedString>
     friend struct LockedItemRepository;
     static IndexedStringRepository& repo()
     {
-        static QMutex mutex;
+        static ItemRepositorySharedMutex mutex;
         static RepositoryManager<IndexedStringRepository, true, false> manager { QStringLiteral("String Index"),
                                                                                  &mutex };
         return *manager.repository();
@@ -222,14 +223,15 @@ IndexedString::IndexedString(const char* str, unsigned short length, uint hash)
         m_index = charToIndex(str[0]);
     } else {
         const auto request = IndexedStringRepositoryItemRequest(str, hash ? hash : hashString(str, length), length);
-        bool refcount = shouldDoDUChainReferenceCounting(this);
-        m_index = LockedItemRepository::write<IndexedString>([request, refcount](IndexedStringRepository& repo) {
-            auto index = repo.index(request);
-            if (refcount) {
+        if (shouldDoDUChainReferenceCounting(this)) {
+            m_index = LockedItemRepository::write<IndexedString>([request](IndexedStringRepository& repo) {
+                auto index = repo.index(request);
                 ReferenceCountChanger::increase(index)(repo);
-            }
-            return index;
-        });
+                return index;
+            });
+        } else {
+            m_index = LockedItemRepository::index<IndexedString>(request);
+        }
     }
 }
 
@@ -413,9 +415,7 @@ uint IndexedString::indexForString(const char* str, short unsigned length, uint
         return charToIndex(str[0]);
     } else {
         const auto request = IndexedStringRepositoryItemRequest(str, hash ? hash : hashString(str, length), length);
-        return LockedItemRepository::write<IndexedString>([request](IndexedStringRepository& repo) {
-            return repo.index(request);
-        });
+        return LockedItemRepository::index<IndexedString>(request);
     }
 }
 
@@ -12,13 +12,18 @@
 #include <QFile>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QReadWriteLock>
+#include <QScopeGuard>
 
 #include <KMessageBox>
 #include <KLocalizedString>
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <shared_mutex>
 #include <type_traits>
+#include <utility>
 
 #include "referencecounting.h"
 #include "abstractitemrepository.h"
@@ -37,8 +42,6 @@
 //Makes sure that all items stay reachable through the basic hash
 // #define DEBUG_ITEM_REACHABILITY
 
-///@todo Dynamic bucket hash size
-
 #ifdef DEBUG_ITEM_REACHABILITY
 #define ENSURE_REACHABLE(bucket) Q_ASSERT(allItemsReachable(bucket));
 #define IF_ENSURE_REACHABLE(x) x
@@ -151,6 +154,20 @@ void writeList(QIODevice* file, const QVector<T>& from)
 {
     writeValues(file, from.size(), from.data());
 }
+
+template<typename Mutex, typename = void>
+struct SupportsSharedLocking : std::false_type
+{
+};
+
+template<typename Mutex>
+struct SupportsSharedLocking<Mutex, std::void_t<decltype(std::declval<Mutex&>().lock_shared())>> : std::true_type
+{
+};
+
+/// Whether @p Mutex can be locked in shared mode, see ItemRepositorySharedMutex
+template<typename Mutex>
+constexpr bool supportsSharedLocking = SupportsSharedLocking<Mutex>::value;
 }
 /**
  * This file implements a generic bucket-based indexing repository, that can be used for example to index strings.
@@ -243,7 +260,7 @@ public:
 
             m_changed = true;
             m_dirty = false;
-            m_lastUsed = 0;
+            markUsed();
         }
     }
 
@@ -268,7 +285,7 @@ public:
         m_mappedData = m_data;
 
         m_changed = false;
-        m_lastUsed = 0;
+        markUsed();
         Q_ASSERT(fileMap.current() - fileMapData == DataSize - ItemRepositoryBucketSize);
     }
 
@@ -355,7 +372,7 @@ public:
     //Tries to find the index this item has in this bucket, or returns zero if the item isn't there yet.
     unsigned short findIndex(const ItemRequest& request) const
     {
-        m_lastUsed = 0;
+        markUsed();
 
         unsigned short localHash = request.hash() % ObjectMapSize;
         unsigned short index = m_objectMap[localHash];
@@ -376,7 +393,7 @@ public:
     //Created indices will never begin with 0xffff____, so you can use that index-range for own purposes.
     unsigned short index(const ItemRequest& request, unsigned int itemSize)
     {
-        m_lastUsed = 0;
+        markUsed();
 
         unsigned short localHash = request.hash() % ObjectMapSize;
         unsigned short index = m_objectMap[localHash];
@@ -548,7 +565,7 @@ public:
     {
         Q_ASSERT(modulo % ObjectMapSize == 0);
 
-        m_lastUsed = 0;
+        markUsed();
 
         uint hashMod = hash % modulo;
         unsigned short localHash = hash % ObjectMapSize;
@@ -613,7 +630,7 @@ public:
     {
         ifDebugLostSpace(Q_ASSERT(!lostSpace()); )
 
-        m_lastUsed = 0;
+        markUsed();
         prepareChange();
 
         unsigned int size = itemFromIndex(index)->itemSize();
@@ -703,7 +720,7 @@ public:
     ///@warning When using multi-threading, mutex() must be locked as long as you use the returned data
     inline const Item* itemFromIndex(unsigned short index) const
     {
-        m_lastUsed = 0;
+        markUsed();
         return reinterpret_cast<Item*>(m_data + index);
     }
 
@@ -725,6 +742,26 @@ public:
         return true;
     }
 
+    ///Replaces every nextBucketForHash link to a bucket from @p firstRemovedBucket on
+    ///@param replacement Called with the hash slot and the removed bucket, returns the new link target
+    template <class Replacement>
+    void replaceNextBucketsFrom(unsigned short firstRemovedBucket, const Replacement& replacement)
+    {
+        if (!m_nextBucketHash)
+            return;
+
+        bool changed = false;
+        for (uint a = 0; a < NextBucketHashSize; ++a) {
+            if (m_nextBucketHash[a] >= firstRemovedBucket) {
+                if (!changed) {
+                    prepareChange();
+                    changed = true;
+                }
+                m_nextBucketHash[a] = replacement(a, m_nextBucketHash[a]);
+            }
+        }
+    }
+
     std::unique_ptr<short unsigned int[]> takeNextBucketHash()
     {
         if (m_mappedData == m_data) {
@@ -749,10 +786,19 @@ public:
         return ItemRepositoryBucketSize - m_available;
     }
 
+    /// @return the bytes allocated for this bucket, nothing while it only points into the memory-mapped file
+    uint allocatedMemory() const
+    {
+        if (!m_data || m_data == m_mappedData) {
+            return 0;
+        }
+        return dataSize() + sizeof(short unsigned int) * (ObjectMapSize + NextBucketHashSize);
+    }
+
     template <class Visitor>
     bool visitAllItems(Visitor& visitor) const
     {
-        m_lastUsed = 0;
+        markUsed();
         for (uint a = 0; a < ObjectMapSize; ++a) {
             uint currentIndex = m_objectMap[a];
             while (currentIndex) {
@@ -802,13 +848,13 @@ public:
 
     unsigned short nextBucketForHash(uint hash) const
     {
-        m_lastUsed = 0;
+        markUsed();
         return m_nextBucketHash[hash % NextBucketHashSize];
     }
 
     void setNextBucketForHash(unsigned int hash, unsigned short bucket)
     {
-        m_lastUsed = 0;
+        markUsed();
         prepareChange();
         m_nextBucketHash[hash % NextBucketHashSize] = bucket;
     }
@@ -860,13 +906,13 @@ public:
 
     void tick() const
     {
-        ++m_lastUsed;
+        m_lastUsed.fetch_add(1, std::memory_order_relaxed);
     }
 
     //How many ticks ago the item was last used
     int lastUsed() const
     {
-        return m_lastUsed;
+        return m_lastUsed.load(std::memory_order_relaxed);
     }
 
     //Whether this bucket was changed since it was last stored
@@ -922,6 +968,12 @@ public:
 
 private:
 
+    // Relaxed, because concurrent readers of a shared-locked repository all touch this counter
+    void markUsed() const
+    {
+        m_lastUsed.store(0, std::memory_order_relaxed);
+    }
+
     void makeDataPrivate()
     {
         if (m_mappedData == m_data) {
@@ -1100,7 +1152,7 @@ private:
 
     bool m_dirty = false; //Whether the data was changed since the last finalCleanup
     bool m_changed  = false; //Whether this bucket was changed since it was last stored to disk
-    mutable int m_lastUsed = 0; //How many ticks ago this bucket was last accessed
+    mutable std::atomic<int> m_lastUsed = 0; //How many ticks ago this bucket was last accessed
 };
 
 ///This object needs to be kept alive as long as you change the contents of an item
@@ -1147,6 +1199,11 @@ struct ItemRepositoryStatistics {
     float averageNextBucketForHashSequenceLength
         = -1; // Average sequence length of a nextBucketForHash sequence(If not empty)
 
+    quint64 lookups = -1; // How many lookups walked a bucket chain while the statistics were enabled
+    float averageLookupChainLength = -1; // Average count of buckets visited per lookup
+    uint longestLookupChain = -1; // Most buckets visited by a single lookup
+    bool growingBucketHash = false; // Whether the bucket hash is being migrated to a bigger size right now
+
     QString print() const
     {
         QString ret;
@@ -1175,11 +1232,52 @@ struct ItemRepositoryStatistics {
                    .arg(totalBucketFollowerSlots)
                    .arg(averageNextBucketForHashSequenceLength)
                    .arg(longestNextBucketChain);
+        if (lookups == quint64(-1)) {
+            ret += QStringLiteral("\nlookup statistics disabled");
+        } else {
+            ret += QStringLiteral("\nlookups: %1 average lookup chain length: %2 longest lookup chain: %3")
+                       .arg(lookups)
+                       .arg(averageLookupChainLength)
+                       .arg(longestLookupChain);
+        }
+        if (growingBucketHash) {
+            ret += QStringLiteral(" (growing bucket hash)");
+        }
         return ret;
     }
     operator QString() const { return print(); }
 };
 
+/**
+ * Mutex type that puts an ItemRepository into concurrent-reader mode.
+ *
+ * lock() and unlock() take the lock exclusively, so all existing code paths that modify the repository
+ * (inserts, deletes, dynamic items, storing) keep working unchanged. Additionally, lock_shared() allows
+ * many threads to look up already stored items at the same time, see LockedItemRepository::read()
+ * and LockedItemRepository::index().
+ *
+ * In this mode the repository maps its bucket file read-only and loads all buckets when it is opened,
+ * and never unloads them again. That way shared lookups never need to modify the bucket table.
+ *
+ * @note The lock is not recursive, only use it for repositories whose item requests don't recurse
+ *       into the same repository.
+ */
+class ItemRepositorySharedMutex
+{
+    Q_DISABLE_COPY_MOVE(ItemRepositorySharedMutex)
+public:
+    ItemRepositorySharedMutex() = default;
+
+    void lock() { m_lock.lockForWrite(); }
+    void unlock() { m_lock.unlock(); }
+
+    void lock_shared() { m_lock.lockForRead(); }
+    void unlock_shared() { m_lock.unlock(); }
+
+private:
+    QReadWriteLock m_lock;
+};
+
 /**
  * The ItemRepository is essentially an on-disk key/value hash map
  *
@@ -1197,7 +1295,8 @@ struct ItemRepositoryStatistics {
  *                                 repository that does on-disk reference counting, like IndexedString,
  *                                 IndexedIdentifier, etc.
  * @tparam Mutex The mutex type to use internally. It has to be locked externally before accessing the item repository
- *               from multiple threads.
+ *               from multiple threads. When it is ItemRepositorySharedMutex, the const lookup API
+ *               (findIndex(), findItem(), itemFromIndex(), visitAllItems()) may be used under a shared lock.
  */
 
 template <class Item, class ItemRequest, bool markForReferenceCounting = true, typename Mutex = QMutex,
@@ -1209,15 +1308,24 @@ class ItemRepository : public AbstractItemRepository
     enum {
         //Must be a multiple of Bucket::ObjectMapSize, so Bucket::hasClashingItem can be computed
         //Must also be a multiple of Bucket::NextBucketHashSize, for the same reason.(Currently those are same)
-        bucketHashSize = (targetBucketHashSize / MyBucket::ObjectMapSize) * MyBucket::ObjectMapSize
+        //The bucket hash is doubled while items are added, which keeps it a multiple of both.
+        initialBucketHashSize = (targetBucketHashSize / MyBucket::ObjectMapSize) * MyBucket::ObjectMapSize,
+        maxBucketHashSize = 1 << 24,
+        //The bucket hash grows once it holds more than this many items per slot on average
+        maxItemsPerBucketHashSlot = 2,
+        //Count of old slots migrated to the grown bucket hash per inserted item
+        bucketHashGrowthStep = 64,
     };
 
     enum {
-        BucketStartOffset = sizeof(uint) * 7 + sizeof(short unsigned int) * bucketHashSize //Position in the data where the bucket array starts
+        BucketStartOffset = sizeof(uint) * 7 //Position in the data where the bucket array starts
     };
 
     Q_DISABLE_COPY_MOVE(ItemRepository)
 public:
+    /// Whether already stored items may be looked up while holding only a shared lock on mutex()
+    static constexpr bool concurrentReaders = ItemRepositoryUtils::supportsSharedLocking<Mutex>;
+
     ///@param registry May be zero, then the repository will not be registered at all. Else, the repository will
     /// register itself to that registry.
     ///                If this is zero, you have to care about storing the data using store() and/or close() by
@@ -1245,9 +1353,10 @@ public:
 
     ///Unloading of buckets is enabled by default. Use this to disable it. When unloading is enabled, the data
     ///gotten from must only itemFromIndex must not be used for a long time.
+    ///@note Repositories with concurrent readers never unload buckets, shared lookups rely on them staying loaded.
     void setUnloadingEnabled(bool enabled)
     {
-        m_unloadingEnabled = enabled;
+        m_unloadingEnabled = enabled && !concurrentReaders;
     }
 
     ///Returns the index for the given item. If the item is not in the repository yet, it is inserted.
@@ -1258,12 +1367,27 @@ public:
         const uint hash = request.hash();
         const uint size = request.itemSize();
 
+        // ItemRequest::createItem() may recurse into this repository. Only the outermost call
+        // grows the bucket hash, so that nested calls never move the chain heads walked below.
+        const bool outermostCall = !m_insideIndex;
+        m_insideIndex = true;
+        const auto resetInsideIndex = qScopeGuard([this, outermostCall]() {
+            if (outermostCall) {
+                m_insideIndex = false;
+            }
+        });
+        if (outermostCall) {
+            growBucketHash();
+        }
+
         // Bucket indexes tracked while walking the bucket chain for this request hash
         unsigned short bucketInChainWithSpace = 0;
         unsigned short lastBucketWalked = 0;
+        uint chainLength = 0;
 
         const ushort foundIndexInBucket = walkBucketChain(hash, [&](ushort bucketIdx, const MyBucket* bucketPtr) {
                 lastBucketWalked = bucketIdx;
+                ++chainLength;
 
                 const ushort found = bucketPtr->findIndex(request);
 
@@ -1273,6 +1397,7 @@ public:
 
                 return found;
             });
+        recordLookup(chainLength);
 
         if (foundIndexInBucket) {
             // 'request' is already present, return the existing index
@@ -1431,7 +1556,7 @@ public:
                 ++m_statItemCount;
 
                 const int previousBucketNumber = lastBucketWalked;
-                unsigned short* const bucketHashPosition = m_firstBucketForHash + (hash % bucketHashSize);
+                unsigned short* const bucketHashPosition = &firstBucketForHash(hash);
 
                 if (!(*bucketHashPosition)) {
                     Q_ASSERT(!previousBucketNumber);
@@ -1521,10 +1646,15 @@ public:
     ///Returns zero if the item is not in the repository yet
     unsigned int findIndex(const ItemRequest& request) const
     {
-        return walkBucketChain(request.hash(), [this, &request](ushort bucketIdx, const MyBucket* bucketPtr) {
+        uint chainLength = 0;
+        const uint index = walkBucketChain(request.hash(), [this, &request, &chainLength](ushort bucketIdx,
+                                                                                            const MyBucket* bucketPtr) {
+                ++chainLength;
                 const ushort indexInBucket = bucketPtr->findIndex(request);
                 return indexInBucket ? createIndex(bucketIdx, indexInBucket) : 0u;
             });
+        recordLookup(chainLength);
+        return index;
     }
 
     /// Returns nullptr if the item is not in the repository yet
@@ -1573,9 +1703,9 @@ public:
         if (!previousBucketPtr) {
             // This bucket is linked in the m_firstBucketForHash array, find the next clashing bucket in the chain
             // There may be items in the chain that clash only with MyBucket::NextBucketHashSize, skipped here
-            m_firstBucketForHash[hash %
-                                 bucketHashSize] = walkBucketChain(hash, [hash](ushort bucketIdx, MyBucket* bucketPtr) {
-                    if (bucketPtr->hasClashingItem(hash, bucketHashSize)) {
+            const uint modulo = bucketHashModulo(hash);
+            firstBucketForHash(hash) = walkBucketChain(hash, [hash, modulo](ushort bucketIdx, MyBucket* bucketPtr) {
+                    if (bucketPtr->hasClashingItem(hash, modulo)) {
                         return bucketIdx;
                     }
                     return static_cast<ushort>(0);
@@ -1670,6 +1800,23 @@ public:
         return statistics().print();
     }
 
+    /**
+     * Returns whether the lookup statistics are recorded. That is off by default, as it updates shared
+     * counters on every lookup, unless KDEV_ITEMREPOSITORY_STATISTICS is set.
+     */
+    bool statisticsEnabled() const
+    {
+        return m_recordStatistics.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Starts or stops recording the lookup statistics.
+     */
+    void setStatisticsEnabled(bool enabled)
+    {
+        m_recordStatistics.store(enabled, std::memory_order_relaxed);
+    }
+
     ItemRepositoryStatistics statistics() const
     {
         Q_ASSERT(!m_currentBucket || m_currentBucket < m_buckets.size());
@@ -1693,11 +1840,18 @@ public:
         }
 
 #endif
-        ret.hashSize = bucketHashSize;
-        ret.hashUse = 0;
-        for (uint a = 0; a < bucketHashSize; ++a)
-            if (m_firstBucketForHash[a])
-                ++ret.hashUse;
+        ret.hashSize = m_bucketHashSize;
+        ret.hashUse = std::count_if(m_firstBucketForHash.begin(), m_firstBucketForHash.end(), [](ushort bucket) {
+            return bucket != 0;
+        });
+        ret.growingBucketHash = !m_previousFirstBucketForHash.isEmpty();
+
+        if (statisticsEnabled()) {
+            ret.lookups = m_statLookups.load(std::memory_order_relaxed);
+            ret.averageLookupChainLength
+                = ret.lookups ? float(m_statLookupChainLengths.load(std::memory_order_relaxed)) / ret.lookups : 0;
+            ret.longestLookupChain = m_statLongestLookupChain.load(std::memory_order_relaxed);
+        }
 
         ret.emptyBuckets = 0;
 
@@ -1795,6 +1949,10 @@ public:
     void visitAllItems(Visitor& visitor, bool onlyInMemory = false) const
     {
         for (int a = 1; a <= m_currentBucket; ++a) {
+            // the tail of a monster bucket is no bucket on its own, its items are visited through the head
+            if (m_monsterBucketTailMarker.at(a)) {
+                continue;
+            }
             if (!onlyInMemory || m_buckets.at(a)) {
                 auto bucket = bucketForIndex(a);
                 if (bucket && !bucket->visitAllItems(visitor))
@@ -1818,10 +1976,11 @@ private:
         Q_ASSERT(m_file);
         Q_ASSERT(m_dynamicFile);
 
+        Q_ASSERT(m_previousFirstBucketForHash.isEmpty());
+
         m_file->seek(0);
         writeValue(m_file, m_repositoryVersion);
-        uint hashSize = bucketHashSize;
-        writeValue(m_file, hashSize);
+        writeValue(m_file, m_bucketHashSize);
         uint itemRepositoryVersion = staticItemRepositoryVersion();
         writeValue(m_file, itemRepositoryVersion);
         writeValue(m_file, m_statBucketHashClashes);
@@ -1830,7 +1989,6 @@ private:
         const uint bucketCount = static_cast<uint>(m_buckets.size());
         writeValue(m_file, bucketCount);
         writeValue(m_file, m_currentBucket);
-        writeValues(m_file, bucketHashSize, m_firstBucketForHash);
         Q_ASSERT(m_file->pos() == BucketStartOffset);
 
         m_dynamicFile->seek(0);
@@ -1839,6 +1997,12 @@ private:
 
         Q_ASSERT(m_buckets.size() == m_monsterBucketTailMarker.size());
         writeList(m_dynamicFile, m_monsterBucketTailMarker);
+
+        // the bucket hash lives in the dynamic file, so that its size can change without moving the buckets
+        Q_ASSERT(static_cast<uint>(m_firstBucketForHash.size()) == m_bucketHashSize);
+        writeList(m_dynamicFile, m_firstBucketForHash);
+        // the lists above may have become shorter
+        m_dynamicFile->resize(m_dynamicFile->pos());
     }
 
     ///Synchronizes the state on disk to the one in memory, and does some memory-management.
@@ -1846,6 +2010,11 @@ private:
     void store() final
     {
         if (m_file) {
+            // only a fully migrated bucket hash is written to disk
+            if (!m_previousFirstBucketForHash.isEmpty()) {
+                migrateBucketHash(m_previousFirstBucketForHash.size());
+            }
+
             if (!m_file->open(QFile::ReadWrite) || !m_dynamicFile->open(QFile::ReadWrite)) {
                 qFatal("cannot re-open repository file for storing");
                 return;
@@ -1872,6 +2041,14 @@ private:
             if (m_metaDataChanged) {
                 writeMetadata();
             }
+
+            // drop the space of buckets released by compact()
+            const qint64 bucketsEnd = BucketStartOffset + qint64(m_buckets.size() - 1) * MyBucket::DataSize;
+            if (m_file->size() > bucketsEnd) {
+                m_fileMapSize = std::min<qint64>(m_fileMapSize, bucketsEnd - BucketStartOffset);
+                m_file->resize(bucketsEnd);
+            }
+
             //To protect us from inconsistency due to crashes. flush() is not enough. We need to close.
             m_file->close();
             m_dynamicFile->close();
@@ -1905,7 +2082,10 @@ private:
             Q_ASSERT(m_freeSpaceBuckets.isEmpty());
             allocateNextBuckets(ItemRepositoryBucketLinearGrowthFactor);
 
-            std::fill_n(m_firstBucketForHash, bucketHashSize, 0);
+            Q_ASSERT(m_bucketHashSize == initialBucketHashSize);
+            Q_ASSERT(!std::any_of(m_firstBucketForHash.begin(), m_firstBucketForHash.end(), [](ushort bucket) {
+                return bucket != 0;
+            }));
 
             // Skip the first bucket, we won't use it so we have the zero indices for special purposes
             Q_ASSERT(m_currentBucket == 1);
@@ -1935,12 +2115,15 @@ private:
             readValue(m_file, &m_statBucketHashClashes);
             readValue(m_file, &m_statItemCount);
 
-            if (storedVersion != m_repositoryVersion || hashSize != bucketHashSize
+            // the stored hash size may have grown from the initial one by doubling
+            const bool validHashSize = hashSize >= initialBucketHashSize && hashSize <= maxBucketHashSize
+                && hashSize % initialBucketHashSize == 0;
+            if (storedVersion != m_repositoryVersion || !validHashSize
                 || itemRepositoryVersion != staticItemRepositoryVersion()) {
                 qDebug() << "repository" << m_repositoryName << "version mismatch in" << m_file->fileName()
                          << ", stored: version " << storedVersion << "hashsize" << hashSize << "repository-version"
-                         << itemRepositoryVersion << " current: version" << m_repositoryVersion << "hashsize"
-                         << bucketHashSize << "repository-version" << staticItemRepositoryVersion();
+                         << itemRepositoryVersion << " current: version" << m_repositoryVersion << "initial hashsize"
+                         << initialBucketHashSize << "repository-version" << staticItemRepositoryVersion();
                 delete m_file;
                 m_file = nullptr;
                 delete m_dynamicFile;
@@ -1960,8 +2143,6 @@ private:
             readValue(m_file, &m_currentBucket);
             Q_ASSERT(m_currentBucket);
 
-            readValues(m_file, bucketHashSize, m_firstBucketForHash);
-
             Q_ASSERT(m_file->pos() == BucketStartOffset);
 
             uint freeSpaceBucketsSize = 0;
@@ -1971,6 +2152,10 @@ private:
 
             m_monsterBucketTailMarker.resize(bucketCount);
             readList(m_dynamicFile, &m_monsterBucketTailMarker);
+
+            m_bucketHashSize = hashSize;
+            m_firstBucketForHash.resize(m_bucketHashSize);
+            readList(m_dynamicFile, &m_firstBucketForHash);
         }
 
         m_fileMapSize = 0;
@@ -1992,9 +2177,24 @@ private:
         m_file->close();
         m_dynamicFile->close();
 
+        if constexpr (concurrentReaders) {
+            loadAllBuckets();
+        }
+
         return true;
     }
 
+    /// Loads every bucket up front, so that lookups under a shared lock never have to modify m_buckets.
+    /// Buckets inside the file map are not copied, they point straight into the read-only mapping.
+    void loadAllBuckets()
+    {
+        for (int a = 1; a < m_buckets.size(); ++a) {
+            if (!m_monsterBucketTailMarker[a]) {
+                a += bucketForIndex(a)->monsterBucketExtent();
+            }
+        }
+    }
+
     ///@warning by default, this does not store the current state to disk.
     void close(bool doStore = false) final
     {
@@ -2016,7 +2216,10 @@ private:
         qDeleteAll(m_buckets);
         m_buckets.clear();
 
-        std::fill_n(m_firstBucketForHash, bucketHashSize, 0);
+        m_bucketHashSize = initialBucketHashSize;
+        m_firstBucketForHash.fill(0, initialBucketHashSize);
+        m_previousFirstBucketForHash.clear();
+        m_bucketHashMigrationPosition = 0;
     }
 
     int finalCleanup() final
@@ -2033,6 +2236,91 @@ private:
         return changed;
     }
 
+    qint64 allocatedMemory() const final
+    {
+        qint64 ret = 0;
+        for (const auto* bucket : m_buckets) {
+            if (bucket) {
+                ret += bucket->allocatedMemory();
+            }
+        }
+        return ret;
+    }
+
+    qint64 compact() final
+    {
+        if (!m_file) {
+            return 0;
+        }
+
+        // the bucket hash may reference any bucket, don't let it refer to released ones later on
+        if (!m_previousFirstBucketForHash.isEmpty()) {
+            migrateBucketHash(m_previousFirstBucketForHash.size());
+        }
+
+        // Items can never move, since their indices are stored elsewhere, e.g. in top-context data.
+        // So only the empty buckets at the end can be released.
+        int lastUsedBucket = m_buckets.size() - 1;
+        while (lastUsedBucket > 1 && isReleasableBucket(lastUsedBucket)) {
+            --lastUsedBucket;
+        }
+
+        // keep some empty buckets, so that we don't have to allocate new ones right away
+        const int bucketCount = lastUsedBucket + 1 + ItemRepositoryBucketLinearGrowthFactor;
+        if (bucketCount + ItemRepositoryBucketLinearGrowthFactor > m_buckets.size()) {
+            return 0;
+        }
+
+        // Released buckets are empty, so chains may just skip them. Links pointing into the released
+        // range are redirected to the first kept bucket that the chain reaches behind it.
+        const ushort firstReleasedBucket = bucketCount;
+        const auto skipReleasedBuckets = [this, firstReleasedBucket](uint hash, ushort bucket) {
+            while (bucket >= firstReleasedBucket) {
+                bucket = bucketForIndex(bucket)->nextBucketForHash(hash);
+            }
+            return bucket;
+        };
+        for (int a = 1; a < bucketCount; ++a) {
+            if (!m_monsterBucketTailMarker[a]) {
+                bucketForIndex(a)->replaceNextBucketsFrom(firstReleasedBucket, skipReleasedBuckets);
+            }
+        }
+        for (uint slot = 0; slot < m_bucketHashSize; ++slot) {
+            auto& bucket = m_firstBucketForHash[slot];
+            if (bucket >= firstReleasedBucket) {
+                bucket = skipReleasedBuckets(slot, bucket);
+            }
+        }
+
+        m_freeSpaceBuckets.erase(std::remove_if(m_freeSpaceBuckets.begin(), m_freeSpaceBuckets.end(),
+                                                [firstReleasedBucket](uint bucket) {
+                                                    return bucket >= firstReleasedBucket;
+                                                }),
+                                 m_freeSpaceBuckets.end());
+        for (int a = bucketCount; a < m_buckets.size(); ++a) {
+            delete m_buckets[a];
+        }
+        m_buckets.resize(bucketCount);
+        m_monsterBucketTailMarker.resize(bucketCount);
+        m_currentBucket = std::min(m_currentBucket, bucketCount - 1);
+        m_metaDataChanged = true;
+
+        // nothing may be loaded from the part of the file map that is going to be truncated
+        const qint64 bucketsEnd = BucketStartOffset + qint64(bucketCount - 1) * MyBucket::DataSize;
+        m_fileMapSize = std::min<qint64>(m_fileMapSize, bucketsEnd - BucketStartOffset);
+
+        return std::max<qint64>(0, m_file->size() - bucketsEnd);
+    }
+
+    bool isReleasableBucket(int bucketNumber) const
+    {
+        if (m_monsterBucketTailMarker[bucketNumber]) {
+            return false;
+        }
+        const auto* bucketPtr = bucketForIndex(bucketNumber);
+        return bucketPtr->isEmpty() && !bucketPtr->monsterBucketExtent();
+    }
+
     uint usedMemory() const
     {
         uint used = 0;
@@ -2061,8 +2349,14 @@ private:
     template <typename Visitor>
     auto walkBucketChain(unsigned int hash, const Visitor& visitor) const->decltype(visitor(0, nullptr))
     {
-        unsigned short bucketIndex = m_firstBucketForHash[hash % bucketHashSize];
+        return walkBucketChain(firstBucketForHash(hash), hash, visitor);
+    }
 
+    /// Walks through all buckets clashing with @p hash, starting at @p bucketIndex
+    template <typename Visitor>
+    auto walkBucketChain(unsigned short bucketIndex, unsigned int hash,
+                         const Visitor& visitor) const->decltype(visitor(0, nullptr))
+    {
         while (bucketIndex) {
             auto* bucketPtr = bucketForIndex(bucketIndex);
 
@@ -2076,6 +2370,99 @@ private:
         return {}; // clazy:exclude=returning-void-expression
     }
 
+    /// @return the size of the bucket hash table that holds the chain head for @p hash
+    ///         While the bucket hash grows, slots that are not migrated yet still live in the previous table.
+    uint bucketHashModulo(uint hash) const
+    {
+        const uint previousSize = m_previousFirstBucketForHash.size();
+        if (previousSize && hash % previousSize >= m_bucketHashMigrationPosition) {
+            return previousSize;
+        }
+        return m_bucketHashSize;
+    }
+
+    unsigned short firstBucketForHash(uint hash) const
+    {
+        const uint modulo = bucketHashModulo(hash);
+        if (modulo != m_bucketHashSize) {
+            return m_previousFirstBucketForHash.at(hash % modulo);
+        }
+        return m_firstBucketForHash.at(hash % modulo);
+    }
+
+    unsigned short& firstBucketForHash(uint hash)
+    {
+        const uint modulo = bucketHashModulo(hash);
+        if (modulo != m_bucketHashSize) {
+            return m_previousFirstBucketForHash[hash % modulo];
+        }
+        return m_firstBucketForHash[hash % modulo];
+    }
+
+    /// Starts doubling the bucket hash once it got too crowded, and migrates a bounded count of slots
+    /// of an ongoing growth. That way no single insertion has to pay for rehashing the whole table.
+    void growBucketHash()
+    {
+        if (!m_previousFirstBucketForHash.isEmpty()) {
+            migrateBucketHash(bucketHashGrowthStep);
+            return;
+        }
+
+        if (m_statItemCount <= m_bucketHashSize * maxItemsPerBucketHashSlot
+            || m_bucketHashSize * 2 > maxBucketHashSize) {
+            return;
+        }
+
+        m_metaDataChanged = true;
+        m_previousFirstBucketForHash = std::exchange(m_firstBucketForHash, QVector<unsigned short>());
+        m_bucketHashSize *= 2;
+        m_firstBucketForHash.fill(0, m_bucketHashSize);
+        m_bucketHashMigrationPosition = 0;
+    }
+
+    /// Moves up to @p slots slots of the previous bucket hash into the grown one.
+    /// Every previous slot s splits into the slots s + k * previousSize. Each of those starts at the
+    /// first bucket of the previous chain that actually contains an item clashing with the bigger modulo,
+    /// exactly like deleteItem() re-links the head of a chain.
+    void migrateBucketHash(uint slots)
+    {
+        const uint previousSize = m_previousFirstBucketForHash.size();
+        Q_ASSERT(previousSize);
+        Q_ASSERT(m_bucketHashSize % previousSize == 0);
+
+        const uint end = std::min(previousSize, m_bucketHashMigrationPosition + slots);
+        for (; m_bucketHashMigrationPosition < end; ++m_bucketHashMigrationPosition) {
+            const ushort previousHead = m_previousFirstBucketForHash.at(m_bucketHashMigrationPosition);
+            if (!previousHead) {
+                continue;
+            }
+            for (uint slot = m_bucketHashMigrationPosition; slot < m_bucketHashSize; slot += previousSize) {
+                m_firstBucketForHash[slot]
+                    = walkBucketChain(previousHead, slot, [this, slot](ushort bucketIdx, MyBucket* bucketPtr) {
+                          return bucketPtr->hasClashingItem(slot, m_bucketHashSize) ? bucketIdx : ushort(0);
+                      });
+            }
+        }
+
+        if (m_bucketHashMigrationPosition == previousSize) {
+            m_previousFirstBucketForHash = QVector<unsigned short>();
+            m_bucketHashMigrationPosition = 0;
+        }
+    }
+
+    void recordLookup(uint chainLength) const
+    {
+        if (!statisticsEnabled()) {
+            return;
+        }
+        m_statLookups.fetch_add(1, std::memory_order_relaxed);
+        m_statLookupChainLengths.fetch_add(chainLength, std::memory_order_relaxed);
+        uint longest = m_statLongestLookupChain.load(std::memory_order_relaxed);
+        while (chainLength > longest
+               && !m_statLongestLookupChain.compare_exchange_weak(longest, chainLength, std::memory_order_relaxed)) {
+        }
+    }
+
     ///Makes sure the order within m_freeSpaceBuckets is correct, after largestFreeSize has been changed for m_freeSpaceBuckets[index].
     ///If too few space is free within the given bucket, it is removed from m_freeSpaceBuckets.
     void updateFreeSpaceOrder(uint index)
@@ -2496,7 +2883,7 @@ private:
     }
 
     bool m_metaDataChanged = true;
-    bool m_unloadingEnabled = true;
+    bool m_unloadingEnabled = !concurrentReaders;
     // an unused, empty repo has no bucket yet
     // on first use this will then get incremented directly as we never use the zero-bucket index
     // that value is reserved for special purposes instead
@@ -2511,8 +2898,19 @@ private:
     mutable QVector<MyBucket*> m_buckets;
     uint m_statBucketHashClashes = 0;
     uint m_statItemCount = 0;
-    //Maps hash-values modulo 1<<bucketHashSizeBits to the first bucket such a hash-value appears in
-    short unsigned int m_firstBucketForHash[bucketHashSize] = { 0 };
+    // lookup statistics are updated by concurrent readers while m_recordStatistics is set, and not stored to disk
+    std::atomic<bool> m_recordStatistics = qEnvironmentVariableIsSet("KDEV_ITEMREPOSITORY_STATISTICS");
+    mutable std::atomic<quint64> m_statLookups = 0;
+    mutable std::atomic<quint64> m_statLookupChainLengths = 0;
+    mutable std::atomic<uint> m_statLongestLookupChain = 0;
+    //Maps hash-values modulo m_bucketHashSize to the first bucket such a hash-value appears in
+    uint m_bucketHashSize = initialBucketHashSize;
+    QVector<unsigned short> m_firstBucketForHash = QVector<unsigned short>(initialBucketHashSize, 0);
+    //While the bucket hash grows, this is the previous table. Its slots below m_bucketHashMigrationPosition
+    //have already been moved into m_firstBucketForHash, see migrateBucketHash()
+    QVector<unsigned short> m_previousFirstBucketForHash;
+    uint m_bucketHashMigrationPosition = 0;
+    bool m_insideIndex = false;
 
     //File that contains the buckets
     QFile* m_file = nullptr;
@@ -2539,8 +2937,32 @@ struct LockedItemRepository {
     {
         const auto& repo = ItemRepositoryFor<Context>::repo();
 
+        if constexpr (std::decay_t<decltype(repo)>::concurrentReaders) {
+            std::shared_lock lock(*repo.mutex());
+            return op(repo);
+        } else {
+            QMutexLocker lock(repo.mutex());
+            return op(repo);
+        }
+    }
+
+    /// @return the index of @p request, the item is inserted if it is not stored yet
+    /// For repositories with concurrent readers, stored items are found under the shared lock,
+    /// only an actual insertion takes the exclusive lock.
+    template<typename Context, typename Request>
+    static unsigned int index(const Request& request)
+    {
+        auto& repo = ItemRepositoryFor<Context>::repo();
+
+        if constexpr (std::decay_t<decltype(repo)>::concurrentReaders) {
+            std::shared_lock lock(*repo.mutex());
+            if (const auto index = repo.findIndex(request)) {
+                return index;
+            }
+        }
+
         QMutexLocker lock(repo.mutex());
-        return op(repo);
+        return repo.index(request);
     }
 
     template<typename Context, typename Op>
@@ -357,6 +357,38 @@ int ItemRepositoryRegistry::finalCleanup()
     return changed;
 }
 
+qint64 ItemRepositoryRegistry::compact()
+{
+    Q_D(ItemRepositoryRegistry);
+
+    QMutexLocker lock(&d->m_mutex);
+    qint64 reclaimed = 0;
+    for (auto* repository : std::as_const(d->m_repositories)) {
+        std::scoped_lock repoLock(*repository);
+        const qint64 released = repository->compact();
+        if (released) {
+            qCDebug(SERIALIZATION) << "compacted" << repository->repositoryName() << ":" << released << "bytes";
+        }
+        reclaimed += released;
+    }
+
+    return reclaimed;
+}
+
+qint64 ItemRepositoryRegistry::allocatedMemory() const
+{
+    Q_D(const ItemRepositoryRegistry);
+
+    QMutexLocker lock(&d->m_mutex);
+    qint64 ret = 0;
+    for (auto* repository : std::as_const(d->m_repositories)) {
+        std::scoped_lock repoLock(*repository);
+        ret += repository->allocatedMemory();
+    }
+
+    return ret;
+}
+
 ItemRepositoryRegistry::~ItemRepositoryRegistry()
 {
     Q_D(const ItemRepositoryRegistry);
@@ -68,6 +68,15 @@ public:
     /// @returns Count of bytes of data that have been removed.
     int finalCleanup();
 
+    /// Releases unused space at the end of all repositories, without moving any items.
+    /// Every repository is only locked while it is compacted itself, so this can run while parsing.
+    /// The files are truncated when the repositories are stored next time.
+    /// @returns Count of bytes that are reclaimed.
+    qint64 compact();
+
+    /// @returns Count of bytes all registered repositories take on the heap, see AbstractItemRepository::allocatedMemory
+    qint64 allocatedMemory() const;
+
     /// Prints the statistics of all registered item-repositories to the command line using qDebug().
     void printAllStatistics() const;
 
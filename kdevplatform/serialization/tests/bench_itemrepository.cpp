@@ -13,6 +13,8 @@
 #include <algorithm>
 #include <limits>
 #include <random>
+#include <shared_mutex>
+#include <thread>
 #include <vector>
 #include <QTest>
 
@@ -96,6 +98,8 @@ struct TestDataRepositoryItemRequest
 };
 
 using TestDataRepository = ItemRepository<TestData, TestDataRepositoryItemRequest, false>;
+using SharedTestDataRepository
+    = ItemRepository<TestData, TestDataRepositoryItemRequest, false, ItemRepositorySharedMutex>;
 
 static QVector<QString> generateData()
 {
@@ -205,6 +209,113 @@ void BenchItemRepository::lookupValue()
     }
 }
 
+static QVector<QByteArray> toUtf8(const QVector<QString>& data)
+{
+    QVector<QByteArray> ret;
+    ret.reserve(data.size());
+    for (const QString& item : data) {
+        ret << item.toUtf8();
+    }
+    return ret;
+}
+
+/// Every thread looks up its share of @p existing and inserts every tenth item of its share of @p fresh,
+/// locking the repository the way LockedItemRepository would.
+template<typename Repository>
+static void lookupInsertMix(Repository& repo, const QVector<QByteArray>& existing, const QVector<QByteArray>& fresh,
+                            int threadCount)
+{
+    const auto lookup = [&repo](const QByteArray& item) {
+        const TestDataRepositoryItemRequest request(item.constData(), item.length());
+        if constexpr (Repository::concurrentReaders) {
+            std::shared_lock lock(*repo.mutex());
+            return repo.findIndex(request);
+        } else {
+            QMutexLocker lock(repo.mutex());
+            return repo.findIndex(request);
+        }
+    };
+    const auto insert = [&repo](const QByteArray& item) {
+        QMutexLocker lock(repo.mutex());
+        return repo.index(TestDataRepositoryItemRequest(item.constData(), item.length()));
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (int thread = 0; thread < threadCount; ++thread) {
+        threads.emplace_back([&, thread]() {
+            for (int i = thread; i < existing.size(); i += threadCount) {
+                if (!lookup(existing[i])) {
+                    qFatal("item not found");
+                }
+                if (i % 10 == 0 && i < fresh.size()) {
+                    insert(fresh[i]);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BenchItemRepository::concurrentLookupInsertMix_data()
+{
+    QTest::addColumn<bool>("sharedLocking");
+    QTest::addColumn<int>("threadCount");
+
+    const int maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts{1};
+    if (maxThreadCount > 4) {
+        threadCounts.push_back(4);
+    }
+    if (maxThreadCount > 1) {
+        threadCounts.push_back(maxThreadCount);
+    }
+    for (int threadCount : threadCounts) {
+        QTest::addRow("exclusive-%d", threadCount) << false << threadCount;
+        QTest::addRow("shared-%d", threadCount) << true << threadCount;
+    }
+}
+
+void BenchItemRepository::concurrentLookupInsertMix()
+{
+    QFETCH(bool, sharedLocking);
+    QFETCH(int, threadCount);
+
+    const QVector<QByteArray> existing = toUtf8(generateData());
+    QVector<QByteArray> fresh;
+    fresh.reserve(existing.size());
+    for (const QByteArray& item : existing) {
+        fresh << item + "/new";
+    }
+
+    const auto run = [&](auto& repo) {
+        QMutexLocker lock(repo.mutex());
+        for (const QByteArray& item : existing) {
+            repo.index(TestDataRepositoryItemRequest(item.constData(), item.length()));
+        }
+        lock.unlock();
+
+        QBENCHMARK_ONCE {
+            lookupInsertMix(repo, existing, fresh, threadCount);
+        }
+
+        const uint expectedItems = existing.size() + (existing.size() + 9) / 10;
+        QCOMPARE(repo.statistics().totalItems, expectedItems);
+    };
+
+    if (sharedLocking) {
+        ItemRepositorySharedMutex mutex;
+        SharedTestDataRepository repo("TestDataRepositoryConcurrentShared", &mutex);
+        run(repo);
+    } else {
+        QMutex mutex;
+        TestDataRepository repo("TestDataRepositoryConcurrentExclusive", &mutex);
+        run(repo);
+    }
+}
+
 void BenchItemRepository::shouldDoReferenceCounting_data()
 {
     QTest::addColumn<bool>("enableReferenceCounting");
@@ -20,6 +20,8 @@ private Q_SLOTS:
     void removeDisk();
     void lookupKey();
     void lookupValue();
+    void concurrentLookupInsertMix_data();
+    void concurrentLookupInsertMix();
 
     void shouldDoReferenceCounting_data();
     void shouldDoReferenceCounting();
@@ -1,5 +1,7 @@
 #include "itemrepositorytestbase.h"
 
+#include <QDir>
+#include <QFileInfo>
 #include <QTest>
 
 // enable various debug facilities in the ItemRepository code
@@ -251,6 +253,96 @@ private Q_SLOTS:
             delete[] item;
         }
     }
+    void growBucketHash()
+    {
+        // a tiny bucket hash, so that it has to grow a few times
+        using SmallHashRepository = ItemRepository<TestItem, TestItemRequest, true, QMutex, 0, 280>;
+        const uint initialHashSize = SmallHashRepository::initialBucketHashSize;
+        const uint itemCount = initialHashSize * 16;
+
+        QMutex mutex;
+        QVector<TestItem*> items;
+        QVector<uint> indices;
+        uint grownHashSize = 0;
+        {
+            SmallHashRepository repository(QStringLiteral("GrowBucketHash"), &mutex);
+            repository.setStatisticsEnabled(true);
+            for (uint i = 0; i < itemCount; ++i) {
+                items << createItem(i * 7919 + 3, sizeof(TestItem) + 20);
+                indices << repository.index(TestItemRequest(*items.back()));
+                QVERIFY(indices.back());
+            }
+            for (uint i = 0; i < itemCount; ++i) {
+                QCOMPARE(repository.findIndex(TestItemRequest(*items[i])), indices[i]);
+            }
+            QVERIFY(repository.statistics().hashSize > initialHashSize);
+
+            // storing finishes an ongoing growth
+            repository.store();
+            const auto stats = repository.statistics();
+            QVERIFY(!stats.growingBucketHash);
+            QVERIFY(stats.lookups >= itemCount);
+            grownHashSize = stats.hashSize;
+        }
+
+        // the grown size is persisted
+        SmallHashRepository repository(QStringLiteral("GrowBucketHash"), &mutex);
+        QCOMPARE(repository.statistics().hashSize, grownHashSize);
+        for (uint i = 0; i < itemCount; ++i) {
+            QCOMPARE(repository.findIndex(TestItemRequest(*items[i])), indices[i]);
+        }
+
+        for (auto item : std::as_const(items)) {
+            delete[] item;
+        }
+    }
+    void compactTrailingBuckets()
+    {
+        QMutex mutex;
+        ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("CompactTrailingBuckets"), &mutex);
+        const QString fileName
+            = QDir(globalItemRepositoryRegistry().path()).filePath(QStringLiteral("CompactTrailingBuckets"));
+        const uint nextBucketHashSize = decltype(repository)::MyBucket::NextBucketHashSize;
+
+        // three items per bucket, all with clashing hashes so that the buckets get linked
+        const uint itemCount = 300;
+        const uint keptItemCount = 60;
+        QVector<TestItem*> items;
+        QVector<uint> indices;
+        for (uint i = 0; i < itemCount; ++i) {
+            items << createItem(i * nextBucketHashSize + 1, ItemRepositoryBucketSize * 0.3);
+            indices << repository.index(TestItemRequest(*items.back()));
+            QVERIFY(indices.back());
+        }
+        repository.store();
+
+        for (uint i = keptItemCount; i < itemCount; ++i) {
+            repository.deleteItem(indices[i]);
+        }
+        repository.store();
+        const qint64 sizeBeforeCompaction = QFileInfo(fileName).size();
+
+        const qint64 reclaimed = repository.compact();
+        QVERIFY(reclaimed > 0);
+        repository.store();
+        QCOMPARE(QFileInfo(fileName).size(), sizeBeforeCompaction - reclaimed);
+
+        // nothing left to release
+        QCOMPARE(repository.compact(), qint64(0));
+
+        for (uint i = 0; i < keptItemCount; ++i) {
+            QCOMPARE(repository.findIndex(TestItemRequest(*items[i])), indices[i]);
+        }
+        for (uint i = keptItemCount; i < itemCount; ++i) {
+            QVERIFY(!repository.findIndex(TestItemRequest(*items[i])));
+            QVERIFY(repository.index(TestItemRequest(*items[i])));
+        }
+        repository.statistics();
+
+        for (auto item : std::as_const(items)) {
+            delete[] item;
+        }
+    }
     void testStringSharing()
     {
         QString qString;
@@ -343,7 +435,7 @@ private Q_SLOTS:
         QMutex mutex;
         ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("PermissiveModulo"), &mutex);
 
-        const uint bucketHashSize = decltype(repository)::bucketHashSize;
+        const uint bucketHashSize = decltype(repository)::initialBucketHashSize;
         const uint nextBucketHashSize = decltype(repository)::MyBucket::NextBucketHashSize;
         auto bucketNumberForIndex = [](const uint index) {
                                         return index >> 16;
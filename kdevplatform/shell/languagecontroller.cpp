@@ -11,6 +11,7 @@
 #include <utility>
 #include <vector>
 
+#include <QDBusConnection>
 #include <QHash>
 #include <QMimeDatabase>
 #include <QMultiHash>
@@ -25,6 +26,7 @@
 #include <language/interfaces/ilanguagesupport.h>
 #include <language/backgroundparser/backgroundparser.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/memorygovernor.h>
 
 #include "problemmodelset.h"
 
@@ -230,6 +232,9 @@ void LanguageController::initialize()
 
     // make sure the DUChain is setup before we try to access it from different threads at the same time
     DUChain::self();
+
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/org/kdevelop/MemoryGovernor"),
+        MemoryGovernor::self(), QDBusConnection::ExportScriptableSlots);
 }
 
 void LanguageController::cleanup()
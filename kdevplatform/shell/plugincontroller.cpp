@@ -13,10 +13,13 @@
 
 #include <algorithm>
 
+#include <QCoreApplication>
 #include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QMap>
+#include <QTextStream>
+#include <QTimer>
 
 #include <KConfigGroup>
 #include <KLocalizedString>
@@ -53,6 +56,7 @@ inline QString KEY_Required() { return QStringLiteral("X-KDevelop-IRequired"); }
 inline QString KEY_Optional() { return QStringLiteral("X-KDevelop-IOptional"); }
 inline QString KEY_KPlugin() { return QStringLiteral("KPlugin"); }
 inline QString KEY_EnabledByDefault() { return QStringLiteral("EnabledByDefault"); }
+inline QString KEY_Deferred() { return QStringLiteral("X-KDevelop-Deferred"); }
 
 inline QString KEY_Global() { return QStringLiteral("Global"); }
 inline QString KEY_Project() { return QStringLiteral("Project"); }
@@ -71,6 +75,15 @@ bool isGlobalPlugin( const KPluginMetaData& info )
     return info.value(KEY_Category()) == KEY_Global();
 }
 
+/**
+ * Plugins that only provide tool views or actions can set this, so they are not
+ * created before the main window is usable.
+ */
+bool isDeferredPlugin( const KPluginMetaData& info )
+{
+    return info.value(KEY_Deferred(), false);
+}
+
 bool hasMandatoryProperties( const KPluginMetaData& info )
 {
     QString mode = info.value(KEY_Mode());
@@ -172,6 +185,20 @@ public:
     };
     CleanupMode cleanupMode;
 
+    /// Where the startup time of a plugin went, in ms
+    struct StartupTiming
+    {
+        /// Including the loading of the library
+        qint64 factory = 0;
+        qint64 creation = 0;
+        bool deferred = false;
+    };
+    QHash<QString, StartupTiming> startupTimings;
+    qint64 initializeTime = 0;
+
+    /// Global plugins marked as deferred, created one by one once the event loop runs
+    QStringList deferredPlugins;
+
     bool canUnload(const KPluginMetaData& plugin)
     {
         qCDebug(SHELL) << "checking can unload for:" << plugin.name() << plugin.value(KEY_LoadMode());
@@ -276,6 +303,45 @@ public:
         return (enabledState(info) >= FirstEnabledState);
     }
 
+    /**
+     * Whether loadPluginInternal would try to load @p info, without looking at its dependencies
+     */
+    bool isLoadable(const KPluginMetaData& info) const
+    {
+        return isEnabled(info) && hasMandatoryProperties(info)
+            && !(info.value(KEY_Mode()) == KEY_Gui() && core->setupFlags() == Core::NoUi);
+    }
+
+    /**
+     * Prints where the startup time went per plugin when KDEV_PLUGIN_TIMING is set
+     */
+    void printStartupTimings() const
+    {
+        if (!qEnvironmentVariableIsSet("KDEV_PLUGIN_TIMING")) {
+            return;
+        }
+
+        QVector<QPair<QString, StartupTiming>> timings;
+        timings.reserve(startupTimings.size());
+        for (auto it = startupTimings.constBegin(); it != startupTimings.constEnd(); ++it) {
+            timings.append({it.key(), it.value()});
+        }
+        std::sort(timings.begin(), timings.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.factory + lhs.second.creation > rhs.second.factory + rhs.second.creation;
+        });
+
+        QTextStream out(stderr);
+        out << "Plugin startup timings in ms (factory, creation):\n";
+        for (const auto& timing : std::as_const(timings)) {
+            out << "  " << timing.first << ": " << timing.second.factory << ", " << timing.second.creation;
+            if (timing.second.deferred) {
+                out << " (deferred)";
+            }
+            out << '\n';
+        }
+        out << "Initializing the plugin controller took " << initializeTime << " ms" << Qt::endl;
+    }
+
     void initKTextEditorIntegration()
     {
         if (core->setupFlags() == Core::NoUi) {
@@ -375,6 +441,8 @@ void PluginController::cleanup()
     }
 
     d->cleanupMode = PluginControllerPrivate::CleaningUp;
+    d->deferredPlugins.clear();
+    QCoreApplication::instance()->removeEventFilter(this);
 
     // Ask all plugins to unload
     while ( !d->loadedPlugins.isEmpty() )
@@ -446,14 +514,72 @@ void PluginController::initialize()
     // Synchronize so we're writing out to the file.
     grp.sync();
 
-    // load global plugins
+    // load global plugins, deferring those that are not needed for a usable main window
+    QVector<KPluginMetaData> startupPlugins;
+    d->deferredPlugins.clear();
     for (const KPluginMetaData& pi : std::as_const(d->plugins)) {
         if (isGlobalPlugin(pi)) {
-            loadPluginInternal(pi.pluginId());
+            if (isDeferredPlugin(pi) && d->core->setupFlags() != Core::NoUi) {
+                d->deferredPlugins.append(pi.pluginId());
+            } else {
+                startupPlugins.append(pi);
+            }
         }
     }
 
-    qCDebug(SHELL) << "Done loading plugins - took:" << timer.elapsed() << "ms";
+    for (const KPluginMetaData& pi : std::as_const(startupPlugins)) {
+        loadPluginInternal(pi.pluginId());
+    }
+
+    d->initializeTime = timer.elapsed();
+    qCDebug(SHELL) << "Done loading plugins - took:" << d->initializeTime << "ms," << d->deferredPlugins.size()
+                   << "deferred";
+
+    if (d->deferredPlugins.isEmpty()) {
+        d->printStartupTimings();
+    } else {
+        // context menus are built on demand from the loaded plugins, see eventFilter()
+        QCoreApplication::instance()->installEventFilter(this);
+        QTimer::singleShot(0, this, &PluginController::loadNextDeferredPlugin);
+    }
+}
+
+void PluginController::loadNextDeferredPlugin()
+{
+    Q_D(PluginController);
+
+    if (d->cleanupMode != PluginControllerPrivate::Running || d->deferredPlugins.isEmpty()) {
+        return;
+    }
+
+    const QString pluginId = d->deferredPlugins.takeFirst();
+    d->startupTimings[pluginId].deferred = true;
+    loadPluginInternal(pluginId);
+
+    // one plugin per event loop iteration, to keep the user interface responsive
+    if (d->deferredPlugins.isEmpty()) {
+        QCoreApplication::instance()->removeEventFilter(this);
+        d->printStartupTimings();
+    } else {
+        QTimer::singleShot(0, this, &PluginController::loadNextDeferredPlugin);
+    }
+}
+
+void PluginController::loadDeferredPlugins()
+{
+    Q_D(PluginController);
+
+    while (!d->deferredPlugins.isEmpty()) {
+        loadNextDeferredPlugin();
+    }
+}
+
+bool PluginController::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::ContextMenu) {
+        loadDeferredPlugins();
+    }
+    return IPluginController::eventFilter(watched, event);
 }
 
 QList<IPlugin *> PluginController::loadedPlugins() const
@@ -533,6 +659,9 @@ IPlugin *PluginController::loadPluginInternal( const QString &pluginId )
         return nullptr;
     }
 
+    // a deferred plugin that is needed now is loaded right away
+    d->deferredPlugins.removeOne(pluginId);
+
     if ( IPlugin* plugin = d->loadedPlugins.value( info ) ) {
         return plugin;
     }
@@ -590,7 +719,10 @@ IPlugin *PluginController::loadPluginInternal( const QString &pluginId )
     loadOptionalDependencies( info );
 
     // now we can finally load the plugin itself
+    QElapsedTimer stepTimer;
+    stepTimer.start();
     const auto factory = KPluginFactory::loadFactory(info);
+    d->startupTimings[pluginId].factory = stepTimer.restart();
     if (!factory) {
         qCWarning(SHELL) << "Can't load plugin" << pluginId
                          << "because a factory to load the plugin could not be obtained:" << factory.errorText;
@@ -607,6 +739,7 @@ IPlugin *PluginController::loadPluginInternal( const QString &pluginId )
             return nullptr;
         }
     }
+    d->startupTimings[pluginId].creation = stepTimer.elapsed();
 
     KConfigGroup group = Core::self()->activeSession()->config()->group(KEY_Plugins());
     // runtime errors such as missing executables on the system or such get checked now
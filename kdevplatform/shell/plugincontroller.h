@@ -121,6 +121,10 @@ public:
 
     void resetToDefaults();
 
+protected:
+    /// Loads the plugins still deferred at startup before a context menu is built, they may extend it
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private:
     /**
      * Directly unload the given \a plugin, either deleting it now or \a deletion.
@@ -156,6 +160,16 @@ private:
     bool loadDependencies(const KPluginMetaData&, QString& failedPlugin);
     void loadOptionalDependencies(const KPluginMetaData& info);
 
+    /**
+     * Loads the first of the plugins deferred at startup, and schedules the next one.
+     */
+    void loadNextDeferredPlugin();
+
+    /**
+     * Loads all plugins still deferred at startup right away.
+     */
+    void loadDeferredPlugins();
+
     void cleanup();
     virtual void initialize();
 
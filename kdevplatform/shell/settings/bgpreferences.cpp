@@ -6,10 +6,12 @@
 
 #include "bgpreferences.h"
 
+#include <QLocale>
 #include <QThread>
 
 #include <interfaces/ilanguagecontroller.h>
 #include <language/backgroundparser/backgroundparser.h>
+#include <language/duchain/memorygovernor.h>
 
 #include "../core.h"
 
@@ -26,6 +28,31 @@ BGPreferences::BGPreferences(QWidget* parent)
 {
     preferencesDialog = new Ui::BGPreferences;
     preferencesDialog->setupUi(this);
+
+    // the governor notifies from its own thread
+    connect(MemoryGovernor::self(), &MemoryGovernor::usageChanged, this, &BGPreferences::updateMemoryUsage,
+            Qt::QueuedConnection);
+    updateMemoryUsage();
+}
+
+void BGPreferences::updateMemoryUsage()
+{
+    const QLocale locale;
+    QStringList lines;
+    const auto usage = MemoryGovernor::self()->usage();
+    for (const auto& category : usage) {
+        const QString bytes = category.bytes < 0 ? i18nc("@item memory usage", "unknown")
+                                                 : locale.formattedDataSize(category.bytes);
+        lines.append(i18nc("@item memory usage: category, amount", "%1: %2", category.category, bytes));
+    }
+    const auto budget = MemoryGovernor::self()->budget();
+    if (budget > 0) {
+        lines.append(i18nc("@item", "Budget: %1", locale.formattedDataSize(budget)));
+    }
+    if (MemoryGovernor::self()->isUnderPressure()) {
+        lines.append(i18nc("@item", "The budget is exceeded."));
+    }
+    preferencesDialog->memoryUsage->setText(lines.join(QLatin1Char('\n')));
 }
 
 void BGPreferences::reset()
@@ -38,6 +65,7 @@ void BGPreferences::reset()
     preferencesDialog->kcfg_delay->setValue(config.readEntry("Delay", 500));
     preferencesDialog->kcfg_threads->setValue(config.readEntry("Number of Threads", QThread::idealThreadCount()));
     preferencesDialog->kcfg_enable->setChecked(config.readEntry("Enabled", true));
+    preferencesDialog->kcfg_memoryBudget->setValue(config.readEntry("Memory Budget", 0));
 }
 
 BGPreferences::~BGPreferences( )
@@ -56,11 +84,13 @@ void BGPreferences::apply()
 
     Core::self()->languageController()->backgroundParser()->setDelay( preferencesDialog->kcfg_delay->value() );
     Core::self()->languageController()->backgroundParser()->setThreadCount( preferencesDialog->kcfg_threads->value() );
+    MemoryGovernor::self()->setBudget(qint64(preferencesDialog->kcfg_memoryBudget->value()) * 1024 * 1024);
 
     KConfigGroup config(ICore::self()->activeSession()->config(), QStringLiteral("Background Parser"));
     config.writeEntry("Enabled", preferencesDialog->kcfg_enable->isChecked());
     config.writeEntry("Delay", preferencesDialog->kcfg_delay->value());
     config.writeEntry("Number of Threads", preferencesDialog->kcfg_threads->value());
+    config.writeEntry("Memory Budget", preferencesDialog->kcfg_memoryBudget->value());
 }
 
 QString BGPreferences::name() const
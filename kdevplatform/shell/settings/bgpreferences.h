@@ -33,6 +33,8 @@ public:
     void reset() override;
 
 private:
+    void updateMemoryUsage();
+
     Ui::BGPreferences *preferencesDialog;
 
 };
@@ -7,10 +7,14 @@
 #ifndef KDEVPLATFORM_ALGORITHM_H
 #define KDEVPLATFORM_ALGORITHM_H
 
+#include <QSemaphore>
 #include <QSet>
+#include <QThreadPool>
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <memory>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -76,6 +80,52 @@ InsertionResult<typename QSet<ElementType>::iterator> insert(QSet<ElementType>&
     Q_ASSERT(set.size() <= oldSize + 1);
     return {std::move(it), set.size() != oldSize};
 }
+
+/**
+ * Calls @p function(begin, end) for consecutive ranges that together cover [0, @p count), concurrently on the
+ * calling thread and on the global thread pool, and returns once all calls have returned.
+ *
+ * Each range contains at least @p minimumRangeSize elements, so that small counts are processed on the calling
+ * thread alone. As the calling thread takes part, the function makes progress even if the pool is busy.
+ */
+template<typename Function>
+void parallelForRanges(int count, int minimumRangeSize, const Function& function)
+{
+    auto* const pool = QThreadPool::globalInstance();
+    const int threadCount = std::max(pool->maxThreadCount(), 1);
+    // more ranges than threads balance the load when some ranges take longer than others
+    const int maxRangeCount = std::min(count / std::max(minimumRangeSize, 1), threadCount * 4);
+    if (maxRangeCount <= 1) {
+        if (count > 0) {
+            function(0, count);
+        }
+        return;
+    }
+    const int rangeSize = (count + maxRangeCount - 1) / maxRangeCount;
+    const int rangeCount = (count + rangeSize - 1) / rangeSize;
+
+    struct State
+    {
+        std::atomic<int> nextRange = 0;
+        QSemaphore processedRanges;
+    };
+    // pool tasks may start after all ranges have been processed and this function has returned,
+    // they only dereference @p function after claiming a range
+    const auto state = std::make_shared<State>();
+    const auto processRanges = [state, count, rangeSize, rangeCount, function = &function]() {
+        for (int range = state->nextRange++; range < rangeCount; range = state->nextRange++) {
+            const int begin = range * rangeSize;
+            (*function)(begin, std::min(begin + rangeSize, count));
+            state->processedRanges.release();
+        }
+    };
+
+    for (int i = 1, taskCount = std::min(rangeCount, threadCount); i < taskCount; ++i) {
+        pool->start(processRanges);
+    }
+    processRanges();
+    state->processedRanges.acquire(rangeCount);
+}
 }
 
 #endif // KDEVPLATFORM_ALGORITHM_H
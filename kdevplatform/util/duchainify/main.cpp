@@ -19,6 +19,9 @@
 #include <language/duchain/persistentsymboltable.h>
 
 #include <interfaces/ilanguagecontroller.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+#include <serialization/itemrepositoryregistry.h>
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 
@@ -26,7 +29,12 @@
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 #include <QDebug>
+#include <QDir>
 #include <QDirIterator>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStringList>
 #include <QTimer>
 
@@ -39,6 +47,53 @@ bool verbose = false, warnings = false;
 
 using namespace KDevelop;
 
+namespace {
+/// @return the peak resident memory of this process in KiB, or -1 where it is not known
+qint64 peakResidentMemory()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+/// @return the sizes of the files in the item-repository directory of the session, in bytes
+/// The files in sub-directories, e.g. the top-contexts, are summed up per sub-directory.
+QHash<QString, qint64> repositorySizes()
+{
+    QHash<QString, qint64> ret;
+    const QDir repositoryDir(globalItemRepositoryRegistry().path());
+    QDirIterator it(repositoryDir.path(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QString relativePath = repositoryDir.relativeFilePath(it.filePath());
+        ret[relativePath.section(QLatin1Char('/'), 0, 0)] += it.fileInfo().size();
+    }
+    return ret;
+}
+
+double milliseconds(qint64 nanoseconds)
+{
+    return nanoseconds < 0 ? -1 : nanoseconds / 1000000.0;
+}
+
+QJsonObject lockHistogramToJson(const DUChainLockHistogram& histogram)
+{
+    return QJsonObject{
+        {QStringLiteral("samples"), double(histogram.samples)},
+        {QStringLiteral("totalMs"), histogram.totalMicroseconds / 1000.0},
+        {QStringLiteral("longestMs"), histogram.longestMicroseconds / 1000.0},
+    };
+}
+}
+
 void messageOutput(QtMsgType type, const QMessageLogContext& context, const QString& msg)
 {
     Q_UNUSED(context);
@@ -68,28 +123,33 @@ Manager::Manager(QCommandLineParser* args) : m_total(0)
 {
 }
 
+void Manager::setStartupTime(qint64 startupTime)
+{
+    m_startupTime = startupTime;
+}
+
 void Manager::init()
 {
-    if (m_args->positionalArguments().isEmpty()) {
+    if (m_args->positionalArguments().isEmpty() && !m_args->isSet(QStringLiteral("project"))) {
         std::cerr << "Need file or directory to duchainify" << std::endl;
         QCoreApplication::exit(1);
+        return;
     }
 
-    TopDUContext::Features features = TopDUContext::VisibleDeclarationsAndContexts;
     if (m_args->isSet(QStringLiteral("features"))) {
         QString featuresStr = m_args->value(QStringLiteral("features"));
         if (featuresStr == QLatin1String("visible-declarations")) {
-            features = TopDUContext::VisibleDeclarationsAndContexts;
+            m_features = TopDUContext::VisibleDeclarationsAndContexts;
         } else if (featuresStr == QLatin1String("all-declarations")) {
-            features = TopDUContext::AllDeclarationsAndContexts;
+            m_features = TopDUContext::AllDeclarationsAndContexts;
         } else if (featuresStr == QLatin1String("all-declarations-and-uses")) {
-            features = TopDUContext::AllDeclarationsContextsAndUses;
+            m_features = TopDUContext::AllDeclarationsContextsAndUses;
         } else if (featuresStr == QLatin1String("all-declarations-and-uses-and-AST")) {
-            features = TopDUContext::AllDeclarationsContextsAndUses | TopDUContext::AST;
+            m_features = TopDUContext::AllDeclarationsContextsAndUses | TopDUContext::AST;
         } else if (featuresStr == QLatin1String("empty")) {
-            features = TopDUContext::Empty;
+            m_features = TopDUContext::Empty;
         } else if (featuresStr == QLatin1String("simplified-visible-declarations")) {
-            features = TopDUContext::SimplifiedVisibleDeclarationsAndContexts;
+            m_features = TopDUContext::SimplifiedVisibleDeclarationsAndContexts;
         } else {
             std::cerr << "Wrong feature-string given\n";
             QCoreApplication::exit(2);
@@ -97,9 +157,9 @@ void Manager::init()
         }
     }
     if (m_args->isSet(QStringLiteral("force-update")))
-        features |= TopDUContext::ForceUpdate;
+        m_features |= TopDUContext::ForceUpdate;
     if (m_args->isSet(QStringLiteral("force-update-recursive")))
-        features |= TopDUContext::ForceUpdateRecursive;
+        m_features |= TopDUContext::ForceUpdateRecursive;
 
     if (m_args->isSet(QStringLiteral("threads"))) {
         bool ok = false;
@@ -120,13 +180,63 @@ void Manager::init()
     connect(
         ICore::self()->languageController()->backgroundParser(), &BackgroundParser::hideProgress, this,
         [this]() {
-            if (ICore::self()->languageController()->backgroundParser()->isIdle())
+            // the background parser may also become idle while a project is still being opened
+            if (m_allFilesAdded && ICore::self()->languageController()->backgroundParser()->isIdle())
                 QTimer::singleShot(0, this, &Manager::finish);
         });
 
-    const auto files = m_args->positionalArguments();
-    for (const auto& file : files) {
-        addToBackgroundParser(file, features);
+    m_bench = m_args->isSet(QStringLiteral("bench"));
+    if (m_bench || m_args->isSet(QStringLiteral("dump-lock-statistics"))) {
+        DUChain::lock()->setStatisticsEnabled(true);
+    }
+    if (m_bench) {
+        connect(ICore::self()->languageController()->backgroundParser(), &BackgroundParser::parseJobFinished, this,
+                &Manager::parseJobFinished);
+        m_repositorySizesBefore = repositorySizes();
+        DUChain::lock()->resetStatistics();
+    }
+
+    if (m_args->isSet(QStringLiteral("project"))) {
+        const auto projectUrl = QUrl::fromUserInput(m_args->value(QStringLiteral("project")), QDir::currentPath(),
+                                                    QUrl::AssumeLocalFile);
+        auto* projectController = ICore::self()->projectController();
+        connect(projectController, &IProjectController::projectOpened, this, &Manager::projectOpened);
+        connect(projectController, &IProjectController::projectOpeningAborted, this, &Manager::projectOpeningAborted);
+        m_phaseTimer.start();
+        projectController->openProject(projectUrl);
+        return;
+    }
+
+    parse(m_args->positionalArguments());
+}
+
+void Manager::projectOpened(IProject* project)
+{
+    m_projectImportTime = m_phaseTimer.nsecsElapsed();
+    std::cerr << "opened project " << qPrintable(project->name()) << std::endl;
+
+    QStringList paths = m_args->positionalArguments();
+    if (paths.isEmpty()) {
+        const auto files = project->fileSet();
+        paths.reserve(files.size());
+        for (const auto& file : files) {
+            paths << file.str();
+        }
+    }
+    parse(paths);
+}
+
+void Manager::projectOpeningAborted(IProject* project)
+{
+    std::cerr << "failed to open project " << qPrintable(project->name()) << std::endl;
+    QCoreApplication::exit(4);
+}
+
+void Manager::parse(const QStringList& paths)
+{
+    m_phaseTimer.start();
+    for (const auto& path : paths) {
+        addToBackgroundParser(path, m_features);
     }
 
     m_allFilesAdded = 1;
@@ -143,6 +253,15 @@ void Manager::init()
     }
 }
 
+void Manager::parseJobFinished(ParseJob* job)
+{
+    JobTiming timing{job->document(), job->runTime(), {}};
+    for (int phase = 0; phase < ParseJob::PhaseCount; ++phase) {
+        timing.phaseTimes[phase] = job->phaseTime(static_cast<ParseJob::Phase>(phase));
+    }
+    m_jobTimings.append(timing);
+}
+
 void Manager::updateReady(const IndexedString& url, const ReferencedTopDUContext& topContext)
 {
     qDebug() << "finished" << url.toUrl().toLocalFile() << "success: " << ( bool )topContext;
@@ -251,9 +370,103 @@ QSet<QUrl> Manager::waiting()
 void Manager::finish()
 {
     std::cerr << "ready" << std::endl;
+
+    if (m_bench) {
+        m_indexingTime = m_phaseTimer.nsecsElapsed();
+        QElapsedTimer storeTimer;
+        storeTimer.start();
+        DUChain::self()->storeToDisk();
+        writeBenchReport(storeTimer.nsecsElapsed());
+    }
+
+    if (m_args->isSet(QStringLiteral("dump-lock-statistics"))) {
+        std::cerr << "DUChain lock statistics:" << std::endl;
+        std::cerr << qPrintable(DUChain::lock()->statistics().print()) << std::endl;
+    }
     QCoreApplication::quit();
 }
 
+void Manager::writeBenchReport(qint64 storeTime)
+{
+    const auto* backgroundParser = ICore::self()->languageController()->backgroundParser();
+
+    std::array<qint64, ParseJob::PhaseCount> phaseTotals = {};
+    QJsonArray jobs;
+    for (const auto& timing : std::as_const(m_jobTimings)) {
+        for (int phase = 0; phase < ParseJob::PhaseCount; ++phase) {
+            phaseTotals[phase] += timing.phaseTimes[phase];
+        }
+        jobs.append(QJsonObject{
+            {QStringLiteral("file"), timing.document.str()},
+            {QStringLiteral("runMs"), milliseconds(timing.runTime)},
+            {QStringLiteral("resolveEnvironmentMs"), milliseconds(timing.phaseTimes[ParseJob::ResolveEnvironmentPhase])},
+            {QStringLiteral("parseMs"), milliseconds(timing.phaseTimes[ParseJob::ParsePhase])},
+            {QStringLiteral("buildDUChainMs"), milliseconds(timing.phaseTimes[ParseJob::BuildDUChainPhase])},
+        });
+    }
+
+    // the phases of the parse jobs overlap on the worker threads, so they are summed up over all jobs
+    const QJsonObject phases{
+        {QStringLiteral("startupMs"), milliseconds(m_startupTime)},
+        {QStringLiteral("projectImportMs"), milliseconds(m_projectImportTime)},
+        {QStringLiteral("indexingMs"), milliseconds(m_indexingTime)},
+        {QStringLiteral("resolveEnvironmentTotalMs"), milliseconds(phaseTotals[ParseJob::ResolveEnvironmentPhase])},
+        {QStringLiteral("parseTotalMs"), milliseconds(phaseTotals[ParseJob::ParsePhase])},
+        {QStringLiteral("buildDUChainTotalMs"), milliseconds(phaseTotals[ParseJob::BuildDUChainPhase])},
+        {QStringLiteral("storeToDiskMs"), milliseconds(storeTime)},
+    };
+
+    const auto lockStatistics = DUChain::lock()->statistics();
+    const QJsonObject lock{
+        {QStringLiteral("readWait"), lockHistogramToJson(lockStatistics.readWait)},
+        {QStringLiteral("writeWait"), lockHistogramToJson(lockStatistics.writeWait)},
+        {QStringLiteral("readHold"), lockHistogramToJson(lockStatistics.readHold)},
+        {QStringLiteral("writeHold"), lockHistogramToJson(lockStatistics.writeHold)},
+        {QStringLiteral("parkedWaits"), double(lockStatistics.parkedWaits)},
+        {QStringLiteral("timeouts"), double(lockStatistics.timeouts)},
+    };
+
+    const auto repositorySizesAfter = repositorySizes();
+    QJsonObject repositories;
+    qint64 totalBefore = 0, totalAfter = 0;
+    for (auto it = repositorySizesAfter.constBegin(); it != repositorySizesAfter.constEnd(); ++it) {
+        const qint64 before = m_repositorySizesBefore.value(it.key());
+        repositories.insert(it.key(), QJsonObject{
+            {QStringLiteral("beforeBytes"), double(before)},
+            {QStringLiteral("afterBytes"), double(it.value())},
+        });
+        totalBefore += before;
+        totalAfter += it.value();
+    }
+
+    const QJsonObject report{
+        {QStringLiteral("session"), m_args->isSet(QStringLiteral("cold")) ? QStringLiteral("cold") : QStringLiteral("warm")},
+        {QStringLiteral("threads"), backgroundParser->threadCount()},
+        {QStringLiteral("files"), int(m_total)},
+        {QStringLiteral("parseJobs"), m_jobTimings.size()},
+        {QStringLiteral("phases"), phases},
+        {QStringLiteral("jobs"), jobs},
+        {QStringLiteral("peakResidentMemoryKiB"), double(peakResidentMemory())},
+        {QStringLiteral("duchainLock"), lock},
+        {QStringLiteral("itemRepositories"), QJsonObject{
+            {QStringLiteral("beforeBytes"), double(totalBefore)},
+            {QStringLiteral("afterBytes"), double(totalAfter)},
+            {QStringLiteral("files"), repositories},
+        }},
+    };
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    const QString reportPath = m_args->value(QStringLiteral("bench"));
+    if (reportPath == QLatin1String("-")) {
+        std::cout << json.constData() << std::flush;
+        return;
+    }
+    QFile reportFile(reportPath);
+    if (!reportFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || reportFile.write(json) != json.size()) {
+        std::cerr << "failed to write the benchmark report to " << qPrintable(reportPath) << std::endl;
+    }
+}
+
 using namespace KDevelop;
 
 int main(int argc, char** argv)
@@ -306,6 +519,18 @@ int main(int argc, char** argv)
                                         i18n("Print problems encountered during parsing")});
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("dump-imported-errors")},
                                         i18n("Recursively dump errors from imported contexts.")});
+    parser.addOption(QCommandLineOption{QStringList{QStringLiteral("dump-lock-statistics")},
+                                        i18n("Print wait and hold time histograms of the DUChain lock when done")});
+    parser.addOption(QCommandLineOption{QStringList{QStringLiteral("p"), QStringLiteral("project")},
+                                        i18n("Open the given project first. Without paths, all its files are parsed"),
+                                        QStringLiteral("project-file")});
+    parser.addOption(QCommandLineOption{QStringList{QStringLiteral("cold")},
+                                        i18n("Use a new temporary session, so that nothing is reused from earlier runs")});
+    parser.addOption(QCommandLineOption{
+        QStringList{QStringLiteral("bench")},
+        i18n("Write a JSON report of phase timings, per-file latencies, peak memory, DUChain lock waits and "
+             "item-repository growth to the given file, or to stdout for -"),
+        QStringLiteral("report-file")});
 
     parser.process(app);
 
@@ -315,9 +540,13 @@ int main(int argc, char** argv)
     warnings = parser.isSet(QStringLiteral("warnings"));
     qInstallMessageHandler(messageOutput);
 
+    QElapsedTimer startupTimer;
+    startupTimer.start();
     AutoTestShell::init();
-    TestCore::initialize(Core::NoUi, QStringLiteral("duchainify"));
+    // an empty session name makes TestCore use a temporary session, which is deleted on shutdown
+    TestCore::initialize(Core::NoUi, parser.isSet(QStringLiteral("cold")) ? QString() : QStringLiteral("duchainify"));
     Manager manager(&parser);
+    manager.setStartupTime(startupTimer.nsecsElapsed());
 
     QTimer::singleShot(0, &manager, &Manager::init);
     int ret = app.exec();
@@ -9,13 +9,23 @@
 
 #include <QObject>
 #include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QUrl>
+#include <QVector>
 
+#include <language/backgroundparser/parsejob.h>
 #include <language/duchain/topducontext.h>
 #include <serialization/indexedstring.h>
 
+#include <array>
+
 class QCommandLineParser;
 
+namespace KDevelop {
+class IProject;
+}
+
 class Manager : public QObject
 {
     Q_OBJECT
@@ -24,16 +34,42 @@ public:
     explicit Manager(QCommandLineParser* args);
     void addToBackgroundParser(const QString& path, KDevelop::TopDUContext::Features features);
     QSet<QUrl> waiting();
+    /// Sets the wall time in nanoseconds it took to start the shell, for the benchmark report
+    void setStartupTime(qint64 startupTime);
 
 private:
+    /// Timings of a single parse job, collected with --bench
+    struct JobTiming
+    {
+        KDevelop::IndexedString document;
+        qint64 runTime;
+        std::array<qint64, KDevelop::ParseJob::PhaseCount> phaseTimes;
+    };
+
+    void parse(const QStringList& paths);
+    void writeBenchReport(qint64 storeTime);
+
     QSet<QUrl> m_waiting;
     uint m_total;
     QCommandLineParser* m_args;
     QAtomicInt m_allFilesAdded;
+    KDevelop::TopDUContext::Features m_features = KDevelop::TopDUContext::VisibleDeclarationsAndContexts;
+
+    // only used with --bench, all times are in nanoseconds
+    bool m_bench = false;
+    qint64 m_startupTime = -1;
+    qint64 m_projectImportTime = -1;
+    qint64 m_indexingTime = -1;
+    QElapsedTimer m_phaseTimer;
+    QVector<JobTiming> m_jobTimings;
+    QHash<QString, qint64> m_repositorySizesBefore;
 
 public Q_SLOTS:
     // delay init into event loop so the DUChain can always shutdown gracefully
     void init();
+    void projectOpened(KDevelop::IProject* project);
+    void projectOpeningAborted(KDevelop::IProject* project);
+    void parseJobFinished(KDevelop::ParseJob* job);
     void updateReady(const KDevelop::IndexedString& url, const KDevelop::ReferencedTopDUContext& topContext);
     void finish();
     void dump(const KDevelop::ReferencedTopDUContext& topContext);
@@ -0,0 +1,272 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_SHARDEDLRUCACHE_H
+#define KDEVPLATFORM_SHARDEDLRUCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace KDevelop {
+/**
+ * Statistics of a ShardedLruCache, see ShardedLruCache::statistics().
+ */
+struct ShardedLruCacheStatistics
+{
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    std::size_t usedMemory = 0;
+    std::size_t memoryBudget = 0;
+    int entries = 0;
+};
+
+/**
+ * A thread-safe key-value cache with a bounded memory footprint.
+ *
+ * The entries are distributed over @p ShardCount independently locked shards, so that lookups from
+ * different threads rarely contend. The lock of a shard is only held while an entry is copied in or out,
+ * so @p Value should be cheap to copy, e.g. an implicitly shared Qt container.
+ *
+ * Each shard gets an equal part of the memory budget. When a shard exceeds it, its least recently used
+ * entries are evicted until it is back at three quarters of its budget.
+ *
+ * @p SizeOf is a callable taking a key and its value and returning the approximate count of bytes
+ * that the entry occupies.
+ */
+template <typename Key, typename Value, typename SizeOf, int ShardCount = 16>
+class ShardedLruCache
+{
+    static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0, "ShardCount must be a power of two");
+
+public:
+    explicit ShardedLruCache(std::size_t memoryBudget, SizeOf sizeOf = {})
+        : m_sizeOf(std::move(sizeOf))
+    {
+        setMemoryBudget(memoryBudget);
+    }
+
+    Q_DISABLE_COPY_MOVE(ShardedLruCache)
+
+    /// @return a copy of the value cached for @p key, if any.
+    std::optional<Value> value(const Key& key) const
+    {
+        return read(key, [](const Value& value) {
+            return std::optional<Value>(value);
+        });
+    }
+
+    /**
+     * Calls @p extract with the value cached for @p key, if any, and returns its result.
+     *
+     * @p extract must return a std::optional, the lookup counts as a hit if it returns a value.
+     * This allows caching a container per key and counting hits for the contained items.
+     */
+    template <typename Extract>
+    auto read(const Key& key, Extract extract) const -> std::invoke_result_t<Extract, const Value&>
+    {
+        auto& shard = shardFor(key);
+        QMutexLocker lock(&shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        it->lastUse = ++shard.tick;
+        auto ret = extract(std::as_const(it->value));
+        (ret ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+        return ret;
+    }
+
+    /// Caches @p value for @p key, replacing any previously cached value.
+    void insert(const Key& key, const Value& value)
+    {
+        update(key, [&value](Value& cached) {
+            cached = value;
+        });
+    }
+
+    /**
+     * Calls @p modify with a reference to the value cached for @p key, which is default-constructed first if
+     * @p key is not cached yet. @p modify must not access this cache.
+     */
+    template <typename Modify>
+    void update(const Key& key, Modify modify)
+    {
+        auto& shard = shardFor(key);
+        QMutexLocker lock(&shard.mutex);
+        auto& entry = shard.entries[key];
+        shard.usedMemory -= entry.size;
+        modify(entry.value);
+        entry.size = m_sizeOf(key, entry.value);
+        entry.lastUse = ++shard.tick;
+        shard.usedMemory += entry.size;
+        if (shard.usedMemory > m_shardBudget.load(std::memory_order_relaxed)) {
+            evict(shard);
+        }
+    }
+
+    void remove(const Key& key)
+    {
+        auto& shard = shardFor(key);
+        QMutexLocker lock(&shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            shard.usedMemory -= it->size;
+            shard.entries.erase(it);
+        }
+    }
+
+    void clear()
+    {
+        for (auto& shard : m_shards) {
+            QMutexLocker lock(&shard.mutex);
+            shard.entries.clear();
+            shard.usedMemory = 0;
+        }
+    }
+
+    /**
+     * Evicts the least recently used entries until about @p bytes have been freed.
+     *
+     * Each shard frees its share of @p bytes, in proportion to the memory it uses.
+     * @return the count of bytes actually freed
+     */
+    std::size_t release(std::size_t bytes)
+    {
+        std::size_t usedMemory = 0;
+        for (auto& shard : m_shards) {
+            QMutexLocker lock(&shard.mutex);
+            usedMemory += shard.usedMemory;
+        }
+        if (usedMemory == 0) {
+            return 0;
+        }
+
+        std::size_t freed = 0;
+        for (auto& shard : m_shards) {
+            QMutexLocker lock(&shard.mutex);
+            const auto share = static_cast<std::size_t>(double(bytes) * shard.usedMemory / usedMemory);
+            freed += evictOldest(shard, share);
+        }
+        return freed;
+    }
+
+    /// Changes the memory budget. Shards exceeding their new part of it are shrunk on their next insertion.
+    void setMemoryBudget(std::size_t memoryBudget)
+    {
+        m_shardBudget.store(std::max<std::size_t>(memoryBudget / ShardCount, 1), std::memory_order_relaxed);
+    }
+
+    ShardedLruCacheStatistics statistics() const
+    {
+        ShardedLruCacheStatistics ret;
+        ret.hits = m_hits.load(std::memory_order_relaxed);
+        ret.misses = m_misses.load(std::memory_order_relaxed);
+        ret.evictions = m_evictions.load(std::memory_order_relaxed);
+        ret.memoryBudget = m_shardBudget.load(std::memory_order_relaxed) * ShardCount;
+        for (auto& shard : m_shards) {
+            QMutexLocker lock(&shard.mutex);
+            ret.usedMemory += shard.usedMemory;
+            ret.entries += static_cast<int>(shard.entries.size());
+        }
+        return ret;
+    }
+
+private:
+    struct Entry
+    {
+        Value value = {};
+        std::size_t size = 0;
+        quint64 lastUse = 0;
+    };
+
+    struct Shard
+    {
+        mutable QMutex mutex;
+        QHash<Key, Entry> entries;
+        std::size_t usedMemory = 0;
+        quint64 tick = 0;
+    };
+
+    Shard& shardFor(const Key& key) const
+    {
+        if constexpr (ShardCount == 1) {
+            return m_shards[0];
+        } else {
+            // QHash uses the low bits of the hash itself, so spread the high bits over the shards
+            const auto hash = static_cast<quint32>(qHash(key)) * 2654435761U;
+            return m_shards[hash >> (32 - shardBits())];
+        }
+    }
+
+    static constexpr int shardBits()
+    {
+        int bits = 0;
+        while ((1 << bits) < ShardCount) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    void evict(Shard& shard)
+    {
+        const auto target = m_shardBudget.load(std::memory_order_relaxed) / 4 * 3;
+        if (shard.usedMemory > target) {
+            evictOldest(shard, shard.usedMemory - target);
+        }
+    }
+
+    /// Evicts the least recently used entries of @p shard until at least @p bytes have been freed, returns those.
+    std::size_t evictOldest(Shard& shard, std::size_t bytes)
+    {
+        if (bytes == 0) {
+            return 0;
+        }
+
+        std::vector<std::pair<quint64, Key>> byAge;
+        byAge.reserve(shard.entries.size());
+        for (auto it = shard.entries.cbegin(), end = shard.entries.cend(); it != end; ++it) {
+            byAge.emplace_back(it->lastUse, it.key());
+        }
+        std::sort(byAge.begin(), byAge.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+
+        std::size_t freed = 0;
+        for (const auto& entry : byAge) {
+            if (freed >= bytes) {
+                break;
+            }
+            auto it = shard.entries.find(entry.second);
+            freed += it->size;
+            shard.usedMemory -= it->size;
+            shard.entries.erase(it);
+            m_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        return freed;
+    }
+
+    SizeOf m_sizeOf;
+    std::atomic<std::size_t> m_shardBudget = 0;
+    mutable std::array<Shard, ShardCount> m_shards;
+    mutable std::atomic<quint64> m_hits = 0;
+    mutable std::atomic<quint64> m_misses = 0;
+    std::atomic<quint64> m_evictions = 0;
+};
+}
+
+#endif // KDEVPLATFORM_SHARDEDLRUCACHE_H
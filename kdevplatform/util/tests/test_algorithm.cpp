@@ -14,6 +14,7 @@
 #include <QString>
 #include <QTest>
 
+#include <atomic>
 #include <utility>
 #include <vector>
 
@@ -93,4 +94,40 @@ void TestAlgorithm::testInsert()
     QCOMPARE(set, expected);
 }
 
+void TestAlgorithm::testParallelForRanges_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("minimumRangeSize");
+
+    QTest::newRow("empty") << 0 << 1;
+    QTest::newRow("single element") << 1 << 1;
+    QTest::newRow("below minimum range size") << 99 << 100;
+    QTest::newRow("uneven ranges") << 1001 << 7;
+    QTest::newRow("many elements") << 100000 << 64;
+}
+
+void TestAlgorithm::testParallelForRanges()
+{
+    QFETCH(const int, count);
+    QFETCH(const int, minimumRangeSize);
+
+    // every element must be visited exactly once
+    std::vector<std::atomic<int>> visits(count);
+    std::atomic<int> invalidRanges = 0;
+    Algorithm::parallelForRanges(count, minimumRangeSize, [&](int begin, int end) {
+        if (begin < 0 || begin >= end || end > count) {
+            ++invalidRanges;
+            return;
+        }
+        for (int i = begin; i < end; ++i) {
+            ++visits[i];
+        }
+    });
+
+    QCOMPARE(invalidRanges.load(), 0);
+    for (int i = 0; i < count; ++i) {
+        QCOMPARE(visits[i].load(), 1);
+    }
+}
+
 #include "moc_test_algorithm.cpp"
@@ -25,6 +25,9 @@ private Q_SLOTS:
     void testUnite5Int();
 
     void testInsert();
+
+    void testParallelForRanges();
+    void testParallelForRanges_data();
 };
 
 #endif // KDEVPLATFORM_TEST_ALGORITHM_H
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+#include <QThread>
+#include <QVector>
+
+#include "../shardedlrucache.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace KDevelop;
+
+namespace {
+struct VectorSize
+{
+    std::size_t operator()(int, const QVector<int>& value) const
+    {
+        return sizeof(int) + value.size() * sizeof(int);
+    }
+};
+
+using Cache = ShardedLruCache<int, QVector<int>, VectorSize, 1>;
+}
+
+class TestShardedLruCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void lookup()
+    {
+        Cache cache(1024);
+        QVERIFY(!cache.value(1));
+
+        cache.insert(1, {1, 2, 3});
+        QCOMPARE(cache.value(1).value_or(QVector<int>()), QVector<int>({1, 2, 3}));
+
+        cache.update(1, [](QVector<int>& value) {
+            value.append(4);
+        });
+        QCOMPARE(cache.value(1).value_or(QVector<int>()), QVector<int>({1, 2, 3, 4}));
+
+        cache.remove(1);
+        QVERIFY(!cache.value(1));
+
+        const auto statistics = cache.statistics();
+        QCOMPARE(statistics.hits, quint64(2));
+        QCOMPARE(statistics.misses, quint64(2));
+        QCOMPARE(statistics.entries, 0);
+        QCOMPARE(statistics.usedMemory, std::size_t(0));
+    }
+
+    void evictLeastRecentlyUsed()
+    {
+        // every entry takes 4 * sizeof(int) bytes, so only four fit at once
+        Cache cache(16 * sizeof(int));
+        for (int i = 0; i < 4; ++i) {
+            cache.insert(i, {i, i, i});
+        }
+        QCOMPARE(cache.statistics().entries, 4);
+
+        // make 0 the most recently used entry, 1 is the least recently used one now
+        QVERIFY(cache.value(0));
+
+        cache.insert(4, {4, 4, 4});
+        const auto statistics = cache.statistics();
+        QVERIFY(statistics.evictions >= 1);
+        QVERIFY(statistics.usedMemory <= 12 * sizeof(int));
+        QVERIFY(!cache.value(1));
+        QVERIFY(cache.value(0));
+        QVERIFY(cache.value(4));
+    }
+
+    void release()
+    {
+        Cache cache(1024 * sizeof(int));
+        for (int i = 0; i < 8; ++i) {
+            cache.insert(i, {i, i, i});
+        }
+        // make 0 the most recently used entry
+        QVERIFY(cache.value(0));
+
+        // every entry takes 4 * sizeof(int) bytes, so this evicts the two least recently used ones
+        QCOMPARE(cache.release(6 * sizeof(int)), std::size_t(8 * sizeof(int)));
+        const auto statistics = cache.statistics();
+        QCOMPARE(statistics.entries, 6);
+        QCOMPARE(statistics.usedMemory, std::size_t(24 * sizeof(int)));
+        QVERIFY(!cache.value(1));
+        QVERIFY(!cache.value(2));
+        QVERIFY(cache.value(0));
+        QVERIFY(cache.value(3));
+
+        QCOMPARE(cache.release(0), std::size_t(0));
+        QCOMPARE(cache.statistics().entries, 6);
+    }
+
+    void clear()
+    {
+        ShardedLruCache<int, QVector<int>, VectorSize> cache(1024 * 1024);
+        for (int i = 0; i < 100; ++i) {
+            cache.insert(i, {i});
+        }
+        QCOMPARE(cache.statistics().entries, 100);
+
+        cache.clear();
+        QCOMPARE(cache.statistics().entries, 0);
+        QCOMPARE(cache.statistics().usedMemory, std::size_t(0));
+    }
+
+    void concurrentAccess()
+    {
+        ShardedLruCache<int, QVector<int>, VectorSize> cache(64 * 1024);
+        std::atomic<int> mismatches = 0;
+
+        std::vector<std::unique_ptr<QThread>> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back(QThread::create([&cache, &mismatches, t] {
+                for (int i = 0; i < 10000; ++i) {
+                    const int key = (i * 7 + t) % 1000;
+                    if (const auto value = cache.value(key)) {
+                        if (value->first() != key) {
+                            ++mismatches;
+                        }
+                    } else {
+                        cache.insert(key, {key, t});
+                    }
+                }
+            }));
+            threads.back()->start();
+        }
+        for (auto& thread : threads) {
+            QVERIFY(thread->wait());
+        }
+
+        QCOMPARE(mismatches.load(), 0);
+        const auto statistics = cache.statistics();
+        QCOMPARE(statistics.hits + statistics.misses, quint64(40000));
+        QVERIFY(statistics.usedMemory <= statistics.memoryBudget);
+    }
+};
+
+QTEST_MAIN(TestShardedLruCache)
+
+#include "test_shardedlrucache.moc"
@@ -31,6 +31,7 @@
 #include "clangsettings/clangsettingsmanager.h"
 #include "duchain/clanghelpers.h"
 #include "duchain/clangpch.h"
+#include "duchain/clangpreamblecache.h"
 #include "duchain/duchainutils.h"
 #include "duchain/parsesession.h"
 #include "duchain/clangindex.h"
@@ -44,11 +45,16 @@
 
 #include <KTextEditor/Document>
 
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QReadLocker>
+#include <QSet>
 #include <QStringList>
 
+#include <algorithm>
+#include <vector>
+
 using namespace KDevelop;
 
 namespace {
@@ -146,12 +152,31 @@ DocumentChangeTracker* trackerForUrl(const IndexedString& url)
     return ICore::self()->languageController()->backgroundParser()->trackerForUrl(url);
 }
 
+/// @return the beginning of the file at @p path, which is enough to find its leading includes
+QByteArray leadingContents(const QString& path, const QVector<UnsavedFile>& unsavedFiles)
+{
+    for (const auto& unsavedFile : unsavedFiles) {
+        if (unsavedFile.fileName() == path) {
+            return unsavedFile.contents().join(QLatin1Char('\n')).toUtf8();
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.read(64 * 1024);
+}
+
 }
 
 ClangParseJob::ClangParseJob(const IndexedString& url, ILanguageSupport* languageSupport)
     : ParseJob(url, languageSupport)
     , m_options(ParseSessionData::NoOption)
 {
+    QElapsedTimer environmentTimer;
+    environmentTimer.start();
+
     const auto tuUrl = clang()->index()->translationUnitForUrl(url);
     bool hasBuildSystemInfo;
     if (auto file = findProjectFileItem(tuUrl, &hasBuildSystemInfo)) {
@@ -175,6 +200,12 @@ ClangParseJob::ClangParseJob(const IndexedString& url, ILanguageSupport* languag
         : ClangParsingEnvironment::Unknown
     );
     m_environment.setTranslationUnitUrl(tuUrl);
+    addPhaseTime(ResolveEnvironmentPhase, environmentTimer.nsecsElapsed());
+
+    const auto preambleCacheSettings = ClangSettingsManager::self()->preambleCacheSettings();
+    m_useSharedPreamble = preambleCacheSettings.enabled && isSource;
+    clang()->index()->preambleCache()->setBudgets(qint64(preambleCacheSettings.memoryBudget) * 1024 * 1024,
+                                                  qint64(preambleCacheSettings.diskBudget) * 1024 * 1024);
 
     Path::List projectPaths;
     const auto& projects = ICore::self()->projectController()->projects();
@@ -224,6 +255,9 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
     }
 
     {
+        QElapsedTimer environmentTimer;
+        environmentTimer.start();
+
         const auto tuUrlStr = m_environment.translationUnitUrl().str();
         if (!m_tuDocumentIsUnsaved && !QFile::exists(tuUrlStr)) {
             // maybe we requested a parse job some time ago but now the file
@@ -237,6 +271,11 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
         m_environment.addDefines(IDefinesAndIncludesManager::manager()->definesInBackground(tuUrlStr));
         m_environment.addParserArguments(IDefinesAndIncludesManager::manager()->parserArgumentsInBackground(tuUrlStr));
         m_environment.setPchInclude(userDefinedPchIncludeForFile(tuUrlStr));
+        if (m_useSharedPreamble && !m_environment.pchInclude().isValid()) {
+            m_environment.setPchInclude(clang()->index()->preambleCache()->preambleInclude(
+                m_environment, leadingContents(tuUrlStr, m_unsavedFiles)));
+        }
+        addPhaseTime(ResolveEnvironmentPhase, environmentTimer.nsecsElapsed());
     }
 
     if (abortRequested()) {
@@ -274,6 +313,22 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
         if (abortRequested() || !isUpdateRequired(ParseSession::languageString())) {
             return;
         }
+        if (reuseUnchangedContext()) {
+            return;
+        }
+    }
+
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+
+    if (clang()->index()->preambleCache()->isPreambleInclude(m_environment.pchInclude())) {
+        // build the shared preamble first, so that this translation unit already benefits from it
+        if (!clang()->index()->pch(m_environment)) {
+            m_environment.setPchInclude({});
+        }
+        if (abortRequested()) {
+            return;
+        }
     }
 
     ParseSession session(ClangIntegration::DUChainUtils::findParseSessionData(document(), m_environment.translationUnitUrl()));
@@ -284,6 +339,7 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
     if (!session.data() || !session.reparse(m_unsavedFiles, m_environment)) {
         session.setData(createSessionData());
     }
+    addPhaseTime(ParsePhase, parseTimer.nsecsElapsed());
 
     if (!session.unit()) {
         // failed to parse file, unpin and don't try again
@@ -318,9 +374,12 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
         return;
     }
 
+    QElapsedTimer buildTimer;
+    buildTimer.start();
     auto context = ClangHelpers::buildDUChain(session.mainFile(), imports, session, minimumFeatures(), includedFiles,
                                               m_unsavedRevisions, document(), clang()->index(),
                                               [this] { return abortRequested(); });
+    addPhaseTime(BuildDUChainPhase, buildTimer.nsecsElapsed());
     setDuChain(context);
 
     if (abortRequested()) {
@@ -364,6 +423,122 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
     }
 }
 
+bool ClangParseJob::reuseUnchangedContext()
+{
+    if ((minimumFeatures() & TopDUContext::ForceUpdate) || (m_options & ParseSessionData::OpenedInEditor)) {
+        return false;
+    }
+
+    struct File
+    {
+        ClangParsingEnvironmentFile::Ptr environmentFile;
+        IndexedString url;
+        ModificationRevision storedRevision;
+        ModificationRevision currentRevision;
+        quint64 contentHash;
+        QVector<ParsingEnvironmentFile*> imports;
+    };
+    // the document and its recursive imports, every file after its imports
+    std::vector<File> files;
+
+    ReferencedTopDUContext context;
+    {
+        DUChainReadLocker lock;
+        ClangParsingEnvironmentFile::Ptr root;
+        const auto environmentFiles = DUChain::self()->allEnvironmentFiles(document());
+        for (const auto& file : environmentFiles) {
+            if (file->language() == ParseSession::languageString()) {
+                root.reset(dynamic_cast<ClangParsingEnvironmentFile*>(file.data()));
+                break;
+            }
+        }
+        if (!root || !root->topContext() || !root->featuresSatisfied(minimumFeatures())
+            || root->environmentRequiresUpdate(m_environment)) {
+            return false;
+        }
+        context = root->topContext();
+
+        QSet<ParsingEnvironmentFile*> visited;
+        const auto collect = [&files, &visited](const auto& self, const ParsingEnvironmentFilePointer& file) -> bool {
+            if (visited.contains(file.data())) {
+                return true;
+            }
+            visited.insert(file.data());
+
+            ClangParsingEnvironmentFile::Ptr clangFile(dynamic_cast<ClangParsingEnvironmentFile*>(file.data()));
+            if (!clangFile) {
+                return false;
+            }
+            const auto imports = file->imports();
+            QVector<ParsingEnvironmentFile*> importPointers;
+            importPointers.reserve(imports.size());
+            for (const auto& import : imports) {
+                if (!self(self, import)) {
+                    return false;
+                }
+                importPointers.append(import.data());
+            }
+            files.push_back({clangFile, clangFile->url(), clangFile->modificationRevision(), {},
+                             clangFile->contentHash(), importPointers});
+            return true;
+        };
+        if (!collect(collect, ParsingEnvironmentFilePointer(root.data()))) {
+            return false;
+        }
+    }
+
+    // compare the contents of the modified files without holding the DUChain lock
+    QSet<ParsingEnvironmentFile*> modified;
+    for (auto& file : files) {
+        if (abortRequested()) {
+            return false;
+        }
+        file.currentRevision = m_unsavedRevisions.value(file.url, ModificationRevision::revisionForFile(file.url));
+        if (file.currentRevision == file.storedRevision) {
+            continue;
+        }
+        if (file.currentRevision.revision != 0 || file.contentHash == 0) {
+            // the file is modified in an editor or its parsed contents are not known
+            return false;
+        }
+        QFile contents(file.url.str());
+        if (!contents.open(QIODevice::ReadOnly)
+            || ClangParsingEnvironmentFile::hashContents(contents.readAll()) != file.contentHash) {
+            return false;
+        }
+        modified.insert(file.environmentFile.data());
+    }
+
+    const auto modifiedCount = modified.size();
+    {
+        DUChainWriteLocker lock;
+        // refresh the modification revisions of the modified files and of all files that include them
+        for (const auto& file : files) {
+            const bool importsModified = std::any_of(file.imports.cbegin(), file.imports.cend(),
+                                                     [&modified](ParsingEnvironmentFile* import) {
+                                                         return modified.contains(import);
+                                                     });
+            if (!importsModified && !modified.contains(file.environmentFile.data())) {
+                continue;
+            }
+            modified.insert(file.environmentFile.data());
+
+            file.environmentFile->setModificationRevision(file.currentRevision);
+            file.environmentFile->clearModificationRevisions();
+            const auto imports = file.environmentFile->imports();
+            for (const auto& import : imports) {
+                file.environmentFile->addModificationRevisions(import->allModificationRevisions());
+            }
+        }
+    }
+
+    clangDebug() << "reusing the context of" << document() << "as the contents of its" << modifiedCount
+                 << "modified files did not change";
+    setDuChain(context);
+    highlightDUChain();
+    return true;
+}
+
 ParseSessionData::Ptr ClangParseJob::createSessionData() const
 {
     return ParseSessionData::Ptr(new ParseSessionData(m_unsavedFiles, clang()->index(), m_environment, m_options));
@@ -40,10 +40,19 @@ protected:
 private:
     QExplicitlySharedDataPointer<ParseSessionData> createSessionData() const;
 
+    /**
+     * Reuses the existing context of the document if neither its environment nor the contents of any of the
+     * files it consists of have changed, even though their modification times did.
+     *
+     * @return whether the context was reused, so that no parsing is necessary
+     */
+    bool reuseUnchangedContext();
+
     ClangParsingEnvironment m_environment;
     QVector<UnsavedFile> m_unsavedFiles;
     ParseSessionData::Options m_options;
     bool m_tuDocumentIsUnsaved = false;
+    bool m_useSharedPreamble = false;
     QHash<KDevelop::IndexedString, KDevelop::ModificationRevision> m_unsavedRevisions;
 };
 
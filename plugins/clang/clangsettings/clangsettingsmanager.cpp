@@ -28,6 +28,10 @@ namespace
 
     const QString forwardDeclare = QStringLiteral("forwardDeclare");
 
+    const QString sharedPreambles = QStringLiteral("sharedPreambles");
+    const QString sharedPreambleMemoryBudget = QStringLiteral("sharedPreambleMemoryBudget");
+    const QString sharedPreambleDiskBudget = QStringLiteral("sharedPreambleDiskBudget");
+
 AssistantsSettings readAssistantsSettings(KConfig* cfg)
 {
     auto grp = cfg->group(settingsGroup);
@@ -48,6 +52,18 @@ CodeCompletionSettings readCodeCompletionSettings(KConfig* cfg)
 
     return settings;
 }
+
+PreambleCacheSettings readPreambleCacheSettings(KConfig* cfg)
+{
+    auto grp = cfg->group(settingsGroup);
+    PreambleCacheSettings settings;
+
+    settings.enabled = grp.readEntry(sharedPreambles, settings.enabled);
+    settings.memoryBudget = grp.readEntry(sharedPreambleMemoryBudget, settings.memoryBudget);
+    settings.diskBudget = grp.readEntry(sharedPreambleDiskBudget, settings.diskBudget);
+
+    return settings;
+}
 }
 
 ClangSettingsManager* ClangSettingsManager::self()
@@ -75,6 +91,12 @@ CodeCompletionSettings ClangSettingsManager::codeCompletionSettings() const
     return readCodeCompletionSettings(cfg.data());
 }
 
+PreambleCacheSettings ClangSettingsManager::preambleCacheSettings() const
+{
+    auto cfg = ICore::self()->activeSession()->config();
+    return readPreambleCacheSettings(cfg.data());
+}
+
 ParserSettings ClangSettingsManager::parserSettings(KDevelop::ProjectBaseItem* item) const
 {
     return {IDefinesAndIncludesManager::manager()->parserArguments(item)};
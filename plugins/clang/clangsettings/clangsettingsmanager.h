@@ -38,6 +38,16 @@ struct AssistantsSettings
     bool forwardDeclare = true;
 };
 
+struct PreambleCacheSettings
+{
+    /// Whether translation units with equal leading includes share a precompiled preamble, opt-in for now
+    bool enabled = false;
+    /// The memory the shared preambles may occupy, in MiB
+    int memoryBudget = 1024;
+    /// The disk space the shared preambles may occupy, in MiB
+    int diskBudget = 4096;
+};
+
 class KDEVCLANGPRIVATE_EXPORT ClangSettingsManager
 {
 public:
@@ -47,6 +57,8 @@ public:
 
     CodeCompletionSettings codeCompletionSettings() const;
 
+    PreambleCacheSettings preambleCacheSettings() const;
+
     ParserSettings parserSettings(KDevelop::ProjectBaseItem* item) const;
 
     ParserSettings parserSettings(const QString& path) const;
@@ -29,10 +29,12 @@
 #include "duchain/documentfinderhelpers.h"
 #include "duchain/navigationwidget.h"
 #include "duchain/clangindex.h"
+#include "duchain/clangpreamblecache.h"
 #include "duchain/clanghelpers.h"
 #include "duchain/macrodefinition.h"
 #include "duchain/clangparsingenvironmentfile.h"
 #include "duchain/duchainutils.h"
+#include "duchain/parsesession.h"
 
 #include <language/assistant/staticassistantsmanager.h>
 #include <language/assistant/renameassistant.h>
@@ -43,6 +45,7 @@
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainutils.h>
+#include <language/duchain/memorygovernor.h>
 #include <language/duchain/parsingenvironment.h>
 #include <language/duchain/use.h>
 #include <language/editor/documentcursor.h>
@@ -63,6 +66,16 @@ using namespace KDevelop;
 
 namespace {
 
+QString translationUnitsCategory()
+{
+    return QStringLiteral("Clang translation units");
+}
+
+QString preamblesCategory()
+{
+    return QStringLiteral("Clang preambles");
+}
+
 QPair<QString, KTextEditor::Range> lineInDocument(const QUrl &url, const KTextEditor::Cursor& position)
 {
     KDevelop::IDocument* doc = ICore::self()->documentController()->documentForUrl(url);
@@ -183,6 +196,16 @@ ClangSupport::ClangSupport(QObject* parent, const KPluginMetaData& metaData, con
     m_refactoring = new ClangRefactoring(this);
     m_index.reset(new ClangIndex);
 
+    auto* governor = MemoryGovernor::self();
+    governor->registerConsumer(translationUnitsCategory(), &ParseSessionData::memoryUsage,
+                               &ParseSessionData::releaseIdleSessions);
+    auto* preambleCache = m_index->preambleCache();
+    governor->registerConsumer(preamblesCategory(), [preambleCache]() {
+        return preambleCache->memoryUsage();
+    }, [preambleCache](qint64 bytes) {
+        preambleCache->releaseMemory(bytes);
+    });
+
     auto model = new KDevelop::CodeCompletion( this, new ClangCodeCompletionModel(m_index.data(), this), name() );
     connect(model, &CodeCompletion::registeredToView,
             this, &ClangSupport::disableKeywordCompletion);
@@ -207,6 +230,9 @@ ClangSupport::~ClangSupport()
     // By locking the parse-mutexes, we make sure that parse jobs get a chance to finish in a good state
     parseLock()->unlock();
 
+    MemoryGovernor::self()->unregisterConsumer(translationUnitsCategory());
+    MemoryGovernor::self()->unregisterConsumer(preamblesCategory());
+
     const auto& mimeTypes = DocumentFinderHelpers::mimeTypesList();
     for (const auto& type : mimeTypes) {
         KDevelop::IBuddyDocumentFinder::removeFinder(type);
@@ -0,0 +1,54 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef COMPLETIONCACHE_H
+#define COMPLETIONCACHE_H
+
+#include <language/codecompletion/codecompletionitem.h>
+#include <language/editor/modificationrevision.h>
+
+#include <KTextEditor/Cursor>
+
+#include <QList>
+#include <QString>
+#include <QUrl>
+
+/// Returns the identifier the user typed after a completion position, given the text following it
+inline QString typedPrefix(const QString& followingText)
+{
+    int length = 0;
+    while (length < followingText.size()
+           && (followingText.at(length).isLetterOrNumber() || followingText.at(length) == QLatin1Char('_'))) {
+        ++length;
+    }
+    return followingText.left(length);
+}
+
+/**
+ * The result of the last completion, which is re-filtered when completion is requested again at the same
+ * position of the same document contents, e.g. because the user continued typing an identifier.
+ */
+struct CompletionCache
+{
+    bool matches(const QUrl& url, const KTextEditor::Cursor& position,
+                 const KDevelop::ModificationRevision& revision, const QString& text) const
+    {
+        return valid && this->position == position && this->revision == revision && this->url == url
+            && this->text == text;
+    }
+
+    bool valid = false;
+    QUrl url;
+    KTextEditor::Cursor position;
+    /// The revision of the document the context was parsed from
+    KDevelop::ModificationRevision revision;
+    /// The document contents in front of the completion position
+    QString text;
+    QList<KDevelop::CompletionTreeItemPointer> items;
+    QList<KDevelop::CompletionTreeElementPointer> ungrouped;
+};
+
+#endif // COMPLETIONCACHE_H
@@ -51,6 +51,7 @@
 #include <algorithm>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <memory>
 
 #include <KTextEditor/Document>
@@ -134,6 +135,11 @@ public:
         m_unimportant = true;
     }
 
+    const QString& display() const
+    {
+        return m_display;
+    }
+
 protected:
     QString m_display;
     QString m_prefix;
@@ -1486,4 +1492,74 @@ void ClangCodeCompletionContext::setFilters(const ClangCodeCompletionContext::Co
     m_filters = filters;
 }
 
+namespace {
+QString itemName(const CompletionTreeItem* item)
+{
+    QString display;
+    if (auto declarationItem = dynamic_cast<const CompletionItem<NormalDeclarationCompletionItem>*>(item)) {
+        display = declarationItem->display();
+    } else if (auto simpleItem = dynamic_cast<const CompletionItem<CompletionTreeItem>*>(item)) {
+        display = simpleItem->display();
+    }
+    // strip the arguments of macros and declarations without a DUChain declaration
+    const auto paren = display.indexOf(QLatin1Char('('));
+    return paren == -1 ? display : display.left(paren);
+}
+
+/// Returns how well @p name matches @p prefix, higher is better, -1 means no match
+int matchQuality(const QString& name, const QString& prefix)
+{
+    if (name.startsWith(prefix)) {
+        return 3;
+    }
+    if (name.startsWith(prefix, Qt::CaseInsensitive)) {
+        return 2;
+    }
+    if (name.contains(prefix, Qt::CaseInsensitive)) {
+        return 1;
+    }
+    // the characters of the prefix in order, as matched by fuzzy filtering in the completion widget
+    int position = 0;
+    for (const auto character : prefix) {
+        position = name.indexOf(character, position, Qt::CaseInsensitive);
+        if (position == -1) {
+            return -1;
+        }
+        ++position;
+    }
+    return 0;
+}
+}
+
+QList<CompletionTreeItemPointer> ClangCodeCompletionContext::filterItems(const QList<CompletionTreeItemPointer>& items,
+                                                                         const QString& prefix)
+{
+    if (prefix.isEmpty()) {
+        return items;
+    }
+
+    QVector<QPair<int, CompletionTreeItemPointer>> matches;
+    for (const auto& item : items) {
+        // argument hints describe the call around the position, not the identifier being typed
+        if (item->argumentHintDepth() > 0) {
+            matches.append({std::numeric_limits<int>::max(), item});
+            continue;
+        }
+        const auto quality = matchQuality(itemName(item.data()), prefix);
+        if (quality != -1) {
+            matches.append({quality, item});
+        }
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    QList<CompletionTreeItemPointer> filtered;
+    filtered.reserve(matches.size());
+    for (const auto& match : std::as_const(matches)) {
+        filtered.append(match.second);
+    }
+    return filtered;
+}
+
 #include "context.moc"
@@ -46,6 +46,16 @@ public:
     ContextFilters filters() const;
     void setFilters(const ContextFilters& filters);
 
+    /**
+     * Returns the items of @p items whose name matches the identifier @p prefix, best matches first.
+     * Argument hints are always kept, in front of the other items.
+     *
+     * Used to narrow down the result of an earlier completion at the same position while the user
+     * continues typing, without asking Clang again.
+     */
+    static QList<KDevelop::CompletionTreeItemPointer>
+    filterItems(const QList<KDevelop::CompletionTreeItemPointer>& items, const QString& prefix);
+
 private:
     void addOverwritableItems();
     void addImplementationHelperItems();
@@ -7,6 +7,7 @@
 #include "model.h"
 
 #include "util/clangdebug.h"
+#include "completioncache.h"
 #include "context.h"
 #include "includepathcompletioncontext.h"
 
@@ -16,6 +17,7 @@
 
 #include <language/codecompletion/codecompletionworker.h>
 #include <language/duchain/topducontext.h>
+#include <language/duchain/parsingenvironment.h>
 #include <language/duchain/duchainutils.h>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/stringhelpers.h>
@@ -61,12 +63,30 @@ public:
 
 public Q_SLOTS:
     void completionRequested(const QUrl &url, const KTextEditor::Cursor& position, const QString& text, const QString& followingText)
+    {
+        schedule(url, position, text, followingText, false);
+    }
+
+    void speculativeCompletionRequested(const QUrl& url, const KTextEditor::Cursor& position, const QString& text,
+                                        const QString& followingText)
+    {
+        if (m_timer && m_timer->isActive() && !m_speculative) {
+            // never replace an actual request
+            return;
+        }
+        schedule(url, position, text, followingText, true);
+    }
+
+private:
+    void schedule(const QUrl& url, const KTextEditor::Cursor& position, const QString& text,
+                  const QString& followingText, bool speculative)
     {
         // group requests and only handle the latest one
         m_url = url;
         m_position = position;
         m_text = text;
         m_followingText = followingText;
+        m_speculative = speculative;
 
         if (!m_timer) {
             // lazy-load the timer to initialize it in the background thread
@@ -78,7 +98,6 @@ public Q_SLOTS:
         m_timer->start();
     }
 
-private:
     void run()
     {
         aborting() = false;
@@ -95,6 +114,16 @@ private:
             return;
         }
 
+        const auto* environmentFile = top->parsingEnvironmentFile().data();
+        const auto revision = environmentFile ? environmentFile->modificationRevision() : ModificationRevision();
+        if (m_cache.matches(m_url, m_position, revision, m_text)) {
+            if (!m_speculative) {
+                deliver(ClangCodeCompletionContext::filterItems(m_cache.items, typedPrefix(m_followingText)),
+                        m_cache.ungrouped);
+            }
+            return;
+        }
+
         ParseSessionData::Ptr sessionData(ClangIntegration::DUChainUtils::findParseSessionData(top->url(), m_index->translationUnitForUrl(top->url())));
 
         if (!sessionData) {
@@ -131,6 +160,29 @@ private:
             return;
         }
 
+        // include path completion is cheap and depends on the typed text, don't cache it
+        if (completionContext->isValid() && !includePathCompletionRequired(m_text)) {
+            m_cache.valid = true;
+            m_cache.url = m_url;
+            m_cache.position = m_position;
+            m_cache.revision = revision;
+            m_cache.text = m_text;
+            m_cache.items = items;
+            m_cache.ungrouped = completionContext->ungroupedElements();
+        } else {
+            m_cache = {};
+        }
+
+        if (m_speculative) {
+            // keep the result for when completion is actually invoked
+            return;
+        }
+
+        deliver(items, completionContext->ungroupedElements());
+    }
+
+    void deliver(const QList<CompletionTreeItemPointer>& items, const QList<CompletionTreeElementPointer>& ungrouped)
+    {
         auto tree = computeGroups( items, {} );
 
         if (aborting()) {
@@ -138,7 +190,7 @@ private:
             return;
         }
 
-        tree += completionContext->ungroupedElements();
+        tree += ungrouped;
 
         foundDeclarations( tree, {} );
     }
@@ -149,6 +201,8 @@ private:
     KTextEditor::Cursor m_position;
     QString m_text;
     QString m_followingText;
+    bool m_speculative = false;
+    CompletionCache m_cache;
 };
 }
 
@@ -184,6 +238,12 @@ bool ClangCodeCompletionModel::shouldStartCompletion(KTextEditor::View* view, co
     if (userInsertion && lastChar == QLatin1Char('-') && includePathCompletionRequired(view->document()->line(position.line()))) {
         return true;
     }
+    if (userInsertion
+        && (inserted.endsWith(QLatin1String("::")) || inserted.endsWith(QLatin1String("->"))
+            || lastChar == QLatin1Char('.'))) {
+        // start completing right away, so the result is ready when completion is invoked after the typing delay
+        requestCompletionAt(view, completionRange(view, position).start(), view->document()->url(), true);
+    }
     if (userInsertion && inserted.endsWith(QLatin1String("::"))) {
         return true;
     }
@@ -217,15 +277,27 @@ CodeCompletionWorker* ClangCodeCompletionModel::createCompletionWorker()
     auto worker = new ClangCodeCompletionWorker(m_index, this);
     connect(this, &ClangCodeCompletionModel::requestCompletion,
             worker, &ClangCodeCompletionWorker::completionRequested);
+    connect(this, &ClangCodeCompletionModel::requestSpeculativeCompletion,
+            worker, &ClangCodeCompletionWorker::speculativeCompletionRequested);
     return worker;
 }
 
 void ClangCodeCompletionModel::completionInvokedInternal(KTextEditor::View* view, const KTextEditor::Range& range,
                                                          CodeCompletionModel::InvocationType /*invocationType*/, const QUrl &url)
 {
-    auto text = view->document()->text({0, 0, range.start().line(), range.start().column()});
-    auto followingText = view->document()->text({{range.start().line(), range.start().column()}, view->document()->documentEnd()});
-    emit requestCompletion(url, KTextEditor::Cursor(range.start()), text, followingText);
+    requestCompletionAt(view, range.start(), url, false);
+}
+
+void ClangCodeCompletionModel::requestCompletionAt(KTextEditor::View* view, const KTextEditor::Cursor& position,
+                                                   const QUrl& url, bool speculative)
+{
+    auto text = view->document()->text({{0, 0}, position});
+    auto followingText = view->document()->text({position, view->document()->documentEnd()});
+    if (speculative) {
+        emit requestSpeculativeCompletion(url, position, text, followingText);
+    } else {
+        emit requestCompletion(url, position, text, followingText);
+    }
 }
 
 #include "model.moc"
@@ -30,6 +30,9 @@ public:
 
 Q_SIGNALS:
     void requestCompletion(const QUrl &url, const KTextEditor::Cursor& cursor, const QString& text, const QString& followingText);
+    /// Like requestCompletion, but only prepares the result of a completion that is likely to be invoked soon
+    void requestSpeculativeCompletion(const QUrl& url, const KTextEditor::Cursor& cursor, const QString& text,
+                                      const QString& followingText);
 
 protected:
     KDevelop::CodeCompletionWorker* createCompletionWorker() override;
@@ -38,6 +41,9 @@ protected:
                                    InvocationType invocationType, const QUrl &url) override;
 
 private:
+    void requestCompletionAt(KTextEditor::View* view, const KTextEditor::Cursor& position, const QUrl& url,
+                             bool speculative);
+
     ClangIndex* m_index;
 };
 
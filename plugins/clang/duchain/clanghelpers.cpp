@@ -198,6 +198,10 @@ ReferencedTopDUContext ClangHelpers::buildDUChain(CXFile file, const Imports& im
         } else {
             envFile->setModificationRevision(*it);
         }
+
+        std::size_t contentsSize = 0;
+        const char* contents = clang_getFileContents(session.unit(), file, &contentsSize);
+        envFile->setContentHash(contents ? ClangParsingEnvironmentFile::hashContents(QByteArrayView(contents, contentsSize)) : 0);
     }
 
     const auto problems = session.problemsForFile(file);
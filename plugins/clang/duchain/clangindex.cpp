@@ -8,6 +8,7 @@
 
 #include "clangpch.h"
 #include "clangparsingenvironment.h"
+#include "clangpreamblecache.h"
 #include "documentfinderhelpers.h"
 
 #include <interfaces/icompletionsettings.h>
@@ -75,6 +76,7 @@ CXIndex createIndex()
 
 ClangIndex::ClangIndex()
     : m_index(createIndex())
+    , m_preambleCache(new ClangPreambleCache(ICore::self()->sessionTemporaryDirectoryPath() + QLatin1String("/preambles")))
 {
 }
 
@@ -90,6 +92,10 @@ QSharedPointer<const ClangPCH> ClangIndex::pch(const ClangParsingEnvironment& en
         return {};
     }
 
+    if (m_preambleCache->isPreambleInclude(pchInclude)) {
+        return m_preambleCache->pch(environment, this);
+    }
+
     UrlParseLock pchLock(IndexedString(pchInclude.pathOrUrl()));
 
     if (QFile::exists(pchInclude.toLocalFile() + QLatin1String(".pch"))) {
@@ -106,6 +112,11 @@ QSharedPointer<const ClangPCH> ClangIndex::pch(const ClangParsingEnvironment& en
     return pch;
 }
 
+ClangPreambleCache* ClangIndex::preambleCache() const
+{
+    return m_preambleCache.get();
+}
+
 ClangIndex::~ClangIndex()
 {
     clang_disposeIndex(m_index);
@@ -19,8 +19,11 @@
 
 #include <clang-c/Index.h>
 
+#include <memory>
+
 class ClangParsingEnvironment;
 class ClangPCH;
+class ClangPreambleCache;
 
 class KDEVCLANGPRIVATE_EXPORT ClangIndex
 {
@@ -38,6 +41,11 @@ public:
      */
     QSharedPointer<const ClangPCH> pch(const ClangParsingEnvironment& environment);
 
+    /**
+     * @returns the cache of the preambles that translation units share as their PCH include
+     */
+    ClangPreambleCache* preambleCache() const;
+
     /**
      * Gets the currently pinned TU for @p url
      *
@@ -61,6 +69,8 @@ private:
     QReadWriteLock m_pchLock;
     QHash<KDevelop::Path, QSharedPointer<const ClangPCH>> m_pch;
 
+    const std::unique_ptr<ClangPreambleCache> m_preambleCache;
+
     QMutex m_mappingMutex;
     QHash<KDevelop::IndexedString, KDevelop::IndexedString> m_tuForUrl;
 };
@@ -12,6 +12,8 @@
 #include <language/duchain/duchainregister.h>
 #include "clangprivateexport.h"
 
+#include <QByteArrayView>
+
 class ClangParsingEnvironmentFileData;
 
 class KDEVCLANGPRIVATE_EXPORT ClangParsingEnvironmentFile : public KDevelop::ParsingEnvironmentFile
@@ -24,6 +26,11 @@ public:
     ~ClangParsingEnvironmentFile() override;
 
     bool needsUpdate(const KDevelop::ParsingEnvironment* environment = nullptr) const override;
+
+    /**
+     * @return whether this file has to be parsed again in @p environment, regardless of its contents
+     */
+    bool environmentRequiresUpdate(const ClangParsingEnvironment& environment) const;
     int type() const override;
 
     bool matchEnvironment(const KDevelop::ParsingEnvironment* environment) const override;
@@ -34,6 +41,17 @@ public:
 
     uint environmentHash() const;
 
+    /**
+     * Sets the hash of the contents this file was parsed from, see hashContents().
+     *
+     * This allows reusing the context when the modification time of the file changes but its contents do not,
+     * which happens e.g. when switching branches back and forth. 0 means unknown.
+     */
+    void setContentHash(quint64 hash);
+    quint64 contentHash() const;
+
+    static quint64 hashContents(QByteArrayView contents);
+
     enum {
         Identity = 142
     };
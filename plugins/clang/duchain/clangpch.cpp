@@ -8,6 +8,10 @@
 
 #include <language/duchain/duchain.h>
 
+#include <QFileInfo>
+
+#include <algorithm>
+
 #include "clanghelpers.h"
 #include "util/clangtypes.h"
 #include "clangparsingenvironment.h"
@@ -24,7 +28,7 @@ inline CXFile mapFile(CXFile file, CXTranslationUnit tu)
 
 }
 
-ClangPCH::ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index)
+ClangPCH::ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index, Kind kind)
     : m_session({})
 {
     const auto& pchInclude = environment.pchInclude();
@@ -33,7 +37,8 @@ ClangPCH::ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index
     const TopDUContext::Features pchFeatures = TopDUContext::AllDeclarationsContextsUsesAndAST;
     const IndexedString doc(pchInclude.pathOrUrl());
 
-    ClangParsingEnvironment pchEnv;
+    // a shared preamble replaces the leading includes of translation units, so it must see their include paths and defines
+    ClangParsingEnvironment pchEnv = kind == SharedPreamble ? environment : ClangParsingEnvironment();
     pchEnv.setPchInclude(Path());
     pchEnv.setTranslationUnitUrl(doc);
     m_session.setData(ParseSessionData::Ptr(new ParseSessionData({}, index, pchEnv, ParseSessionData::PrecompiledHeader)));
@@ -44,6 +49,37 @@ ClangPCH::ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index
 
     auto imports = ClangHelpers::tuImports(m_session.unit());
     m_context = ClangHelpers::buildDUChain(m_session.mainFile(), imports, m_session, pchFeatures, m_includes, {}, {});
+
+    m_dependencies.reserve(m_includes.size() + 1);
+    const auto addDependency = [this](CXFile file) {
+        m_dependencies.append({ClangString(clang_getFileName(file)).toString(), qint64(clang_getFileTime(file))});
+    };
+    addDependency(m_session.mainFile());
+    for (auto it = m_includes.constBegin(); it != m_includes.constEnd(); ++it) {
+        addDependency(it.key());
+    }
+}
+
+bool ClangPCH::isUpToDate() const
+{
+    return std::all_of(m_dependencies.cbegin(), m_dependencies.cend(), [](const QPair<QString, qint64>& dependency) {
+        const QFileInfo info(dependency.first);
+        return info.exists() && info.lastModified().toSecsSinceEpoch() == dependency.second;
+    });
+}
+
+qint64 ClangPCH::memoryUsage() const
+{
+    if (!m_session.unit()) {
+        return 0;
+    }
+    qint64 ret = 0;
+    const auto usage = clang_getCXTUResourceUsage(m_session.unit());
+    for (unsigned i = 0; i < usage.numEntries; ++i) {
+        ret += usage.entries[i].amount;
+    }
+    clang_disposeCXTUResourceUsage(usage);
+    return ret;
 }
 
 IncludeFileContexts ClangPCH::mapIncludes(CXTranslationUnit tu) const
@@ -18,7 +18,12 @@ class ClangParsingEnvironment;
 class KDEVCLANGPRIVATE_EXPORT ClangPCH
 {
 public:
-    ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index);
+    enum Kind {
+        UserDefined, ///< A header configured by the user, it is parsed without the environment of the translation unit
+        SharedPreamble ///< A preamble shared by several translation units, it is parsed with their environment
+    };
+
+    ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index, Kind kind = UserDefined);
 
     IncludeFileContexts mapIncludes(CXTranslationUnit tu) const;
 
@@ -26,10 +31,18 @@ public:
 
     KDevelop::ReferencedTopDUContext context() const;
 
+    /// @return whether none of the files included by the PCH has been modified since it was built
+    bool isUpToDate() const;
+
+    /// @return the count of bytes of memory held by the translation unit of the PCH
+    qint64 memoryUsage() const;
+
 private:
     Q_DISABLE_COPY(ClangPCH)
 
     IncludeFileContexts m_includes;
+    /// The files the PCH consists of and their modification times when it was built
+    QVector<QPair<QString, qint64>> m_dependencies;
     KDevelop::ReferencedTopDUContext m_context;
     ParseSession m_session;
 };
@@ -0,0 +1,448 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "clangpreamblecache.h"
+
+#include "clangparsingenvironment.h"
+#include "clangpch.h"
+
+#include <util/clangdebug.h>
+
+#include <language/backgroundparser/urlparselock.h>
+#include <serialization/indexedstring.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace KDevelop;
+
+namespace {
+
+/// Sharing fewer includes does not pay off the cost of building and loading a separate PCH
+constexpr int MinimumIncludeCount = 3;
+
+QString pchPath(const QString& headerPath)
+{
+    return headerPath + QLatin1String(".pch");
+}
+
+/// @return whether the translation unit at @p path is parsed in a language that a PCH header can share
+bool isSupportedTranslationUnit(const QString& path)
+{
+    // these are parsed with a language option that the preamble header would not get, see argsForSession()
+    const auto suffix = QFileInfo(path).suffix().toLower();
+    return suffix != QLatin1String("cu") && suffix != QLatin1String("cl") && suffix != QLatin1String("m")
+        && suffix != QLatin1String("mm");
+}
+
+/// Removes the comments from @p line, which continues a block comment if @p inBlockComment is set
+QByteArray stripComments(QByteArrayView line, bool* inBlockComment)
+{
+    QByteArray ret;
+    qsizetype pos = 0;
+    while (pos < line.size()) {
+        if (*inBlockComment) {
+            const auto end = line.indexOf("*/", pos);
+            if (end == -1) {
+                return ret;
+            }
+            *inBlockComment = false;
+            pos = end + 2;
+            ret += ' ';
+            continue;
+        }
+        const auto lineComment = line.indexOf("//", pos);
+        const auto blockComment = line.indexOf("/*", pos);
+        if (blockComment != -1 && (lineComment == -1 || blockComment < lineComment)) {
+            ret.append(line.sliced(pos, blockComment - pos));
+            *inBlockComment = true;
+            pos = blockComment + 2;
+        } else {
+            ret.append(line.sliced(pos, (lineComment == -1 ? line.size() : lineComment) - pos));
+            return ret;
+        }
+    }
+    return ret;
+}
+
+/// @return whether the header at @p path starts with an include guard or #pragma once
+bool hasIncludeGuard(const QString& path)
+{
+    // the headers of a project are checked for every translation unit that includes them
+    static QMutex mutex;
+    static QHash<QString, QPair<QDateTime, bool>> cache;
+    const QFileInfo info(path);
+    const auto lastModified = info.lastModified();
+    {
+        QMutexLocker lock(&mutex);
+        const auto it = cache.constFind(path);
+        if (it != cache.constEnd() && it->first == lastModified) {
+            return it->second;
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    bool guarded = false;
+    bool inBlockComment = false;
+    QByteArray guardMacro;
+    while (!file.atEnd()) {
+        const auto line = stripComments(file.readLine(), &inBlockComment).trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        if (!line.startsWith('#')) {
+            break;
+        }
+
+        const auto directive = line.sliced(1).trimmed();
+        if (!guardMacro.isEmpty()) {
+            // the #ifndef must be followed by the #define of its macro
+            guarded = directive.startsWith("define") && directive.sliced(6).trimmed() == guardMacro;
+            break;
+        }
+        if (directive.startsWith("pragma") && directive.sliced(6).trimmed() == "once") {
+            guarded = true;
+            break;
+        }
+        if (directive.startsWith("ifndef")) {
+            guardMacro = directive.sliced(6).trimmed();
+        } else if (directive.startsWith("if")) {
+            auto condition = directive.sliced(2).trimmed();
+            if (condition.startsWith('!')) {
+                condition = condition.sliced(1).trimmed();
+                if (condition.startsWith("defined")) {
+                    condition = condition.sliced(7).trimmed();
+                    if (condition.startsWith('(') && condition.endsWith(')')) {
+                        condition = condition.sliced(1, condition.size() - 2).trimmed();
+                    }
+                    guardMacro = condition;
+                }
+            }
+        }
+        if (guardMacro.isEmpty()) {
+            break;
+        }
+    }
+
+    QMutexLocker lock(&mutex);
+    cache.insert(path, {lastModified, guarded});
+    return guarded;
+}
+
+/// @return the path of the header @p fileName is included as, or an empty string if it is not found
+QString resolveInclude(const QString& fileName, bool quoted, const QDir& directory, const Path::List& includePaths)
+{
+    if (quoted && QFileInfo::exists(directory.filePath(fileName))) {
+        return QFileInfo(directory.filePath(fileName)).absoluteFilePath();
+    }
+    for (const auto& includePath : includePaths) {
+        const auto path = includePath.toLocalFile() + QLatin1Char('/') + fileName;
+        if (QFileInfo::exists(path)) {
+            return path;
+        }
+    }
+    return {};
+}
+
+QByteArray preambleKey(const ClangParsingEnvironment& environment, const QByteArray& block)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const auto addData = [&hash](const QByteArray& data) {
+        hash.addData(data);
+        hash.addData(QByteArrayView("\0", 1));
+    };
+    const auto addPaths = [&addData](const Path::List& paths) {
+        for (const auto& path : paths) {
+            addData(path.toLocalFile().toUtf8());
+        }
+        addData({});
+    };
+
+    addData(block);
+    addData(environment.parserSettings().parserOptions.toUtf8());
+    const auto includes = environment.includes();
+    addPaths(includes.system);
+    addPaths(includes.project);
+    const auto frameworkDirectories = environment.frameworkDirectories();
+    addPaths(frameworkDirectories.system);
+    addPaths(frameworkDirectories.project);
+    const auto defines = environment.defines();
+    for (auto it = defines.constBegin(); it != defines.constEnd(); ++it) {
+        addData(it.key().toUtf8());
+        addData(it.value().toUtf8());
+    }
+    addData(environment.workingDirectory().toLocalFile().toUtf8());
+    addData(QFileInfo(environment.translationUnitUrl().str()).suffix().toUtf8());
+    return hash.result().toHex();
+}
+}
+
+ClangPreambleCache::ClangPreambleCache(const QString& storageDirectory)
+    : m_storageDirectory(storageDirectory)
+{
+}
+
+ClangPreambleCache::~ClangPreambleCache() = default;
+
+void ClangPreambleCache::setBudgets(qint64 memoryBudget, qint64 diskBudget)
+{
+    QMutexLocker lock(&m_mutex);
+    m_memoryBudget = memoryBudget;
+    m_diskBudget = diskBudget;
+}
+
+qint64 ClangPreambleCache::memoryUsage() const
+{
+    QMutexLocker lock(&m_mutex);
+    qint64 ret = 0;
+    for (const auto& entry : m_entries) {
+        ret += entry.memoryUsage;
+    }
+    return ret;
+}
+
+void ClangPreambleCache::releaseMemory(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    qint64 usage = 0;
+    for (const auto& entry : std::as_const(m_entries)) {
+        usage += entry.memoryUsage;
+    }
+    enforceBudgets({}, std::max<qint64>(usage - bytes, 0));
+}
+
+QByteArray ClangPreambleCache::leadingIncludeBlock(const QByteArray& contents, const QString& translationUnitPath,
+                                                   const Path::List& includePaths, int* includeCount)
+{
+    const QFileInfo translationUnit(translationUnitPath);
+    const auto directory = translationUnit.dir();
+
+    QByteArray block;
+    qsizetype blockEnd = 0;
+    int includes = 0;
+    bool inBlockComment = false;
+
+    qsizetype lineStart = 0;
+    while (lineStart < contents.size()) {
+        auto lineEnd = contents.indexOf('\n', lineStart);
+        if (lineEnd == -1) {
+            lineEnd = contents.size();
+        }
+        const auto line = stripComments(QByteArrayView(contents).sliced(lineStart, lineEnd - lineStart), &inBlockComment)
+                              .trimmed();
+        lineStart = lineEnd + 1;
+
+        if (line.isEmpty()) {
+            continue;
+        }
+        if (!line.startsWith('#') || line.endsWith('\\')) {
+            break;
+        }
+
+        const auto directive = line.sliced(1).trimmed();
+        if (directive.startsWith("define") || directive.startsWith("undef")) {
+            block += line + '\n';
+            continue;
+        }
+        if (!directive.startsWith("include")) {
+            break;
+        }
+
+        const auto spec = directive.sliced(7).trimmed();
+        const char close = spec.startsWith('<') ? '>' : spec.startsWith('"') ? '"' : 0;
+        const auto specEnd = close ? spec.indexOf(close, 1) : -1;
+        if (specEnd == -1) {
+            // a macro include or something unexpected
+            break;
+        }
+        const auto fileName = QString::fromUtf8(spec.sliced(1, specEnd - 1));
+
+        // the own header differs for each translation unit, and leaving it out would move the following
+        // includes in front of it
+        if (close == '"' && QFileInfo(fileName).completeBaseName() == translationUnit.completeBaseName()) {
+            break;
+        }
+
+        // the translation unit includes the header again after the preamble, which only works with a guard
+        const auto path = resolveInclude(fileName, close == '"', directory, includePaths);
+        if (path.isEmpty() || !hasIncludeGuard(path)) {
+            break;
+        }
+
+        if (close == '"' && QFileInfo::exists(directory.filePath(fileName))) {
+            block += "#include \"" + path.toUtf8() + "\"\n";
+        } else {
+            block += "#include " + spec.left(specEnd + 1) + '\n';
+        }
+        blockEnd = block.size();
+        ++includes;
+    }
+
+    if (includeCount) {
+        *includeCount = includes;
+    }
+    block.truncate(blockEnd);
+    return block;
+}
+
+QString ClangPreambleCache::headerPath(const QByteArray& key) const
+{
+    return m_storageDirectory + QLatin1Char('/') + QString::fromLatin1(key) + QLatin1String(".h");
+}
+
+bool ClangPreambleCache::isPreambleInclude(const Path& pchInclude) const
+{
+    return pchInclude.isValid() && pchInclude.parent() == Path(m_storageDirectory);
+}
+
+Path ClangPreambleCache::preambleInclude(const ClangParsingEnvironment& environment, const QByteArray& contents)
+{
+    const auto translationUnitPath = environment.translationUnitUrl().str();
+    if (!isSupportedTranslationUnit(translationUnitPath)) {
+        return {};
+    }
+
+    int includeCount = 0;
+    const auto includePaths = environment.includes();
+    const auto block =
+        leadingIncludeBlock(contents, translationUnitPath, includePaths.project + includePaths.system, &includeCount);
+    if (includeCount < MinimumIncludeCount) {
+        return {};
+    }
+
+    const auto key = preambleKey(environment, block);
+    const auto path = headerPath(key);
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_failedKeys.contains(key)) {
+            return {};
+        }
+        if (m_entries.contains(key)) {
+            return Path(path);
+        }
+    }
+
+    // the name of the header is a hash of its contents, so an existing header is up to date
+    if (!QFile::exists(path)) {
+        QDir().mkpath(m_storageDirectory);
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(KDEV_CLANG) << "cannot write shared preamble" << path << file.errorString();
+            return {};
+        }
+        file.write(block);
+        if (!file.commit()) {
+            qCWarning(KDEV_CLANG) << "cannot write shared preamble" << path << file.errorString();
+            return {};
+        }
+    }
+    return Path(path);
+}
+
+QSharedPointer<const ClangPCH> ClangPreambleCache::pch(const ClangParsingEnvironment& environment, ClangIndex* index)
+{
+    const auto& pchInclude = environment.pchInclude();
+    Q_ASSERT(isPreambleInclude(pchInclude));
+    const auto header = pchInclude.toLocalFile();
+    auto key = pchInclude.lastPathSegment().toLatin1();
+    key.chop(2); // ".h"
+
+    UrlParseLock pchLock(IndexedString(pchInclude.pathOrUrl()));
+
+    QSharedPointer<const ClangPCH> cached;
+    {
+        QMutexLocker lock(&m_mutex);
+        const auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            cached = it->pch;
+            it->lastUse = QDateTime::currentMSecsSinceEpoch();
+        }
+    }
+    if (cached && cached->isUpToDate() && QFile::exists(pchPath(header))) {
+        return cached;
+    }
+
+    clangDebug() << "building shared preamble" << header << "for" << environment.translationUnitUrl();
+    QSharedPointer<const ClangPCH> pch(new ClangPCH(environment, index, ClangPCH::SharedPreamble));
+
+    QMutexLocker lock(&m_mutex);
+    if (!pch->context() || !QFile::exists(pchPath(header))) {
+        clangDebug() << "cannot build shared preamble" << header;
+        m_failedKeys.insert(key);
+        m_entries.remove(key);
+        return {};
+    }
+
+    Entry entry;
+    entry.pch = pch;
+    entry.memoryUsage = pch->memoryUsage();
+    entry.diskUsage = QFileInfo(pchPath(header)).size();
+    entry.lastUse = QDateTime::currentMSecsSinceEpoch();
+    m_entries.insert(key, entry);
+    enforceBudgets(key, m_memoryBudget);
+    return pch;
+}
+
+void ClangPreambleCache::removeFiles(const QByteArray& key) const
+{
+    // the tiny header stays, a translation unit that is about to use it then parses it without the PCH
+    QFile::remove(pchPath(headerPath(key)));
+}
+
+void ClangPreambleCache::enforceBudgets(const QByteArray& keep, qint64 memoryBudget)
+{
+    qint64 memoryUsage = 0;
+    qint64 diskUsage = 0;
+    std::vector<std::pair<qint64, QByteArray>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(), end = m_entries.cend(); it != end; ++it) {
+        memoryUsage += it->memoryUsage;
+        diskUsage += it->diskUsage;
+        if (it.key() != keep) {
+            byAge.emplace_back(it->lastUse, it.key());
+        }
+    }
+    std::sort(byAge.begin(), byAge.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    // first only release the parsed preambles, their PCH files still speed up the translation units
+    for (const auto& aged : byAge) {
+        if (memoryUsage <= memoryBudget) {
+            break;
+        }
+        auto& entry = m_entries[aged.second];
+        if (entry.pch) {
+            memoryUsage -= entry.memoryUsage;
+            entry.pch.reset();
+            entry.memoryUsage = 0;
+        }
+    }
+
+    for (const auto& aged : byAge) {
+        if (diskUsage <= m_diskBudget) {
+            break;
+        }
+        const auto it = m_entries.find(aged.second);
+        diskUsage -= it->diskUsage;
+        removeFiles(aged.second);
+        m_entries.erase(it);
+    }
+}
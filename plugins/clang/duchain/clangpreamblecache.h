@@ -0,0 +1,119 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef CLANGPREAMBLECACHE_H
+#define CLANGPREAMBLECACHE_H
+
+#include "clangprivateexport.h"
+
+#include <util/path.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+
+class ClangIndex;
+class ClangParsingEnvironment;
+class ClangPCH;
+
+/**
+ * Shares precompiled preambles between translation units.
+ *
+ * Most source files of a project start with a block of includes that many other files of the project share,
+ * and parsing these headers dominates the time needed to parse the file. This cache writes the leading include
+ * block of a translation unit into a header named after a hash of the block and of everything that influences
+ * how it is parsed: the parser arguments, include paths, defines and working directory. Translation units with
+ * equal hashes then use the same header as their PCH include and share a single precompiled version of it.
+ * The translation unit still includes these headers itself, which is cheap as their include guards are defined
+ * by then.
+ *
+ * The precompiled preambles are kept in memory and on disk within the given budgets; the least recently used
+ * ones are dropped first.
+ *
+ * This class is thread safe.
+ */
+class KDEVCLANGPRIVATE_EXPORT ClangPreambleCache
+{
+public:
+    /// @param storageDirectory the directory the preamble headers and their precompiled versions are written to
+    explicit ClangPreambleCache(const QString& storageDirectory);
+    ~ClangPreambleCache();
+
+    Q_DISABLE_COPY_MOVE(ClangPreambleCache)
+
+    /// Sets the memory and disk space the cached preambles may occupy, in bytes.
+    void setBudgets(qint64 memoryBudget, qint64 diskBudget);
+
+    /// @return the memory taken by the precompiled preambles that are loaded, in bytes
+    qint64 memoryUsage() const;
+
+    /// Drops the least recently used precompiled preambles from memory until about @p bytes are released.
+    /// Their files are kept, so they are loaded again quickly when needed.
+    void releaseMemory(qint64 bytes);
+
+    /**
+     * @return the shared preamble header for a translation unit parsed in @p environment that starts with
+     *         @p contents, or an invalid path if it has no shareable preamble
+     *
+     * The header is written to the storage directory if it does not exist yet.
+     */
+    KDevelop::Path preambleInclude(const ClangParsingEnvironment& environment, const QByteArray& contents);
+
+    /// @return whether @p pchInclude was returned by preambleInclude()
+    bool isPreambleInclude(const KDevelop::Path& pchInclude) const;
+
+    /**
+     * @return the precompiled preamble for the PCH include of @p environment, which must have been returned by
+     *         preambleInclude()
+     *
+     * The preamble is built if it is not cached or one of its headers has been modified. A null pointer is
+     * returned if it cannot be built, and the preamble is not offered by preambleInclude() anymore.
+     */
+    QSharedPointer<const ClangPCH> pch(const ClangParsingEnvironment& environment, ClangIndex* index);
+
+    /**
+     * @return the block of leading includes of @p contents, which is the beginning of the file at
+     *         @p translationUnitPath, suitable for a header in a different directory
+     *
+     * Comments, blank lines and single-line defines and undefines are skipped, the block ends before the first
+     * other directive or code. It also ends before the own header of the translation unit, which differs for
+     * each translation unit, and before any header that is not found in @p includePaths or has no include
+     * guard, as the translation unit includes the headers of the block a second time. Quoted includes are
+     * rewritten to absolute paths if they are found next to the translation unit. The returned block ends with
+     * the last include.
+     *
+     * @param includeCount set to the count of includes in the returned block
+     */
+    static QByteArray leadingIncludeBlock(const QByteArray& contents, const QString& translationUnitPath,
+                                          const KDevelop::Path::List& includePaths, int* includeCount = nullptr);
+
+private:
+    struct Entry
+    {
+        QSharedPointer<const ClangPCH> pch;
+        qint64 memoryUsage = 0;
+        qint64 diskUsage = 0;
+        qint64 lastUse = 0;
+    };
+
+    QString headerPath(const QByteArray& key) const;
+    void removeFiles(const QByteArray& key) const;
+    /// Drops the least recently used preambles except @p keep until @p memoryBudget and the disk budget are met.
+    void enforceBudgets(const QByteArray& keep, qint64 memoryBudget);
+
+    const QString m_storageDirectory;
+    mutable QMutex m_mutex;
+    qint64 m_memoryBudget = 0;
+    qint64 m_diskBudget = 0;
+    QHash<QByteArray, Entry> m_entries;
+    /// The keys of the preambles that failed to build
+    QSet<QByteArray> m_failedKeys;
+};
+
+#endif // CLANGPREAMBLECACHE_H
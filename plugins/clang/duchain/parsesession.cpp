@@ -24,12 +24,16 @@
 
 #include <KShell>
 
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
 #include <QMimeDatabase>
 #include <QMimeType>
+#include <QSet>
 
 #include <algorithm>
+#include <vector>
 
 using namespace KDevelop;
 
@@ -227,6 +231,36 @@ bool hasQtIncludes(const Path::List& includePaths)
     }) != includePaths.end();
 }
 
+/// Sessions that are not used for this long may be dropped under memory pressure
+const qint64 maxIdleTime = 60 * 1000;
+
+struct SessionRegistry
+{
+    QMutex mutex;
+    QSet<ParseSessionData*> sessions;
+};
+
+SessionRegistry& sessionRegistry()
+{
+    static SessionRegistry registry;
+    return registry;
+}
+
+qint64 translationUnitMemoryUsage(CXTranslationUnit unit)
+{
+    if (!unit) {
+        return 0;
+    }
+
+    const CXTUResourceUsage usage = clang_getCXTUResourceUsage(unit);
+    qint64 ret = 0;
+    for (unsigned int i = 0; i < usage.numEntries; ++i) {
+        ret += usage.entries[i].amount;
+    }
+    clang_disposeCXTUResourceUsage(usage);
+    return ret;
+}
+
 }
 
 ParseSessionData::ParseSessionData(const QVector<UnsavedFile>& unsavedFiles, ClangIndex* index,
@@ -375,13 +409,96 @@ ParseSessionData::ParseSessionData(const QVector<UnsavedFile>& unsavedFiles, Cla
     } else {
         qCWarning(KDEV_CLANG) << "Failed to parse translation unit:" << tuUrl;
     }
+
+    m_lastUse = QDateTime::currentMSecsSinceEpoch();
+    auto& registry = sessionRegistry();
+    QMutexLocker lock(&registry.mutex);
+    registry.sessions.insert(this);
 }
 
 ParseSessionData::~ParseSessionData()
 {
+    {
+        auto& registry = sessionRegistry();
+        QMutexLocker lock(&registry.mutex);
+        registry.sessions.remove(this);
+    }
+
     clang_disposeTranslationUnit(m_unit);
 }
 
+qint64 ParseSessionData::memoryUsage()
+{
+    auto& registry = sessionRegistry();
+    QMutexLocker lock(&registry.mutex);
+    qint64 ret = 0;
+    for (const auto* session : std::as_const(registry.sessions)) {
+        ret += session->m_memoryUsage.load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+void ParseSessionData::releaseIdleSessions(qint64 bytes)
+{
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    auto& registry = sessionRegistry();
+
+    struct IdleSession
+    {
+        qint64 lastUse;
+        qint64 memoryUsage;
+        ParseSessionData* session;
+    };
+    std::vector<IdleSession> idleSessions;
+    {
+        QMutexLocker lock(&registry.mutex);
+        for (auto* session : std::as_const(registry.sessions)) {
+            const auto lastUse = session->m_lastUse.load(std::memory_order_relaxed);
+            if (now - lastUse >= maxIdleTime) {
+                idleSessions.push_back({lastUse, session->m_memoryUsage.load(std::memory_order_relaxed), session});
+            }
+        }
+    }
+    std::sort(idleSessions.begin(), idleSessions.end(), [](const IdleSession& lhs, const IdleSession& rhs) {
+        return lhs.lastUse < rhs.lastUse;
+    });
+
+    // the sessions may be gone once the registry is unlocked, so only their addresses are kept
+    QHash<const IAstContainer*, ParseSessionData*> release;
+    for (const auto& idleSession : idleSessions) {
+        if (bytes <= 0) {
+            break;
+        }
+        bytes -= idleSession.memoryUsage;
+        release.insert(idleSession.session, idleSession.session);
+    }
+    if (release.isEmpty()) {
+        return;
+    }
+
+    int released = 0;
+    DUChainWriteLocker lock;
+    const auto chains = DUChain::self()->allChains();
+    for (auto* top : chains) {
+        auto* session = release.value(top->ast().data());
+        if (!session) {
+            continue;
+        }
+        {
+            // the address may have been reused by a session created meanwhile
+            QMutexLocker registryLock(&registry.mutex);
+            if (!registry.sessions.contains(session)
+                || now - session->m_lastUse.load(std::memory_order_relaxed) < maxIdleTime) {
+                continue;
+            }
+        }
+        // this may destroy the session, which takes the registry lock
+        top->clearAst();
+        ++released;
+    }
+    clangDebug() << "dropped" << released << "idle parse sessions";
+}
+
 QByteArray ParseSessionData::writeDefinesFile(const QMap<QString, QString>& defines)
 {
     m_definesFile.open();
@@ -431,6 +548,7 @@ QByteArray ParseSessionData::writeDefinesFile(const QMap<QString, QString>& defi
 void ParseSessionData::setUnit(CXTranslationUnit unit)
 {
     m_unit = unit;
+    m_memoryUsage.store(translationUnitMemoryUsage(m_unit), std::memory_order_relaxed);
     m_diagnosticsCache.clear();
     if (m_unit) {
         const ClangString unitFile(clang_getTranslationUnitSpelling(unit));
@@ -451,6 +569,7 @@ ParseSession::ParseSession(const ParseSessionData::Ptr& data)
     if (d) {
         ENSURE_CHAIN_NOT_LOCKED
         d->m_mutex.lock();
+        d->m_lastUse.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
     }
 }
 
@@ -476,6 +595,7 @@ void ParseSession::setData(const ParseSessionData::Ptr& data)
     if (d) {
         ENSURE_CHAIN_NOT_LOCKED
         d->m_mutex.lock();
+        d->m_lastUse.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
     }
 }
 
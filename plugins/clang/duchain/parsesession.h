@@ -11,6 +11,8 @@
 #include <QList>
 #include <QTemporaryFile>
 
+#include <atomic>
+
 #include <clang-c/Index.h>
 
 #include <serialization/indexedstring.h>
@@ -52,12 +54,29 @@ public:
 
     ClangParsingEnvironment environment() const;
 
+    /**
+     * @return the memory libclang uses for the translation units of all sessions, as of their last (re)parse
+     */
+    static qint64 memoryUsage();
+
+    /**
+     * Detaches the least recently used sessions that have been idle for a minute from the top-contexts
+     * holding them, until about @p bytes are released.
+     *
+     * The translation unit is parsed from scratch when the document is parsed again.
+     * The DUChain must not be locked.
+     */
+    static void releaseIdleSessions(qint64 bytes);
+
 private:
     friend class ParseSession;
     void setUnit(CXTranslationUnit unit);
     QByteArray writeDefinesFile(const QMap<QString, QString>& defines);
 
     QMutex m_mutex;
+    std::atomic<qint64> m_memoryUsage = 0;
+    /// When a ParseSession last used this, in ms since the epoch
+    std::atomic<qint64> m_lastUse = 0;
 
     CXFile m_file = nullptr;
     CXTranslationUnit m_unit = nullptr;
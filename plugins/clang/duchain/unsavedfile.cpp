@@ -38,3 +38,13 @@ void UnsavedFile::convertToUtf8()
         m_contentsUtf8 += line.toUtf8() + '\n';
     }
 }
+
+QString UnsavedFile::fileName() const
+{
+    return m_fileName;
+}
+
+QStringList UnsavedFile::contents() const
+{
+    return m_contents;
+}
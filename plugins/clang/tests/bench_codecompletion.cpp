@@ -6,10 +6,12 @@
 
 #include "bench_codecompletion.h"
 
+#include <QElapsedTimer>
 #include <QTest>
 #include <QSignalSpy>
 
 #include <KTextEditor/Cursor>
+#include <KTextEditor/Document>
 
 #include <tests/testfile.h>
 
@@ -82,4 +84,73 @@ void BenchCodeCompletion::benchCodeCompletion()
     }
 }
 
+void BenchCodeCompletion::benchKeystrokes_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<KTextEditor::Cursor>("position");
+    QTest::addColumn<QString>("typed");
+
+    QTest::newRow("member") << R"(
+    #include <string>
+
+    int main()
+    {
+        std::string s;
+        s.
+    }
+    )" << KTextEditor::Cursor(6, 10) << "find_last";
+
+    QTest::newRow("scope") << R"(
+    #include <vector>
+    #include <unordered_map>
+
+    int main()
+    {
+        std::
+    }
+    )" << KTextEditor::Cursor(6, 13) << "unordered";
+}
+
+void BenchCodeCompletion::benchKeystrokes()
+{
+    QFETCH(QString, code);
+    QFETCH(KTextEditor::Cursor, position);
+    QFETCH(QString, typed);
+
+    TestFile file(code, "cpp");
+    QVERIFY(file.parseAndWait(TopDUContext::AllDeclarationsContextsUsesAndAST, 1, 5000));
+
+    auto view = createView(file.url().toUrl());
+    auto* document = view->document();
+
+    QSignalSpy spy(m_model, &QAbstractItemModel::modelReset);
+    const auto complete = [&](const KTextEditor::Cursor& cursor) {
+        spy.clear();
+        m_model->completionInvoked(view.get(), {position, cursor}, KTextEditor::CodeCompletionModel::UserInvocation);
+        while (spy.isEmpty()) {
+            QVERIFY(spy.wait());
+        }
+    };
+
+    // the first completion after the member access or scope operator, later keystrokes only narrow it down
+    complete(position);
+
+    const int rounds = 5;
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < typed.size(); ++i) {
+            const KTextEditor::Cursor cursor(position.line(), position.column() + i);
+            document->insertText(cursor, typed.at(i));
+            timer.start();
+            complete({cursor.line(), cursor.column() + 1});
+            elapsed += timer.nsecsElapsed();
+            QVERIFY(m_model->rowCount());
+        }
+        document->removeText({position, KTextEditor::Cursor(position.line(), position.column() + typed.size())});
+    }
+
+    QTest::setBenchmarkResult(elapsed / 1000000.0 / (rounds * typed.size()), QTest::WalltimeMilliseconds);
+}
+
 #include "moc_bench_codecompletion.cpp"
@@ -23,6 +23,8 @@ public:
 private Q_SLOTS:
     void benchCodeCompletion_data();
     void benchCodeCompletion();
+    void benchKeystrokes_data();
+    void benchKeystrokes();
 
 private:
     QScopedPointer<ClangIndex> m_index;
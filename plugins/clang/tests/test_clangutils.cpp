@@ -9,6 +9,7 @@
 #include "../util/clangutils.h"
 #include "../util/clangtypes.h"
 #include "../util/clangdebug.h"
+#include "../duchain/clangpreamblecache.h"
 
 #include <language/editor/documentrange.h>
 #include <tests/testcore.h>
@@ -17,6 +18,8 @@
 
 #include <clang-c/Index.h>
 
+#include <QFileInfo>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 
 #include <QDebug>
@@ -305,4 +308,103 @@ void TestClangUtils::testGetCursorSignature_data()
         << "bool klass::operator<(const T&)";
 }
 
+void TestClangUtils::testLeadingIncludeBlock()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QByteArray, expectedBlock);
+    QFETCH(int, expectedIncludeCount);
+
+    QTemporaryDir includeDir;
+    QVERIFY(includeDir.isValid());
+    const auto writeHeader = [&includeDir](const QString& fileName, const QByteArray& contents) {
+        QFile header(includeDir.filePath(fileName));
+        QVERIFY(header.open(QIODevice::WriteOnly));
+        header.write(contents);
+    };
+    for (const auto name : {'a', 'b', 'c', 'd'}) {
+        const QByteArray guard = QByteArray(1, name).toUpper() + "_H";
+        writeHeader(QString(QLatin1Char(name)) + QLatin1String(".h"),
+                    "/* license */\n#ifndef " + guard + "\n#define " + guard + "\nint " + name + ";\n#endif\n");
+    }
+    writeHeader(QStringLiteral("once.h"), "// license\n#pragma once\nint once;\n");
+    writeHeader(QStringLiteral("defined.h"), "#if !defined(DEFINED_H)\n#define DEFINED_H\n#endif\n");
+    writeHeader(QStringLiteral("unguarded.h"), "#define UNGUARDED\nint unguarded;\n");
+    writeHeader(QStringLiteral("wrongguard.h"), "#ifndef WRONG_H\n#define OTHER_H\n#endif\n");
+
+    int includeCount = -1;
+    const auto block = ClangPreambleCache::leadingIncludeBlock(contents, QStringLiteral("/nonexistent/foo.cpp"),
+                                                               {Path(includeDir.path())}, &includeCount);
+    QCOMPARE(block, expectedBlock);
+    QCOMPARE(includeCount, expectedIncludeCount);
+}
+
+void TestClangUtils::testLeadingIncludeBlock_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QByteArray>("expectedBlock");
+    QTest::addColumn<int>("expectedIncludeCount");
+
+    QTest::newRow("includes")
+        << QByteArray("#include <a.h>\n#include <b.h>\n#include \"c.h\"\nint x;\n#include <d.h>\n")
+        << QByteArray("#include <a.h>\n#include <b.h>\n#include \"c.h\"\n") << 3;
+    QTest::newRow("comments")
+        << QByteArray("// license\n/* multi\n   line */\n#include <a.h> // why\n\n#  include /* x */ <b.h>\n")
+        << QByteArray("#include <a.h>\n#include <b.h>\n") << 2;
+    QTest::newRow("own-header-first")
+        << QByteArray("#include \"foo.h\"\n#include <a.h>\n#include <b.h>\n")
+        << QByteArray() << 0;
+    QTest::newRow("own-header-later")
+        << QByteArray("#include <a.h>\n#include <b.h>\n#include \"foo.h\"\n#include <c.h>\n")
+        << QByteArray("#include <a.h>\n#include <b.h>\n") << 2;
+    QTest::newRow("guards")
+        << QByteArray("#include <once.h>\n#include <defined.h>\n#include <a.h>\n")
+        << QByteArray("#include <once.h>\n#include <defined.h>\n#include <a.h>\n") << 3;
+    QTest::newRow("unguarded")
+        << QByteArray("#include <a.h>\n#include <unguarded.h>\n#include <b.h>\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("wrong-guard")
+        << QByteArray("#include <a.h>\n#include <wrongguard.h>\n#include <b.h>\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("not-found")
+        << QByteArray("#include <a.h>\n#include <missing.h>\n#include <b.h>\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("defines")
+        << QByteArray("#define A 1\n#include <a.h>\n#undef B\n#define C\n")
+        << QByteArray("#define A 1\n#include <a.h>\n") << 1;
+    QTest::newRow("conditional")
+        << QByteArray("#include <a.h>\n#ifdef X\n#include <b.h>\n#endif\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("macro-include")
+        << QByteArray("#include <a.h>\n#include MACRO\n#include <b.h>\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("multi-line-define")
+        << QByteArray("#include <a.h>\n#define A \\\n 1\n#include <b.h>\n")
+        << QByteArray("#include <a.h>\n") << 1;
+    QTest::newRow("code-first")
+        << QByteArray("int x;\n#include <a.h>\n")
+        << QByteArray() << 0;
+}
+
+void TestClangUtils::testLeadingIncludeBlockQuotedPaths()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile header(dir.filePath(QStringLiteral("bar.h")));
+    QVERIFY(header.open(QIODevice::WriteOnly));
+    header.write("#pragma once\n");
+    header.close();
+    QTemporaryDir includeDir;
+    QVERIFY(includeDir.isValid());
+    QFile otherHeader(includeDir.filePath(QStringLiteral("other.h")));
+    QVERIFY(otherHeader.open(QIODevice::WriteOnly));
+    otherHeader.write("#pragma once\n");
+    otherHeader.close();
+
+    // quoted includes next to the translation unit are made absolute, the others are found in the include paths
+    const auto block = ClangPreambleCache::leadingIncludeBlock("#include \"bar.h\"\n#include \"other.h\"\n",
+                                                               dir.filePath(QStringLiteral("foo.cpp")),
+                                                               {Path(includeDir.path())});
+    QCOMPARE(block, "#include \"" + QFileInfo(header).absoluteFilePath().toUtf8() + "\"\n#include \"other.h\"\n");
+}
+
 #include "moc_test_clangutils.cpp"
@@ -26,6 +26,9 @@ private Q_SLOTS:
     void testRangeForIncludePathSpec();
     void testGetCursorSignature();
     void testGetCursorSignature_data();
+    void testLeadingIncludeBlock();
+    void testLeadingIncludeBlock_data();
+    void testLeadingIncludeBlockQuotedPaths();
 };
 
 #endif // TESTCLANGUTILS_H
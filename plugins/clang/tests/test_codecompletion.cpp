@@ -25,6 +25,7 @@
 #include <language/codecompletion/codecompletiontesthelper.h>
 #include <language/duchain/types/functiontype.h>
 
+#include "codecompletion/completioncache.h"
 #include "codecompletion/completionhelper.h"
 #include "codecompletion/context.h"
 #include "codecompletion/includepathcompletioncontext.h"
@@ -38,9 +39,11 @@
 
 #include <KConfigGroup>
 
+#include <QDateTime>
 #include <QVersionNumber>
 #include <QStandardPaths>
 
+#include <algorithm>
 #include <optional>
 
 // TODO: QTEST_MAIN_WRAPPER not part of public documented API
@@ -1596,6 +1599,86 @@ void TestCodeCompletion::testArgumentHintCompletionDefaultParameters()
     QCOMPARE(itemDisplay, QStringLiteral("f(int i, int j = 0, double k = 1)"));
 }
 
+void TestCodeCompletion::testFilterItems()
+{
+    TestFile file(QStringLiteral("int fooBar; int barFoo; int bazooka; void foo(int);\nint main() { foo( "),
+                  QStringLiteral("cpp"));
+    QVERIFY(file.parseAndWait(TopDUContext::AllDeclarationsContextsUsesAndAST));
+    DUChainReadLocker lock;
+    auto top = file.topContext();
+    QVERIFY(top);
+    const ParseSessionData::Ptr sessionData(dynamic_cast<ParseSessionData*>(top->ast().data()));
+    QVERIFY(sessionData);
+
+    lock.unlock();
+
+    const auto context = createContext(top, sessionData, {1, 18});
+    context->setFilters(NoMacroOrBuiltin);
+    lock.lock();
+    const auto tester = ClangCodeCompletionItemTester(context);
+
+    const auto names = [&tester](const QList<CompletionTreeItemPointer>& items) {
+        QStringList names;
+        for (const auto& item : items) {
+            if (item->argumentHintDepth() == 0) {
+                names << tester.itemData(item).toString();
+            }
+        }
+        return names;
+    };
+    const auto hintCount = [](const QList<CompletionTreeItemPointer>& items) {
+        return static_cast<int>(std::count_if(items.begin(), items.end(), [](const CompletionTreeItemPointer& item) {
+            return item->argumentHintDepth() > 0;
+        }));
+    };
+    QCOMPARE(hintCount(tester.items), 1);
+
+    // exact prefix matches first, then case-insensitive prefix, substring and subsequence matches
+    auto filtered = ClangCodeCompletionContext::filterItems(tester.items, QStringLiteral("bar"));
+    QCOMPARE(names(filtered), (QStringList{QStringLiteral("barFoo"), QStringLiteral("fooBar")}));
+    QCOMPARE(hintCount(filtered), 1);
+    QVERIFY(filtered.first()->argumentHintDepth() > 0);
+
+    filtered = ClangCodeCompletionContext::filterItems(tester.items, QStringLiteral("bzk"));
+    QCOMPARE(names(filtered), QStringList{QStringLiteral("bazooka")});
+    QCOMPARE(hintCount(filtered), 1);
+
+    // the argument hints are kept even when no name matches
+    filtered = ClangCodeCompletionContext::filterItems(tester.items, QStringLiteral("xyz"));
+    QVERIFY(names(filtered).isEmpty());
+    QCOMPARE(hintCount(filtered), 1);
+
+    QCOMPARE(ClangCodeCompletionContext::filterItems(tester.items, QString()).size(), tester.items.size());
+}
+
+void TestCodeCompletion::testCompletionCache()
+{
+    const auto url = QUrl::fromLocalFile(QStringLiteral("/foo.cpp"));
+    const KTextEditor::Cursor position(3, 4);
+    const ModificationRevision revision(QDateTime::fromSecsSinceEpoch(1000), 1);
+    const auto text = QStringLiteral("int main() { s.");
+
+    CompletionCache cache;
+    QVERIFY(!cache.matches(url, position, revision, text));
+
+    cache.valid = true;
+    cache.url = url;
+    cache.position = position;
+    cache.revision = revision;
+    cache.text = text;
+    QVERIFY(cache.matches(url, position, revision, text));
+
+    // typing after the position does not change the key, anything else does
+    QVERIFY(!cache.matches(QUrl::fromLocalFile(QStringLiteral("/bar.cpp")), position, revision, text));
+    QVERIFY(!cache.matches(url, {3, 5}, revision, text));
+    QVERIFY(!cache.matches(url, position, ModificationRevision(QDateTime::fromSecsSinceEpoch(1000), 2), text));
+    QVERIFY(!cache.matches(url, position, revision, text + QLatin1Char('x')));
+
+    QCOMPARE(typedPrefix(QStringLiteral("find_last(); }")), QStringLiteral("find_last"));
+    QCOMPARE(typedPrefix(QStringLiteral("x1 + 2")), QStringLiteral("x1"));
+    QCOMPARE(typedPrefix(QStringLiteral("); }")), QString());
+}
+
 void TestCodeCompletion::testCompleteFunction()
 {
     QFETCH(QString, code);
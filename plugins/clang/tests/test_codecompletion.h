@@ -45,6 +45,8 @@ private Q_SLOTS:
     void testOverloadedFunctions();
     void testVariableScope();
     void testArgumentHintCompletionDefaultParameters();
+    void testFilterItems();
+    void testCompletionCache();
 
     void testCompleteFunction_data();
     void testCompleteFunction();
@@ -31,6 +31,7 @@
 #include <language/duchain/use.h>
 #include <language/duchain/duchaindumper.h>
 #include <language/backgroundparser/backgroundparser.h>
+#include <language/editor/modificationrevision.h>
 #include <interfaces/ilanguagecontroller.h>
 #include <interfaces/idocumentcontroller.h>
 #include <util/kdevstringhandler.h>
@@ -490,6 +491,47 @@ void TestDUChain::testReparse()
     }
 }
 
+void TestDUChain::testReuseUnchangedContext()
+{
+    TestFile header(QStringLiteral("int foo() { return 42; }\n"), QStringLiteral("h"));
+    TestFile impl("#include \"" + header.url().str() + "\"\n"
+                  "int main() { return foo(); }", QStringLiteral("cpp"), &header);
+    QVERIFY(impl.parseAndWait(TopDUContext::AllDeclarationsContextsAndUses));
+
+    const auto touchHeader = [&header]() {
+        QFile file(header.url().str());
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        const auto modificationTime = file.fileTime(QFileDevice::FileModificationTime).addSecs(10);
+        QVERIFY(file.setFileTime(modificationTime, QFileDevice::FileModificationTime));
+        ModificationRevision::clearModificationCache(header.url());
+    };
+
+    QSignalSpy updateSpy(DUChain::self(), &DUChain::updateReady);
+
+    // a new modification time alone does not require parsing again
+    touchHeader();
+    {
+        DUChainReadLocker lock;
+        QVERIFY(impl.topContext()->parsingEnvironmentFile()->needsUpdate());
+    }
+    QVERIFY(impl.parseAndWait(TopDUContext::AllDeclarationsContextsAndUses));
+    QVERIFY(updateSpy.isEmpty());
+    {
+        DUChainReadLocker lock;
+        QVERIFY(!impl.topContext()->parsingEnvironmentFile()->needsUpdate());
+        auto headerCtx = DUChain::self()->chainForDocument(header.url());
+        QVERIFY(headerCtx);
+        QVERIFY(!headerCtx->parsingEnvironmentFile()->needsUpdate());
+        QCOMPARE(headerCtx->localDeclarations().size(), 1);
+    }
+
+    // but new contents do
+    header.setFileContents(QStringLiteral("int foo() { return 43; }\n"));
+    touchHeader();
+    QVERIFY(impl.parseAndWait(TopDUContext::AllDeclarationsContextsAndUses));
+    QVERIFY(!updateSpy.isEmpty());
+}
+
 void TestDUChain::testReparseError()
 {
     TestFile file(QStringLiteral("int i = 1 / 0;\n"), QStringLiteral("cpp"));
@@ -40,6 +40,7 @@ private Q_SLOTS:
     void testMissingInclude();
     void testIncludeLocking();
     void testReparse();
+    void testReuseUnchangedContext();
     void testReparseError();
     void testTemplate();
     void testNamespace();
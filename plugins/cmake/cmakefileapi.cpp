@@ -15,6 +15,7 @@
 #include <QVersionNumber>
 
 #include <makefileresolver/makefileresolver.h>
+#include <util/algorithm.h>
 
 #include "cmakeutils.h"
 #include "cmakeprojectdata.h"
@@ -160,11 +161,25 @@ ReplyIndex findReplyIndexFile(const QString& buildDirectory)
     return {};
 }
 
-static CMakeTarget parseTarget(const QJsonObject& target, StringInterner& stringInterner,
-                               PathInterner& sourcePathInterner, PathInterner& buildPathInterner,
-                               CMakeFilesCompilationData& compilationData)
+namespace {
+/// The contents of one target reply file, which is parsed independently of all others
+struct ParsedTarget
 {
-    CMakeTarget ret;
+    CMakeTarget target;
+    QVector<CMakeFile> compileGroups;
+    /// The canonical paths of the sources with compile groups and the index of their group
+    QVector<QPair<Path, int>> compiledSources;
+};
+
+ParsedTarget parseTarget(const QJsonObject& target, const Path& sourceDirectory, const Path& buildDirectory)
+{
+    // the strings and paths are interned per target here, and across targets when the targets are merged
+    StringInterner stringInterner;
+    PathInterner sourcePathInterner(sourceDirectory);
+    PathInterner buildPathInterner(buildDirectory);
+
+    ParsedTarget parsed;
+    auto& ret = parsed.target;
     ret.name = target.value(QLatin1String("name")).toString();
     ret.type = CMakeTarget::typeToEnum(target.value(QLatin1String("type")).toString());
     ret.folder = target.value(QLatin1String("folder")).toObject().value(QLatin1String("name")).toString();
@@ -185,7 +200,7 @@ static CMakeTarget parseTarget(const QJsonObject& target, StringInterner& string
         }
     }
 
-    QVector<CMakeFile> compileGroups;
+    auto& compileGroups = parsed.compileGroups;
     for (const auto& jsonCompileGroup : target.value(QLatin1String("compileGroups")).toArray()) {
         CMakeFile cmakeFile;
         const auto compileGroup = jsonCompileGroup.toObject();
@@ -222,45 +237,112 @@ static CMakeTarget parseTarget(const QJsonObject& target, StringInterner& string
         if (compileGroupIndex < 0 || compileGroupIndex > compileGroups.size()) {
             continue;
         }
-        const auto compileGroup = compileGroups.value(compileGroupIndex);
         const auto path = sourcePathInterner.internPath(source.value(QLatin1String("path")).toString());
         if (path.isValid()) {
-            compilationData.files[toCanonical(path)] = compileGroup;
+            parsed.compiledSources.append({toCanonical(path), compileGroupIndex});
         }
     }
-    return ret;
+    return parsed;
+}
+
+/// Shares the strings and paths that are equal across targets
+class TargetMerger
+{
+public:
+    explicit TargetMerger(StringInterner& stringInterner)
+        : m_stringInterner(stringInterner)
+    {
+    }
+
+    CMakeTarget merge(ParsedTarget&& parsed, CMakeFilesCompilationData& compilationData)
+    {
+        for (auto& compileGroup : parsed.compileGroups) {
+            compileGroup.language = m_stringInterner.internString(compileGroup.language);
+            compileGroup.compileFlags = m_stringInterner.internString(compileGroup.compileFlags);
+            QHash<QString, QString> defines;
+            defines.reserve(compileGroup.defines.size());
+            for (auto it = compileGroup.defines.cbegin(), end = compileGroup.defines.cend(); it != end; ++it) {
+                defines.insert(m_stringInterner.internString(it.key()), m_stringInterner.internString(it.value()));
+            }
+            compileGroup.defines = std::move(defines);
+            for (auto& include : compileGroup.includes) {
+                include = internPath(include);
+            }
+        }
+
+        for (const auto& source : std::as_const(parsed.compiledSources)) {
+            compilationData.files[internPath(source.first)] = parsed.compileGroups.value(source.second);
+        }
+
+        auto& target = parsed.target;
+        for (auto& path : target.artifacts) {
+            path = internPath(path);
+        }
+        for (auto& path : target.sources) {
+            path = internPath(path);
+        }
+        return std::move(target);
+    }
+
+private:
+    Path internPath(const Path& path)
+    {
+        return *m_paths.insert(path);
+    }
+
+    StringInterner& m_stringInterner;
+    QSet<Path> m_paths;
+};
 }
 
 static CMakeProjectData parseCodeModel(const QJsonObject& codeModel, const QDir& replyDir,
-                                       StringInterner&stringInterner, PathInterner& sourcePathInterner, PathInterner& buildPathInterner)
+                                       StringInterner&stringInterner, PathInterner& sourcePathInterner,
+                                       const Path& sourceDirectory, const Path& buildDirectory)
 {
     CMakeProjectData ret;
     // for now, we only use the first available configuration and don't support multi configurations
     const auto configuration = codeModel.value(QLatin1String("configurations")).toArray().at(0).toObject();
     const auto targets = configuration.value(QLatin1String("targets")).toArray();
     const auto directories = configuration.value(QLatin1String("directories")).toArray();
+
+    // the target files of all directories, in order
+    QVector<QPair<Path, QString>> targetFiles;
     for (const auto& directoryValue : directories) {
         const auto directory = directoryValue.toObject();
         if (!directory.contains(QLatin1String("targetIndexes"))) {
             continue;
         }
         const auto dirSourcePath = sourcePathInterner.internPath(directory.value(QLatin1String("source")).toString());
-        auto& dirTargets = ret.targets[dirSourcePath];
+        // directories without valid targets are listed nevertheless
+        ret.targets[dirSourcePath];
         for (const auto& targetIndex : directory.value(QLatin1String("targetIndexes")).toArray()) {
             const auto jsonTarget = targets.at(targetIndex.toInt(-1)).toObject();
             if (jsonTarget.isEmpty()) {
                 continue;
             }
-            const auto targetFile = jsonTarget.value(QLatin1String("jsonFile")).toString();
-            const auto target = parseTarget(parseFile(replyDir.absoluteFilePath(targetFile)),
-                                            stringInterner, sourcePathInterner, buildPathInterner,
-                                            ret.compilationData);
-            if (target.name.isEmpty()) {
-                continue;
-            }
-            dirTargets.append(target);
+            targetFiles.append({dirSourcePath, jsonTarget.value(QLatin1String("jsonFile")).toString()});
         }
     }
+
+    // Large projects have thousands of target files, parse them concurrently. Each JSON document
+    // is dropped as soon as its target is extracted, so only few of them are in memory at once.
+    QVector<ParsedTarget> parsedTargets(targetFiles.size());
+    Algorithm::parallelForRanges(targetFiles.size(), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            parsedTargets[i] =
+                parseTarget(parseFile(replyDir.absoluteFilePath(targetFiles[i].second)), sourceDirectory, buildDirectory);
+        }
+    });
+
+    TargetMerger merger(stringInterner);
+    for (int i = 0; i < targetFiles.size(); ++i) {
+        auto target = merger.merge(std::move(parsedTargets[i]), ret.compilationData);
+        if (target.name.isEmpty()) {
+            continue;
+        }
+        ret.targets[targetFiles[i].first].append(target);
+    }
+
     ret.compilationData.isValid = !codeModel.isEmpty();
     ret.compilationData.rebuildFileForFolderMapping();
     if (!ret.compilationData.isValid) {
@@ -312,7 +394,6 @@ CMakeProjectData parseReplyIndexFile(const ReplyIndex& replyIndex, const Path& s
 
     StringInterner stringInterner;
     PathInterner sourcePathInterner(toCanonical(sourceDirectory));
-    PathInterner buildPathInterner(buildDirectory);
 
     CMakeProjectData codeModel;
     QSet<Path> cmakeFiles;
@@ -324,8 +405,8 @@ CMakeProjectData parseReplyIndexFile(const ReplyIndex& replyIndex, const Path& s
         const auto jsonFile = response.value(QLatin1String("jsonFile")).toString();
         const auto jsonFilePath = replyDir.absoluteFilePath(jsonFile);
         if (kind == QLatin1String("codemodel")) {
-            codeModel = parseCodeModel(parseFile(jsonFilePath), replyDir,
-                                       stringInterner, sourcePathInterner, buildPathInterner);
+            codeModel = parseCodeModel(parseFile(jsonFilePath), replyDir, stringInterner, sourcePathInterner,
+                                       toCanonical(sourceDirectory), buildDirectory);
             if (!codeModel.compilationData.isValid) {
                 break; // skip to printing a warning and the early return under the loop
             }
@@ -0,0 +1,131 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <cmakefileapi.h>
+#include <cmakeprojectdata.h>
+
+#include <util/path.h>
+
+using namespace KDevelop;
+
+namespace {
+void writeJson(const QString& path, const QJsonObject& object)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+/// Writes a reply of @p targetCount targets with @p sourcesPerTarget sources each into @p replyDir
+CMake::FileApi::ReplyIndex writeReply(const QDir& replyDir, int targetCount, int sourcesPerTarget)
+{
+    // a few targets per directory, as in typical projects
+    const int targetsPerDirectory = 4;
+
+    QJsonArray targets;
+    QJsonArray directories;
+    QJsonArray targetIndexes;
+    for (int i = 0; i < targetCount; ++i) {
+        const auto directory = QStringLiteral("src/dir%1").arg(i / targetsPerDirectory);
+        const auto jsonFile = QStringLiteral("target-%1.json").arg(i);
+        targets.append(QJsonObject{{"name", QStringLiteral("target%1").arg(i)}, {"jsonFile", jsonFile}});
+        targetIndexes.append(i);
+        if (targetIndexes.size() == targetsPerDirectory || i == targetCount - 1) {
+            directories.append(QJsonObject{{"source", directory}, {"targetIndexes", targetIndexes}});
+            targetIndexes = {};
+        }
+
+        QJsonArray sources;
+        for (int j = 0; j < sourcesPerTarget; ++j) {
+            sources.append(QJsonObject{{"path", QStringLiteral("%1/file%2_%3.cpp").arg(directory).arg(i).arg(j)},
+                                       {"compileGroupIndex", 0}});
+        }
+        const QJsonObject compileGroup{
+            {"language", "CXX"},
+            {"compileCommandFragments",
+             QJsonArray{QJsonObject{{"fragment", "-O2 -g -fPIC -std=gnu++20 -DQT_NO_DEBUG"}}}},
+            {"defines",
+             QJsonArray{QJsonObject{{"define", QStringLiteral("target%1_EXPORTS").arg(i)}},
+                        QJsonObject{{"define", "QT_CORE_LIB"}}, QJsonObject{{"define", "QT_GUI_LIB"}}}},
+            {"includes",
+             QJsonArray{QJsonObject{{"path", directory}}, QJsonObject{{"path", "/usr/include/qt6"}},
+                        QJsonObject{{"path", "/usr/include/qt6/QtCore"}}}},
+        };
+        writeJson(replyDir.filePath(jsonFile),
+                  QJsonObject{{"name", QStringLiteral("target%1").arg(i)},
+                              {"type", "SHARED_LIBRARY"},
+                              {"artifacts", QJsonArray{QJsonObject{{"path", QStringLiteral("lib/libtarget%1.so").arg(i)}}}},
+                              {"sources", sources},
+                              {"compileGroups", QJsonArray{compileGroup}}});
+    }
+
+    const QJsonObject configuration{{"directories", directories}, {"targets", targets}};
+    writeJson(replyDir.filePath(QStringLiteral("codemodel-v2.json")),
+              QJsonObject{{"configurations", QJsonArray{configuration}}});
+
+    const QJsonObject response{{"kind", "codemodel"}, {"jsonFile", "codemodel-v2.json"}};
+    const QJsonObject query{{"responses", QJsonArray{response}}};
+    const QJsonObject reply{{"client-kdevelop", QJsonObject{{"query.json", query}}}};
+    return {QDateTime::currentDateTime(), QJsonObject{{"reply", reply}}};
+}
+}
+
+class BenchCMakeFileApi : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchParseReplyIndexFile_data()
+    {
+        QTest::addColumn<int>("targetCount");
+        QTest::addColumn<int>("sourcesPerTarget");
+
+        QTest::newRow("100 targets") << 100 << 20;
+        QTest::newRow("1000 targets") << 1000 << 20;
+        QTest::newRow("4000 targets") << 4000 << 20;
+    }
+
+    void benchParseReplyIndexFile()
+    {
+        QFETCH(int, targetCount);
+        QFETCH(int, sourcesPerTarget);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const Path sourceDirectory(dir.filePath(QStringLiteral("source")));
+        const Path buildDirectory(dir.filePath(QStringLiteral("build")));
+        const QDir replyDir(buildDirectory.toLocalFile() + QLatin1String("/.cmake/api/v1/reply/"));
+        QVERIFY(replyDir.mkpath(QStringLiteral(".")));
+
+        const auto replyIndex = writeReply(replyDir, targetCount, sourcesPerTarget);
+
+        CMakeProjectData data;
+        QBENCHMARK {
+            data = CMake::FileApi::parseReplyIndexFile(replyIndex, sourceDirectory, buildDirectory);
+        }
+
+        QVERIFY(data.compilationData.isValid);
+        QCOMPARE(data.compilationData.files.size(), targetCount * sourcesPerTarget);
+        int parsedTargets = 0;
+        for (const auto& targets : std::as_const(data.targets)) {
+            parsedTargets += targets.size();
+        }
+        QCOMPARE(parsedTargets, targetCount);
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchCMakeFileApi)
+
+#include "bench_cmakefileapi.moc"
@@ -0,0 +1,144 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "compilerprobecache.h"
+
+#include <debug.h>
+
+#include <interfaces/icore.h>
+#include <language/duchain/duchain.h>
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace KDevelop;
+
+namespace
+{
+/// Increase when the format of the file or the meaning of the stored outputs changes
+const quint32 cacheVersion = 1;
+/// How long to wait for more outputs before writing the file, in ms
+const int saveDelay = 5000;
+}
+
+CompilerProbeCache::CompilerProbeCache(const QString& fileName)
+    : m_fileName(fileName)
+{
+    // the cache is usually created by the first probe, in a thread without an event loop
+    if (auto* app = QCoreApplication::instance()) {
+        m_saveTimer.moveToThread(app->thread());
+    }
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(saveDelay);
+    QObject::connect(&m_saveTimer, &QTimer::timeout, &m_saveTimer, [this] {
+        flush();
+    });
+}
+
+CompilerProbeCache::~CompilerProbeCache()
+{
+    flush();
+}
+
+CompilerProbeCache& CompilerProbeCache::self()
+{
+    static CompilerProbeCache cache([] {
+        auto* core = ICore::self();
+        if (!core || !core->activeSessionLock()) {
+            return QString();
+        }
+        return DUChain::repositoryPathForSession(core->activeSessionLock()) + QLatin1String("/compilers");
+    }());
+    return cache;
+}
+
+QByteArray CompilerProbeCache::output(const QString& key)
+{
+    QMutexLocker lock(&m_mutex);
+    load();
+    return m_outputs.value(key);
+}
+
+void CompilerProbeCache::insert(const QString& key, const QByteArray& output)
+{
+    QMutexLocker lock(&m_mutex);
+    load();
+    m_outputs.insert(key, output);
+    m_dirty = true;
+
+    if (m_fileName.isEmpty() || m_saveScheduled) {
+        return;
+    }
+    m_saveScheduled = true;
+    // the timer can only be started from the main thread, the probes run in others
+    QMetaObject::invokeMethod(&m_saveTimer, [this] {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_saveScheduled = false;
+        }
+        if (!m_saveTimer.isActive()) {
+            m_saveTimer.start();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void CompilerProbeCache::flush()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_dirty) {
+        save();
+    }
+}
+
+void CompilerProbeCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QFile file(m_fileName);
+    if (m_fileName.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    quint32 version = 0;
+    stream >> version;
+    if (version != cacheVersion) {
+        return;
+    }
+    stream >> m_outputs;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(DEFINESANDINCLUDES) << "ignoring corrupted compiler cache" << m_fileName;
+        m_outputs.clear();
+    }
+}
+
+void CompilerProbeCache::save()
+{
+    m_dirty = false;
+    if (m_fileName.isEmpty()) {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(DEFINESANDINCLUDES) << "cannot write compiler cache" << m_fileName << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << cacheVersion << m_outputs;
+    if (!file.commit()) {
+        qCDebug(DEFINESANDINCLUDES) << "cannot write compiler cache" << m_fileName << file.errorString();
+    }
+}
@@ -0,0 +1,59 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef COMPILERPROBECACHE_H
+#define COMPILERPROBECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QTimer>
+
+/**
+ * Persists the output of compiler invocations that query builtin defines and include paths.
+ *
+ * Keys identify the compiler binary by its path, modification time and size, together with the
+ * arguments it was invoked with, so that updating a compiler invalidates its entries. The cache
+ * lives next to the DUChain of the active session and is cleared together with it.
+ *
+ * Inserted outputs are written to the file shortly afterwards in one go, and on destruction.
+ */
+class CompilerProbeCache
+{
+public:
+    /// Creates a cache stored in @p fileName, an empty file name keeps the cache in memory only
+    explicit CompilerProbeCache(const QString& fileName);
+    ~CompilerProbeCache();
+
+    /// The cache of the active session
+    static CompilerProbeCache& self();
+
+    /// @return the output stored for @p key, or a null byte array
+    QByteArray output(const QString& key);
+    /// Stores @p output for @p key, may be called from any thread
+    void insert(const QString& key, const QByteArray& output);
+
+    /// Writes the inserted outputs to the file now instead of waiting for that
+    void flush();
+
+private:
+    void load();
+    void save();
+
+    QMutex m_mutex;
+    QString m_fileName;
+    bool m_loaded = false;
+    /// Whether outputs were inserted since the file was written
+    bool m_dirty = false;
+    /// Whether m_saveTimer is about to be started
+    bool m_saveScheduled = false;
+    QHash<QString, QByteArray> m_outputs;
+    /// Lives in the main thread, whose event loop runs the deferred writes
+    QTimer m_saveTimer;
+};
+
+#endif // COMPILERPROBECACHE_H
@@ -20,6 +20,7 @@
 #include <KLocalizedString>
 #include <QStandardPaths>
 #include <QDir>
+#include <QSet>
 
 using namespace KDevelop;
 
@@ -143,6 +144,8 @@ CompilerProvider::CompilerProvider( SettingsManager* settings, QObject* parent )
     connect(ICore::self()->runtimeController(), &IRuntimeController::currentRuntimeChanged, this, [this]() { m_defaultProvider.clear(); });
     connect(ICore::self()->projectController(), &IProjectController::projectConfigurationChanged, this, &CompilerProvider::projectChanged);
     connect(ICore::self()->projectController(), &IProjectController::projectOpened, this, &CompilerProvider::projectChanged);
+    // after projectChanged(), which may change the default compiler
+    connect(ICore::self()->projectController(), &IProjectController::projectOpened, this, &CompilerProvider::prefetch);
 }
 
 CompilerProvider::~CompilerProvider() = default;
@@ -179,6 +182,41 @@ void CompilerProvider::projectChanged(KDevelop::IProject* p)
     qCDebug(DEFINESANDINCLUDES) << "using compiler" << m_defaultProvider << path;
 }
 
+void CompilerProvider::prefetch(KDevelop::IProject* p)
+{
+    // The files are asked for one after another when their parse jobs get created, so that each waits for the
+    // compiler to run with its arguments. Start the compiler for all of them now, where they can run in parallel.
+    // The files of a target usually share their arguments, looking at the first one per language suffices.
+    QVector<ProjectBaseItem*> items{p->projectItem()};
+    while (!items.isEmpty()) {
+        auto* item = items.takeLast();
+        const auto folders = item->folderList();
+        for (auto* folder : folders) {
+            items.append(folder);
+        }
+        const auto targets = item->targetList();
+        for (auto* target : targets) {
+            items.append(target);
+        }
+
+        const auto files = item->fileList();
+        if (files.isEmpty()) {
+            continue;
+        }
+        // the configuration applies to directories, which the files share with their folder or target
+        const auto config = configForItem(item);
+        QSet<Utils::LanguageType> languageTypes;
+        for (auto* file : files) {
+            const auto languageType = Utils::languageType(file->path().path(), config.parserArguments.parseAmbiguousAsCPP);
+            if (languageType == Utils::Other || languageTypes.contains(languageType)) {
+                continue;
+            }
+            languageTypes.insert(languageType);
+            config.compiler->prefetch(languageType, parserArguments(config, languageType, file));
+        }
+    }
+}
+
 QHash<QString, QString> CompilerProvider::defines( const QString& path ) const
 {
     auto config = configForItem(nullptr);
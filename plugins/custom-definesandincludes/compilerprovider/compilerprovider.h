@@ -51,6 +51,8 @@ public:
 private Q_SLOTS:
     void retrieveUserDefinedCompilers();
     void projectChanged(KDevelop::IProject* p);
+    /// Starts looking up the builtin defines and includes for the arguments the files of @p p are parsed with
+    void prefetch(KDevelop::IProject* p);
 
 private:
     mutable CompilerPointer m_defaultProvider;
@@ -6,16 +6,22 @@
 
 #include "gcclikecompiler.h"
 
+#include "compilerprobecache.h"
+
 #include <debug.h>
 
 #include <interfaces/iruntime.h>
 #include <interfaces/iruntimecontroller.h>
 
+#include <QDateTime>
 #include <QFileInfo>
 #include <QProcess>
 #include <QRegExp>
 #include <QRegularExpression>
-#include <QScopeGuard>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <optional>
 
 using namespace KDevelop;
 
@@ -67,106 +73,48 @@ QString languageStandard(const QString& arguments, Utils::LanguageType type)
     }
 }
 
-}
-
-Defines GccLikeCompiler::defines(Utils::LanguageType type, const QString& arguments) const
+/// Returns the arguments to query builtin defines
+QStringList definesArguments(Utils::LanguageType type, const QString& arguments)
 {
-    // first do a lookup by type and arguments
-    auto& data = m_definesIncludes[type][arguments];
-    if (data.definedMacros.wasCached) {
-        return data.definedMacros.data;
-    }
-
     // TODO: what about -mXXX or -target= flags, some of these change search paths/defines
-    const QStringList compilerArguments{
-        languageOption(type),
-        languageStandard(arguments, type),
-        QStringLiteral("-dM"),
-        QStringLiteral("-E"),
+    return {
+        languageOption(type), languageStandard(arguments, type), QStringLiteral("-dM"), QStringLiteral("-E"),
         QStringLiteral("-"),
     };
+}
 
-    // if that fails, do a lookup based on the actual compiler arguments
-    // often these are much less variable than the arguments passed per TU
-    // so here we can better exploit the cache by doing this two-phase lookup
-    auto& cachedData = m_defines[compilerArguments];
-    auto updateDataOnExit = qScopeGuard([&] {
-        // we don't want to run the below code more than once
-        // even if it errors out
-        cachedData.wasCached = true;
-        data.definedMacros = cachedData;
-    });
-
-    if (cachedData.wasCached) {
-        return cachedData.data;
-    }
-
-    const auto rt = ICore::self()->runtimeController()->currentRuntime();
-    QProcess proc;
-    proc.setProcessChannelMode(QProcess::MergedChannels);
-    proc.setStandardInputFile(QProcess::nullDevice());
-    proc.setProgram(path());
-    proc.setArguments(compilerArguments);
-    rt->startProcess(&proc);
-
-    if ( !proc.waitForStarted( 2000 ) || !proc.waitForFinished( 2000 ) ) {
-        qCDebug(DEFINESANDINCLUDES) <<  "Unable to read standard macro definitions from "<< path() << compilerArguments;
-        return {};
-    }
+/// Returns the arguments to query builtin include paths
+QStringList includesArguments(Utils::LanguageType type, const QString& arguments)
+{
+    return {
+        languageOption(type), languageStandard(arguments, type), QStringLiteral("-E"), QStringLiteral("-v"),
+        QStringLiteral("-"),
+    };
+}
 
-    if (proc.exitCode() != 0) {
-        qCWarning(DEFINESANDINCLUDES) <<  "error while fetching defines for the compiler:" << path() << compilerArguments << proc.readAll();
-        return {};
-    }
+Defines parseDefines(const QByteArray& output)
+{
+    Defines defines;
 
     // #define a 1
     // #define a
     QRegExp defineExpression(QStringLiteral("#define\\s+(\\S+)(?:\\s+(.*)\\s*)?"));
 
-    while ( proc.canReadLine() ) {
-        auto line = proc.readLine();
-
+    const auto lines = output.split('\n');
+    for (const auto& line : lines) {
         if ( defineExpression.indexIn(QString::fromUtf8(line)) != -1 ) {
-            cachedData.data[defineExpression.cap(1)] = defineExpression.cap(2).trimmed();
+            defines[defineExpression.cap(1)] = defineExpression.cap(2).trimmed();
         }
     }
 
-    return cachedData.data;
+    return defines;
 }
 
-Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& arguments) const
+Path::List parseIncludes(const QByteArray& output, const IRuntime* rt)
 {
-    // first do a lookup by type and arguments
-    auto& data = m_definesIncludes[type][arguments];
-    if (data.includePaths.wasCached) {
-        return data.includePaths.data;
-    }
-
-    const QStringList compilerArguments {
-        languageOption(type), languageStandard(arguments, type), QStringLiteral("-E"), QStringLiteral("-v"),
-        QStringLiteral("-"),
-    };
+    Path::List includes;
 
-    // if that fails, do a lookup based on the actual compiler arguments
-    // often these are much less variable than the arguments passed per TU
-    // so here we can better exploit the cache by doing this two-phase lookup
-    auto& cachedData = m_includes[compilerArguments];
-    auto updateDataOnExit = qScopeGuard([&] {
-        // we don't want to run the below code more than once
-        // even if it errors out
-        cachedData.wasCached = true;
-        data.includePaths = cachedData;
-    });
-
-    if (cachedData.wasCached) {
-        return cachedData.data;
-    }
-
-    const auto rt = ICore::self()->runtimeController()->currentRuntime();
-    QProcess proc;
-    proc.setProcessChannelMode( QProcess::MergedChannels );
-
-    // The following command will spit out a bunch of information we don't care
+    // The compiler will spit out a bunch of information we don't care
     // about before spitting out the include paths.  The parts we care about
     // look like this:
     // #include "..." search starts here:
@@ -179,21 +127,6 @@ Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& ar
     //  /usr/include
     // End of search list.
 
-    proc.setStandardInputFile(QProcess::nullDevice());
-    proc.setProgram(path());
-    proc.setArguments(compilerArguments);
-    rt->startProcess(&proc);
-
-    if ( !proc.waitForStarted( 2000 ) || !proc.waitForFinished( 2000 ) ) {
-        qCDebug(DEFINESANDINCLUDES) <<  "Unable to read standard include paths from " << path();
-        return {};
-    }
-
-    if (proc.exitCode() != 0) {
-        qCWarning(DEFINESANDINCLUDES) <<  "error while fetching includes for the compiler:" << path() << proc.readAll();
-        return {};
-    }
-
     // We'll use the following constants to know what we're currently parsing.
     enum Status {
         Initial,
@@ -203,8 +136,8 @@ Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& ar
     };
     Status mode = Initial;
 
-    const auto output = QString::fromLocal8Bit( proc.readAllStandardOutput() );
-    const auto lines = QStringView{output}.split(QLatin1Char('\n'));
+    const auto text = QString::fromLocal8Bit(output);
+    const auto lines = QStringView{text}.split(QLatin1Char('\n'));
     for (const auto line : lines) {
         switch ( mode ) {
             case Initial:
@@ -227,7 +160,7 @@ Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& ar
                     auto hostPath = rt->pathInHost(Path(QFileInfo(line.trimmed().toString()).canonicalFilePath()));
                     // but skip folders with compiler builtins, we cannot parse these with clang
                     if (!QFile::exists(hostPath.toLocalFile() + QLatin1String("/cpuid.h"))) {
-                        cachedData.data << Path(QFileInfo(hostPath.toLocalFile()).canonicalFilePath());
+                        includes << Path(QFileInfo(hostPath.toLocalFile()).canonicalFilePath());
                     }
                 }
                 break;
@@ -239,11 +172,196 @@ Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& ar
         }
     }
 
-    return cachedData.data;
+    return includes;
+}
+
+/**
+ * Returns what identifies the compiler @p compiler in the persistent cache: the runtime, the path and the
+ * modification time and size of the binary, or an empty string if the binary cannot be found.
+ */
+QString compilerIdentity(const QString& compiler, const IRuntime* rt)
+{
+    const auto executable = QFileInfo(compiler).isAbsolute() ? compiler : rt->findExecutable(compiler);
+    if (executable.isEmpty()) {
+        return {};
+    }
+    // follows symlinks, so that updating the compiler behind e.g. /usr/bin/c++ is noticed
+    const QFileInfo info(rt->pathInHost(Path(executable)).toLocalFile());
+    if (!info.exists()) {
+        return {};
+    }
+    return rt->name() + QLatin1Char('\n') + executable + QLatin1Char('\n') + QString::number(info.size())
+        + QLatin1Char('\n') + QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+/**
+ * Runs @p compiler with @p arguments to query its builtin defines or include paths, unless its output is
+ * cached persistently for the compiler @p identity.
+ * @return the output, or std::nullopt if the compiler failed
+ */
+std::optional<QByteArray> runProbe(const QString& compiler, const QStringList& arguments, const QString& identity,
+                                   const IRuntime* rt, const QString& what)
+{
+    QString cacheKey;
+    if (!identity.isEmpty()) {
+        cacheKey = identity + QLatin1Char('\n') + arguments.join(QLatin1Char(' '));
+        const auto output = CompilerProbeCache::self().output(cacheKey);
+        if (!output.isNull()) {
+            return output;
+        }
+    }
+
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.setStandardInputFile(QProcess::nullDevice());
+    process.setProgram(compiler);
+    process.setArguments(arguments);
+    rt->startProcess(&process);
+
+    if ( !process.waitForStarted( 2000 ) || !process.waitForFinished( 2000 ) ) {
+        qCDebug(DEFINESANDINCLUDES) << "Unable to read standard" << what << "from" << process.program() << arguments;
+        return std::nullopt;
+    }
+
+    if (process.exitCode() != 0) {
+        qCWarning(DEFINESANDINCLUDES) << "error while fetching" << what << "for the compiler:"
+                                      << process.program() << arguments << process.readAll();
+        return std::nullopt;
+    }
+
+    const auto output = process.readAll();
+    if (!cacheKey.isEmpty()) {
+        CompilerProbeCache::self().insert(cacheKey, output);
+    }
+    return output;
+}
+
+/// The threads the compilers run in, kept apart from the global pool as they mostly wait for the processes
+QThreadPool* probeThreadPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+}
+
+QFuture<void> GccLikeCompiler::startProbe(const QStringList& probeArguments, Probe probe) const
+{
+    const auto it = m_pendingProbes.constFind(probeArguments);
+    if (it != m_pendingProbes.constEnd()) {
+        return *it;
+    }
+
+    const auto rt = ICore::self()->runtimeController()->currentRuntime();
+    // the probe stores its result itself, so that prefetched probes are not lost when nobody waits for them;
+    // m_mutex is held here, so it cannot remove itself from m_pendingProbes before it was inserted
+    auto future = QtConcurrent::run(
+        probeThreadPool(), [this, probeArguments, probe, rt, compiler = path(), identity = compilerIdentity(path(), rt)] {
+            const auto what = probe == Probe::MacroDefinitions ? QStringLiteral("macro definitions")
+                                                                : QStringLiteral("include paths");
+            const auto output = runProbe(compiler, probeArguments, identity, rt, what);
+
+            // we don't want to run the probes more than once, even if they error out
+            if (probe == Probe::MacroDefinitions) {
+                const auto defines = output ? parseDefines(*output) : Defines();
+                QMutexLocker lock(&m_mutex);
+                auto& cached = m_defines[probeArguments];
+                cached.data = defines;
+                cached.wasCached = true;
+                m_pendingProbes.remove(probeArguments);
+            } else {
+                const auto includes = output ? parseIncludes(*output, rt) : Path::List();
+                QMutexLocker lock(&m_mutex);
+                auto& cached = m_includes[probeArguments];
+                cached.data = includes;
+                cached.wasCached = true;
+                m_pendingProbes.remove(probeArguments);
+            }
+        });
+    m_pendingProbes.insert(probeArguments, future);
+    return future;
+}
+
+GccLikeCompiler::DefinesIncludes GccLikeCompiler::probe(Utils::LanguageType type, const QString& arguments) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    // first do a lookup by type and arguments
+    {
+        const auto& data = m_definesIncludes[type][arguments];
+        if (data.definedMacros.wasCached && data.includePaths.wasCached) {
+            return data;
+        }
+    }
+
+    // if that fails, do a lookup based on the actual compiler arguments
+    // often these are much less variable than the arguments passed per TU
+    // so here we can better exploit the cache by doing this two-phase lookup
+    const auto definesProbeArguments = definesArguments(type, arguments);
+    const auto includesProbeArguments = includesArguments(type, arguments);
+    const bool definesCached = m_defines.value(definesProbeArguments).wasCached;
+    const bool includesCached = m_includes.value(includesProbeArguments).wasCached;
+
+    // both probes run at the same time, the callers ask for defines and includes of a file together anyways,
+    // and the lock is not held while waiting for them, so that other argument sets can be probed meanwhile
+    if (!definesCached || !includesCached) {
+        QFuture<void> definesProbe;
+        QFuture<void> includesProbe;
+        if (!definesCached) {
+            definesProbe = startProbe(definesProbeArguments, Probe::MacroDefinitions);
+        }
+        if (!includesCached) {
+            includesProbe = startProbe(includesProbeArguments, Probe::IncludePaths);
+        }
+
+        lock.unlock();
+        if (!definesCached) {
+            definesProbe.waitForFinished();
+        }
+        if (!includesCached) {
+            includesProbe.waitForFinished();
+        }
+        lock.relock();
+    }
+
+    auto& data = m_definesIncludes[type][arguments];
+    data.definedMacros = m_defines.value(definesProbeArguments);
+    data.includePaths = m_includes.value(includesProbeArguments);
+    return data;
+}
+
+void GccLikeCompiler::prefetch(Utils::LanguageType type, const QString& arguments) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    const auto& data = m_definesIncludes.value(type).value(arguments);
+    if (data.definedMacros.wasCached && data.includePaths.wasCached) {
+        return;
+    }
+
+    const auto definesProbeArguments = definesArguments(type, arguments);
+    if (!m_defines.value(definesProbeArguments).wasCached) {
+        startProbe(definesProbeArguments, Probe::MacroDefinitions);
+    }
+    const auto includesProbeArguments = includesArguments(type, arguments);
+    if (!m_includes.value(includesProbeArguments).wasCached) {
+        startProbe(includesProbeArguments, Probe::IncludePaths);
+    }
+}
+
+Defines GccLikeCompiler::defines(Utils::LanguageType type, const QString& arguments) const
+{
+    return probe(type, arguments).definedMacros.data;
+}
+
+Path::List GccLikeCompiler::includes(Utils::LanguageType type, const QString& arguments) const
+{
+    return probe(type, arguments).includePaths.data;
 }
 
 void GccLikeCompiler::invalidateCache()
 {
+    QMutexLocker lock(&m_mutex);
     m_definesIncludes.clear();
 }
 
@@ -253,4 +371,17 @@ GccLikeCompiler::GccLikeCompiler(const QString& name, const QString& path, bool
     connect(ICore::self()->runtimeController(), &IRuntimeController::currentRuntimeChanged, this, &GccLikeCompiler::invalidateCache);
 }
 
+GccLikeCompiler::~GccLikeCompiler()
+{
+    // the running probes store their results in this compiler
+    QList<QFuture<void>> pendingProbes;
+    {
+        QMutexLocker lock(&m_mutex);
+        pendingProbes = m_pendingProbes.values();
+    }
+    for (auto& probe : pendingProbes) {
+        probe.waitForFinished();
+    }
+}
+
 #include "moc_gcclikecompiler.cpp"
@@ -9,16 +9,22 @@
 
 #include "icompiler.h"
 
+#include <QFuture>
+#include <QMutex>
+
 class GccLikeCompiler : public QObject, public ICompiler
 {
     Q_OBJECT
 public:
     GccLikeCompiler( const QString& name, const QString& path, bool editable, const QString& factoryName );
+    ~GccLikeCompiler() override;
 
     KDevelop::Defines defines(Utils::LanguageType type, const QString& arguments) const override;
 
     KDevelop::Path::List includes(Utils::LanguageType type, const QString& arguments) const override;
 
+    void prefetch(Utils::LanguageType type, const QString& arguments) const override;
+
 private:
     void invalidateCache();
 
@@ -32,10 +38,28 @@ private:
         Cached<KDevelop::Path::List> includePaths;
     };
 
+    /// Queries the builtin defines and include paths for @p arguments, unless they are cached
+    DefinesIncludes probe(Utils::LanguageType type, const QString& arguments) const;
+    enum class Probe {
+        MacroDefinitions,
+        IncludePaths,
+    };
+    /**
+     * Starts running the compiler with @p probeArguments in the background, unless that is already in progress.
+     * The probe stores its result in m_defines or m_includes when it finishes.
+     * Must be called with m_mutex held.
+     */
+    QFuture<void> startProbe(const QStringList& probeArguments, Probe probe) const;
+
+    /// Protects the members below, so that the compiler can be queried from several threads at once
+    mutable QMutex m_mutex;
+
     /// List of defines/includes per arguments
     mutable QHash<Utils::LanguageType, QHash<QString, DefinesIncludes>> m_definesIncludes;
     mutable QHash<QStringList, Cached<KDevelop::Defines>> m_defines;
     mutable QHash<QStringList, Cached<KDevelop::Path::List>> m_includes;
+    /// The probes that are running right now, entries are removed when they finish
+    mutable QHash<QStringList, QFuture<void>> m_pendingProbes;
 };
 
 #endif // GCCLIKECOMPILER_H
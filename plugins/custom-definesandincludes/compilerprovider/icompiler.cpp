@@ -48,3 +48,7 @@ QString ICompiler::factoryName() const
 {
     return m_factoryName;
 }
+
+void ICompiler::prefetch(Utils::LanguageType /*type*/, const QString& /*arguments*/) const
+{
+}
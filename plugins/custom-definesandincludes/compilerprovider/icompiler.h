@@ -53,6 +53,13 @@ public:
      */
     virtual KDevelop::Path::List includes(Utils::LanguageType type, const QString& arguments) const = 0;
 
+    /**
+     * Starts looking up the defines and includes for @p type and @p arguments in the background,
+     * so that several argument sets can be looked up at once before they are asked for.
+     * Does nothing by default.
+     */
+    virtual void prefetch(Utils::LanguageType type, const QString& arguments) const;
+
     void setPath( const QString &path );
 
     /// @return path to the compiler
@@ -6,8 +6,13 @@
 
 #include "test_compilerprovider.h"
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
 #include <QTest>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
+#include <QtConcurrentRun>
 
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
@@ -20,7 +25,10 @@
 #include <serialization/indexedstring.h>
 
 #include <algorithm>
+#include <memory>
 
+#include "../compilerprobecache.h"
+#include "../gcclikecompiler.h"
 #include "../compilerprovider.h"
 #include "../settingsmanager.h"
 
@@ -111,6 +119,78 @@ void TestCompilerProvider::testCompilerIncludesAndDefines()
     QVERIFY(!compiler->includes(Utils::Cpp, QStringLiteral("-std=c++11")).isEmpty());
 }
 
+void TestCompilerProvider::testProbeCache()
+{
+    QTemporaryDir dir;
+    const auto fileName = dir.path() + "/compilers";
+
+    {
+        CompilerProbeCache cache(fileName);
+        QVERIFY(cache.output("gcc").isNull());
+        cache.insert("gcc", "#define A 1\n");
+        QCOMPARE(cache.output("gcc"), QByteArray("#define A 1\n"));
+    }
+
+    // the outputs survive across instances, as they do across sessions
+    CompilerProbeCache cache(fileName);
+    QCOMPARE(cache.output("gcc"), QByteArray("#define A 1\n"));
+    QVERIFY(cache.output("clang").isNull());
+
+    // the probes create and fill the cache in threads without an event loop, it is written nevertheless
+    {
+        const auto workerFileName = dir.path() + "/compilers-worker";
+        std::unique_ptr<CompilerProbeCache> workerCache;
+        QtConcurrent::run([&] {
+            workerCache = std::make_unique<CompilerProbeCache>(workerFileName);
+            workerCache->insert("clang", "#define B 1\n");
+        }).waitForFinished();
+        QTRY_VERIFY_WITH_TIMEOUT(QFileInfo::exists(workerFileName), 10000);
+        QCOMPARE(CompilerProbeCache(workerFileName).output("clang"), QByteArray("#define B 1\n"));
+    }
+
+#ifdef Q_OS_WIN
+    QSKIP("the fake compiler is a shell script");
+#endif
+    // replacing the compiler binary invalidates its outputs, noticed by its size or modification time
+    const auto compilerPath = dir.path() + "/fake-gcc";
+    const auto writeCompiler = [&](const QByteArray& value, const QDateTime& lastModified) {
+        QFile compiler(compilerPath);
+        QVERIFY(compiler.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        compiler.write("#!/bin/sh\necho '#define KDEV_PROBE " + value + "'\n");
+        QVERIFY(compiler.setFileTime(lastModified, QFileDevice::FileModificationTime));
+        compiler.close();
+        QVERIFY(compiler.setPermissions(compiler.permissions() | QFileDevice::ExeOwner));
+    };
+    const auto probedValue = [&] {
+        // a new compiler instance, so that only the persistent cache is used
+        GccLikeCompiler compiler(QStringLiteral("fake"), compilerPath, false, QStringLiteral("GCC"));
+        return compiler.defines(Utils::Cpp, QStringLiteral("-std=c++17")).value(QStringLiteral("KDEV_PROBE"));
+    };
+    const auto lastModified = QDateTime::currentDateTime().addSecs(-3600);
+
+    writeCompiler("1", lastModified);
+    QCOMPARE(probedValue(), QStringLiteral("1"));
+
+    // an equal size and modification time are taken for the same compiler
+    writeCompiler("2", lastModified);
+    QCOMPARE(probedValue(), QStringLiteral("1"));
+
+    writeCompiler("22", lastModified);
+    QCOMPARE(probedValue(), QStringLiteral("22"));
+
+    writeCompiler("33", lastModified.addSecs(60));
+    QCOMPARE(probedValue(), QStringLiteral("33"));
+
+    // a prefetched probe keeps its result for the later queries
+    writeCompiler("44", lastModified.addSecs(120));
+    {
+        GccLikeCompiler compiler(QStringLiteral("fake"), compilerPath, false, QStringLiteral("GCC"));
+        compiler.prefetch(Utils::Cpp, QStringLiteral("-std=c++17"));
+        QCOMPARE(compiler.defines(Utils::Cpp, QStringLiteral("-std=c++17")).value(QStringLiteral("KDEV_PROBE")),
+                 QStringLiteral("44"));
+    }
+}
+
 void TestCompilerProvider::testStorageBackwardsCompatible()
 {
     auto settings = SettingsManager::globalInstance();
@@ -17,6 +17,7 @@ private Q_SLOTS:
     void cleanupTestCase();
     void testRegisterCompiler();
     void testCompilerIncludesAndDefines();
+    void testProbeCache();
     void testStorageBackwardsCompatible();
     void testCompilerIncludesAndDefinesForProject();
     void testStorageNewSystem();
@@ -0,0 +1,108 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "gitindexcache.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+GitIndexCache::GitIndexCache(Lister lister, IndexLocator indexLocator)
+    : m_lister(std::move(lister))
+    , m_indexLocator(std::move(indexLocator))
+{
+}
+
+QStringList GitIndexCache::trackedFiles(const QDir& repository, const QStringList& paths)
+{
+    const auto cachedFiles = this->files(repository);
+    const auto files = cachedFiles ? *cachedFiles : list(repository);
+
+    QStringList ret;
+    for (const auto& path : paths) {
+        const auto cleanPath = QDir::cleanPath(path);
+        const auto directoryPrefix = cleanPath + QLatin1Char('/');
+        // the files within the path directly follow it, except for siblings such as "path.txt" in between
+        for (auto it = std::lower_bound(files.cbegin(), files.cend(), cleanPath);
+             it != files.cend() && it->startsWith(cleanPath); ++it) {
+            if (it->size() == cleanPath.size() || it->startsWith(directoryPrefix)) {
+                ret.append(*it);
+            }
+        }
+    }
+    return ret;
+}
+
+std::optional<bool> GitIndexCache::isTracked(const QDir& repository, const QString& file)
+{
+    const auto files = this->files(repository);
+    if (!files) {
+        return std::nullopt;
+    }
+    return std::binary_search(files->cbegin(), files->cend(), QDir::cleanPath(file));
+}
+
+QString GitIndexCache::indexPath(const QDir& repository)
+{
+    return entry(repository).indexPath;
+}
+
+void GitIndexCache::invalidateIndex(const QString& indexPath)
+{
+    const auto cleanPath = QDir::cleanPath(indexPath);
+    for (auto& entry : m_entries) {
+        if (entry.indexPath == cleanPath) {
+            entry.filesListed = false;
+            entry.files.clear();
+        }
+    }
+}
+
+GitIndexCache::Entry& GitIndexCache::entry(const QDir& repository)
+{
+    const auto root = repository.absolutePath();
+    auto it = m_entries.find(root);
+    if (it == m_entries.end()) {
+        Entry entry;
+        const auto indexPath = m_indexLocator(repository);
+        if (!indexPath.isEmpty()) {
+            entry.indexPath = QDir::cleanPath(repository.absoluteFilePath(indexPath));
+        }
+        it = m_entries.insert(root, entry);
+    }
+    return *it;
+}
+
+QStringList GitIndexCache::list(const QDir& repository) const
+{
+    const auto root = repository.absolutePath();
+    auto files = m_lister(repository);
+    for (auto& file : files) {
+        file = root + QLatin1Char('/') + file;
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::optional<QStringList> GitIndexCache::files(const QDir& repository)
+{
+    auto& entry = this->entry(repository);
+    const QFileInfo index(entry.indexPath);
+    if (entry.indexPath.isEmpty() || !index.isFile()) {
+        return std::nullopt;
+    }
+
+    const auto lastModified = index.lastModified();
+    const auto size = index.size();
+    if (!entry.filesListed || entry.indexLastModified != lastModified || entry.indexSize != size) {
+        entry.files = list(repository);
+        entry.filesListed = true;
+        entry.indexLastModified = lastModified;
+        entry.indexSize = size;
+    }
+    return entry.files;
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef KDEVPLATFORM_PLUGIN_GITINDEXCACHE_H
+#define KDEVPLATFORM_PLUGIN_GITINDEXCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+class QDir;
+
+/**
+ * Caches the files tracked in git repositories, so that status queries and version control checks
+ * don't have to run `git ls-files` each time.
+ *
+ * The files of a repository are listed again once its index file changed, which is noticed by its
+ * modification time and size, or earlier when the index is invalidated explicitly. The index file is
+ * located by asking git once per repository, as worktrees and submodules keep it outside of their root.
+ */
+class GitIndexCache
+{
+public:
+    /// Lists the files tracked in @p repository, relative to its root
+    using Lister = std::function<QStringList(const QDir& repository)>;
+    /// @return the path of the index file of @p repository, relative to its root or absolute, or an empty string if it is unknown
+    using IndexLocator = std::function<QString(const QDir& repository)>;
+
+    GitIndexCache(Lister lister, IndexLocator indexLocator);
+
+    /// @return the absolute paths of the tracked files of @p repository that are or are within one of @p paths
+    QStringList trackedFiles(const QDir& repository, const QStringList& paths);
+    /**
+     * @return whether the file with the absolute path @p file is tracked in @p repository, or std::nullopt
+     * if the index of @p repository cannot be located so its files are not cached; better ask git about the
+     * single file then
+     */
+    std::optional<bool> isTracked(const QDir& repository, const QString& file);
+
+    /// @return the absolute path of the index file of @p repository, or an empty string if it is unknown
+    QString indexPath(const QDir& repository);
+
+    /// Lists the files of the repositories using the index file @p indexPath again when they are needed next time
+    void invalidateIndex(const QString& indexPath);
+
+private:
+    struct Entry
+    {
+        /// empty if the index could not be located
+        QString indexPath;
+        bool filesListed = false;
+        QDateTime indexLastModified;
+        qint64 indexSize = -1;
+        /// sorted absolute paths
+        QStringList files;
+    };
+
+    Entry& entry(const QDir& repository);
+    /// @return the sorted absolute paths of the tracked files of @p repository
+    QStringList list(const QDir& repository) const;
+    /// @return the sorted absolute paths of the tracked files of @p repository, or std::nullopt if they are not cached
+    std::optional<QStringList> files(const QDir& repository);
+
+    Lister m_lister;
+    IndexLocator m_indexLocator;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_GITINDEXCACHE_H
@@ -20,6 +20,7 @@
 #include <QTimer>
 #include <QRegExp>
 #include <QRegularExpression>
+#include <QSet>
 #include <QPointer>
 #include <QTemporaryFile>
 #include <QVersionNumber>
@@ -178,6 +179,18 @@ QDir urlDir(const QList<QUrl>& urls) { return urlDir(urls.first()); } //TODO: co
 
 GitPlugin::GitPlugin(QObject* parent, const KPluginMetaData& metaData, const QVariantList&)
     : DistributedVersionControlPlugin(QStringLiteral("kdevgit"), parent, metaData)
+    , m_indexCache([this](const QDir& repository) {
+        return getLsFiles(repository, QStringList(QStringLiteral("-c")), OutputJob::Silent);
+    }, [this](const QDir& repository) {
+        // worktrees and submodules don't keep their index in .git/index
+        QScopedPointer<DVcsJob> job(gitRevParse(repository.absolutePath(),
+                                                {QStringLiteral("--git-path"), QStringLiteral("index")},
+                                                OutputJob::Silent));
+        if (job->exec() && job->status() == KDevelop::VcsJob::JobSucceeded)
+            return job->output().trimmed();
+
+        return QString();
+    })
     , m_repoStatusModel(new RepoStatusModel(this))
     , m_commitToolViewFactory(new CommitToolViewFactory(m_repoStatusModel))
 {
@@ -354,10 +367,15 @@ bool GitPlugin::isVersionControlled(const QUrl &path)
         return isValidDirectory(path);
     }
 
-    QString filename = fsObject.fileName();
+    const QDir dir = dotGitDirectory(path);
+    if (const auto tracked = m_indexCache.isTracked(dir, fsObject.absoluteFilePath())) {
+        return *tracked;
+    }
 
-    QStringList otherFiles = getLsFiles(fsObject.dir(), QStringList(QStringLiteral("--")) << filename, KDevelop::OutputJob::Silent);
-    return !otherFiles.empty();
+    // the files are not cached without a known index, ask about this one only
+    const QStringList listfiles = getLsFiles(fsObject.dir(), QStringList(QStringLiteral("--")) << fsObject.fileName(),
+                                             OutputJob::Silent);
+    return !listfiles.empty();
 }
 
 VcsJob* GitPlugin::init(const QUrl &directory)
@@ -1415,7 +1433,7 @@ void GitPlugin::parseGitStatusOutput(DVcsJob* job)
     QDir dotGit = dotGitDirectory(QUrl::fromLocalFile(workingDir.absolutePath()));
 
     QVariantList statuses;
-    QList<QUrl> processedFiles;
+    QSet<QUrl> processedFiles;
 
     for (const auto line : outputLines) {
         //every line is 2 chars for the status, 1 space then the file desc
@@ -1432,7 +1450,7 @@ void GitPlugin::parseGitStatusOutput(DVcsJob* job)
             status.setUrl(QUrl::fromLocalFile(dotGit.absoluteFilePath(curr.first(arrow).toString())));
             status.setState(VcsStatusInfo::ItemDeleted);
             statuses.append(QVariant::fromValue<VcsStatusInfo>(status));
-            processedFiles += status.url();
+            processedFiles.insert(status.url());
 
             curr = curr.sliced(arrow + 4);
         }
@@ -1448,7 +1466,7 @@ void GitPlugin::parseGitStatusOutput(DVcsJob* job)
         status.setUrl(QUrl::fromLocalFile(dotGit.absoluteFilePath(curr.toString())));
         status.setExtendedState(ex_state);
         status.setState(extendedStateToBasic(ex_state));
-        processedFiles.append(status.url());
+        processedFiles.insert(status.url());
 
         qCDebug(PLUGIN_GIT) << "Checking git status for " << line << curr << status.state();
 
@@ -1459,12 +1477,12 @@ void GitPlugin::parseGitStatusOutput(DVcsJob* job)
     QStringList::const_iterator it=oldcmd.constBegin()+oldcmd.indexOf(QStringLiteral("--"))+1, itEnd=oldcmd.constEnd();
     paths.reserve(oldcmd.size());
     for(; it!=itEnd; ++it)
-        paths += *it;
+        paths += workingDir.absoluteFilePath(*it);
 
     //here we add the already up to date files
-    const QStringList files = getLsFiles(job->directory(), QStringList{QStringLiteral("-c"), QStringLiteral("--")} << paths, OutputJob::Silent);
+    const QStringList files = m_indexCache.trackedFiles(dotGit, paths);
     for (const QString& file : files) {
-        QUrl fileUrl = QUrl::fromLocalFile(workingDir.absoluteFilePath(file));
+        QUrl fileUrl = QUrl::fromLocalFile(file);
 
         if(!processedFiles.contains(fileUrl)) {
             VcsStatusInfo status;
@@ -1782,10 +1800,19 @@ void GitPlugin::registerRepositoryForCurrentBranchChanges(const QUrl& repository
     QDir dir = dotGitDirectory(repository);
     QString headFile = dir.absoluteFilePath(QStringLiteral(".git/HEAD"));
     m_watcher->addFile(headFile);
+    const QString indexFile = m_indexCache.indexPath(dir);
+    if (!indexFile.isEmpty()) {
+        m_watcher->addFile(indexFile);
+    }
 }
 
 void GitPlugin::fileChanged(const QString& file)
 {
+    if (file.endsWith(QLatin1String("/index"))) {
+        m_indexCache.invalidateIndex(file);
+        return;
+    }
+
     Q_ASSERT(file.endsWith(QLatin1String("HEAD")));
     //SMTH/.git/HEAD -> SMTH/
     const QUrl fileUrl = Path(file).parent().parent().toUrl();
@@ -15,6 +15,8 @@
 #include <outputview/outputjob.h>
 #include <vcs/vcsjob.h>
 
+#include "gitindexcache.h"
+
 #include <QDateTime>
 
 class KDirWatch;
@@ -349,6 +351,7 @@ private:
 
     KDirWatch* m_watcher;
     QList<QUrl> m_branchesChange;
+    GitIndexCache m_indexCache;
     bool m_usePrefix = true;
 
     /** A tree model tracking and classifying changes into staged, unstaged and untracked */
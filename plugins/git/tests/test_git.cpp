@@ -127,10 +127,15 @@ void GitInitTest::addFiles()
     VcsJob* j = m_plugin->status(QList<QUrl>() << QUrl::fromLocalFile(gitTest_BaseDir()));
     VERIFYJOB(j);
 
+    QVERIFY(!m_plugin->isVersionControlled(QUrl::fromLocalFile(gitTest_BaseDir() + gitTest_FileName())));
+
     // /tmp/kdevGit_testdir/ and testfile
     j = m_plugin->add(QList<QUrl>() << QUrl::fromLocalFile(gitTest_BaseDir() + gitTest_FileName()));
     VERIFYJOB(j);
 
+    // the cached list of tracked files notices the changed index
+    QVERIFY(m_plugin->isVersionControlled(QUrl::fromLocalFile(gitTest_BaseDir() + gitTest_FileName())));
+
     QVERIFY(writeFile(gitSrcDir() + gitTest_FileName3(), QStringLiteral("No, foo()! It's bar()!")));
 
     //test git-status exitCode again
@@ -12,12 +12,17 @@
 #include "grepfindthread.h"
 #include "grepoutputmodel.h"
 #include "greputil.h"
+#include "trigramindex.h"
 
 #include "debug.h"
 
+#include <QByteArrayView>
+#include <QDateTime>
 #include <QDebug>
 #include <QFile>
-#include <QTextStream>
+#include <QStringDecoder>
+#include <QStringTokenizer>
+#include <QThreadPool>
 
 #include <KEncodingProber>
 #include <KLocalizedString>
@@ -26,8 +31,40 @@
 #include <interfaces/icore.h>
 #include <interfaces/iuicontroller.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
 using namespace KDevelop;
 
+/// Which files may contain the required literal of a search according to the trigram indexes
+struct GrepCandidateFilter
+{
+    std::vector<std::pair<std::shared_ptr<TrigramIndex>, TrigramIndex::Query>> queries;
+
+    /// This checks the file system for the files excluded by an index, so it is called by the workers.
+    bool mayContain(const QString& path) const
+    {
+        return std::all_of(queries.begin(), queries.end(), [&path](const auto& query) {
+            return query.first->mayContain(query.second, path);
+        });
+    }
+};
+
+struct GrepBatch
+{
+    QList<QUrl> files;
+    std::shared_ptr<const GrepCandidateFilter> candidateFilter;
+    /// The matches in files[i] are stored in results[i] by the worker that searched it
+    std::vector<GrepOutputItem::List> results;
+    std::atomic<int> nextFile = 0;
+    std::atomic<int> runningWorkers = 0;
+    std::atomic<bool> cancelled = false;
+};
+
 QDebug operator<<(QDebug debug, const GrepJobSettings& s)
 {
     const QDebugStateSaver saver(debug);
@@ -68,66 +105,175 @@ QDebug operator<<(QDebug debug, const GrepJobSettings& s)
     return debug;
 }
 
+namespace {
+/// Files are searched in batches of this many files per thread, the results of a batch are shown at once
+constexpr int FilesPerThreadInBatch = 16;
+/// Files are decoded and searched in chunks of about this many bytes, rounded to whole lines
+constexpr qsizetype GrepChunkSize = 1024 * 1024;
+/// Larger files are read instead of mapped
+constexpr qsizetype MaxMappedFileSize = 16 * 1024 * 1024;
+/// Files modified more recently are read instead of mapped, as they may still be written to
+constexpr qint64 MinMappedFileAgeSecs = 2;
+
+bool containsAsciiLiteral(QByteArrayView data, QByteArrayView literal, Qt::CaseSensitivity caseSensitivity)
+{
+    if (caseSensitivity == Qt::CaseSensitive) {
+        return data.indexOf(literal) != -1;
+    }
+
+    const auto toLower = [](char ch) {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    };
+    const auto hash = [toLower](char ch) {
+        return std::hash<char>()(toLower(ch));
+    };
+    const auto equal = [toLower](char a, char b) {
+        return toLower(a) == toLower(b);
+    };
+    const std::boyer_moore_horspool_searcher searcher(literal.begin(), literal.end(), hash, equal);
+    return std::search(data.begin(), data.end(), searcher) != data.end();
+}
+}
+
 GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re)
+{
+    return grepFile(filename, re, requiredLiteral(re));
+}
+
+GrepOutputItem::List grepFile(const QString& filename, const QRegExp& re, const QString& literal)
 {
     GrepOutputItem::List res;
     QFile file(filename);
 
     if(!file.open(QIODevice::ReadOnly))
         return res;
-    int lineno = 0;
-
 
-    // detect encoding (unicode files can be feed forever, stops when confidence reachs 99%
-    KEncodingProber prober;
-    while(!file.atEnd() && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99) {
-        prober.feed(file.read(0xFF));
+    // map the file instead of reading it if possible, files that cannot match are never copied then;
+    // a mapping faults when the file is truncated meanwhile, so files that may still be written to are read,
+    // as are large files, which would otherwise occupy their whole size in the address space of every worker
+    QByteArrayView mapped;
+    if (const auto size = file.size(); size > 0 && size <= MaxMappedFileSize
+        && file.fileTime(QFileDevice::FileModificationTime).secsTo(QDateTime::currentDateTimeUtc())
+            >= MinMappedFileAgeSecs) {
+        if (const uchar* data = file.map(0, size)) {
+            mapped = QByteArrayView(data, size);
+        }
     }
 
-    // reads file with detected encoding
-    file.seek(0);
-    // TODO: consider using QIODevice::readLine() and QStringDecoder in place of QTextStream.
-    // The reason is the following paragraph in the documentation of QStringConverter::encodingForName():
-    //      If the name is not the name of a codec listed in the Encoding enumeration, std::nullopt
-    //      is returned. Such a name may, none the less, be accepted by the QStringConverter
-    //      constructor when Qt is built with ICU, if ICU provides a converter with the given name.
-    // The code inside the following `if` block replaced the line `stream.setCodec(prober.encoding().constData());`
-    // during porting from Qt 5 to Qt 6. The function QTextStream::setCodec(const char *codecName)
-    // removed in Qt 6 had probably supported ICU codec names.
-    QTextStream stream(&file);
-    if (prober.confidence() > 0.7) {
-        const auto encoding = QStringConverter::encodingForName(prober.encoding().constData());
-        if (encoding) {
-            stream.setEncoding(*encoding);
+    // the file is searched in chunks of whole lines, so that only one chunk at a time is decoded
+    qsizetype mappedPos = 0;
+    QByteArray readBuffer;
+    QByteArray chunkBuffer;
+    const auto nextChunk = [&]() -> QByteArrayView {
+        if (!mapped.isNull()) {
+            if (mappedPos >= mapped.size()) {
+                return {};
+            }
+            qsizetype end = mapped.size();
+            if (mappedPos + GrepChunkSize < mapped.size()) {
+                const auto newline = mapped.indexOf('\n', mappedPos + GrepChunkSize);
+                if (newline != -1) {
+                    end = newline + 1;
+                }
+            }
+            const auto chunk = mapped.sliced(mappedPos, end - mappedPos);
+            mappedPos = end;
+            return chunk;
         }
-    }
-    while( !stream.atEnd() )
-    {
-        QString data = stream.readLine();
 
+        while (true) {
+            const auto read = file.read(GrepChunkSize);
+            const auto newline = read.lastIndexOf('\n');
+            readBuffer += read;
+            if (read.isEmpty() || newline != -1) {
+                const auto end = read.isEmpty() ? readBuffer.size() : readBuffer.size() - read.size() + newline + 1;
+                chunkBuffer = readBuffer.first(end);
+                readBuffer.remove(0, end);
+                return chunkBuffer;
+            }
+        }
+    };
+
+    const bool asciiLiteral = !literal.isEmpty() && isAscii(literal);
+    const QByteArray latin1Literal = asciiLiteral ? literal.toLatin1() : QByteArray();
+    bool asciiCompatible = false;
+    std::optional<QStringDecoder> decoder;
+
+    QRegExp regExp(re);
+    int lineno = 0;
+    const auto searchLine = [&](QStringView line) {
         // remove line terminators (in order to not match them)
-        for (int pos = data.length()-1; pos >= 0 && (data[pos] == QLatin1Char('\r') || data[pos] == QLatin1Char('\n')); pos--) {
-            data.chop(1);
+        while (line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+
+        if (asciiLiteral && !line.contains(literal, re.caseSensitivity())) {
+            lineno++;
+            return;
         }
 
+        const QString lineText = line.toString();
         int offset = 0;
         // allow empty string matching result in an infinite loop !
-        while( re.indexIn(data, offset)!=-1 && re.cap(0).length() > 0 )
+        while( regExp.indexIn(lineText, offset)!=-1 && regExp.cap(0).length() > 0 )
         {
-            int start = re.pos(0);
-            int end = start + re.cap(0).length();
+            int start = regExp.pos(0);
+            int end = start + regExp.cap(0).length();
 
             DocumentChangePointer change = DocumentChangePointer(new DocumentChange(
                 IndexedString(filename),
                 KTextEditor::Range(lineno, start, lineno, end),
-                re.cap(0), QString()));
+                regExp.cap(0), QString()));
 
-            res << GrepOutputItem(change, data, false);
+            res << GrepOutputItem(change, lineText, false);
             offset = end;
         }
         lineno++;
+    };
+
+    // the decoded start of a line that continues in the next chunk, chunks of ASCII-compatible files end with
+    // complete lines
+    QString partialLine;
+    for (auto chunk = nextChunk(); !chunk.isEmpty(); chunk = nextChunk()) {
+        if (!decoder) {
+            asciiCompatible = isAsciiCompatible(chunk);
+
+            // detect encoding (unicode files can be feed forever, stops when confidence reachs 99%
+            KEncodingProber prober;
+            for (qsizetype pos = 0;
+                 pos < chunk.size() && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99;
+                 pos += 0xFF) {
+                const auto probe = chunk.sliced(pos, std::min<qsizetype>(0xFF, chunk.size() - pos));
+                prober.feed(QByteArray::fromRawData(probe.data(), probe.size()));
+            }
+
+            // decodes file with detected encoding, the name based constructor also accepts the codecs provided by ICU
+            QByteArray encoding = QByteArrayLiteral("UTF-8");
+            if (prober.confidence() > 0.7 && QStringDecoder(prober.encoding().constData()).isValid()) {
+                encoding = prober.encoding();
+            }
+            decoder.emplace(encoding.constData());
+        }
+
+        // every match contains the literal, so skip chunks that do not contain it without decoding them
+        if (asciiLiteral && asciiCompatible && partialLine.isEmpty()
+            && !containsAsciiLiteral(chunk, latin1Literal, re.caseSensitivity())) {
+            lineno += chunk.count('\n');
+            continue;
+        }
+
+        const QString text = partialLine + decoder->decode(chunk);
+        const auto lastNewline = text.lastIndexOf(QLatin1Char('\n'));
+        if (lastNewline != -1) {
+            for (QStringView line : qTokenize(QStringView(text).first(lastNewline), u'\n')) {
+                searchLine(line);
+            }
+        }
+        partialLine = text.sliced(lastNewline + 1);
+    }
+    if (!partialLine.isEmpty()) {
+        searchLine(partialLine);
     }
-    file.close();
     return res;
 }
 
@@ -139,6 +285,7 @@ GrepJob::GrepJob( QObject* parent )
     , m_findSomething(false)
 {
     qRegisterMetaType<GrepOutputItem::List>();
+    qRegisterMetaType<GrepOutputBatch>();
 
     setCapabilities(Killable);
     KDevelop::ICore::self()->uiController()->registerStatus(this);
@@ -202,6 +349,16 @@ void GrepJob::slotFindFinished()
         m_regExp.setPatternSyntax(QRegExp::Wildcard);
     }
 
+    m_requiredLiteral = requiredLiteral(m_regExp);
+    auto candidateFilter = std::make_shared<GrepCandidateFilter>();
+    for (const auto& index : std::as_const(m_trigramIndexes)) {
+        auto query = index->query(m_requiredLiteral);
+        if (!query.allFiles) {
+            candidateFilter->queries.emplace_back(index, std::move(query));
+        }
+    }
+    m_candidateFilter = std::move(candidateFilter);
+
     if (m_outputModel) {
         m_outputModel->setRegExp(m_regExp);
         m_outputModel->setReplacementTemplate(m_settings.replacementTemplate);
@@ -219,6 +376,7 @@ void GrepJob::slotFindFinished()
 void GrepJob::slotWork()
 {
     Q_ASSERT(!m_findThread);
+    Q_ASSERT(!m_batch);
 
     switch(m_workState)
     {
@@ -241,19 +399,7 @@ void GrepJob::slotWork()
             if(m_fileIndex < m_fileList.length())
             {
                 emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
-                if(m_fileIndex < m_fileList.length()) {
-                    QString file = m_fileList[m_fileIndex].toLocalFile();
-                    GrepOutputItem::List items = grepFile(file, m_regExp);
-
-                    if(!items.isEmpty())
-                    {
-                        m_findSomething = true;
-                        emit foundMatches(file, items);
-                    }
-
-                    m_fileIndex++;
-                }
-                QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
+                startGrepBatch();
             }
             else
             {
@@ -266,6 +412,62 @@ void GrepJob::slotWork()
     }
 }
 
+void GrepJob::startGrepBatch()
+{
+    auto* const threadPool = QThreadPool::globalInstance();
+    const int threadCount = std::max(1, threadPool->maxThreadCount());
+    const int batchSize = std::min(threadCount * FilesPerThreadInBatch, int(m_fileList.size()) - m_fileIndex);
+    const int workerCount = std::min(threadCount, batchSize);
+
+    m_batch = std::make_shared<GrepBatch>();
+    m_batch->files = m_fileList.mid(m_fileIndex, batchSize);
+    m_batch->candidateFilter = m_candidateFilter;
+    m_batch->results.resize(batchSize);
+    m_batch->runningWorkers = workerCount;
+
+    for (int i = 0; i < workerCount; ++i) {
+        // QRegExp is reentrant but not thread-safe, so every worker matches with its own copy
+        threadPool->start([this, batch = m_batch, re = QRegExp(m_regExp), literal = m_requiredLiteral]() {
+            for (int index = batch->nextFile++; index < batch->files.size() && !batch->cancelled;
+                 index = batch->nextFile++) {
+                const auto path = batch->files[index].toLocalFile();
+                if (batch->candidateFilter->mayContain(path)) {
+                    batch->results[index] = grepFile(path, re, literal);
+                }
+            }
+            if (--batch->runningWorkers == 0) {
+                QMetaObject::invokeMethod(this, &GrepJob::finishGrepBatch, Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void GrepJob::finishGrepBatch()
+{
+    Q_ASSERT(m_batch && m_batch->runningWorkers == 0);
+    const auto batch = std::move(m_batch);
+
+    if (m_workState == WorkCancelled) {
+        dieAfterCancellation();
+        return;
+    }
+    Q_ASSERT(m_workState == WorkGrep);
+
+    GrepOutputBatch matches;
+    for (int i = 0; i < batch->files.size(); ++i) {
+        if (!batch->results[i].isEmpty()) {
+            matches.append(GrepFileMatches{batch->files[i].toLocalFile(), std::move(batch->results[i])});
+        }
+    }
+    if (!matches.isEmpty()) {
+        m_findSomething = true;
+        emit foundMatches(matches);
+    }
+
+    m_fileIndex += batch->files.size();
+    QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
+}
+
 void GrepJob::die()
 {
     emit hideProgress(this);
@@ -293,7 +495,7 @@ void GrepJob::start()
     m_outputModel->clear();
 
     connect(this, &GrepJob::foundMatches,
-            m_outputModel, &GrepOutputModel::appendOutputs, Qt::QueuedConnection);
+            m_outputModel, &GrepOutputModel::appendOutputBatch, Qt::QueuedConnection);
 
     QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
 }
@@ -309,10 +511,15 @@ bool GrepJob::doKill()
             Q_ASSERT(m_workState == WorkCollectFiles);
             m_findThread->tryAbort();
         }
+        if (m_batch) {
+            Q_ASSERT(m_workState == WorkGrep);
+            m_batch->cancelled = true;
+        }
         m_workState = WorkCancelled;
     }
     // Do not let KJob finish immediately if the state was neither Unstarted nor Dead:
     // * If m_findThread != nullptr, let it finish first.
+    // * If m_batch != nullptr, let its workers finish first.
     // * Otherwise, slotWork() is about to be invoked. Don't want this to be destroyed by KJob before that happens.
     return false;
 }
@@ -348,6 +555,11 @@ void GrepJob::setSettings(const GrepJobSettings& settings)
     setObjectName(i18n("Grep: %1", m_settings.pattern));
 }
 
+void GrepJob::setTrigramIndexes(const QList<std::shared_ptr<TrigramIndex>>& indexes)
+{
+    m_trigramIndexes = indexes;
+}
+
 GrepJobSettings GrepJob::settings() const
 {
     return m_settings;
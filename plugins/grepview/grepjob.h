@@ -22,6 +22,8 @@
 
 #include "grepoutputmodel.h"
 
+#include <memory>
+
 namespace KDevelop
 {
     class IProject;
@@ -30,6 +32,10 @@ namespace KDevelop
 class GrepFindFilesThread;
 class GrepViewPlugin;
 class FindReplaceTest; //FIXME: this is useful only for tests
+class BenchFindReplace;
+class TrigramIndex;
+struct GrepCandidateFilter;
+struct GrepBatch;
 
 class QDebug;
 
@@ -62,6 +68,7 @@ class GrepJob : public KJob, public KDevelop::IStatus
 
     friend class GrepViewPlugin;
     friend class FindReplaceTest;
+    friend class BenchFindReplace;
 
 private:
     ///Job can only be instanciated by plugin
@@ -75,6 +82,8 @@ public:
 
     void setOutputModel(GrepOutputModel * model);
     void setDirectoryChoice(const QList<QUrl> &choice);
+    /// Sets the indexes used to skip files which cannot contain a match
+    void setTrigramIndexes(const QList<std::shared_ptr<TrigramIndex>>& indexes);
 
     void start() override;
 
@@ -92,18 +101,27 @@ Q_SIGNALS:
     void showErrorMessage(const QString& message, int timeout = 5) override;
     void hideProgress( KDevelop::IStatus* ) override;
     void showProgress( KDevelop::IStatus*, int minimum, int maximum, int value) override;
-    void foundMatches( const QString& filename, const GrepOutputItem::List& matches);
+    void foundMatches(const GrepOutputBatch& matches);
 
 private:
     Q_INVOKABLE void slotWork();
+    /// Greps the next files of m_fileList in parallel on the global thread pool.
+    void startGrepBatch();
+    /// Reports the results of the batch that has just finished and continues with the next step.
+    void finishGrepBatch();
     void die();
     void dieAfterCancellation();
 
     QList<QUrl> m_directoryChoice;
+    QList<std::shared_ptr<TrigramIndex>> m_trigramIndexes;
     QString m_errorMessage;
 
     QRegExp m_regExp;
     QString m_regExpSimple;
+    /// A string which every match of m_regExp contains, used to skip files and lines quickly.
+    QString m_requiredLiteral;
+    /// Skips the files which cannot contain m_requiredLiteral according to m_trigramIndexes.
+    std::shared_ptr<const GrepCandidateFilter> m_candidateFilter;
     QPointer<GrepOutputModel> m_outputModel;
 
     enum {
@@ -118,6 +136,7 @@ private:
     QList<QUrl> m_fileList;
     int m_fileIndex;
     GrepFindFilesThread* m_findThread;
+    std::shared_ptr<GrepBatch> m_batch;
 
     GrepJobSettings m_settings;
 
@@ -127,5 +146,7 @@ private:
 //FIXME: this function is used externally only for tests, find a way to keep it
 //       static for a regular compilation
 GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re);
+/// @param requiredLiteral a string that every match of @p re contains, see requiredLiteral()
+GrepOutputItem::List grepFile(const QString& filename, const QRegExp& re, const QString& requiredLiteral);
 
 #endif
@@ -387,7 +387,27 @@ void GrepOutputModel::appendOutputs( const QString &filename, const GrepOutputIt
 {
     if(items.isEmpty())
         return;
-    
+
+    appendFileItem(filename, items);
+    updateRootItemText();
+}
+
+void GrepOutputModel::appendOutputBatch(const GrepOutputBatch& batch)
+{
+    bool appended = false;
+    for (const auto& file : batch) {
+        if (!file.matches.isEmpty()) {
+            appendFileItem(file.filename, file.matches);
+            appended = true;
+        }
+    }
+    if (appended) {
+        updateRootItemText();
+    }
+}
+
+void GrepOutputModel::appendFileItem(const QString& filename, const GrepOutputItem::List& items)
+{
     if(rowCount() == 0)
     {
         m_rootItem = new GrepOutputItem(QString(), QString(), m_itemsCheckable);
@@ -397,11 +417,6 @@ void GrepOutputModel::appendOutputs( const QString &filename, const GrepOutputIt
     m_fileCount  += 1;
     m_matchCount += items.length();
 
-    const QString matchText = i18np("<b>1</b> match", "<b>%1</b> matches", m_matchCount);
-    const QString fileText = i18np("<b>1</b> file", "<b>%1</b> files", m_fileCount);
-
-    m_rootItem->setText(i18nc("%1 is e.g. '4 matches', %2 is e.g. '1 file'", "<b>%1 in %2</b>", matchText, fileText));
-    
     QString fnString = i18np("%2: 1 match", "%2: %1 matches",
                              items.length(), ICore::self()->projectController()->prettyFileName(QUrl::fromLocalFile(filename)));
 
@@ -421,6 +436,14 @@ void GrepOutputModel::appendOutputs( const QString &filename, const GrepOutputIt
     }
 }
 
+void GrepOutputModel::updateRootItemText()
+{
+    const QString matchText = i18np("<b>1</b> match", "<b>%1</b> matches", m_matchCount);
+    const QString fileText = i18np("<b>1</b> file", "<b>%1</b> files", m_fileCount);
+
+    m_rootItem->setText(i18nc("%1 is e.g. '4 matches', %2 is e.g. '1 file'", "<b>%1 in %2</b>", matchText, fileText));
+}
+
 void GrepOutputModel::updateCheckState(QStandardItem* item)
 {
     // if we don't disconnect the SIGNAL, the setCheckState will call it in loop
@@ -71,6 +71,16 @@ private:
 
 Q_DECLARE_METATYPE(GrepOutputItem::List)
 
+/// The matches found in a batch of files, see GrepOutputModel::appendOutputBatch()
+struct GrepFileMatches
+{
+    QString filename;
+    GrepOutputItem::List matches;
+};
+using GrepOutputBatch = QList<GrepFileMatches>;
+
+Q_DECLARE_METATYPE(GrepOutputBatch)
+
 class GrepOutputModel : public QStandardItemModel
 {
     Q_OBJECT
@@ -95,6 +105,8 @@ public:
     
 public Q_SLOTS:
     void appendOutputs( const QString &filename, const GrepOutputItem::List &lines );
+    /// Like appendOutputs() for each file in @p batch, but updates the summary only once
+    void appendOutputBatch(const GrepOutputBatch& batch);
     void activate( const QModelIndex &idx );
     void doReplacements();
     void setReplacement(const QString &repl);
@@ -110,6 +122,8 @@ Q_SIGNALS:
 
 private:    
     void makeItemsCheckable(bool checkable, GrepOutputItem* item);
+    void appendFileItem(const QString& filename, const GrepOutputItem::List& items);
+    void updateRootItemText();
     
     QRegExp m_regExp;
     QString m_replacement;
@@ -7,8 +7,10 @@
 #include "greputil.h"
 
 #include <algorithm>
+#include <QByteArrayView>
 #include <QChar>
 #include <QComboBox>
+#include <QRegExp>
 
 static int const MAX_LAST_SEARCH_ITEMS_COUNT = 15;
 
@@ -36,6 +38,123 @@ QString substitudePattern(const QString& pattern, const QString& searchString)
     return result;
 }
 
+static bool isHexDigit(QChar ch)
+{
+    return (ch >= QLatin1Char('0') && ch <= QLatin1Char('9')) || (ch >= QLatin1Char('a') && ch <= QLatin1Char('f'))
+        || (ch >= QLatin1Char('A') && ch <= QLatin1Char('F'));
+}
+
+QString requiredLiteral(const QRegExp& re)
+{
+    const QString pattern = re.pattern();
+
+    switch (re.patternSyntax()) {
+    case QRegExp::FixedString:
+        return pattern;
+    case QRegExp::RegExp:
+    case QRegExp::RegExp2:
+    case QRegExp::Wildcard:
+    case QRegExp::WildcardUnix:
+        break;
+    default:
+        return QString();
+    }
+
+    const bool wildcard = re.patternSyntax() == QRegExp::Wildcard || re.patternSyntax() == QRegExp::WildcardUnix;
+
+    QString longest;
+    QString current;
+    const auto endLiteral = [&longest, &current]() {
+        if (current.size() > longest.size()) {
+            longest = current;
+        }
+        current.clear();
+    };
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar ch = pattern[i];
+        if (wildcard) {
+            if (ch == QLatin1Char('*') || ch == QLatin1Char('?') || ch == QLatin1Char('[') || ch == QLatin1Char('\\')) {
+                // the contents of a character set cannot be part of a literal anyway
+                endLiteral();
+            } else {
+                current.append(ch);
+            }
+            continue;
+        }
+
+        switch (ch.unicode()) {
+        case '|':
+        case '(':
+        case ')':
+            // alternatives and groups could make any part of the pattern optional, don't analyze them
+            return QString();
+        case '\\':
+            if (i + 1 < pattern.size() && !pattern[i + 1].isLetterOrNumber()) {
+                current.append(pattern[++i]);
+            } else {
+                // character class, assertion, back reference or character code
+                endLiteral();
+                ++i;
+                // skip the digits of \xhhhh and \0ooo, so that they are not taken as literal characters
+                int digits = 0;
+                if (i < pattern.size() && pattern[i] == QLatin1Char('x')) {
+                    while (digits < 4 && i + 1 < pattern.size() && isHexDigit(pattern[i + 1])) {
+                        ++i;
+                        ++digits;
+                    }
+                } else if (i < pattern.size() && pattern[i] == QLatin1Char('0')) {
+                    while (digits < 3 && i + 1 < pattern.size() && pattern[i + 1] >= QLatin1Char('0')
+                           && pattern[i + 1] <= QLatin1Char('7')) {
+                        ++i;
+                        ++digits;
+                    }
+                }
+            }
+            break;
+        case '[':
+            endLiteral();
+            // skip the character set, a leading ']' belongs to the set
+            i += (i + 1 < pattern.size() && pattern[i + 1] == QLatin1Char('^')) ? 2 : 1;
+            if (i < pattern.size() && pattern[i] == QLatin1Char(']')) {
+                ++i;
+            }
+            for (; i < pattern.size() && pattern[i] != QLatin1Char(']'); ++i) {
+                if (pattern[i] == QLatin1Char('\\')) {
+                    ++i;
+                }
+            }
+            break;
+        case '*':
+        case '?':
+        case '{':
+            // the preceding character is optional
+            current.chop(1);
+            endLiteral();
+            if (ch == QLatin1Char('{')) {
+                while (i < pattern.size() && pattern[i] != QLatin1Char('}')) {
+                    ++i;
+                }
+            }
+            break;
+        case '+':
+            // the preceding character is required, but what follows it need not be adjacent
+            endLiteral();
+            break;
+        case '.':
+        case '^':
+        case '$':
+            endLiteral();
+            break;
+        default:
+            current.append(ch);
+        }
+    }
+    endLiteral();
+
+    return longest;
+}
+
 QStringList qCombo2StringList( QComboBox* combo, bool allowEmpty )
 {
     QStringList list;
@@ -58,3 +177,19 @@ QStringList qCombo2StringList( QComboBox* combo, bool allowEmpty )
     return list;
 }
 
+bool isAscii(const QString& text)
+{
+    return std::all_of(text.cbegin(), text.cend(), [](QChar ch) {
+        return ch.unicode() < 0x80;
+    });
+}
+
+bool isAsciiCompatible(QByteArrayView data)
+{
+    if (data.startsWith("\xFF\xFE") || data.startsWith("\xFE\xFF")) {
+        return false;
+    }
+    // UTF-16 and UTF-32 encode ASCII characters with null bytes
+    const auto probe = data.first(std::min<qsizetype>(data.size(), 4096));
+    return !probe.contains('\0');
+}
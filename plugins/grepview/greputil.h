@@ -10,7 +10,9 @@
 
 #include <QStringList>
 
+class QByteArrayView;
 class QComboBox;
+class QRegExp;
 
 /// Returns the contents of a QComboBox as a QStringList
 QStringList qCombo2StringList( QComboBox* combo, bool allowEmpty = false );
@@ -18,4 +20,14 @@ QStringList qCombo2StringList( QComboBox* combo, bool allowEmpty = false );
 /// Replaces each occurrence of "%s" in pattern by searchString (and "%%" by "%")
 QString substitudePattern(const QString& pattern, const QString& searchString);
 
+/// Returns the longest literal text that every match of @p re contains, or an empty string if none is known.
+/// Matching the case sensitivity of @p re is left to the caller.
+QString requiredLiteral(const QRegExp& re);
+
+/// Returns whether @p text consists of ASCII characters only
+bool isAscii(const QString& text);
+
+/// Returns whether ASCII characters are encoded as single ASCII bytes in @p data, as far as we can tell.
+bool isAsciiCompatible(QByteArrayView data);
+
 #endif
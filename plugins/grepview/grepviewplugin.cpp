@@ -13,6 +13,7 @@
 #include "grepoutputdelegate.h"
 #include "grepjob.h"
 #include "grepoutputview.h"
+#include "trigramindexmanager.h"
 #include "debug.h"
 
 #include <QAction>
@@ -92,6 +93,8 @@ GrepViewPlugin::GrepViewPlugin(QObject* parent, const KPluginMetaData& metaData,
     new GrepOutputDelegate(this);
     m_factory = new GrepOutputViewFactory(this);
     core()->uiController()->addToolView(i18nc("@title:window", "Find/Replace in Files"), m_factory);
+
+    m_trigramIndexManager = new TrigramIndexManager(this);
 }
 
 GrepOutputViewFactory* GrepViewPlugin::toolViewFactory() const
@@ -113,6 +116,8 @@ void GrepViewPlugin::unload()
     }
 
     core()->uiController()->removeToolView(m_factory);
+
+    m_trigramIndexManager->abortJobs();
 }
 
 void GrepViewPlugin::startSearch(const QString& pattern, const QString& directory, bool show)
@@ -223,6 +228,7 @@ GrepJob* GrepViewPlugin::newGrepJob()
         m_currentJob->kill();
     }
     m_currentJob = new GrepJob();
+    m_currentJob->setTrigramIndexes(m_trigramIndexManager->indexes());
     connect(m_currentJob, &GrepJob::finished, this, &GrepViewPlugin::jobFinished);
     return m_currentJob;
 }
@@ -18,6 +18,7 @@ class KJob;
 class GrepDialog;
 class GrepJob;
 class GrepOutputViewFactory;
+class TrigramIndexManager;
 
 class GrepViewPlugin : public KDevelop::IPlugin
 {
@@ -62,6 +63,7 @@ private:
     QString m_directory;
     QString m_contextMenuDirectory;
     GrepOutputViewFactory* m_factory;
+    TrigramIndexManager* m_trigramIndexManager;
 };
 
 #endif
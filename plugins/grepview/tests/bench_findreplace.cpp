@@ -0,0 +1,146 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "bench_findreplace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QTest>
+#include <QUrl>
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+#include "../grepjob.h"
+#include "../grepoutputmodel.h"
+
+using namespace KDevelop;
+
+namespace {
+constexpr int NeedleEveryNthFile = 50;
+
+QString treePath(const QTemporaryDir& tree, int fileCount)
+{
+    return tree.filePath(QStringLiteral("tree%1").arg(fileCount));
+}
+}
+
+void BenchFindReplace::initTestCase()
+{
+    AutoTestShell::init({{}}); // do not load plugins at all
+    TestCore::initialize(Core::NoUi);
+
+    QVERIFY(m_tree.isValid());
+    for (int fileCount : {100, 1000, 10000}) {
+        generateTree(treePath(m_tree, fileCount), fileCount);
+    }
+}
+
+void BenchFindReplace::cleanupTestCase()
+{
+    TestCore::shutdown();
+}
+
+void BenchFindReplace::generateTree(const QString& path, int fileCount)
+{
+    constexpr int FilesPerDirectory = 100;
+    constexpr int LinesPerFile = 200;
+
+    for (int i = 0; i < fileCount; ++i) {
+        const QString dir = path + QStringLiteral("/dir%1").arg(i / FilesPerDirectory);
+        QVERIFY(QDir().mkpath(dir));
+
+        QFile file(dir + QStringLiteral("/file%1.cpp").arg(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QByteArray contents;
+        for (int line = 0; line < LinesPerFile; ++line) {
+            contents += "    int value" + QByteArray::number(line) + " = compute(argument, " + QByteArray::number(i)
+                + "); // some ordinary source code\n";
+            if (i % NeedleEveryNthFile == 0 && line == LinesPerFile / 2) {
+                contents += "    auto needle = findTheNeedle(haystack);\n";
+            }
+        }
+        QCOMPARE(file.write(contents), contents.size());
+    }
+}
+
+void BenchFindReplace::benchGrepJob_data()
+{
+    QTest::addColumn<int>("fileCount");
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<bool>("regexp");
+    QTest::addColumn<bool>("caseSensitive");
+
+    for (int fileCount : {100, 1000, 10000}) {
+        const auto row = [fileCount](const char* name) {
+            return QTest::addRow("%s-%d", name, fileCount) << fileCount;
+        };
+        row("literal") << QStringLiteral("needle") << false << true;
+        row("literal-case-insensitive") << QStringLiteral("NEEDLE") << false << false;
+        row("regexp") << QStringLiteral("find\\w+\\(hay") << true << true;
+        row("regexp-without-literal") << QStringLiteral("\\bne+dle\\b") << true << true;
+        row("no-match") << QStringLiteral("nonexistent") << false << true;
+    }
+}
+
+void BenchFindReplace::benchGrepJob()
+{
+    QFETCH(int, fileCount);
+    QFETCH(QString, pattern);
+    QFETCH(bool, regexp);
+    QFETCH(bool, caseSensitive);
+
+    GrepJobSettings settings;
+    settings.pattern = pattern;
+    settings.regexp = regexp;
+    settings.caseSensitive = caseSensitive;
+    settings.searchTemplate = QStringLiteral("%s");
+    settings.replacementTemplate = QStringLiteral("%s");
+    settings.files = QStringLiteral("*");
+
+    const QList<QUrl> directoryChoice{QUrl::fromLocalFile(treePath(m_tree, fileCount))};
+
+    QBENCHMARK {
+        GrepOutputModel model;
+        auto* const job = new GrepJob;
+        job->setOutputModel(&model);
+        job->setDirectoryChoice(directoryChoice);
+        job->setSettings(settings);
+        QVERIFY(job->exec());
+        // let the model receive the queued results
+        QCoreApplication::processEvents();
+    }
+}
+
+void BenchFindReplace::benchGrepFile_data()
+{
+    QTest::addColumn<QRegExp>("search");
+
+    QTest::newRow("literal") << QRegExp(QStringLiteral("needle"));
+    QTest::newRow("literal-case-insensitive") << QRegExp(QStringLiteral("NEEDLE"), Qt::CaseInsensitive);
+    QTest::newRow("regexp-without-literal") << QRegExp(QStringLiteral("\\bne+dle\\b"));
+    QTest::newRow("no-match") << QRegExp(QStringLiteral("nonexistent"));
+}
+
+void BenchFindReplace::benchGrepFile()
+{
+    QFETCH(QRegExp, search);
+
+    // a file that contains the pattern and one that does not
+    const QString path = treePath(m_tree, 100) + QStringLiteral("/dir0/");
+    const QString matchingFile = path + QStringLiteral("file0.cpp");
+    const QString otherFile = path + QStringLiteral("file1.cpp");
+
+    QBENCHMARK {
+        grepFile(matchingFile, search);
+        grepFile(otherFile, search);
+    }
+}
+
+QTEST_MAIN(BenchFindReplace)
+
+#include "moc_bench_findreplace.cpp"
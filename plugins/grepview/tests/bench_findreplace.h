@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_PLUGIN_BENCHFINDREPLACE_H
+#define KDEVPLATFORM_PLUGIN_BENCHFINDREPLACE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class BenchFindReplace : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchGrepJob();
+    void benchGrepJob_data();
+
+    void benchGrepFile();
+    void benchGrepFile_data();
+
+private:
+    /// Writes @p fileCount generated source files below @p path, the pattern "needle" occurs in every 50th.
+    void generateTree(const QString& path, int fileCount);
+
+    QTemporaryDir m_tree;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_BENCHFINDREPLACE_H
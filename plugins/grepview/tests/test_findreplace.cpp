@@ -9,7 +9,9 @@
 #include "test_findreplace.h"
 
 #include <QByteArray>
+#include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
 #include <QString>
 #include <QStringList>
 #include <QTest>
@@ -27,6 +29,8 @@
 #include "../grepjob.h"
 #include "../grepviewplugin.h"
 #include "../grepoutputmodel.h"
+#include "../greputil.h"
+#include "../trigramindex.h"
 
 #include <iterator>
 #include <vector>
@@ -96,6 +100,43 @@ void FindReplaceTest::testFind_data()
                            << (MatchList() << Match(0, 0, 6));
     QTest::newRow("Matching empty string anywhere") << "foobar\n" << QRegExp("")
                            << (MatchList());
+    QTest::newRow("Case insensitive literal") << "FooBar\nfoobar" << QRegExp("foobar", Qt::CaseInsensitive)
+                           << (MatchList() << Match(0, 0, 6) << Match(1, 0, 6));
+    QTest::newRow("Literal not in file") << "foo\nbaz" << QRegExp("bar", Qt::CaseSensitive, QRegExp::Wildcard)
+                           << (MatchList());
+    QTest::newRow("Optional character in literal") << "fbar\nfobar" << QRegExp("fo?bar")
+                           << (MatchList() << Match(0, 0, 4) << Match(1, 0, 5));
+}
+
+void FindReplaceTest::testRequiredLiteral_data()
+{
+    QTest::addColumn<QRegExp>("search");
+    QTest::addColumn<QString>("literal");
+
+    QTest::newRow("Plain") << QRegExp("foo") << "foo";
+    QTest::newRow("Word boundaries") << QRegExp("\\bfoo\\b") << "foo";
+    QTest::newRow("Escaped characters") << QRegExp("x\\.y->z") << "x.y->z";
+    QTest::newRow("Optional character") << QRegExp("fo?obar") << "obar";
+    QTest::newRow("Repeated character") << QRegExp("ab+cd") << "ab";
+    QTest::newRow("Character set") << QRegExp("[abc]+def") << "def";
+    QTest::newRow("Character set with bracket") << QRegExp("[]x]yz") << "yz";
+    QTest::newRow("Any character") << QRegExp("foo.*barbaz") << "barbaz";
+    QTest::newRow("Alternatives") << QRegExp("foo|bar") << "";
+    QTest::newRow("Group") << QRegExp("(?:foo)?bar") << "";
+    QTest::newRow("Character class only") << QRegExp("\\w+") << "";
+    QTest::newRow("Hexadecimal character code") << QRegExp("\\x41bc") << "";
+    QTest::newRow("Octal character code") << QRegExp("\\0101") << "";
+    QTest::newRow("Character code before literal") << QRegExp("\\x41 foo") << " foo";
+    QTest::newRow("Wildcard") << QRegExp("*.cpp", Qt::CaseSensitive, QRegExp::Wildcard) << ".cpp";
+    QTest::newRow("Fixed string") << QRegExp("a|b", Qt::CaseSensitive, QRegExp::FixedString) << "a|b";
+}
+
+void FindReplaceTest::testRequiredLiteral()
+{
+    QFETCH(QRegExp, search);
+    QFETCH(QString, literal);
+
+    QCOMPARE(requiredLiteral(search), literal);
 }
 
 void FindReplaceTest::testFind()
@@ -125,6 +166,166 @@ void FindReplaceTest::testFind()
     QCOMPARE(QString(file.readAll()), subject);
 }
 
+void FindReplaceTest::testFindInChunks_data()
+{
+    QTest::addColumn<bool>("mapped");
+
+    // recently modified files are read instead of mapped
+    QTest::newRow("read") << false;
+    QTest::newRow("mapped") << true;
+}
+
+void FindReplaceTest::testFindInChunks()
+{
+    QFETCH(bool, mapped);
+
+    // the file spans several chunks, the chunks without matches are skipped by the prefilter
+    const int lineCount = 300000;
+    const QList<int> matchingLines{0, 1, 150000, lineCount - 1};
+    QByteArray subject;
+    for (int line = 0; line < lineCount; ++line) {
+        subject += "line " + QByteArray::number(line) + (matchingLines.contains(line) ? " needle\n" : "\n");
+    }
+    QVERIFY(subject.size() > 3 * 1024 * 1024);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(subject);
+    if (mapped) {
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-3600), QFileDevice::FileModificationTime));
+    }
+    file.close();
+
+    const auto matches = grepFile(file.fileName(), QRegExp(QStringLiteral("needle")));
+    QCOMPARE(matches.size(), matchingLines.size());
+    for (int i = 0; i < matches.size(); ++i) {
+        const auto line = matchingLines[i];
+        const auto lineText = QStringLiteral("line %1 needle").arg(line);
+        QCOMPARE(matches[i].change()->m_range.start().line(), line);
+        QCOMPARE(matches[i].change()->m_range.start().column(), lineText.size() - 6);
+        QCOMPARE(matches[i].text(), lineText);
+    }
+}
+
+void FindReplaceTest::testTrigramIndex()
+{
+    TrigramIndex index(QString{});
+    index.ensureLoaded();
+
+    const auto a = QUrl::fromLocalFile(QStringLiteral("/a.cpp"));
+    const auto b = QUrl::fromLocalFile(QStringLiteral("/b.cpp"));
+    const auto c = QUrl::fromLocalFile(QStringLiteral("/c.cpp"));
+    const auto notIndexed = QUrl::fromLocalFile(QStringLiteral("/d.cpp"));
+    const QList<QUrl> files{a, b, c, notIndexed};
+
+    index.addFile(a.toLocalFile(), 1, 1, "int findNeedle();");
+    index.addFile(b.toLocalFile(), 1, 1, "int haystack();");
+    index.addOpaqueFile(c.toLocalFile(), 1, 1);
+    QCOMPARE(index.indexedFileCount(), 3);
+    QVERIFY(index.isUpToDate(a.toLocalFile(), 1, 1));
+    QVERIFY(!index.isUpToDate(a.toLocalFile(), 2, 1));
+
+    QCOMPARE(index.candidates(files, QStringLiteral("Needle")), (QList<QUrl>{a, c, notIndexed}));
+    QCOMPARE(index.candidates(files, QStringLiteral("needle")), (QList<QUrl>{a, c, notIndexed}));
+    QCOMPARE(index.candidates(files, QStringLiteral("stack")), (QList<QUrl>{b, c, notIndexed}));
+    QCOMPARE(index.candidates(files, QStringLiteral("int ")), files);
+    QCOMPARE(index.candidates(files, QStringLiteral("nowhere")), (QList<QUrl>{c, notIndexed}));
+    // too short or non-ASCII literals do not prune anything
+    QCOMPARE(index.candidates(files, QStringLiteral("xy")), files);
+    QCOMPARE(index.candidates(files, QStringLiteral("n\u00e4dle")), files);
+
+    // a changed file is a candidate until it has been indexed again
+    index.removeFile(a.toLocalFile());
+    QCOMPARE(index.candidates(files, QStringLiteral("nowhere")), (QList<QUrl>{a, c, notIndexed}));
+    index.addFile(a.toLocalFile(), 2, 1, "int nowhere();");
+    QCOMPARE(index.candidates(files, QStringLiteral("needle")), (QList<QUrl>{c, notIndexed}));
+    QCOMPARE(index.candidates(files, QStringLiteral("nowhere")), (QList<QUrl>{a, c, notIndexed}));
+    QCOMPARE(index.indexedFileCount(), 3);
+
+    // a file that is indexed again after a query may contain anything
+    const auto query = index.query(QStringLiteral("haystack"));
+    QVERIFY(!query.allFiles);
+    QVERIFY(!index.mayContain(query, a.toLocalFile()));
+    index.addFile(a.toLocalFile(), 3, 1, "int haystack();");
+    QVERIFY(index.mayContain(query, a.toLocalFile()));
+    QVERIFY(index.mayContain(index.query(QStringLiteral("haystack")), a.toLocalFile()));
+    QVERIFY(index.query(QStringLiteral("xy")).allFiles);
+}
+
+void FindReplaceTest::testTrigramIndexPersistence()
+{
+    QTemporaryDir tmpDir;
+    QVERIFY(tmpDir.isValid());
+    const auto storagePath = tmpDir.filePath(QStringLiteral("index/trigrams"));
+
+    const auto a = QUrl::fromLocalFile(QStringLiteral("/a.cpp"));
+    const auto b = QUrl::fromLocalFile(QStringLiteral("/b.cpp"));
+    const QList<QUrl> files{a, b};
+    {
+        TrigramIndex index(storagePath);
+        index.ensureLoaded();
+        index.addFile(a.toLocalFile(), 1, 2, "findNeedle");
+        index.addFile(b.toLocalFile(), 3, 4, "haystack");
+        // the removed entry must be dropped when saving
+        index.addFile(b.toLocalFile(), 5, 6, "needle in a haystack");
+        QVERIFY(index.save());
+    }
+
+    TrigramIndex index(storagePath);
+    index.ensureLoaded();
+    QCOMPARE(index.indexedFileCount(), 2);
+    QVERIFY(index.isUpToDate(a.toLocalFile(), 1, 2));
+    QVERIFY(index.isUpToDate(b.toLocalFile(), 5, 6));
+    QCOMPARE(index.candidates(files, QStringLiteral("needle")), files);
+    QCOMPARE(index.candidates(files, QStringLiteral("hay")), QList<QUrl>{b});
+
+    // saving again only writes the changed shards, the others still match the stored files
+    const auto c = QUrl::fromLocalFile(QStringLiteral("/c.cpp"));
+    index.addFile(c.toLocalFile(), 7, 8, "xyz");
+    QVERIFY(index.save());
+    {
+        TrigramIndex reloadedIndex(storagePath);
+        reloadedIndex.ensureLoaded();
+        QCOMPARE(reloadedIndex.indexedFileCount(), 3);
+        QCOMPARE(reloadedIndex.candidates({a, b, c}, QStringLiteral("needle")), files);
+        QCOMPARE(reloadedIndex.candidates({a, b, c}, QStringLiteral("XYZ")), QList<QUrl>{c});
+    }
+
+    // a corrupted index is discarded
+    QFile file(storagePath + QLatin1String("/files"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("garbage");
+    file.close();
+    TrigramIndex corruptedIndex(storagePath);
+    corruptedIndex.ensureLoaded();
+    QCOMPARE(corruptedIndex.indexedFileCount(), 0);
+}
+
+void FindReplaceTest::testTrigramIndexStaleEntries()
+{
+    QTemporaryDir tmpDir;
+    QVERIFY(tmpDir.isValid());
+
+    const auto path = tmpDir.filePath(QStringLiteral("a.cpp"));
+    const auto url = QUrl::fromLocalFile(path);
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("int haystack();");
+    file.close();
+    const QFileInfo info(path);
+
+    TrigramIndex index(QString{});
+    index.ensureLoaded();
+    index.addFile(path, info.lastModified().toMSecsSinceEpoch(), info.size(), "int haystack();");
+    QCOMPARE(index.candidates({url}, QStringLiteral("needle")), QList<QUrl>{});
+
+    // e.g. edited while KDevelop was not running, the entry loaded from disk is outdated
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("int needle_in_a_haystack();");
+    file.close();
+    QCOMPARE(index.candidates({url}, QStringLiteral("needle")), QList<QUrl>{url});
+}
+
 void FindReplaceTest::testSingleFileAsDirectoryChoice()
 {
     QTemporaryDir tmpDir;
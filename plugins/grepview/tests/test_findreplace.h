@@ -49,6 +49,15 @@ private Q_SLOTS:
 
     void testFind();
     void testFind_data();
+    void testFindInChunks();
+    void testFindInChunks_data();
+
+    void testRequiredLiteral();
+    void testRequiredLiteral_data();
+
+    void testTrigramIndex();
+    void testTrigramIndexPersistence();
+    void testTrigramIndexStaleEntries();
 
     void testSingleFileAsDirectoryChoice();
 
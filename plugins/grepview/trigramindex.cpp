@@ -0,0 +1,500 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "trigramindex.h"
+
+#include "greputil.h"
+
+#include "debug.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+constexpr quint32 StorageMagic = 0x4b445449; // "KDTI"
+constexpr quint32 StorageVersion = 2;
+
+char foldCase(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+}
+
+TrigramIndex::TrigramIndex(const QString& storagePath)
+    : m_storagePath(storagePath)
+{
+}
+
+int TrigramIndex::shardIndex(quint32 trigram)
+{
+    // scale the upper bits of a multiplicative hash, the lower ones depend on the last character only
+    return static_cast<int>((quint64(trigram * 0x9E3779B1u) * ShardCount) >> 32);
+}
+
+QString TrigramIndex::shardPath(int shard) const
+{
+    return m_storagePath + QLatin1String("/postings-") + QString::number(shard);
+}
+
+std::vector<quint32> TrigramIndex::trigrams(QByteArrayView data)
+{
+    std::vector<quint32> ret;
+    if (data.size() < 3) {
+        return ret;
+    }
+    ret.reserve(data.size() - 2);
+
+    quint32 trigram = (quint32(quint8(foldCase(data[0]))) << 8) | quint8(foldCase(data[1]));
+    for (qsizetype i = 2; i < data.size(); ++i) {
+        trigram = ((trigram << 8) | quint8(foldCase(data[i]))) & 0xFFFFFF;
+        ret.push_back(trigram);
+    }
+
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+void TrigramIndex::ensureLoaded()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    if (!load()) {
+        clear();
+    }
+}
+
+void TrigramIndex::clear()
+{
+    m_files.clear();
+    m_fileIds.clear();
+    m_removedFiles = 0;
+    for (auto& shard : m_shards) {
+        shard.postings.clear();
+        shard.dirty = true;
+    }
+    m_postingCount = 0;
+}
+
+bool TrigramIndex::load()
+{
+    QFile file(m_storagePath + QLatin1String("/files"));
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot open trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 generation = 0;
+    stream >> magic >> version >> generation;
+    if (magic != StorageMagic || version != StorageVersion) {
+        qCDebug(PLUGIN_GREPVIEW) << "discarding trigram index with unknown format" << m_storagePath;
+        return false;
+    }
+
+    qint32 fileCount = 0;
+    stream >> fileCount;
+    if (fileCount < 0) {
+        return false;
+    }
+    m_files.resize(fileCount);
+    for (int id = 0; id < fileCount && stream.status() == QDataStream::Ok; ++id) {
+        auto& entry = m_files[id];
+        stream >> entry.path >> entry.lastModified >> entry.size >> entry.opaque;
+        m_fileIds.insert(entry.path, id);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(PLUGIN_GREPVIEW) << "discarding corrupted trigram index" << m_storagePath;
+        return false;
+    }
+
+    for (int shard = 0; shard < ShardCount; ++shard) {
+        if (!loadShard(shard, generation)) {
+            return false;
+        }
+        m_shards[shard].dirty = false;
+    }
+    m_generation = generation;
+
+    qCDebug(PLUGIN_GREPVIEW) << "loaded trigram index" << m_storagePath << "with" << fileCount << "files";
+    return true;
+}
+
+bool TrigramIndex::loadShard(int shard, quint32 generation)
+{
+    QFile file(shardPath(shard));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot open trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 shardGeneration = 0;
+    stream >> magic >> version >> shardGeneration;
+    if (magic != StorageMagic || version != StorageVersion || shardGeneration != generation) {
+        // saving was interrupted after the ids had been reassigned
+        qCDebug(PLUGIN_GREPVIEW) << "discarding inconsistent trigram index" << m_storagePath;
+        return false;
+    }
+
+    const auto fileCount = static_cast<int>(m_files.size());
+    auto& postings = m_shards[shard].postings;
+    qint32 trigramCount = 0;
+    stream >> trigramCount;
+    for (int i = 0; i < trigramCount && stream.status() == QDataStream::Ok; ++i) {
+        quint32 trigram = 0;
+        qint32 idCount = 0;
+        stream >> trigram >> idCount;
+        if (idCount < 0) {
+            return false;
+        }
+        std::vector<int> ids;
+        // the ids are stored as differences to their predecessor, which are small for common trigrams
+        qint32 id = 0;
+        for (int j = 0; j < idCount && stream.status() == QDataStream::Ok; ++j) {
+            qint32 delta = 0;
+            stream >> delta;
+            if (delta < 0 || (j > 0 && delta == 0)) {
+                return false;
+            }
+            id += delta;
+            ids.push_back(id);
+        }
+        // the shards are written before the files, so they may contain files that were added afterwards,
+        // these are indexed again
+        ids.erase(std::lower_bound(ids.begin(), ids.end(), fileCount), ids.end());
+        if (!ids.empty()) {
+            m_postingCount += ids.size();
+            postings.insert(trigram, std::move(ids));
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(PLUGIN_GREPVIEW) << "discarding corrupted trigram index" << m_storagePath;
+        return false;
+    }
+    return true;
+}
+
+bool TrigramIndex::save()
+{
+    QMutexLocker saveLock(&m_saveMutex);
+
+    QMutexLocker lock(&m_mutex);
+    if (!m_loaded) {
+        return true;
+    }
+    compact();
+    // Only the ids of these files are written to the shards, and the files are written last. That way, the
+    // stored postings of every stored file are complete, even when saving is interrupted. compact() is only
+    // called while m_saveMutex is held, so the ids do not change until the files are written.
+    const auto files = m_files;
+    const auto generation = m_generation;
+    lock.unlock();
+
+    const auto fileCount = static_cast<int>(files.size());
+    if (QFileInfo(m_storagePath).isFile()) {
+        // written as a single file by an earlier version
+        QFile::remove(m_storagePath);
+    }
+    QDir().mkpath(m_storagePath);
+
+    for (int i = 0; i < ShardCount; ++i) {
+        lock.relock();
+        auto& shard = m_shards[i];
+        if (!shard.dirty) {
+            lock.unlock();
+            continue;
+        }
+        // copy one shard at a time, so that saving needs little memory in addition to the index
+        Postings postings;
+        postings.reserve(shard.postings.size());
+        bool complete = true;
+        for (auto it = shard.postings.cbegin(), end = shard.postings.cend(); it != end; ++it) {
+            const auto idsEnd = std::lower_bound(it->begin(), it->end(), fileCount);
+            complete = complete && idsEnd == it->end();
+            if (idsEnd != it->begin()) {
+                postings.insert(it.key(), std::vector<int>(it->begin(), idsEnd));
+            }
+        }
+        // the postings of files that were added in the meantime are written the next time
+        shard.dirty = !complete;
+        lock.unlock();
+
+        if (!writeShard(i, postings, generation)) {
+            lock.relock();
+            shard.dirty = true;
+            return false;
+        }
+    }
+
+    return writeFiles(files, generation);
+}
+
+bool TrigramIndex::writeFiles(const std::vector<File>& files, quint32 generation) const
+{
+    QSaveFile file(m_storagePath + QLatin1String("/files"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot write trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << StorageMagic << StorageVersion << generation;
+    stream << qint32(files.size());
+    for (const auto& entry : files) {
+        stream << entry.path << entry.lastModified << entry.size << entry.opaque;
+    }
+
+    if (!file.commit()) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot write trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TrigramIndex::writeShard(int shard, const Postings& postings, quint32 generation) const
+{
+    QSaveFile file(shardPath(shard));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot write trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << StorageMagic << StorageVersion << generation;
+    stream << qint32(postings.size());
+    for (auto it = postings.cbegin(), end = postings.cend(); it != end; ++it) {
+        stream << it.key() << qint32(it->size());
+        qint32 previous = 0;
+        for (const int id : *it) {
+            stream << qint32(id - previous);
+            previous = id;
+        }
+    }
+
+    if (!file.commit()) {
+        qCWarning(PLUGIN_GREPVIEW) << "cannot write trigram index" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void TrigramIndex::compact()
+{
+    if (m_removedFiles == 0) {
+        return;
+    }
+
+    std::vector<int> newIds(m_files.size(), -1);
+    std::vector<File> files;
+    files.reserve(m_files.size() - m_removedFiles);
+    for (std::size_t id = 0; id < m_files.size(); ++id) {
+        if (!m_files[id].removed) {
+            newIds[id] = static_cast<int>(files.size());
+            files.push_back(std::move(m_files[id]));
+        }
+    }
+    m_files = std::move(files);
+    m_removedFiles = 0;
+    ++m_generation;
+
+    m_fileIds.clear();
+    m_fileIds.reserve(m_files.size());
+    for (std::size_t id = 0; id < m_files.size(); ++id) {
+        m_fileIds.insert(m_files[id].path, static_cast<int>(id));
+    }
+
+    m_postingCount = 0;
+    for (auto& shard : m_shards) {
+        // all ids of the stored shards are outdated now
+        shard.dirty = true;
+        for (auto it = shard.postings.begin(); it != shard.postings.end();) {
+            auto& ids = *it;
+            // the mapping preserves the order, so the ids stay sorted
+            auto out = ids.begin();
+            for (const int id : ids) {
+                if (newIds[id] != -1) {
+                    *out++ = newIds[id];
+                }
+            }
+            ids.erase(out, ids.end());
+            if (ids.empty()) {
+                it = shard.postings.erase(it);
+            } else {
+                m_postingCount += ids.size();
+                ++it;
+            }
+        }
+    }
+}
+
+bool TrigramIndex::isUpToDate(const QString& path, qint64 lastModified, qint64 size) const
+{
+    QMutexLocker lock(&m_mutex);
+    const auto id = m_fileIds.value(path, -1);
+    return id != -1 && m_files[id].lastModified == lastModified && m_files[id].size == size;
+}
+
+int TrigramIndex::addFileEntry(const QString& path, qint64 lastModified, qint64 size, bool opaque)
+{
+    // the replaced entry is only dropped by compact(), which is left to save()
+    if (const auto it = m_fileIds.constFind(path); it != m_fileIds.cend()) {
+        m_files[*it].removed = true;
+        ++m_removedFiles;
+    }
+
+    const auto id = static_cast<int>(m_files.size());
+    m_files.push_back({path, lastModified, size, opaque, false});
+    m_fileIds.insert(path, id);
+    return id;
+}
+
+void TrigramIndex::addFile(const QString& path, qint64 lastModified, qint64 size, QByteArrayView contents)
+{
+    // compute the trigrams before locking, this is the expensive part
+    const auto fileTrigrams = trigrams(contents);
+
+    QMutexLocker lock(&m_mutex);
+    if (m_postingCount + static_cast<qint64>(fileTrigrams.size()) > MaxPostingCount) {
+        addFileEntry(path, lastModified, size, true);
+        return;
+    }
+    const int id = addFileEntry(path, lastModified, size, false);
+    // new ids are larger than all previous ones, so appending keeps the postings sorted
+    for (const auto trigram : fileTrigrams) {
+        auto& shard = m_shards[shardIndex(trigram)];
+        shard.postings[trigram].push_back(id);
+        shard.dirty = true;
+    }
+    m_postingCount += fileTrigrams.size();
+}
+
+void TrigramIndex::addOpaqueFile(const QString& path, qint64 lastModified, qint64 size)
+{
+    QMutexLocker lock(&m_mutex);
+    addFileEntry(path, lastModified, size, true);
+}
+
+void TrigramIndex::removeFile(const QString& path)
+{
+    QMutexLocker lock(&m_mutex);
+    const auto it = m_fileIds.find(path);
+    if (it != m_fileIds.end()) {
+        m_files[*it].removed = true;
+        ++m_removedFiles;
+        m_fileIds.erase(it);
+    }
+}
+
+int TrigramIndex::indexedFileCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_fileIds.size();
+}
+
+TrigramIndex::Query TrigramIndex::query(const QString& literal) const
+{
+    Query ret;
+    if (literal.size() < 3 || !isAscii(literal)) {
+        return ret;
+    }
+    const auto queryTrigrams = trigrams(literal.toLatin1());
+
+    QMutexLocker lock(&m_mutex);
+    ret.allFiles = false;
+    ret.generation = m_generation;
+    ret.fileCount = static_cast<int>(m_files.size());
+
+    std::vector<const std::vector<int>*> postings;
+    postings.reserve(queryTrigrams.size());
+    for (const auto trigram : queryTrigrams) {
+        const auto& shardPostings = m_shards[shardIndex(trigram)].postings;
+        const auto it = shardPostings.constFind(trigram);
+        if (it == shardPostings.cend()) {
+            return ret;
+        }
+        postings.push_back(&*it);
+    }
+
+    // intersect the postings, starting with the shortest to keep the intermediate results small
+    std::sort(postings.begin(), postings.end(), [](const std::vector<int>* lhs, const std::vector<int>* rhs) {
+        return lhs->size() < rhs->size();
+    });
+    ret.matchingIds = *postings.front();
+    std::vector<int> intersection;
+    for (auto it = postings.begin() + 1; it != postings.end() && !ret.matchingIds.empty(); ++it) {
+        intersection.clear();
+        std::set_intersection(ret.matchingIds.begin(), ret.matchingIds.end(), (*it)->begin(), (*it)->end(),
+                              std::back_inserter(intersection));
+        ret.matchingIds.swap(intersection);
+    }
+    return ret;
+}
+
+bool TrigramIndex::mayContain(const Query& query, const QString& path) const
+{
+    if (query.allFiles) {
+        return true;
+    }
+
+    qint64 lastModified = 0;
+    qint64 size = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (query.generation != m_generation) {
+            // the ids were reassigned since the query
+            return true;
+        }
+        const auto id = m_fileIds.value(path, -1);
+        // files added since the query may contain anything
+        if (id == -1 || id >= query.fileCount || m_files[id].opaque
+            || std::binary_search(query.matchingIds.begin(), query.matchingIds.end(), id)) {
+            return true;
+        }
+        lastModified = m_files[id].lastModified;
+        size = m_files[id].size;
+    }
+
+    // The entry of an excluded file is checked against the file system outside of the lock: it is stale when
+    // the index was loaded from disk and the file was changed in between, and not indexed again yet.
+    // A file that is gone cannot contain anything.
+    const QFileInfo info(path);
+    return info.exists() && (info.lastModified().toMSecsSinceEpoch() != lastModified || info.size() != size);
+}
+
+QList<QUrl> TrigramIndex::candidates(const QList<QUrl>& files, const QString& literal) const
+{
+    const auto matches = query(literal);
+    if (matches.allFiles) {
+        return files;
+    }
+
+    QList<QUrl> ret;
+    for (const auto& url : files) {
+        if (mayContain(matches, url.toLocalFile())) {
+            ret.append(url);
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,148 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_PLUGIN_TRIGRAMINDEX_H
+#define KDEVPLATFORM_PLUGIN_TRIGRAMINDEX_H
+
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QUrl>
+
+#include <array>
+#include <vector>
+
+/**
+ * An index of the trigrams (three consecutive bytes) contained in a set of files.
+ *
+ * It answers which of these files may contain a string without opening any of them: a file that lacks
+ * one of the trigrams of the string cannot contain it. Trigrams are case-folded for ASCII letters, so the
+ * index serves case-sensitive and case-insensitive searches alike.
+ *
+ * Files that are not indexed, whose index entry was invalidated, or that are not encoded in an
+ * ASCII-compatible encoding are always reported as possible candidates. So are files whose modification
+ * time or size on disk differ from their index entry, as they changed after the index was updated.
+ *
+ * The postings are split into shards by trigram. The index is stored in a directory, with one file for the
+ * indexed files and one for each shard, and only the shards that changed are written when saving. The count
+ * of postings is limited to MaxPostingCount, files that would exceed it are added as opaque files.
+ *
+ * The index is thread-safe.
+ */
+class TrigramIndex
+{
+public:
+    /// @param storagePath the file the index is loaded from and saved to
+    explicit TrigramIndex(const QString& storagePath);
+
+    Q_DISABLE_COPY_MOVE(TrigramIndex)
+
+    /// Loads the index from its storage file unless that has happened already.
+    /// A missing or unreadable storage file results in an empty index.
+    void ensureLoaded();
+    /// Writes the changed parts of the index to its storage directory.
+    /// The index remains usable meanwhile, the files are written without holding its lock.
+    bool save();
+
+    /// @return whether @p path is indexed with the given modification time and size
+    bool isUpToDate(const QString& path, qint64 lastModified, qint64 size) const;
+
+    /// Replaces the index entry of @p path by the trigrams of @p contents.
+    /// If the postings of the index would exceed MaxPostingCount, @p path is added as an opaque file instead.
+    void addFile(const QString& path, qint64 lastModified, qint64 size, QByteArrayView contents);
+    /// Records @p path as a file that is not indexed, so that it always is a candidate, but it is up to date.
+    void addOpaqueFile(const QString& path, qint64 lastModified, qint64 size);
+    /// Invalidates the index entry of @p path, if any. Until it is added again, it is always a candidate.
+    void removeFile(const QString& path);
+
+    /// The files of the index which contain all trigrams of a literal, see query()
+    struct Query
+    {
+        /// Whether the literal is too short or contains non-ASCII characters, so that every file may contain it
+        bool allFiles = true;
+        /// The state of the index the ids below refer to
+        quint32 generation = 0;
+        int fileCount = 0;
+        std::vector<int> matchingIds;
+    };
+
+    /// Looks up which files contain all trigrams of @p literal. This only accesses memory.
+    Query query(const QString& literal) const;
+    /**
+     * @return whether the file at @p path may contain the literal of @p query
+     *
+     * Files excluded by @p query are checked against the file system, so call this on a worker thread.
+     */
+    bool mayContain(const Query& query, const QString& path) const;
+
+    /**
+     * @return the files among @p files which may contain @p literal, in the order of @p files
+     *
+     * All of @p files are returned if @p literal is too short or contains non-ASCII characters.
+     * This checks the file system like mayContain().
+     */
+    QList<QUrl> candidates(const QList<QUrl>& files, const QString& literal) const;
+
+    /// @return the count of files with an up-to-date index entry
+    int indexedFileCount() const;
+
+    /// @return the case-folded, sorted and unique trigrams of @p data
+    static std::vector<quint32> trigrams(QByteArrayView data);
+
+    /// The maximum count of file ids in all postings, which keeps the index below about 256 MiB
+    static constexpr qint64 MaxPostingCount = 64 * 1024 * 1024;
+
+private:
+    struct File
+    {
+        QString path;
+        qint64 lastModified = 0;
+        qint64 size = 0;
+        bool opaque = false;
+        bool removed = false;
+    };
+
+    /// The sorted ids of the entries that contain a trigram, by trigram
+    using Postings = QHash<quint32, std::vector<int>>;
+
+    struct Shard
+    {
+        Postings postings;
+        /// Whether the shard differs from its storage file
+        bool dirty = true;
+    };
+    static constexpr int ShardCount = 64;
+
+    static int shardIndex(quint32 trigram);
+    QString shardPath(int shard) const;
+    int addFileEntry(const QString& path, qint64 lastModified, qint64 size, bool opaque);
+    void compact();
+    void clear();
+    bool load();
+    bool loadShard(int shard, quint32 generation);
+    bool writeFiles(const std::vector<File>& files, quint32 generation) const;
+    bool writeShard(int shard, const Postings& postings, quint32 generation) const;
+
+    const QString m_storagePath;
+    mutable QMutex m_mutex;
+    /// Held by save(), so that the storage files are not written concurrently
+    QMutex m_saveMutex;
+    bool m_loaded = false;
+    /// Index entries by id. Entries are invalidated by setting File::removed, the ids are reassigned by compact().
+    std::vector<File> m_files;
+    int m_removedFiles = 0;
+    /// Incremented by compact(), so that the ids of different generations are not mixed up
+    quint32 m_generation = 0;
+    /// The ids of the valid entry of every indexed path
+    QHash<QString, int> m_fileIds;
+    /// Invalidated entries are only removed from the postings by compact().
+    std::array<Shard, ShardCount> m_shards;
+    qint64 m_postingCount = 0;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_TRIGRAMINDEX_H
@@ -0,0 +1,138 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "trigramindexjob.h"
+
+#include "greputil.h"
+#include "trigramindex.h"
+
+#include "debug.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThreadPool>
+
+namespace {
+/// Larger files are not indexed, they are most likely no source files
+constexpr qint64 MaxIndexedFileSize = 16 * 1024 * 1024;
+/// The index is saved after this many files have been indexed, so that little work is lost on interruption
+constexpr int SaveInterval = 2000;
+/// The progress is reported after this many files have been checked
+constexpr int ProgressInterval = 256;
+}
+
+TrigramIndexJob::TrigramIndexJob(std::shared_ptr<TrigramIndex> index, const QStringList& files, QObject* parent)
+    : KJob(parent)
+    , m_index(std::move(index))
+    , m_files(files)
+{
+    setCapabilities(Killable);
+}
+
+TrigramIndexJob::~TrigramIndexJob()
+{
+    Q_ASSERT(!m_running);
+}
+
+void TrigramIndexJob::start()
+{
+    setTotalAmount(Files, m_files.size());
+    m_running = true;
+    QThreadPool::globalInstance()->start([this]() {
+        run();
+        QMetaObject::invokeMethod(this, &TrigramIndexJob::finish, Qt::QueuedConnection);
+    });
+}
+
+void TrigramIndexJob::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_index->ensureLoaded();
+
+    int checkedFiles = 0;
+    int indexedFiles = 0;
+    for (const auto& path : m_files) {
+        if (m_aborted) {
+            break;
+        }
+        if (++checkedFiles % ProgressInterval == 0) {
+            QMetaObject::invokeMethod(
+                this,
+                [this, checkedFiles]() {
+                    setProcessedAmount(Files, checkedFiles);
+                },
+                Qt::QueuedConnection);
+        }
+
+        const QFileInfo info(path);
+        if (!info.isFile()) {
+            m_index->removeFile(path);
+            continue;
+        }
+        const auto lastModified = info.lastModified().toMSecsSinceEpoch();
+        const auto size = info.size();
+        if (m_index->isUpToDate(path, lastModified, size)) {
+            continue;
+        }
+
+        QFile file(path);
+        if (size > MaxIndexedFileSize || !file.open(QIODevice::ReadOnly)) {
+            m_index->addOpaqueFile(path, lastModified, size);
+            continue;
+        }
+        QByteArray buffer;
+        QByteArrayView contents;
+        if (const uchar* mapped = size > 0 ? file.map(0, size) : nullptr) {
+            contents = QByteArrayView(mapped, size);
+        } else {
+            buffer = file.readAll();
+            contents = buffer;
+        }
+        if (isAsciiCompatible(contents)) {
+            m_index->addFile(path, lastModified, size, contents);
+        } else {
+            m_index->addOpaqueFile(path, lastModified, size);
+        }
+
+        if (++indexedFiles % SaveInterval == 0) {
+            m_index->save();
+        }
+    }
+
+    // also save when aborted, the next job continues from here
+    if (indexedFiles > 0) {
+        m_index->save();
+    }
+    qCDebug(PLUGIN_GREPVIEW) << "indexed" << indexedFiles << "of" << checkedFiles << "checked files in"
+                             << timer.elapsed() << "ms" << (m_aborted ? "(aborted)" : "");
+}
+
+void TrigramIndexJob::finish()
+{
+    m_running = false;
+    if (m_aborted) {
+        setError(KilledJobError);
+    } else {
+        setProcessedAmount(Files, m_files.size());
+    }
+    emitResult();
+}
+
+bool TrigramIndexJob::doKill()
+{
+    if (!m_running) {
+        return true;
+    }
+    // let the worker stop at the next file, finish() emits the result then
+    m_aborted = true;
+    return false;
+}
+
+#include "moc_trigramindexjob.cpp"
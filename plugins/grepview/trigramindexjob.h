@@ -0,0 +1,49 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_PLUGIN_TRIGRAMINDEXJOB_H
+#define KDEVPLATFORM_PLUGIN_TRIGRAMINDEXJOB_H
+
+#include <KJob>
+
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+
+class TrigramIndex;
+
+/**
+ * Brings the entries of a list of files in a TrigramIndex up to date.
+ *
+ * The files are read in a worker thread. Files whose index entry matches their modification time and size
+ * are skipped, and the index is saved periodically, so an interrupted job is resumed by starting a new one
+ * for the same files.
+ */
+class TrigramIndexJob : public KJob
+{
+    Q_OBJECT
+
+public:
+    TrigramIndexJob(std::shared_ptr<TrigramIndex> index, const QStringList& files, QObject* parent = nullptr);
+    ~TrigramIndexJob() override;
+
+    void start() override;
+
+protected:
+    bool doKill() override;
+
+private:
+    void run();
+    void finish();
+
+    const std::shared_ptr<TrigramIndex> m_index;
+    const QStringList m_files;
+    std::atomic<bool> m_aborted = false;
+    bool m_running = false;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_TRIGRAMINDEXJOB_H
@@ -0,0 +1,174 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "trigramindexmanager.h"
+
+#include "trigramindex.h"
+#include "trigramindexjob.h"
+
+#include "debug.h"
+
+#include <QCryptographicHash>
+
+#include <KDirWatch>
+#include <KLocalizedString>
+
+#include <interfaces/icore.h>
+#include <interfaces/iplugin.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+#include <interfaces/iruncontroller.h>
+#include <interfaces/isession.h>
+#include <project/abstractfilemanagerplugin.h>
+#include <serialization/indexedstring.h>
+#include <util/path.h>
+
+using namespace KDevelop;
+
+namespace {
+QString storagePath(IPlugin* plugin, IProject* project)
+{
+    const auto projectPath = project->path().toLocalFile().toUtf8();
+    const auto fileName = QCryptographicHash::hash(projectPath, QCryptographicHash::Sha1).toHex();
+    return ICore::self()->activeSession()->pluginDataArea(plugin).toLocalFile() + QLatin1String("/trigrams/")
+        + QString::fromLatin1(fileName);
+}
+}
+
+TrigramIndexManager::TrigramIndexManager(IPlugin* plugin)
+    : QObject(plugin)
+    , m_plugin(plugin)
+{
+    // collect the changes for a moment, they tend to come in bursts, e.g. when switching git branches
+    m_pendingFilesTimer.setSingleShot(true);
+    m_pendingFilesTimer.setInterval(1000);
+    connect(&m_pendingFilesTimer, &QTimer::timeout, this, &TrigramIndexManager::startPendingJobs);
+
+    auto* const projectController = ICore::self()->projectController();
+    connect(projectController, &IProjectController::projectOpened, this, &TrigramIndexManager::projectOpened);
+    connect(projectController, &IProjectController::projectClosing, this, &TrigramIndexManager::projectClosing);
+    const auto projects = projectController->projects();
+    for (auto* const project : projects) {
+        projectOpened(project);
+    }
+}
+
+TrigramIndexManager::~TrigramIndexManager()
+{
+    abortJobs();
+}
+
+QList<std::shared_ptr<TrigramIndex>> TrigramIndexManager::indexes() const
+{
+    QList<std::shared_ptr<TrigramIndex>> ret;
+    ret.reserve(m_projects.size());
+    for (const auto& project : m_projects) {
+        ret.append(project.index);
+    }
+    return ret;
+}
+
+void TrigramIndexManager::abortJobs()
+{
+    m_pendingFilesTimer.stop();
+    for (auto& project : m_projects) {
+        if (project.job) {
+            project.job->kill();
+        }
+    }
+}
+
+void TrigramIndexManager::projectOpened(IProject* project)
+{
+    if (!project->path().isLocalFile() || m_projects.contains(project)) {
+        return;
+    }
+
+    auto& projectIndex = m_projects[project];
+    projectIndex.index = std::make_shared<TrigramIndex>(storagePath(m_plugin, project));
+
+    if (auto* const manager = qobject_cast<AbstractFileManagerPlugin*>(project->managerPlugin())) {
+        if (auto* const watcher = manager->projectWatcher(project)) {
+            connect(watcher, &KDirWatch::dirty, this, [this, project](const QString& path) {
+                fileChanged(project, path);
+            });
+            connect(watcher, &KDirWatch::created, this, [this, project](const QString& path) {
+                fileChanged(project, path);
+            });
+            connect(watcher, &KDirWatch::deleted, this, [this, project](const QString& path) {
+                fileDeleted(project, path);
+            });
+        }
+    }
+
+    const auto fileSet = project->fileSet();
+    QStringList files;
+    files.reserve(fileSet.size());
+    for (const auto& file : fileSet) {
+        files.append(file.str());
+    }
+    startJob(project, files);
+}
+
+void TrigramIndexManager::projectClosing(IProject* project)
+{
+    const auto projectIndex = m_projects.take(project);
+    if (projectIndex.job) {
+        projectIndex.job->kill();
+    }
+}
+
+void TrigramIndexManager::fileChanged(IProject* project, const QString& path)
+{
+    const auto it = m_projects.find(project);
+    // new files are not part of the project model yet, so accept all files below the project directory
+    if (it == m_projects.end() || !project->path().isParentOf(Path(path))) {
+        return;
+    }
+    // searches must not rely on the outdated entry until the file has been indexed again
+    it->index->removeFile(path);
+    it->pendingFiles.insert(path);
+    m_pendingFilesTimer.start();
+}
+
+void TrigramIndexManager::fileDeleted(IProject* project, const QString& path)
+{
+    const auto it = m_projects.find(project);
+    if (it == m_projects.end()) {
+        return;
+    }
+    it->index->removeFile(path);
+    it->pendingFiles.remove(path);
+}
+
+void TrigramIndexManager::startPendingJobs()
+{
+    for (auto it = m_projects.begin(), end = m_projects.end(); it != end; ++it) {
+        if (!it->job && !it->pendingFiles.isEmpty()) {
+            const QStringList files(it->pendingFiles.cbegin(), it->pendingFiles.cend());
+            it->pendingFiles.clear();
+            startJob(it.key(), files);
+        }
+    }
+}
+
+void TrigramIndexManager::startJob(IProject* project, const QStringList& files)
+{
+    auto& projectIndex = m_projects[project];
+    Q_ASSERT(!projectIndex.job);
+
+    auto* const job = new TrigramIndexJob(projectIndex.index, files);
+    job->setObjectName(i18nc("@info:progress", "Indexing %1 for text search", project->name()));
+    projectIndex.job = job;
+    connect(job, &KJob::finished, this, [this, project]() {
+        if (m_projects.contains(project) && !m_projects[project].pendingFiles.isEmpty()) {
+            m_pendingFilesTimer.start();
+        }
+    });
+    ICore::self()->runController()->registerJob(job);
+}
+
+#include "moc_trigramindexmanager.cpp"
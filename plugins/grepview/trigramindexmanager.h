@@ -0,0 +1,68 @@
+/*
+    SPDX-FileCopyrightText: 2026 the KDevelop Team
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KDEVPLATFORM_PLUGIN_TRIGRAMINDEXMANAGER_H
+#define KDEVPLATFORM_PLUGIN_TRIGRAMINDEXMANAGER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+
+#include <memory>
+
+namespace KDevelop {
+class IPlugin;
+class IProject;
+}
+class TrigramIndex;
+class TrigramIndexJob;
+
+/**
+ * Maintains a TrigramIndex for each open project.
+ *
+ * The index of a project is stored in the session's data area of the grepview plugin. It is brought up to
+ * date when the project is opened and then follows the changes reported by the KDirWatch of the project's
+ * AbstractFileManagerPlugin.
+ */
+class TrigramIndexManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrigramIndexManager(KDevelop::IPlugin* plugin);
+    ~TrigramIndexManager() override;
+
+    /// @return the indexes of all open projects
+    QList<std::shared_ptr<TrigramIndex>> indexes() const;
+
+    /// Aborts the running index jobs, their progress is kept for the next session.
+    void abortJobs();
+
+private:
+    void projectOpened(KDevelop::IProject* project);
+    void projectClosing(KDevelop::IProject* project);
+    void fileChanged(KDevelop::IProject* project, const QString& path);
+    void fileDeleted(KDevelop::IProject* project, const QString& path);
+    void startPendingJobs();
+    void startJob(KDevelop::IProject* project, const QStringList& files);
+
+    struct ProjectIndex
+    {
+        std::shared_ptr<TrigramIndex> index;
+        QPointer<TrigramIndexJob> job;
+        /// Changed files which are to be indexed once the running job, if any, has finished
+        QSet<QString> pendingFiles;
+    };
+
+    KDevelop::IPlugin* const m_plugin;
+    QHash<KDevelop::IProject*, ProjectIndex> m_projects;
+    QTimer m_pendingFilesTimer;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_TRIGRAMINDEXMANAGER_H
@@ -116,12 +116,12 @@ public:
     uint unfilteredItemCount() const override;
     KDevelop::QuickOpenDataPointer data(uint row) const override;
 
-    inline KDevelop::Path itemPath(const ProjectFile& data) const
+    inline const KDevelop::Path& itemPath(const ProjectFile& data) const
     {
         return data.path;
     }
 
-    inline KDevelop::Path itemPrefixPath(const ProjectFile& data) const
+    inline const KDevelop::Path& itemPrefixPath(const ProjectFile& data) const
     {
         return data.projectPath;
     }
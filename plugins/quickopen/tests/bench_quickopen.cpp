@@ -174,6 +174,39 @@ void BenchQuickOpen::benchProjectFileFilter_setFilter_data()
     getData();
 }
 
+void BenchQuickOpen::benchProjectFileFilter_typeFilter()
+{
+    QFETCH(int, files);
+    QFETCH(QString, filter);
+
+    ProjectFileDataProvider provider;
+    TestProject* project = getProjectWithFiles(files);
+
+    projectController->addProject(project);
+
+    provider.reset();
+
+    // simulate typing the filter character by character, each keystroke filters incrementally
+    QBENCHMARK {
+        for (int length = 1; length <= filter.size(); ++length) {
+            provider.setFilterText(filter.left(length));
+        }
+        provider.setFilterText(QString());
+    }
+}
+
+void BenchQuickOpen::benchProjectFileFilter_typeFilter_data()
+{
+    QTest::addColumn<int>("files");
+    QTest::addColumn<QString>("filter");
+
+    for (auto files : { 10000, 50000 }) {
+        for (auto pattern : { "9.txt", "f/b/12", "fbar", "nomatch" }) {
+            QTest::addRow("%6d-%s", files, pattern) << files << QString::fromUtf8(pattern);
+        }
+    }
+}
+
 void BenchQuickOpen::benchProjectFileFilter_providerData()
 {
     QFETCH(int, files);
@@ -12,6 +12,7 @@
 #include <QTest>
 #include <QTemporaryFile>
 
+#include <algorithm>
 #include <type_traits>
 #include <utility>
 
@@ -163,6 +164,65 @@ void TestQuickOpen::testAbbreviations_data()
     QTest::newRow("path_segment_multi_mixed") << items << "ftfoo.h" << StringList({ items.at(2) });
 }
 
+void TestQuickOpen::testSubsequenceFilter()
+{
+    QFETCH(QString, word);
+    QFETCH(QString, filter);
+    QFETCH(bool, mayMatch);
+
+    const SubsequenceFilter subsequenceFilter(filter.split('/', Qt::SkipEmptyParts));
+    QCOMPARE(subsequenceFilter.mayMatch(word), mayMatch);
+    QCOMPARE(subsequenceFilter.mayMatch(Path(word)), mayMatch);
+}
+
+void TestQuickOpen::testSubsequenceFilter_data()
+{
+    QTest::addColumn<QString>("word");
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<bool>("mayMatch");
+
+    QTest::newRow("substring") << "/foo/bar/caz/a.h" << "caz" << true;
+    QTest::newRow("case insensitive") << "/KateThing/CMakeLists.txt" << "kate/cmli" << true;
+    QTest::newRow("wrong order") << "/foo/bar/caz/a.h" << "zac" << false;
+    QTest::newRow("missing character") << "/foo/bar/caz/a.h" << "fooq" << false;
+    QTest::newRow("repeated character") << "/foo/bar.h" << "fooo" << false;
+    QTest::newRow("empty filter") << "/foo/bar.h" << "" << true;
+    QTest::newRow("non-ASCII filter") << "/foo/bar.h" << QStringLiteral("f\u00e4") << true;
+    // the Kelvin sign matches 'k' case-insensitively
+    QTest::newRow("non-ASCII word") << QStringLiteral("/\u212Aate.h") << "kate" << true;
+}
+
+void TestQuickOpen::testLargePathFilter()
+{
+    // enough items to be filtered concurrently, the result must not depend on that
+    StringList items;
+    for (int i = 0; i < 20000; ++i) {
+        items << QStringLiteral("/home/user/project/dir%1/file%2.cpp").arg(i % 97).arg(i);
+    }
+    const QStringList filter{QStringLiteral("dir1"), QStringLiteral("fi12")};
+
+    QVector<QPair<int, int>> expectedMatches;
+    for (int i = 0; i < items.size(); ++i) {
+        const auto quality = matchPathFilter(Path(items.at(i)), filter, Path(QStringLiteral("/home/user/project")));
+        if (quality != -1) {
+            expectedMatches.push_back({quality, i});
+        }
+    }
+    std::stable_sort(expectedMatches.begin(), expectedMatches.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+    StringList expected;
+    for (const auto& match : std::as_const(expectedMatches)) {
+        expected << items.at(match.second);
+    }
+    QVERIFY(!expected.isEmpty());
+
+    PathTestFilter filterItems;
+    filterItems.setItems(items);
+    filterItems.setFilter(filter);
+    QCOMPARE(filterItems.filteredItems(), expected);
+}
+
 void TestQuickOpen::testSorting()
 {
     QFETCH(StringList, items);
@@ -22,6 +22,9 @@ private Q_SLOTS:
     void testStableSort();
     void testAbbreviations();
     void testAbbreviations_data();
+    void testSubsequenceFilter();
+    void testSubsequenceFilter_data();
+    void testLargePathFilter();
     void testDuchainFilter();
     void testDuchainFilter_data();
 